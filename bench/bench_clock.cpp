@@ -0,0 +1,118 @@
+/**
+ * 时钟微基准: steady_clock vs TSC
+ *
+ * 1. 单次调用开销: steady_now_ns() / now_ns() (TSC 换算) / 裸 rdtsc / rdtscp
+ * 2. 准确性: skew_sec 秒内 now_ns() 相对 steady_clock 的偏差 (校准误差 + 漂移)，
+ *    对比只用初次校准锚点 (漂移累积) 和每秒 maybe_reanchor() 重新对齐两种情况
+ * 3. 服务时间模拟: 与 WorkloadSimulator::process 相同的忙等循环，分别以两种时钟
+ *    自旋 target μs，用另一侧时钟测量实际耗时的超出量
+ *
+ * 用法: ./bench_clock [calls=10000000] [spin_us=10] [skew_sec=8]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/common/metrics.h"
+#include "../src/common/types.h"
+
+using namespace malcolm;
+
+namespace {
+
+void print_row(const char* name, const LatencyHistogram& h) {
+    printf("%-28s %10.1f %10ld %10ld %10ld %10ld\n", name, h.mean(),
+           h.percentile(50.0), h.percentile(99.0), h.percentile(99.9), h.max());
+}
+
+/// 连续调用 calls 次，返回平均每次耗时 (ns，以 steady_clock 计时)
+template<typename Clock>
+double per_call_ns(size_t calls, Clock clock) {
+    volatile uint64_t sink = 0;
+    uint64_t start = steady_now_ns();
+    for (size_t i = 0; i < calls; ++i) {
+        sink = sink + clock();
+    }
+    return static_cast<double>(steady_now_ns() - start) / static_cast<double>(calls);
+}
+
+/// 以 clock 忙等 spin_ns (与 WorkloadSimulator::process 相同的循环)，用 steady_clock 测实际耗时
+template<typename Clock>
+void spin_overshoot(size_t rounds, Timestamp spin_ns, Clock clock, LatencyHistogram& overshoot) {
+    for (size_t i = 0; i < rounds; ++i) {
+        uint64_t begin = steady_now_ns();
+        Timestamp target = clock() + spin_ns;
+        while (clock() < target) {
+            asm volatile("pause" ::: "memory");
+        }
+        uint64_t elapsed = steady_now_ns() - begin;
+        overshoot.record(static_cast<int64_t>(elapsed > spin_ns ? elapsed - spin_ns : 0));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000'000;
+    Timestamp spin_ns = us_to_ns(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10);
+    uint64_t skew_sec = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+
+    const tsc_clock::Calibration& cal = tsc_clock::calibration();
+    printf("invariant TSC: %s, now_ns() source: %s",
+           tsc_clock::has_invariant_tsc() ? "yes" : "no", cal.enabled ? "TSC" : "steady_clock");
+    if (cal.enabled) {
+        printf(" (%.4f GHz)", cal.ghz);
+    }
+    printf("\n");
+
+    printf("\nper-call cost over %zu calls (ns)\n", calls);
+    printf("  steady_clock : %6.2f\n", per_call_ns(calls, [] { return steady_now_ns(); }));
+    printf("  now_ns()     : %6.2f\n", per_call_ns(calls, [] { return now_ns(); }));
+    printf("  rdtsc        : %6.2f\n", per_call_ns(calls, [] { return tsc_clock::rdtsc(); }));
+    printf("  rdtscp       : %6.2f\n", per_call_ns(calls, [] { return tsc_clock::rdtscp(); }));
+
+    // 偏差: 每 10ms 比较一次，按秒输出该秒内的最大偏差
+    if (cal.enabled && skew_sec > 0) {
+        printf("\nskew vs steady_clock, max per second (ns)\n");
+        printf("%6s %16s %16s\n", "sec", "initial anchor", "reanchored");
+        int64_t worst_fixed = 0, worst_now = 0;
+        for (uint64_t sec = 1; sec <= skew_sec; ++sec) {
+            int64_t max_fixed = 0, max_now = 0;
+            uint64_t end = steady_now_ns() + ms_to_ns(1000);
+            while (steady_now_ns() < end) {
+                tsc_clock::maybe_reanchor();   // 与周期线程的调用方式相同
+                uint64_t a = steady_now_ns();
+                uint64_t tsc = tsc_clock::rdtsc();
+                uint64_t t = now_ns();
+                uint64_t b = steady_now_ns();
+                uint64_t next = b + ms_to_ns(10);
+                if (b - a > us_to_ns(1)) {
+                    continue;   // 读数之间被中断 / 抢占，丢弃该样本
+                }
+                int64_t mid = static_cast<int64_t>(a + (b - a) / 2);
+                int64_t fixed = static_cast<int64_t>(tsc_clock::convert(cal.anchor, tsc)) - mid;
+                int64_t skew = static_cast<int64_t>(t) - mid;
+                if (std::llabs(fixed) > std::llabs(max_fixed)) max_fixed = fixed;
+                if (std::llabs(skew) > std::llabs(max_now)) max_now = skew;
+                while (steady_now_ns() < next) {}
+            }
+            printf("%6lu %16ld %16ld\n", sec, max_fixed, max_now);
+            if (std::llabs(max_fixed) > std::llabs(worst_fixed)) worst_fixed = max_fixed;
+            if (std::llabs(max_now) > std::llabs(worst_now)) worst_now = max_now;
+        }
+        printf("max |now_ns() - steady_clock| over %lus: %ld ns (initial anchor only: %ld ns)\n",
+               skew_sec, worst_now, worst_fixed);
+    }
+
+    // 服务时间模拟的超出量
+    constexpr size_t kRounds = 20'000;
+    LatencyHistogram steady_spin, tsc_spin;
+    spin_overshoot(kRounds, spin_ns, [] { return steady_now_ns(); }, steady_spin);
+    spin_overshoot(kRounds, spin_ns, [] { return now_ns(); }, tsc_spin);
+    printf("\nsimulated service time overshoot, target %.0f us (ns)\n", ns_to_us(spin_ns));
+    printf("%-28s %10s %10s %10s %10s %10s\n", "spin clock", "mean", "P50", "P99", "P99.9", "max");
+    print_row("steady_clock", steady_spin);
+    print_row("now_ns()", tsc_spin);
+
+    return 0;
+}
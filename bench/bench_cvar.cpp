@@ -0,0 +1,134 @@
+/**
+ * CVaR 计算微基准
+ *
+ * 对比一次调度决策中对所有 Worker 计算 CVaR 的开销:
+ *   - sort   : 每个 Worker 拷贝到新 std::vector 再 std::sort (旧实现)
+ *   - select : compute_cvar_batch() — 单调检查 + 按下标取值，否则 nth_element
+ *
+ * 输入分两种: monotone (分位数非递减，IQN 的常见输出) 和 shuffled (打乱顺序，
+ * 走 nth_element 回退路径)。每种组合先与旧实现比对结果，再测量延迟。
+ *
+ * 用法: ./bench_cvar [iterations=200000] [alpha=0.95]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../src/common/metrics.h"
+#include "../src/scheduler/cvar.h"
+#include "../src/scheduler/malcolm_strict_scheduler.h"
+
+using namespace malcolm;
+
+namespace {
+
+constexpr size_t kQuantiles = MalcolmStrictScheduler::kNumQuantileSamples;
+
+/// 旧实现: 逐个 push_back 到新 vector 后完整排序
+CVaREstimate cvar_sort(const float* quantiles, double alpha) {
+    CVaREstimate result{0.0, 0.0, 0.0};
+
+    std::vector<float> sorted_q;
+    for (size_t i = 0; i < kQuantiles; ++i) {
+        sorted_q.push_back(quantiles[i]);
+    }
+    std::sort(sorted_q.begin(), sorted_q.end());
+
+    result.mean = std::accumulate(sorted_q.begin(), sorted_q.end(), 0.0f) / kQuantiles;
+
+    size_t var_idx = static_cast<size_t>(alpha * kQuantiles);
+    result.var = sorted_q[var_idx];
+
+    double cvar_sum = 0.0;
+    size_t cvar_count = 0;
+    for (size_t i = var_idx; i < kQuantiles; ++i) {
+        cvar_sum += sorted_q[i];
+        ++cvar_count;
+    }
+    result.cvar = cvar_count > 0 ? cvar_sum / cvar_count : result.var;
+    return result;
+}
+
+/// 随机延迟分位数 (ns)，monotone=false 时打乱每个 Worker 内部的顺序
+std::vector<float> make_quantiles(size_t workers, bool monotone, std::mt19937& rng) {
+    std::lognormal_distribution<float> dist(10.0f, 0.8f);
+    std::vector<float> q(workers * kQuantiles);
+    for (size_t w = 0; w < workers; ++w) {
+        float* row = &q[w * kQuantiles];
+        for (size_t i = 0; i < kQuantiles; ++i) row[i] = dist(rng);
+        std::sort(row, row + kQuantiles);
+        if (!monotone) std::shuffle(row, row + kQuantiles, rng);
+    }
+    return q;
+}
+
+double rel_err(double a, double b) {
+    return std::fabs(a - b) / std::max(std::fabs(b), 1.0);
+}
+
+void print_row(const char* name, const LatencyHistogram& h) {
+    printf("%-28s %10.1f %10ld %10ld %10ld %10ld\n", name, h.mean(),
+           h.percentile(50.0), h.percentile(99.0), h.percentile(99.9), h.max());
+}
+
+bool run(size_t workers, bool monotone, size_t iters, double alpha, std::mt19937& rng) {
+    std::vector<float> q = make_quantiles(workers, monotone, rng);
+    std::vector<CVaREstimate> out(workers);
+
+    // 一致性: 与旧实现逐 Worker 比对
+    compute_cvar_batch(q.data(), workers, kQuantiles, alpha, out.data());
+    double max_rel = 0.0;
+    for (size_t w = 0; w < workers; ++w) {
+        CVaREstimate ref = cvar_sort(&q[w * kQuantiles], alpha);
+        max_rel = std::max({max_rel, rel_err(out[w].mean, ref.mean),
+                            rel_err(out[w].var, ref.var), rel_err(out[w].cvar, ref.cvar)});
+    }
+    bool ok = max_rel < 1e-5;
+
+    // 同一次决策内两种实现交替运行，避免频率漂移偏向一方
+    LatencyHistogram sort_hist, select_hist;
+    volatile double sink = 0.0;
+    for (size_t it = 0; it < iters; ++it) {
+        Timestamp start = now_ns();
+        for (size_t w = 0; w < workers; ++w) {
+            sink = sink + cvar_sort(&q[w * kQuantiles], alpha).cvar;
+        }
+        Timestamp mid = now_ns();
+        compute_cvar_batch(q.data(), workers, kQuantiles, alpha, out.data());
+        sink = sink + out[0].cvar;
+        Timestamp end = now_ns();
+        sort_hist.record(static_cast<int64_t>(mid - start));
+        select_hist.record(static_cast<int64_t>(end - mid));
+    }
+
+    printf("\n%zu workers, %s quantiles (max rel err %.1e, %s)\n", workers,
+           monotone ? "monotone" : "shuffled", max_rel, ok ? "OK" : "FAIL");
+    print_row("sort", sort_hist);
+    print_row("select", select_hist);
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iters = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200'000;
+    double alpha = argc > 2 ? std::atof(argv[2]) : MalcolmStrictScheduler::kDefaultCVaRAlpha;
+
+    printf("CVaR over %zu quantiles per worker, alpha=%.2f, SIMD=%s\n",
+           kQuantiles, alpha, simd_isa_name());
+    printf("%-28s %10s %10s %10s %10s %10s\n", "per decision (ns)", "mean", "P50", "P99", "P99.9", "max");
+
+    std::mt19937 rng(42);
+    bool ok = true;
+    for (size_t workers : {5, 16, 64}) {
+        for (bool monotone : {true, false}) {
+            ok = run(workers, monotone, iters, alpha, rng) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
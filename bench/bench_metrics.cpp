@@ -0,0 +1,153 @@
+/**
+ * 多线程指标记录压力测试
+ *
+ * writers 个线程同时向同一个 ConcurrentMetricsCollector 记录，join 后检查:
+ *   - 合并后的 E2E 直方图样本数、请求数、违约数、各 Worker 直方图样本数都与写入总数完全相等
+ *   - 中途 reset() (模拟预热结束) 之前的记录全部被丢弃
+ *   - 另一个线程在写入期间不断 sample_into() 区间直方图，各区间样本数之和与写入总数相等
+ *   - 写入在 ThroughputCounter 窗口 (1s) 内完成时，窗口计数与写入总数相等
+ * 同时给出单次记录的平均耗时和 ThroughputCounter 的 RPS。
+ *
+ * 用法: ./bench_metrics [writers=16] [records_per_writer=1000000]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/common/metrics.h"
+
+using namespace malcolm;
+
+namespace {
+
+RequestTrace make_trace(uint64_t id, std::mt19937_64& rng) {
+    std::lognormal_distribution<double> latency(11.0, 1.0);  // 中位数约 60μs
+    RequestTrace t{};
+    t.request_id = id;
+    t.t1_client_send = 1'000'000;
+    t.t2_lb_receive = t.t1_client_send + 2'000;
+    t.t3_lb_dispatch = t.t2_lb_receive + 500;
+    t.t4_worker_recv = t.t3_lb_dispatch + 2'000;
+    t.t5_worker_done = t.t4_worker_recv + static_cast<Timestamp>(latency(rng));
+    t.t6_lb_response = t.t5_worker_done + 2'000;
+    t.t7_client_recv = t.t6_lb_response + 2'000;
+    t.deadline = t.t1_client_send + us_to_ns(100);
+    t.target_worker_id = static_cast<uint8_t>(id % MetricsCollector::kMaxWorkers);
+    return t;
+}
+
+/// 所有线程同时开始写入，返回平均每次记录耗时 (ns)
+double run_writers(size_t writers, size_t per_writer, ConcurrentMetricsCollector& metrics,
+                   ThroughputCounter* throughput, IntervalHistogram* interval, uint64_t& misses) {
+    std::atomic<size_t> ready{0};
+    std::atomic<uint64_t> total_misses{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w]() {
+            std::mt19937_64 rng(w + 1);
+            std::vector<RequestTrace> traces;
+            traces.reserve(1024);
+            for (size_t i = 0; i < 1024; ++i) traces.push_back(make_trace(w * per_writer + i, rng));
+            uint64_t local_misses = 0;
+
+            ready.fetch_add(1);
+            while (ready.load() < writers) std::this_thread::yield();
+
+            Timestamp start = now_ns();
+            for (size_t i = 0; i < per_writer; ++i) {
+                const RequestTrace& t = traces[i % traces.size()];
+                metrics.record_request(t);
+                if (t.is_deadline_miss()) ++local_misses;
+                if (throughput) throughput->record();
+                if (interval) interval->record(static_cast<int64_t>(t.e2e_latency_ns()));
+            }
+            total_ns.fetch_add(now_ns() - start);
+            total_misses.fetch_add(local_misses);
+        });
+    }
+    for (auto& t : threads) t.join();
+    misses = total_misses.load();
+    return static_cast<double>(total_ns.load()) / static_cast<double>(writers * per_writer);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t writers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    size_t per_writer = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1'000'000;
+    uint64_t expected = static_cast<uint64_t>(writers) * per_writer;
+
+    ConcurrentMetricsCollector metrics;
+    ThroughputCounter throughput;
+    uint64_t misses = 0;
+
+    // 预热阶段的记录应在 reset() 后全部丢弃
+    run_writers(writers, per_writer / 10 + 1, metrics, nullptr, nullptr, misses);
+    metrics.reset();
+
+    // 写入期间持续采样区间直方图 (与 IntervalMetricsLog 的日志线程相同的用法)
+    IntervalHistogram interval;
+    std::atomic<bool> writing{true};
+    uint64_t interval_total = 0;
+    uint64_t intervals = 0;
+    std::thread sampler([&]() {
+        LatencyHistogram scratch;
+        bool last = false;
+        while (!last) {
+            last = !writing.load();
+            scratch.reset();
+            interval.sample_into(scratch);
+            interval_total += static_cast<uint64_t>(scratch.total_count());
+            ++intervals;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    Timestamp write_start = now_ns();
+    double ns_per_record = run_writers(writers, per_writer, metrics, &throughput, &interval, misses);
+    Timestamp write_ns = now_ns() - write_start;
+    writing.store(false);
+    sampler.join();
+
+    MetricsCollector merged;
+    metrics.merge_into(merged);
+    uint64_t per_worker = 0;
+    for (size_t i = 0; i < MetricsCollector::kMaxWorkers; ++i) {
+        per_worker += static_cast<uint64_t>(merged.worker_latency(i).total_count());
+    }
+
+    bool ok = true;
+    auto check = [&](const char* name, uint64_t got, uint64_t want) {
+        bool match = got == want;
+        ok = ok && match;
+        printf("  %-22s %12lu / %12lu  %s\n", name, got, want, match ? "OK" : "FAIL");
+    };
+    printf("%zu writers x %zu records (after discarding a warmup round via reset())\n",
+           writers, per_writer);
+    check("e2e histogram count", static_cast<uint64_t>(merged.e2e_latency().total_count()), expected);
+    check("lb overhead count", static_cast<uint64_t>(merged.lb_overhead().total_count()), expected);
+    check("per-worker counts", per_worker, expected);
+    check("total requests", merged.total_requests(), expected);
+    check("deadline misses", merged.deadline_misses(), misses);
+    check("interval sample sum", interval_total, expected);
+    // 写入在窗口内完成时 (跨越的时间桶不超过窗口) 计数器应看到全部记录
+    Timestamp window_ns = ThroughputCounter::kWindowSize * ThroughputCounter::kBucketDurationNs;
+    if (write_ns + ThroughputCounter::kBucketDurationNs < window_ns) {
+        check("throughput window", throughput.window_count(), expected);
+    } else {
+        printf("  %-22s %12s (writes took %.2fs, longer than the window)\n",
+               "throughput window", "skipped", write_ns / 1e9);
+    }
+    printf("  intervals sampled      %12lu\n", intervals);
+    printf("  avg record cost        %12.1f ns (record_request + ThroughputCounter + interval)\n",
+           ns_per_record);
+    printf("  throughput counter     %12.0f rps over its 1s window\n", throughput.get_rps());
+
+    return ok ? 0 : 1;
+}
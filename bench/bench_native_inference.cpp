@@ -0,0 +1,344 @@
+/**
+ * 原生 SIMD 推理引擎: 一致性检查 + 延迟基准
+ *
+ * 两种用法:
+ *   ./bench_native_inference synthetic [num_workers=16] [hidden=256] [iterations=100000]
+ *       生成随机权重的 IQN 模型 (与 Malcolm-Strict 状态维度一致)，
+ *       与朴素双精度参考实现比对输出，再测量前向传播和完整 schedule() 的延迟
+ *
+ *   ./bench_native_inference <model.bin> [iterations=100000] [model.pt]
+ *       测量导出模型的前向延迟; 以 USE_LIBTORCH 构建且给出 .pt 时，
+ *       在相同随机输入上与 LibTorch 比对输出并测量 LibTorch 延迟
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/common/metrics.h"
+#include "../src/inference/native_model.h"
+#include "../src/scheduler/malcolm_strict_scheduler.h"
+
+#ifdef USE_LIBTORCH
+#include <torch/script.h>
+#endif
+
+using namespace malcolm;
+
+namespace {
+
+constexpr size_t kQuantiles = MalcolmStrictScheduler::kNumQuantileSamples;
+
+struct Layer {
+    size_t in, out;
+    uint32_t act;
+    std::vector<float> w, b;
+};
+
+using Block = std::vector<Layer>;
+
+Layer random_layer(std::mt19937& rng, size_t in, size_t out, uint32_t act) {
+    // He 初始化，保持各层激活量级稳定
+    std::normal_distribution<float> dist(0.0f, std::sqrt(2.0f / in));
+    Layer l{in, out, act, std::vector<float>(in * out), std::vector<float>(out)};
+    for (auto& v : l.w) v = dist(rng);
+    for (auto& v : l.b) v = 0.1f * dist(rng);
+    return l;
+}
+
+void write_block(std::FILE* f, const Block& block) {
+    uint32_t n = static_cast<uint32_t>(block.size());
+    std::fwrite(&n, sizeof(n), 1, f);
+    for (const auto& l : block) {
+        uint32_t hdr[3] = {static_cast<uint32_t>(l.in), static_cast<uint32_t>(l.out), l.act};
+        std::fwrite(hdr, sizeof(uint32_t), 3, f);
+        std::fwrite(l.w.data(), sizeof(float), l.w.size(), f);
+        std::fwrite(l.b.data(), sizeof(float), l.b.size(), f);
+    }
+}
+
+std::vector<double> reference_mlp(const Block& block, std::vector<double> x) {
+    for (const auto& l : block) {
+        std::vector<double> y(l.out);
+        for (size_t r = 0; r < l.out; ++r) {
+            double acc = l.b[r];
+            for (size_t i = 0; i < l.in; ++i) acc += static_cast<double>(l.w[r * l.in + i]) * x[i];
+            y[r] = (l.act == NativeDense::kReLU && acc < 0.0) ? 0.0 : acc;
+        }
+        x = std::move(y);
+    }
+    return x;
+}
+
+/// 朴素双精度 IQN 参考实现，输出 [W][Q]
+std::vector<double> reference_iqn(const Block& state_net, const Block& cos_net, const Block& head,
+                                  const std::vector<float>& state, const std::vector<float>& taus) {
+    std::vector<double> h = reference_mlp(state_net, std::vector<double>(state.begin(), state.end()));
+    size_t n_cos = cos_net[0].in;
+    size_t outputs = head.back().out;
+    std::vector<double> out(outputs * taus.size());
+    for (size_t q = 0; q < taus.size(); ++q) {
+        std::vector<double> cos(n_cos);
+        for (size_t i = 0; i < n_cos; ++i) {
+            cos[i] = std::cos(M_PI * static_cast<double>(i) * taus[q]);
+        }
+        std::vector<double> phi = reference_mlp(cos_net, cos);
+        for (size_t j = 0; j < phi.size(); ++j) phi[j] *= h[j];
+        std::vector<double> z = reference_mlp(head, phi);
+        for (size_t w = 0; w < outputs; ++w) out[w * taus.size() + q] = z[w];
+    }
+    return out;
+}
+
+std::vector<float> scheduler_quantiles() {
+    // 与 MalcolmStrictScheduler::generate_quantile_samples() 相同
+    std::vector<float> taus(kQuantiles);
+    for (size_t i = 0; i < kQuantiles; ++i) {
+        double base = static_cast<double>(i + 1) / (kQuantiles + 1);
+        if (i >= kQuantiles * 0.8) {
+            base = 0.9 + 0.1 * (i - kQuantiles * 0.8) / (kQuantiles * 0.2);
+        }
+        taus[i] = static_cast<float>(base);
+    }
+    return taus;
+}
+
+std::vector<float> random_state(std::mt19937& rng, size_t dim) {
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::vector<float> s(dim);
+    for (auto& v : s) v = dist(rng);
+    return s;
+}
+
+void print_row(const char* name, const LatencyHistogram& h) {
+    printf("%-28s %10.1f %10ld %10ld %10ld %10ld\n", name, h.mean(),
+           h.percentile(50.0), h.percentile(99.0), h.percentile(99.9), h.max());
+}
+
+void print_header() {
+    printf("%-28s %10s %10s %10s %10s %10s\n", "latency (ns)", "mean", "P50", "P99", "P99.9", "max");
+}
+
+std::vector<WorkerState> make_workers(size_t n, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> queue(0, 20);
+    std::vector<WorkerState> workers(n, WorkerState{});
+    for (size_t i = 0; i < n; ++i) {
+        auto& ws = workers[i];
+        ws.worker_id = static_cast<uint8_t>(i);
+        ws.is_healthy = true;
+        ws.capacity_factor = 1.0;
+        ws.queue_length = queue(rng);
+        ws.load_ema = ws.queue_length;
+        ws.avg_service_time = us_to_ns(10);
+        for (auto& b : ws.slack_histogram) b = queue(rng);
+    }
+    return workers;
+}
+
+int run_synthetic(size_t num_workers, size_t hidden, size_t iters) {
+    std::mt19937 rng(42);
+    size_t state_dim = 4 + num_workers * (7 + constants::kSlackHistogramBins);
+    constexpr size_t kNumCos = 64;
+
+    Block state_net = {random_layer(rng, state_dim, hidden, NativeDense::kReLU),
+                       random_layer(rng, hidden, hidden, NativeDense::kReLU)};
+    Block cos_net = {random_layer(rng, kNumCos, hidden, NativeDense::kReLU)};
+    Block head = {random_layer(rng, hidden, hidden, NativeDense::kReLU),
+                  random_layer(rng, hidden, num_workers, NativeDense::kNone)};
+
+    std::string path = "/tmp/bench_native_iqn.bin";
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return 1;
+    }
+    uint32_t hdr[2] = {1, static_cast<uint32_t>(NativeModelKind::kIQN)};
+    std::fwrite("MSNN", 1, 4, f);
+    std::fwrite(hdr, sizeof(uint32_t), 2, f);
+    write_block(f, state_net);
+    write_block(f, cos_net);
+    write_block(f, head);
+    std::fclose(f);
+
+    NativeIQNModel model;
+    if (!model.load(path)) return 1;
+    std::vector<float> taus = scheduler_quantiles();
+    model.set_quantiles(taus.data(), taus.size());
+
+    printf("Synthetic IQN: state_dim=%zu hidden=%zu n_cos=%zu workers=%zu quantiles=%zu, SIMD=%s\n",
+           state_dim, hidden, kNumCos, num_workers, kQuantiles, simd_isa_name());
+
+    // 一致性: 原生 float SIMD vs 朴素 double 参考
+    std::vector<float> out(num_workers * kQuantiles);
+    double max_rel = 0.0;
+    for (int t = 0; t < 100; ++t) {
+        std::vector<float> state = random_state(rng, state_dim);
+        model.forward(state.data(), out.data());
+        std::vector<double> ref = reference_iqn(state_net, cos_net, head, state, taus);
+        for (size_t i = 0; i < out.size(); ++i) {
+            double rel = std::fabs(out[i] - ref[i]) / std::max(1.0, std::fabs(ref[i]));
+            max_rel = std::max(max_rel, rel);
+        }
+    }
+    bool ok = max_rel < 1e-4;
+    printf("Parity vs double reference: max rel err %.3e (%s)\n\n", max_rel, ok ? "OK" : "FAIL");
+
+    // 延迟: 单次前向
+    print_header();
+    std::vector<float> state = random_state(rng, state_dim);
+    LatencyHistogram forward_hist;
+    for (size_t i = 0; i < iters; ++i) {
+        Timestamp start = now_ns();
+        model.forward(state.data(), out.data());
+        forward_hist.record(static_cast<int64_t>(now_ns() - start));
+    }
+    print_row("native forward", forward_hist);
+
+    // 延迟: 完整调度决策 (状态构建 + 推理 + CVaR 选择)
+    std::vector<WorkerState> workers = make_workers(num_workers, rng);
+    ClientRequest req{};
+    req.deadline = now_ns() + ms_to_ns(10);
+    req.expected_service_us = 10;
+
+    MalcolmStrictScheduler native_sched(path);
+    MalcolmStrictScheduler heuristic_sched;
+    LatencyHistogram native_hist, heuristic_hist;
+    for (size_t i = 0; i < iters; ++i) {
+        native_hist.record(static_cast<int64_t>(native_sched.schedule(req, workers).decision_time));
+        heuristic_hist.record(static_cast<int64_t>(heuristic_sched.schedule(req, workers).decision_time));
+    }
+    print_row("schedule() native IQN", native_hist);
+    print_row("schedule() heuristic", heuristic_hist);
+    return ok ? 0 : 1;
+}
+
+int run_model_file(const std::string& path, size_t iters, const std::string& torch_path) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    uint32_t kind = f ? detail::read_native_header(f) : 0;
+    if (f) std::fclose(f);
+
+    std::mt19937 rng(42);
+    std::vector<float> taus = scheduler_quantiles();
+    NativeIQNModel iqn;
+    NativeMLPModel mlp;
+    size_t in_dim = 0, out_len = 0;
+
+    if (kind == static_cast<uint32_t>(NativeModelKind::kIQN) && iqn.load(path)) {
+        iqn.set_quantiles(taus.data(), taus.size());
+        in_dim = iqn.input_dim();
+        out_len = iqn.num_outputs() * kQuantiles;
+        printf("IQN model %s: state_dim=%zu embedding=%zu outputs=%zu, SIMD=%s\n",
+               path.c_str(), in_dim, iqn.embedding_dim(), iqn.num_outputs(), simd_isa_name());
+    } else if (kind == static_cast<uint32_t>(NativeModelKind::kMLP) && mlp.load(path)) {
+        in_dim = mlp.input_dim();
+        out_len = mlp.output_dim();
+        printf("MLP model %s: input=%zu outputs=%zu, SIMD=%s\n",
+               path.c_str(), in_dim, out_len, simd_isa_name());
+    } else {
+        fprintf(stderr, "Cannot load native model %s\n", path.c_str());
+        return 1;
+    }
+    bool is_iqn = kind == static_cast<uint32_t>(NativeModelKind::kIQN);
+
+    std::vector<float> out(out_len);
+    auto native_forward = [&](const std::vector<float>& state) {
+        if (is_iqn) {
+            iqn.forward(state.data(), out.data());
+        } else {
+            const float* q = mlp.forward(state.data());
+            std::copy(q, q + out_len, out.begin());
+        }
+    };
+
+    int rc = 0;
+#ifdef USE_LIBTORCH
+    torch::jit::script::Module module;
+    bool have_torch = false;
+    if (!torch_path.empty()) {
+        module = torch::jit::load(torch_path);
+        module.eval();
+        have_torch = true;
+    }
+    auto torch_forward = [&](std::vector<float>& state) {
+        torch::NoGradGuard no_grad;
+        std::vector<torch::jit::IValue> inputs;
+        inputs.push_back(torch::from_blob(state.data(), {1, static_cast<long>(in_dim)}, torch::kFloat32));
+        if (is_iqn) {
+            inputs.push_back(torch::from_blob(taus.data(), {1, static_cast<long>(kQuantiles)},
+                                              torch::kFloat32));
+        }
+        return module.forward(inputs).toTensor().contiguous();
+    };
+
+    if (have_torch) {
+        // 一致性: 原生 vs LibTorch ([1, W, Q] 或 [1, W]，与原生输出布局相同)
+        double max_rel = 0.0;
+        for (int t = 0; t < 100; ++t) {
+            std::vector<float> state = random_state(rng, in_dim);
+            native_forward(state);
+            auto expected = torch_forward(state);
+            const float* e = expected.data_ptr<float>();
+            for (size_t i = 0; i < out_len; ++i) {
+                double rel = std::fabs(out[i] - e[i]) / std::max(1.0, std::fabs(static_cast<double>(e[i])));
+                max_rel = std::max(max_rel, rel);
+            }
+        }
+        bool ok = max_rel < 1e-4;
+        printf("Parity vs LibTorch: max rel err %.3e (%s)\n", max_rel, ok ? "OK" : "FAIL");
+        rc = ok ? 0 : 1;
+    }
+#else
+    if (!torch_path.empty()) {
+        printf("Built without USE_LIBTORCH, skipping parity check against %s\n", torch_path.c_str());
+    }
+#endif
+
+    printf("\n");
+    print_header();
+    std::vector<float> state = random_state(rng, in_dim);
+    LatencyHistogram native_hist;
+    for (size_t i = 0; i < iters; ++i) {
+        Timestamp start = now_ns();
+        native_forward(state);
+        native_hist.record(static_cast<int64_t>(now_ns() - start));
+    }
+    print_row("native forward", native_hist);
+
+#ifdef USE_LIBTORCH
+    if (have_torch) {
+        LatencyHistogram torch_hist;
+        for (size_t i = 0; i < iters; ++i) {
+            Timestamp start = now_ns();
+            torch_forward(state);
+            torch_hist.record(static_cast<int64_t>(now_ns() - start));
+        }
+        print_row("libtorch forward", torch_hist);
+    }
+#endif
+    return rc;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s synthetic [num_workers=16] [hidden=256] [iterations=100000]\n", argv[0]);
+        printf("       %s <model.bin> [iterations=100000] [model.pt]\n", argv[0]);
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "synthetic") {
+        size_t workers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+        size_t hidden = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+        size_t iters = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 100'000;
+        return run_synthetic(workers, hidden, iters);
+    }
+
+    size_t iters = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100'000;
+    std::string torch_path = argc > 3 ? argv[3] : "";
+    return run_model_file(mode, iters, torch_path);
+}
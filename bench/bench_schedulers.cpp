@@ -0,0 +1,582 @@
+/**
+ * 调度器微基准 (派发路径回归门禁)
+ *
+ * 对每种调度器 × 每个集群规模，按 LB 派发路径的顺序重复:
+ *   schedule() → 目标 Worker queue_length++ / active_requests++ / load_ema 更新 → update_worker_state()
+ * 每批 kBatch 次决策之间 (不计时) 模拟响应到达: 各 Worker 的队列长度和松弛时间直方图
+ * 随机变化并推送给调度器，刷新请求 deadline，使决策不会落在恒定输入上。
+ *
+ * 调度器: po2, malcolm (启发式 / 原生 MLP 模型), malcolm_strict (启发式 / 原生 IQN 模型)。
+ * 模型为随机权重 (格式同 scripts/export_native_model.py 的导出)，只衡量推理开销，
+ * 需要 USE_NATIVE_INFERENCE，否则跳过。
+ *
+ * 输出每次决策的:
+ *   ns / 吞吐        : 计时区间总耗时 / 决策数 (含上述派发簿记)
+ *   P50 / P99        : 调度器自报的 decision_time
+ *   cycles / instr / LLC miss / L1D miss : perf_event_open 硬件计数器 (仅用户态，
+ *                      不可用时 (容器、perf_event_paranoid 过高) 显示 "-")
+ *   allocs           : 全局 operator new 调用次数
+ *   n                : 实际计时的决策数 (每个用例最多计时 1s)
+ *
+ * 门禁: 每个调度器有每次决策分配次数的上限 (po2 / strict / 模型推理为 0)，
+ * 超出时该行标记 FAIL; 计时之前先检查 Power-of-d 的候选抽样 (见 check_po2_sampling)。
+ * 任一项失败时进程返回非 0 (ctest 冒烟测试据此判定)。
+ * 随机模型写在 mkdtemp 创建的临时目录 ($TMPDIR，默认 /tmp) 中，加载后即删除。
+ *
+ * 用法: ./bench_schedulers [decisions=200000] [workers=4,16,64,256] [hidden=256] [csv_path]
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../src/common/metrics.h"
+#include "../src/common/workload.h"
+#include "../src/scheduler/malcolm_scheduler.h"
+#include "../src/scheduler/malcolm_strict_scheduler.h"
+#include "../src/scheduler/po2_scheduler.h"
+
+// ==================== 分配计数 ====================
+// 本进程单线程计时，普通计数器即可。替换版本内联后 GCC 会把 new → free 误报为不匹配
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static uint64_t g_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    ++g_allocations;
+    void* p = nullptr;
+    if (posix_memalign(&p, std::max(static_cast<std::size_t>(align), sizeof(void*)), size ? size : 1) == 0) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+using namespace malcolm;
+
+namespace {
+
+constexpr size_t kBatch = 1024;        // 每批决策数 (批间模拟响应，不计时)
+constexpr size_t kRequestPool = 4096;
+constexpr Timestamp kCaseBudgetNs = 1'000'000'000;   // 每个用例最多计时 1s (大模型 × 256 Worker 很慢)
+
+// ==================== 硬件计数器 ====================
+
+/**
+ * perf_event_open 计数器组 (cycles 为组长，其余可单独缺失)
+ */
+class PerfCounters {
+public:
+    enum Counter { kCycles, kInstructions, kLLCMisses, kL1DMisses, kNumCounters };
+
+    PerfCounters() {
+        fds_.fill(-1);
+        open(kCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (fds_[kCycles] < 0) {
+            return;
+        }
+        open(kInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(kLLCMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open(kL1DMisses, PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    ~PerfCounters() {
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    bool available(Counter c) const { return fds_[c] >= 0; }
+
+    void reset() {
+        totals_.fill(0);
+    }
+
+    void start() {
+        if (fds_[kCycles] < 0) return;
+        ioctl(fds_[kCycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[kCycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    /// 停止并把本段计数累加到 totals
+    void stop() {
+        if (fds_[kCycles] < 0) return;
+        ioctl(fds_[kCycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // PERF_FORMAT_GROUP: nr, values[nr] (按加入组的顺序)
+        uint64_t buf[1 + kNumCounters] = {};
+        if (read(fds_[kCycles], buf, sizeof(buf)) <= 0) return;
+        for (size_t i = 0; i < buf[0] && i < order_.size(); ++i) {
+            totals_[order_[i]] += buf[1 + i];
+        }
+    }
+
+    uint64_t total(Counter c) const { return totals_[c]; }
+
+private:
+    void open(Counter c, uint32_t type, uint64_t config) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = c == kCycles ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                          c == kCycles ? -1 : fds_[kCycles], 0));
+        if (fd >= 0) {
+            fds_[c] = fd;
+            order_.push_back(c);
+        }
+    }
+
+    std::array<int, kNumCounters> fds_;
+    std::array<uint64_t, kNumCounters> totals_{};
+    std::vector<Counter> order_;
+};
+
+// ==================== 合成模型 ====================
+
+struct Layer {
+    size_t in, out;
+    uint32_t act;
+};
+
+void write_random_block(std::FILE* f, std::mt19937& rng, const std::vector<Layer>& block) {
+    uint32_t n = static_cast<uint32_t>(block.size());
+    std::fwrite(&n, sizeof(n), 1, f);
+    for (const auto& l : block) {
+        std::normal_distribution<float> dist(0.0f, std::sqrt(2.0f / l.in));
+        uint32_t hdr[3] = {static_cast<uint32_t>(l.in), static_cast<uint32_t>(l.out), l.act};
+        std::fwrite(hdr, sizeof(uint32_t), 3, f);
+        std::vector<float> w(l.in * l.out), b(l.out);
+        for (auto& v : w) v = dist(rng);
+        for (auto& v : b) v = 0.1f * dist(rng);
+        std::fwrite(w.data(), sizeof(float), w.size(), f);
+        std::fwrite(b.data(), sizeof(float), b.size(), f);
+    }
+}
+
+std::string g_model_dir;   // 本进程私有的临时目录 (首个模型写入时创建，退出前删除)
+
+#ifdef USE_NATIVE_INFERENCE
+/// 在临时目录写随机权重的原生模型文件，返回路径 (失败返回空)，调用方加载后删除
+std::string write_model(NativeModelKind kind, size_t num_workers, size_t hidden) {
+    if (g_model_dir.empty()) {
+        const char* tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp && *tmp ? tmp : "/tmp") + "/bench_schedulers_XXXXXX";
+        if (!mkdtemp(pattern.data())) {
+            fprintf(stderr, "Cannot create temporary directory %s\n", pattern.c_str());
+            return "";
+        }
+        g_model_dir = pattern;
+    }
+    std::string path = g_model_dir + "/" +
+                       std::string(kind == NativeModelKind::kIQN ? "iqn_" : "mlp_") +
+                       std::to_string(num_workers) + ".bin";
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return "";
+    }
+    std::mt19937 rng(7);
+    uint32_t hdr[2] = {1, static_cast<uint32_t>(kind)};
+    std::fwrite("MSNN", 1, 4, f);
+    std::fwrite(hdr, sizeof(uint32_t), 2, f);
+    if (kind == NativeModelKind::kIQN) {
+        constexpr size_t kNumCos = 64;
+        size_t state_dim = MalcolmStrictScheduler::kRequestFeatures +
+                           num_workers * MalcolmStrictScheduler::kWorkerFeatures;
+        write_random_block(f, rng, {{state_dim, hidden, NativeDense::kReLU},
+                                    {hidden, hidden, NativeDense::kReLU}});
+        write_random_block(f, rng, {{kNumCos, hidden, NativeDense::kReLU}});
+        write_random_block(f, rng, {{hidden, hidden, NativeDense::kReLU},
+                                    {hidden, num_workers, NativeDense::kNone}});
+    } else {
+        size_t state_dim = MalcolmScheduler::kRequestFeatures +
+                           num_workers * MalcolmScheduler::kWorkerFeatures;
+        write_random_block(f, rng, {{state_dim, hidden, NativeDense::kReLU},
+                                    {hidden, hidden, NativeDense::kReLU},
+                                    {hidden, num_workers, NativeDense::kNone}});
+    }
+    std::fclose(f);
+    return path;
+}
+#endif
+
+// ==================== 基准 ====================
+
+struct Case {
+    const char* name;
+    bool needs_model;
+    double max_allocs;     // 每次决策分配次数上限 (门禁)
+    std::function<std::unique_ptr<Scheduler>(size_t num_workers, size_t hidden)> make;
+};
+
+struct Result {
+    double ns_per_decision = 0;
+    int64_t p50 = 0;
+    int64_t p99 = 0;
+    double per_decision[PerfCounters::kNumCounters] = {};
+    double allocs_per_decision = 0;
+    size_t decisions = 0;
+};
+
+/// 1/4 slow 节点的异构集群 (队列和直方图由 simulate_responses 填充)
+std::vector<WorkerState> make_workers(size_t n) {
+    std::vector<WorkerState> workers(n, WorkerState{});
+    for (size_t i = 0; i < n; ++i) {
+        auto& ws = workers[i];
+        ws.worker_id = static_cast<uint8_t>(i);
+        ws.address = "bench:" + std::to_string(i);
+        ws.is_healthy = true;
+        ws.capacity_factor = i % 4 == 3 ? 0.2 : 1.0;
+        ws.avg_service_time = us_to_ns(i % 4 == 3 ? 50 : 10);
+    }
+    return workers;
+}
+
+/// 模拟一批响应到达: 队列长度回落到随机水平，松弛时间直方图随之变化
+void simulate_responses(std::vector<WorkerState>& workers, Scheduler& sched, std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> queue(0, 20);
+    for (auto& ws : workers) {
+        ws.queue_length = queue(rng);
+        ws.active_requests = ws.queue_length;
+        ws.update_load_ema(ws.queue_length);
+        for (auto& b : ws.slack_histogram) b = queue(rng) / 4;
+        sched.update_worker_state(ws.worker_id, ws);
+    }
+}
+
+Result run_case(Scheduler& sched, size_t num_workers, size_t decisions, PerfCounters& perf) {
+    std::mt19937 rng(42);
+    std::vector<WorkerState> workers = make_workers(num_workers);
+
+    RequestGenerator gen;
+    gen.set_seed(42);
+    std::vector<ClientRequest> requests(kRequestPool);
+    std::vector<Timestamp> deadline_offsets(kRequestPool);
+    for (size_t i = 0; i < kRequestPool; ++i) {
+        requests[i] = gen.generate();
+        deadline_offsets[i] = requests[i].deadline - requests[i].client_send_time;
+    }
+
+    std::vector<Timestamp> decision_times(kBatch);
+    LatencyHistogram latency;
+    perf.reset();
+    uint64_t allocations = 0;
+    Timestamp timed_ns = 0;
+    size_t timed = 0;
+    size_t next_request = 0;
+
+    // 第一批为预热，不计入结果
+    size_t batches = (decisions + kBatch - 1) / kBatch + 1;
+    for (size_t b = 0; b < batches && timed_ns < kCaseBudgetNs; ++b) {
+        simulate_responses(workers, sched, rng);
+        Timestamp now = now_ns();
+        for (size_t i = 0; i < kRequestPool; ++i) {
+            requests[i].client_send_time = now;
+            requests[i].deadline = now + deadline_offsets[i];
+        }
+
+        bool measure = b > 0;
+        if (measure) perf.start();
+        uint64_t alloc_start = g_allocations;
+        Timestamp start = now_ns();
+        for (size_t i = 0; i < kBatch; ++i) {
+            const ClientRequest& req = requests[next_request];
+            next_request = (next_request + 1) % kRequestPool;
+
+            ScheduleDecision d = sched.schedule(req, workers);
+            decision_times[i] = d.decision_time;
+
+            // LB 派发路径的簿记
+            WorkerState& ws = workers[d.target_worker_id % num_workers];
+            ws.queue_length++;
+            ws.active_requests++;
+            ws.update_load_ema(ws.queue_length);
+            sched.update_worker_state(ws.worker_id, ws);
+        }
+        Timestamp elapsed = now_ns() - start;
+        uint64_t batch_allocs = g_allocations - alloc_start;
+        if (!measure) continue;
+        perf.stop();
+
+        timed_ns += elapsed;
+        timed += kBatch;
+        allocations += batch_allocs;
+        for (Timestamp t : decision_times) {
+            latency.record(static_cast<int64_t>(t));
+        }
+    }
+
+    Result r;
+    r.ns_per_decision = static_cast<double>(timed_ns) / timed;
+    r.p50 = latency.percentile(50.0);
+    r.p99 = latency.percentile(99.0);
+    for (size_t c = 0; c < PerfCounters::kNumCounters; ++c) {
+        auto counter = static_cast<PerfCounters::Counter>(c);
+        r.per_decision[c] = perf.available(counter)
+            ? static_cast<double>(perf.total(counter)) / timed : -1.0;
+    }
+    r.allocs_per_decision = static_cast<double>(allocations) / timed;
+    r.decisions = timed;
+    return r;
+}
+
+std::string fmt_counter(double v) {
+    if (v < 0) return "-";
+    char buf[32];
+    snprintf(buf, sizeof(buf), v < 100 ? "%.2f" : "%.0f", v);
+    return buf;
+}
+
+std::vector<size_t> parse_sizes(const char* list) {
+    std::vector<size_t> sizes;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t n = std::strtoul(item.c_str(), nullptr, 10);
+        if (n >= 1 && n <= 256) {
+            sizes.push_back(n);
+        }
+    }
+    return sizes;
+}
+
+// ==================== Power-of-d 抽样检查 ====================
+
+double choose(size_t n, size_t k) {
+    if (k > n) return 0.0;
+    double r = 1.0;
+    for (size_t i = 0; i < k; ++i) {
+        r = r * static_cast<double>(n - i) / static_cast<double>(i + 1);
+    }
+    return r;
+}
+
+/**
+ * 检查 Po2Scheduler 的候选抽样 (按 queue_length 选择，健康 Worker 的负载互不相同，
+ * 不健康 Worker 的负载最低，选中即暴露):
+ * - 只选健康 Worker; 没有健康 Worker 时返回 0 号
+ * - d >= 健康数 h 时总是选中负载最低的健康 Worker (候选互不相同，覆盖全部健康 Worker)
+ * - 否则候选须是健康 Worker 的均匀 d 子集: 负载排名 r (0 最低) 被选中的概率为
+ *   C(h-1-r, d-1) / C(h, d)，实测频率的偏差须小于 kTolerance
+ * 返回失败的配置数
+ */
+size_t check_po2_sampling() {
+    constexpr size_t kTrials = 100'000;
+    constexpr double kTolerance = 0.01;   // 10 万次抽样时约为 7 倍标准差
+    struct Config {
+        size_t workers, healthy, d;
+    };
+    const Config configs[] = {
+        {16, 16, 2},     // 拒绝采样
+        {64, 40, 8},
+        {64, 5, 2},      // 健康 Worker 很少: 回退到部分 Fisher-Yates
+        {256, 8, 3},
+        {16, 3, 3},      // d == h
+        {256, 2, 8},     // d > h
+        {8, 1, 2},
+        {8, 0, 2},       // 没有健康 Worker
+    };
+
+    printf("Power-of-d sampling checks (%zu decisions each)\n", kTrials);
+    size_t failures = 0;
+    std::mt19937 rng(1);
+    for (const auto& c : configs) {
+        // 随机挑选 h 个健康 Worker，负载排名也随机
+        std::vector<WorkerState> workers = make_workers(c.workers);
+        std::vector<size_t> order(c.workers);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+        std::vector<int> rank(c.workers, -1);
+        for (auto& ws : workers) {
+            ws.is_healthy = false;
+            ws.queue_length = 0;
+        }
+        for (size_t r = 0; r < c.healthy; ++r) {
+            workers[order[r]].is_healthy = true;
+            workers[order[r]].queue_length = static_cast<uint32_t>(r + 1);
+            rank[order[r]] = static_cast<int>(r);
+        }
+
+        Po2Scheduler sched(c.d, LoadMetric::kQueueLength, 42);
+        ClientRequest req{};
+        std::vector<size_t> picked(std::max<size_t>(c.healthy, 1), 0);
+        size_t bad = 0;   // 选中不健康 Worker (或无健康 Worker 时未返回 0 号)
+        for (size_t i = 0; i < kTrials; ++i) {
+            uint8_t target = sched.schedule(req, workers).target_worker_id;
+            if (c.healthy == 0) {
+                bad += target != 0;
+            } else if (target >= c.workers || rank[target] < 0) {
+                ++bad;
+            } else {
+                ++picked[rank[target]];
+            }
+        }
+
+        double max_dev = 0.0;
+        if (c.healthy > 0) {
+            double subsets = choose(c.healthy, std::min(c.d, c.healthy));
+            for (size_t r = 0; r < c.healthy; ++r) {
+                double expected = c.d >= c.healthy
+                    ? (r == 0 ? 1.0 : 0.0)
+                    : choose(c.healthy - 1 - r, c.d - 1) / subsets;
+                double observed = static_cast<double>(picked[r]) / kTrials;
+                max_dev = std::max(max_dev, std::abs(observed - expected));
+            }
+        }
+        bool failed = bad > 0 || max_dev > kTolerance;
+        failures += failed;
+        printf("  workers=%-3zu healthy=%-3zu d=%zu  unhealthy picks=%zu  max |p - expected|=%.4f  %s\n",
+               c.workers, c.healthy, c.d, bad, max_dev, failed ? "FAIL" : "OK");
+    }
+    printf("\n");
+    return failures;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t decisions = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200'000;
+    std::vector<size_t> sizes = parse_sizes(argc > 2 ? argv[2] : "4,16,64,256");
+    size_t hidden = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+    const char* csv_path = argc > 4 ? argv[4] : nullptr;
+    if (decisions == 0 || sizes.empty() || hidden == 0) {
+        fprintf(stderr, "Usage: %s [decisions=200000] [workers=4,16,64,256] [hidden=256] [csv_path]\n",
+                argv[0]);
+        return 1;
+    }
+
+    std::vector<Case> cases = {
+        {"po2", false, 0.0, [](size_t, size_t) {
+            return std::make_unique<Po2Scheduler>();
+        }},
+        // 启发式每次决策构造一个负载向量
+        {"malcolm-heuristic", false, 1.0, [](size_t, size_t) {
+            return std::make_unique<MalcolmScheduler>("", true);
+        }},
+        {"malcolm-model", true, 0.0, [](size_t n, size_t h) -> std::unique_ptr<Scheduler> {
+#ifdef USE_NATIVE_INFERENCE
+            std::string path = write_model(NativeModelKind::kMLP, n, h);
+            if (!path.empty()) {
+                auto sched = std::make_unique<MalcolmScheduler>(path, false);
+                unlink(path.c_str());
+                if (sched->name() == "Malcolm-Model") return sched;   // 加载失败会回退到启发式
+            }
+#endif
+            (void)n; (void)h;
+            return nullptr;
+        }},
+        {"strict-heuristic", false, 0.0, [](size_t, size_t) {
+            return std::make_unique<MalcolmStrictScheduler>();
+        }},
+        {"strict-iqn", true, 0.0, [](size_t n, size_t h) -> std::unique_ptr<Scheduler> {
+#ifdef USE_NATIVE_INFERENCE
+            std::string path = write_model(NativeModelKind::kIQN, n, h);
+            if (!path.empty()) {
+                auto sched = std::make_unique<MalcolmStrictScheduler>(path);
+                unlink(path.c_str());
+                return sched;
+            }
+#endif
+            (void)n; (void)h;
+            return nullptr;
+        }},
+    };
+
+    PerfCounters perf;
+    if (!perf.available(PerfCounters::kCycles)) {
+        printf("perf_event_open unavailable (check /proc/sys/kernel/perf_event_paranoid), "
+               "hardware counters shown as '-'\n");
+    }
+
+    size_t failures = check_po2_sampling();
+
+    std::FILE* csv = csv_path ? std::fopen(csv_path, "w") : nullptr;
+    if (csv) {
+        fprintf(csv, "scheduler,workers,ns_per_decision,p50_ns,p99_ns,cycles,instructions,"
+                     "llc_misses,l1d_misses,allocs\n");
+    }
+
+    printf("%zu decisions per case (batches of %zu), model hidden=%zu\n\n", decisions, kBatch, hidden);
+    printf("%-18s %7s %9s %9s %8s %8s %10s %10s %9s %9s %7s %8s\n", "scheduler", "workers", "ns/dec",
+           "Mdec/s", "P50", "P99", "cycles", "instr", "LLC-miss", "L1D-miss", "allocs", "n");
+
+    for (const auto& c : cases) {
+        for (size_t n : sizes) {
+            std::unique_ptr<Scheduler> sched = c.make(n, hidden);
+            if (!sched) {
+                printf("%-18s %7zu  (skipped: built without USE_NATIVE_INFERENCE)\n", c.name, n);
+                break;
+            }
+            Result r = run_case(*sched, n, decisions, perf);
+            bool failed = r.allocs_per_decision > c.max_allocs;
+            failures += failed;
+            printf("%-18s %7zu %9.1f %9.2f %8ld %8ld %10s %10s %9s %9s %7.2f %8zu%s\n",
+                   c.name, n, r.ns_per_decision, 1e3 / r.ns_per_decision, r.p50, r.p99,
+                   fmt_counter(r.per_decision[PerfCounters::kCycles]).c_str(),
+                   fmt_counter(r.per_decision[PerfCounters::kInstructions]).c_str(),
+                   fmt_counter(r.per_decision[PerfCounters::kLLCMisses]).c_str(),
+                   fmt_counter(r.per_decision[PerfCounters::kL1DMisses]).c_str(),
+                   r.allocs_per_decision, r.decisions,
+                   failed ? "  FAIL (allocs)" : "");
+            if (csv) {
+                fprintf(csv, "%s,%zu,%.2f,%ld,%ld,%.2f,%.2f,%.4f,%.4f,%.4f\n",
+                        c.name, n, r.ns_per_decision, r.p50, r.p99,
+                        r.per_decision[PerfCounters::kCycles],
+                        r.per_decision[PerfCounters::kInstructions],
+                        r.per_decision[PerfCounters::kLLCMisses],
+                        r.per_decision[PerfCounters::kL1DMisses],
+                        r.allocs_per_decision);
+            }
+        }
+    }
+
+    if (csv) {
+        std::fclose(csv);
+        printf("\nResults written to %s\n", csv_path);
+    }
+    if (!g_model_dir.empty()) {
+        rmdir(g_model_dir.c_str());
+    }
+    if (failures > 0) {
+        printf("\n%zu check(s) failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
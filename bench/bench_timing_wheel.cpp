@@ -0,0 +1,291 @@
+/**
+ * EDF 队列: 时间轮正确性检查 + 吞吐基准
+ *
+ * 正确性:
+ *   - bulk       : 同一批随机 deadline (覆盖已过期 / L0 / L1 / L2 / 溢出) 分别压入
+ *                  EDFQueueLocked 和 HierarchicalTimingWheel，全部弹出后
+ *                  逐个比对 deadline 的 L0 刻度序列 (时间轮精度为一个 L0 桶)
+ *   - interleaved: 入队/出队交替 (新任务常早于已弹出的任务)，检查每次弹出的刻度
+ *                  都等于剩余任务的最早刻度
+ *   - slack hist : 增量维护的松弛时间直方图与全量扫描结果比对 (允许相差一个桶)，
+ *                  并对比两者的读取耗时
+ *
+ * 吞吐:
+ *   - saturated : 队列常驻 resident 个任务，循环 insert + pop，测每对操作的耗时
+ *   - paced     : 按 1M tasks/s 的节奏入队并出队，检查能否跟上并给出单次操作延迟分布
+ *
+ * 用法: ./bench_timing_wheel [tasks=2000000] [resident=10000]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../src/common/metrics.h"
+#include "../src/scheduler/edf_queue.h"
+#include "../src/scheduler/slack_histogram.h"
+
+using namespace malcolm;
+
+namespace {
+
+constexpr size_t kTickShift = HierarchicalTimingWheel::kTickShift;
+
+Task make_task(uint64_t id, Timestamp deadline) {
+    Task t{};
+    t.request_id = id;
+    t.deadline = deadline;
+    return t;
+}
+
+bool check_bulk(size_t n, std::mt19937_64& rng) {
+    Timestamp base = now_ns();
+    // 混合各层范围: 已过期 / 131μs 内 / 16.8ms 内 / 2.1s 内 / 更远
+    std::uniform_int_distribution<int> range_pick(0, 4);
+    const Timestamp spans[] = {us_to_ns(100), us_to_ns(100), ms_to_ns(10), ms_to_ns(2000), ms_to_ns(10000)};
+
+    EDFQueueLocked heap;
+    HierarchicalTimingWheel wheel;
+    for (size_t i = 0; i < n; ++i) {
+        int r = range_pick(rng);
+        Timestamp offset = std::uniform_int_distribution<Timestamp>(0, spans[r])(rng);
+        Timestamp deadline = r == 0 ? base - offset : base + offset;
+        heap.push(make_task(i, deadline));
+        wheel.insert(make_task(i, deadline));
+    }
+
+    size_t mismatches = 0;
+    Task a, b;
+    for (size_t i = 0; i < n; ++i) {
+        if (!heap.try_pop(a) || !wheel.try_pop(b)) {
+            printf("bulk: queue drained early at %zu/%zu\n", i, n);
+            return false;
+        }
+        if ((a.deadline >> kTickShift) != (b.deadline >> kTickShift)) {
+            ++mismatches;
+        }
+    }
+    bool ok = mismatches == 0 && wheel.empty() && !wheel.try_pop(b);
+    printf("bulk        %8zu tasks, tick-order mismatches vs EDFQueueLocked: %zu (%s)\n",
+           n, mismatches, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+bool check_interleaved(size_t n, size_t resident, std::mt19937_64& rng) {
+    std::uniform_int_distribution<Timestamp> slack(0, ms_to_ns(10));
+    HierarchicalTimingWheel wheel;
+    std::multiset<Timestamp> remaining;   // 参考: 剩余任务的刻度
+
+    Timestamp clock = now_ns();
+    size_t violations = 0;
+    size_t popped = 0;
+    Task t;
+    for (size_t i = 0; i < n; ++i) {
+        clock += 1000;  // 模拟时间: 每 1μs 到达一个任务
+        Timestamp deadline = clock + slack(rng);
+        wheel.insert(make_task(i, deadline));
+        remaining.insert(deadline >> kTickShift);
+
+        if (remaining.size() <= resident && i + 1 < n) continue;
+        while (remaining.size() > (i + 1 < n ? resident : 0)) {
+            if (!wheel.try_pop(t)) {
+                printf("interleaved: wheel empty with %zu remaining\n", remaining.size());
+                return false;
+            }
+            Timestamp tick = t.deadline >> kTickShift;
+            if (tick != *remaining.begin()) {
+                ++violations;
+            }
+            remaining.erase(remaining.find(tick));
+            ++popped;
+        }
+    }
+    bool ok = violations == 0 && wheel.empty();
+    printf("interleaved %8zu tasks, EDF order violations: %zu (%s)\n",
+           popped, violations, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+using SlackBins = std::array<uint32_t, constants::kSlackHistogramBins>;
+
+/// 原实现: 扫描所有在队任务，按 slack/kSlackBinWidth + 1 分桶
+void scan_slack_histogram(const std::vector<Task>& tasks, Timestamp now, SlackBins& hist) {
+    hist.fill(0);
+    for (const Task& t : tasks) {
+        Duration slack = t.slack_time(now);
+        size_t bin = 0;
+        if (slack > 0) {
+            bin = std::min<size_t>(static_cast<size_t>(slack / constants::kSlackBinWidth) + 1,
+                                   constants::kSlackHistogramBins - 1);
+        }
+        ++hist[bin];
+    }
+}
+
+/**
+ * 模拟时钟下随机入队/出队，每步比对两种直方图
+ *
+ * 增量版按绝对时间窗口分桶，与按相对 slack 分桶最多错开一个桶: 检查总数相等，
+ * 且任意前缀和 (slack 不超过某值的任务数) 的差不超过相邻一个桶的计数
+ */
+bool check_slack_histogram(size_t steps, size_t resident, std::mt19937_64& rng) {
+    std::uniform_int_distribution<Timestamp> slack(0, ms_to_ns(5));
+    std::uniform_int_distribution<Timestamp> late(0, us_to_ns(300));
+    SlackHistogram inc;
+    std::vector<Task> queued;   // 参考: 在队任务
+    Timestamp clock = now_ns();
+    size_t violations = 0;
+    SlackBins a, b;
+    for (size_t i = 0; i < steps; ++i) {
+        clock += 2000;  // 模拟时间: 每 2μs 一步
+        Task t = make_task(i, i % 10 == 0 ? clock - late(rng) : clock + slack(rng));
+        t.slack_epoch = inc.add(t.deadline, clock);
+        queued.push_back(t);
+        if (queued.size() > resident) {
+            size_t victim = std::uniform_int_distribution<size_t>(0, queued.size() - 1)(rng);
+            inc.remove(queued[victim].slack_epoch, clock);
+            queued[victim] = queued.back();
+            queued.pop_back();
+        }
+        if (i % 97 != 0) continue;
+
+        inc.snapshot(clock, a);
+        scan_slack_histogram(queued, clock, b);
+        int64_t pa = 0, pb = 0, total = 0;
+        for (size_t k = 0; k < a.size(); ++k) {
+            pa += a[k];
+            pb += b[k];
+            int64_t slack_room = b[k] + (k + 1 < b.size() ? b[k + 1] : 0);
+            if (std::llabs(pa - pb) > slack_room) ++violations;
+            total += a[k];
+        }
+        if (total != static_cast<int64_t>(queued.size())) ++violations;
+    }
+    bool ok = violations == 0;
+    printf("slack hist  %8zu steps, mismatches vs full scan (±1 bin): %zu (%s)\n",
+           steps, violations, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+void print_row(const char* name, const LatencyHistogram& h) {
+    printf("%-28s %10.1f %10ld %10ld %10ld %10ld\n", name, h.mean(),
+           h.percentile(50.0), h.percentile(99.0), h.percentile(99.9), h.max());
+}
+
+/// 常驻 resident 个任务，循环 insert + pop，返回每秒操作对数
+template<typename Insert, typename Pop>
+double run_saturated(size_t n, size_t resident, Insert insert, Pop pop) {
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<Timestamp> slack(0, ms_to_ns(10));
+    Timestamp base = now_ns();
+    for (size_t i = 0; i < resident; ++i) {
+        insert(make_task(i, base + slack(rng)));
+    }
+    Task t;
+    Timestamp start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        insert(make_task(i, base + i * 1000 + slack(rng)));  // 每 1μs 到达一个任务
+        pop(t);
+    }
+    double secs = static_cast<double>(now_ns() - start) / 1e9;
+    while (pop(t)) {}
+    return static_cast<double>(n) / secs;
+}
+
+/// 按 rate 任务/秒入队 (deadline = 到达 + 0~10ms)，每次入队后出队一个，记录单次操作耗时
+template<typename Insert, typename Pop>
+double run_paced(size_t n, size_t resident, double rate, Insert insert, Pop pop,
+                 LatencyHistogram& insert_hist, LatencyHistogram& pop_hist) {
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<Timestamp> slack(0, ms_to_ns(10));
+    Timestamp interval = static_cast<Timestamp>(1e9 / rate);
+    Task t;
+    for (size_t i = 0; i < resident; ++i) {
+        insert(make_task(i, now_ns() + slack(rng)));
+    }
+    Timestamp start = now_ns();
+    for (size_t i = 0; i < n; ++i) {
+        Timestamp arrival = start + i * interval;
+        while (now_ns() < arrival) {}
+
+        Timestamp t0 = now_ns();
+        insert(make_task(i, arrival + slack(rng)));
+        Timestamp t1 = now_ns();
+        pop(t);
+        Timestamp t2 = now_ns();
+        insert_hist.record(static_cast<int64_t>(t1 - t0));
+        pop_hist.record(static_cast<int64_t>(t2 - t1));
+    }
+    double secs = static_cast<double>(now_ns() - start) / 1e9;
+    while (pop(t)) {}
+    return static_cast<double>(n) / secs;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t tasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2'000'000;
+    size_t resident = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10'000;
+
+    std::mt19937_64 rng(42);
+    bool ok = check_bulk(200'000, rng);
+    ok = check_interleaved(1'000'000, resident, rng) && ok;
+    ok = check_slack_histogram(1'000'000, resident, rng) && ok;
+
+    EDFQueueLocked heap;
+    HierarchicalTimingWheel wheel;
+    auto heap_insert = [&](Task&& t) { heap.push(std::move(t)); };
+    auto heap_pop = [&](Task& t) { return heap.try_pop(t); };
+    auto wheel_insert = [&](Task&& t) { wheel.insert(std::move(t)); };
+    auto wheel_pop = [&](Task& t) { return wheel.try_pop(t); };
+
+    printf("\nsaturated (%zu resident, insert + pop)\n", resident);
+    printf("  heap  : %6.2f M ops/s\n", run_saturated(tasks, resident, heap_insert, heap_pop) / 1e6);
+    printf("  wheel : %6.2f M ops/s\n", run_saturated(tasks, resident, wheel_insert, wheel_pop) / 1e6);
+
+    constexpr double kRate = 1e6;
+    printf("\npaced at %.0f tasks/s (%zu resident)\n", kRate, resident);
+    printf("%-28s %10s %10s %10s %10s %10s\n", "latency (ns)", "mean", "P50", "P99", "P99.9", "max");
+    LatencyHistogram hi, hp, wi, wp;
+    double heap_rate = run_paced(tasks, resident, kRate, heap_insert, heap_pop, hi, hp);
+    double wheel_rate = run_paced(tasks, resident, kRate, wheel_insert, wheel_pop, wi, wp);
+    print_row("heap insert", hi);
+    print_row("heap pop", hp);
+    print_row("wheel insert", wi);
+    print_row("wheel pop", wp);
+    printf("achieved: heap %.2f M/s, wheel %.2f M/s\n", heap_rate / 1e6, wheel_rate / 1e6);
+
+    // 状态上报读取直方图的开销: 全量扫描 vs 增量快照
+    {
+        std::mt19937_64 hist_rng(13);
+        std::uniform_int_distribution<Timestamp> slack(0, ms_to_ns(10));
+        SlackHistogram inc;
+        std::vector<Task> queued;
+        Timestamp base = now_ns();
+        for (size_t i = 0; i < resident; ++i) {
+            queued.push_back(make_task(i, base + slack(hist_rng)));
+            queued.back().slack_epoch = inc.add(queued.back().deadline, base);
+        }
+        LatencyHistogram scan_hist, snap_hist;
+        SlackBins bins;
+        volatile uint32_t sink = 0;
+        for (size_t i = 0; i < 20'000; ++i) {
+            Timestamp t0 = now_ns();
+            scan_slack_histogram(queued, t0, bins);
+            sink = sink + bins[1];
+            Timestamp t1 = now_ns();
+            inc.snapshot(t1, bins);
+            sink = sink + bins[1];
+            Timestamp t2 = now_ns();
+            scan_hist.record(static_cast<int64_t>(t1 - t0));
+            snap_hist.record(static_cast<int64_t>(t2 - t1));
+        }
+        printf("\nslack histogram read (%zu resident)\n", resident);
+        print_row("full scan", scan_hist);
+        print_row("incremental snapshot", snap_hist);
+    }
+
+    return ok ? 0 : 1;
+}
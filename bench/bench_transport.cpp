@@ -0,0 +1,197 @@
+/**
+ * 传输层微基准 (shm / udp)
+ *
+ * 同一进程内一个服务端线程 + N 个客户端线程，经 shm 或 udp 后端做请求/响应:
+ * - 服务端把一轮事件循环收到的请求攒起来，倒序回复 (检验乱序响应的关联是否正确)
+ * - 每个客户端保持 window 个在途请求，响应中回带请求编号，与 tag 比对
+ * 输出吞吐和往返延迟分布; 出现关联错误或丢失响应时返回非 0 (可作为 CI 冒烟测试)
+ * udp 后端可指定每次 recvmmsg / sendmmsg 的报文数，batch=1 即逐包系统调用，用于对比批处理收益
+ *
+ * 用法: ./bench_transport [requests_per_client=1000000] [window=1] [clients=1] [port=31849]
+ *                        [transport=shm|udp] [udp_batch=32]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../src/common/metrics.h"
+#include "../src/common/types.h"
+#include "../src/transport/transport.h"
+#include "../src/transport/udp_transport.h"
+
+using namespace malcolm;
+
+namespace {
+
+constexpr uint8_t kReqEcho = 1;
+
+struct EchoMsg {
+    uint64_t seq;
+    uint64_t send_time;
+};
+
+struct Server {
+    Transport* rpc = nullptr;
+    std::vector<ReqHandle*> deferred;
+    uint64_t handled = 0;
+};
+
+void echo_handler(ReqHandle* req_handle, void* context) {
+    auto* server = static_cast<Server*>(context);
+    // 请求数据只在处理函数内有效: 先拷到预分配的响应缓冲区，稍后再回复
+    const MsgBuffer* req = req_handle->get_req_msgbuf();
+    MsgBuffer& resp = req_handle->pre_resp_msgbuf_;
+    Transport::resize_msg_buffer(&resp, sizeof(EchoMsg));
+    std::memcpy(resp.buf_, req->buf_, sizeof(EchoMsg));
+    server->deferred.push_back(req_handle);
+}
+
+struct Client {
+    Transport* rpc = nullptr;
+    int session = -1;
+    std::vector<MsgBuffer> req_bufs;
+    std::vector<MsgBuffer> resp_bufs;
+    std::vector<uint32_t> free_slots;
+    uint64_t sent = 0;
+    uint64_t completed = 0;
+    uint64_t mismatches = 0;
+    std::vector<uint64_t> slot_seq;
+    LatencyHistogram rtt;
+};
+
+void echo_cont(void* context, void* tag) {
+    auto* client = static_cast<Client*>(context);
+    uint32_t slot = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(tag));
+    const auto* msg = reinterpret_cast<const EchoMsg*>(client->resp_bufs[slot].buf_);
+    if (client->resp_bufs[slot].data_size_ != sizeof(EchoMsg) || msg->seq != client->slot_seq[slot]) {
+        ++client->mismatches;
+    }
+    client->rtt.record(static_cast<int64_t>(now_ns() - msg->send_time));
+    ++client->completed;
+    client->free_slots.push_back(slot);
+}
+
+void send_one(Client& c) {
+    uint32_t slot = c.free_slots.back();
+    c.free_slots.pop_back();
+    auto* msg = reinterpret_cast<EchoMsg*>(c.req_bufs[slot].buf_);
+    msg->seq = c.sent++;
+    msg->send_time = now_ns();
+    c.slot_seq[slot] = msg->seq;
+    c.rpc->enqueue_request(c.session, kReqEcho, &c.req_bufs[slot], &c.resp_bufs[slot],
+                           echo_cont, reinterpret_cast<void*>(static_cast<uintptr_t>(slot)));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    size_t window = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    size_t num_clients = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+    unsigned port = argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 31849;
+    TransportType type = TransportType::kShm;
+    if (argc > 5 && (!parse_transport_type(argv[5], &type) || type == TransportType::kERPC)) {
+        fprintf(stderr, "Unsupported transport: %s (shm or udp)\n", argv[5]);
+        return 1;
+    }
+    size_t udp_batch = argc > 6 ? std::strtoul(argv[6], nullptr, 10) : udp::kDefaultBatch;
+    if (window == 0) window = 1;
+    if (num_clients == 0) num_clients = 1;
+
+    std::string server_uri = "127.0.0.1:" + std::to_string(port);
+    std::unique_ptr<TransportNexus> server_nexus, client_nexus;
+    if (type == TransportType::kUdp) {
+        server_nexus = std::make_unique<UdpNexus>(server_uri, udp_batch);
+        client_nexus = std::make_unique<UdpNexus>("127.0.0.1:0", udp_batch);
+    } else {
+        server_nexus = create_transport_nexus(type, server_uri);
+        client_nexus = create_transport_nexus(type, "127.0.0.1:0");
+    }
+    server_nexus->register_req_func(kReqEcho, echo_handler);
+
+    std::atomic<bool> running{true};
+    std::atomic<bool> server_ready{false};
+    Server server;
+    std::thread server_thread([&] {
+        auto rpc = server_nexus->create_rpc(&server, 0, 0, "bench server");
+        server.rpc = rpc.get();
+        server_ready.store(true);
+        while (running.load(std::memory_order_relaxed)) {
+            rpc->run_event_loop_once();
+            for (auto it = server.deferred.rbegin(); it != server.deferred.rend(); ++it) {
+                rpc->enqueue_response(*it, &(*it)->pre_resp_msgbuf_);
+            }
+            server.handled += server.deferred.size();
+            server.deferred.clear();
+        }
+    });
+    while (!server_ready.load()) {
+        std::this_thread::yield();
+    }
+
+    std::vector<Client> clients(num_clients);
+    std::vector<std::thread> client_threads;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < num_clients; ++i) {
+        client_threads.emplace_back([&, i] {
+            Client& c = clients[i];
+            auto rpc = client_nexus->create_rpc(&c, static_cast<uint8_t>(i), 0,
+                                                "bench client " + std::to_string(i));
+            c.rpc = rpc.get();
+            c.session = rpc->create_session(server_uri, 0);
+            while (!rpc->is_connected(c.session)) {
+                rpc->run_event_loop_once();
+            }
+            for (size_t s = 0; s < window; ++s) {
+                c.req_bufs.push_back(rpc->alloc_msg_buffer_or_die(sizeof(EchoMsg)));
+                c.resp_bufs.push_back(rpc->alloc_msg_buffer_or_die(sizeof(EchoMsg)));
+                c.free_slots.push_back(static_cast<uint32_t>(window - 1 - s));
+            }
+            c.slot_seq.assign(window, 0);
+
+            // 最多等 10 秒，超时视为丢失响应
+            uint64_t deadline = now_ns() + ms_to_ns(10'000);
+            while (c.completed < requests && now_ns() < deadline) {
+                while (!c.free_slots.empty() && c.sent < requests) {
+                    send_one(c);
+                }
+                rpc->run_event_loop_once();
+            }
+            for (size_t s = 0; s < window; ++s) {
+                rpc->free_msg_buffer(c.req_bufs[s]);
+                rpc->free_msg_buffer(c.resp_bufs[s]);
+            }
+        });
+    }
+    for (auto& t : client_threads) {
+        t.join();
+    }
+    double secs = static_cast<double>(now_ns() - start) / 1e9;
+    running.store(false);
+    server_thread.join();
+
+    LatencyHistogram rtt;
+    uint64_t completed = 0, mismatches = 0;
+    for (const auto& c : clients) {
+        rtt.merge_from(c.rtt);
+        completed += c.completed;
+        mismatches += c.mismatches;
+    }
+
+    printf("%s transport: %zu client(s), window %zu, %lu requests each\n",
+           transport_type_name(type), num_clients, window, requests);
+    printf("  completed   : %lu / %lu (server handled %lu)\n",
+           completed, requests * num_clients, server.handled);
+    printf("  throughput  : %.0f req/s\n", completed / secs);
+    printf("  RTT (ns)    : mean %.0f  P50 %ld  P99 %ld  P99.9 %ld  max %ld\n",
+           rtt.mean(), rtt.percentile(50.0), rtt.percentile(99.0), rtt.percentile(99.9), rtt.max());
+    printf("  mismatches  : %lu\n", mismatches);
+
+    bool ok = completed == requests * num_clients && mismatches == 0;
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
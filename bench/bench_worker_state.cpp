@@ -0,0 +1,161 @@
+/**
+ * Worker 状态同步微基准
+ *
+ * 对比 LB 派发路径上两种 Worker 状态访问方式的调度延迟分布:
+ *   - locked : state_mutex_ 包住 schedule()，再加锁更新目标 Worker (旧实现)
+ *   - seqlock: WorkerStateTable::refresh() 无锁同步私有视图 + schedule() + update()
+ *
+ * 每种方式分别在以下干扰下运行:
+ *   - none    : 无后台写者
+ *   - updater : 状态更新线程每 100μs 衰减所有 Worker 的 load_ema (与 LB 相同)
+ *   - busy    : 后台线程连续不断地更新 (模拟其他派发线程的响应回调)
+ *
+ * 用法: ./bench_worker_state [num_workers=16] [iterations=2000000]
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../src/common/metrics.h"
+#include "../src/load_balancer/worker_state_table.h"
+#include "../src/scheduler/malcolm_scheduler.h"
+
+using namespace malcolm;
+
+namespace {
+
+enum class Contention { kNone, kUpdater, kBusy };
+
+const char* contention_name(Contention c) {
+    switch (c) {
+        case Contention::kNone: return "none";
+        case Contention::kUpdater: return "updater";
+        case Contention::kBusy: return "busy";
+    }
+    return "?";
+}
+
+std::vector<WorkerState> make_workers(size_t n) {
+    std::vector<WorkerState> workers(n, WorkerState{});
+    for (size_t i = 0; i < n; ++i) {
+        workers[i].worker_id = static_cast<uint8_t>(i);
+        workers[i].is_healthy = true;
+        workers[i].capacity_factor = 1.0;
+    }
+    return workers;
+}
+
+/// 后台写者: 按干扰模式周期/连续地衰减所有 Worker 的负载
+template<typename DecayFn>
+std::thread start_writer(Contention c, std::atomic<bool>& stop, DecayFn decay) {
+    return std::thread([c, &stop, decay]() mutable {
+        while (!stop.load(std::memory_order_relaxed)) {
+            decay();
+            if (c == Contention::kUpdater) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+    });
+}
+
+void print_row(const char* mode, Contention c, const LatencyHistogram& h) {
+    printf("%-8s %-8s %10.1f %10ld %10ld %10ld %10ld\n",
+           mode, contention_name(c), h.mean(),
+           h.percentile(50.0), h.percentile(99.0), h.percentile(99.9), h.max());
+}
+
+void bench_locked(size_t num_workers, size_t iters, Contention c) {
+    std::vector<WorkerState> workers = make_workers(num_workers);
+    std::mutex state_mutex;
+    MalcolmScheduler scheduler;
+    ClientRequest req{};
+    LatencyHistogram hist;
+
+    std::atomic<bool> stop{false};
+    std::thread writer;
+    if (c != Contention::kNone) {
+        writer = start_writer(c, stop, [&]() {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            for (auto& ws : workers) ws.load_ema *= 0.99;
+        });
+    }
+
+    for (size_t i = 0; i < iters; ++i) {
+        Timestamp start = now_ns();
+        ScheduleDecision decision;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            decision = scheduler.schedule(req, workers);
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            auto& ws = workers[decision.target_worker_id];
+            ws.queue_length++;
+            ws.active_requests++;
+            ws.update_load_ema(ws.queue_length);
+        }
+        hist.record(static_cast<int64_t>(now_ns() - start));
+    }
+
+    stop.store(true);
+    if (writer.joinable()) writer.join();
+    print_row("locked", c, hist);
+}
+
+void bench_seqlock(size_t num_workers, size_t iters, Contention c) {
+    WorkerStateTable table(make_workers(num_workers));
+    std::vector<WorkerState> view;
+    std::vector<uint64_t> versions;
+    table.init_view(view, versions);
+    MalcolmScheduler scheduler;
+    ClientRequest req{};
+    LatencyHistogram hist;
+
+    std::atomic<bool> stop{false};
+    std::thread writer;
+    if (c != Contention::kNone) {
+        writer = start_writer(c, stop, [&]() {
+            for (size_t w = 0; w < table.size(); ++w) {
+                table.update(w, [](WorkerStateSnapshot& ws) { ws.load_ema *= 0.99; });
+            }
+        });
+    }
+
+    for (size_t i = 0; i < iters; ++i) {
+        Timestamp start = now_ns();
+        table.refresh(view, versions);
+        ScheduleDecision decision = scheduler.schedule(req, view);
+        table.update(decision.target_worker_id, [](WorkerStateSnapshot& ws) {
+            ws.queue_length++;
+            ws.active_requests++;
+            ws.update_load_ema(ws.queue_length);
+        });
+        hist.record(static_cast<int64_t>(now_ns() - start));
+    }
+
+    stop.store(true);
+    if (writer.joinable()) writer.join();
+    print_row("seqlock", c, hist);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t num_workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+    size_t iters = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2'000'000;
+
+    printf("Worker state sync: %zu workers, %zu decisions per run (ns)\n",
+           num_workers, iters);
+    printf("%-8s %-8s %10s %10s %10s %10s %10s\n",
+           "mode", "writer", "mean", "P50", "P99", "P99.9", "max");
+
+    for (Contention c : {Contention::kNone, Contention::kUpdater, Contention::kBusy}) {
+        bench_locked(num_workers, iters, c);
+        bench_seqlock(num_workers, iters, c);
+    }
+    return 0;
+}
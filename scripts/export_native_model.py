@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""
+把 TorchScript 模型导出为原生推理引擎 (src/inference/native_model.h) 的扁平权重文件
+
+用法:
+    # Malcolm Nash Q 网络 (纯 MLP: state -> 每个 Worker 的 Q 值)
+    python3 scripts/export_native_model.py --kind mlp \
+        --model models/malcolm_nash.pt --output models/malcolm_nash.bin
+
+    # Malcolm-Strict IQN (state, tau -> [B, num_workers, num_quantiles])
+    python3 scripts/export_native_model.py --kind iqn \
+        --model models/malcolm_strict_iqn.pt --output models/malcolm_strict_iqn.bin
+
+导出后用 numpy 参考实现读回 .bin 文件，与 TorchScript 在随机输入上的输出逐元素比对
+(--verify 0 关闭)。LB 使用 --model=xxx.bin 即走原生引擎。
+
+模型结构约定 (按 state_dict 中 Linear 层的出现顺序):
+  mlp: 所有 Linear 层依次相连，层间 ReLU，最后一层无激活
+  iqn: <state-prefix>* 为状态编码 ψ(s)，每层后 ReLU (含最后一层)
+       <cos-prefix>*   为余弦嵌入层 φ(τ) = ReLU(W·cos(π·i·τ) + b)，i = 0..n_cos-1
+       <head-prefix>*  为输出头，输入为 ψ(s) ⊙ φ(τ)，层间 ReLU，最后一层无激活
+"""
+
+import argparse
+import struct
+import sys
+
+import numpy as np
+
+MAGIC = b'MSNN'
+VERSION = 1
+KIND_MLP = 1
+KIND_IQN = 2
+ACT_NONE = 0
+ACT_RELU = 1
+
+# 与 MalcolmStrictScheduler::kNumQuantileSamples 一致
+NUM_QUANTILE_SAMPLES = 32
+
+
+def quantile_samples(n: int = NUM_QUANTILE_SAMPLES) -> np.ndarray:
+    """与 MalcolmStrictScheduler::generate_quantile_samples() 相同的分位数采样点"""
+    taus = np.empty(n, dtype=np.float32)
+    for i in range(n):
+        base = (i + 1) / (n + 1)
+        if i >= n * 0.8:
+            base = 0.9 + 0.1 * (i - n * 0.8) / (n * 0.2)
+        taus[i] = base
+    return taus
+
+
+def collect_linear_layers(state_dict, prefix: str = ''):
+    """按出现顺序收集前缀下的 Linear 层 (weight, bias)"""
+    layers = []
+    for key, value in state_dict.items():
+        if not key.startswith(prefix) or not key.endswith('.weight') or value.dim() != 2:
+            continue
+        weight = value.detach().float().cpu().numpy()
+        bias_key = key[:-len('weight')] + 'bias'
+        if bias_key in state_dict:
+            bias = state_dict[bias_key].detach().float().cpu().numpy()
+        else:
+            bias = np.zeros(weight.shape[0], dtype=np.float32)
+        layers.append((weight, bias))
+    if not layers:
+        raise ValueError(f"no Linear layers found with prefix '{prefix}'")
+    return layers
+
+
+def with_activations(layers, final_relu: bool):
+    acts = [ACT_RELU] * len(layers)
+    if not final_relu:
+        acts[-1] = ACT_NONE
+    return [(w, b, a) for (w, b), a in zip(layers, acts)]
+
+
+def write_mlp_block(f, layers):
+    f.write(struct.pack('<I', len(layers)))
+    for weight, bias, act in layers:
+        out_dim, in_dim = weight.shape
+        f.write(struct.pack('<III', in_dim, out_dim, act))
+        f.write(np.ascontiguousarray(weight, dtype='<f4').tobytes())
+        f.write(np.ascontiguousarray(bias, dtype='<f4').tobytes())
+
+
+def read_mlp_block(f):
+    (n,) = struct.unpack('<I', f.read(4))
+    layers = []
+    for _ in range(n):
+        in_dim, out_dim, act = struct.unpack('<III', f.read(12))
+        weight = np.frombuffer(f.read(4 * in_dim * out_dim), dtype='<f4').reshape(out_dim, in_dim)
+        bias = np.frombuffer(f.read(4 * out_dim), dtype='<f4')
+        layers.append((weight, bias, act))
+    return layers
+
+
+def read_native_model(path: str):
+    with open(path, 'rb') as f:
+        magic, version, kind = struct.unpack('<4sII', f.read(12))
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{path}: not a native model file")
+        if kind == KIND_MLP:
+            return kind, [read_mlp_block(f)]
+        return kind, [read_mlp_block(f), read_mlp_block(f), read_mlp_block(f)]
+
+
+def mlp_forward(layers, x: np.ndarray) -> np.ndarray:
+    for weight, bias, act in layers:
+        x = x @ weight.T + bias
+        if act == ACT_RELU:
+            x = np.maximum(x, 0.0)
+    return x
+
+
+def iqn_forward(blocks, state: np.ndarray, taus: np.ndarray) -> np.ndarray:
+    """numpy 参考实现，返回 [B, num_workers, num_quantiles]"""
+    state_net, cos_net, head = blocks
+    h = mlp_forward(state_net, state)                                   # [B, H]
+    n_cos = cos_net[0][0].shape[1]
+    cos = np.cos(np.pi * np.arange(n_cos)[None, :] * taus[:, None])     # [Q, n_cos]
+    phi = mlp_forward(cos_net, cos.astype(np.float32))                  # [Q, H]
+    z = mlp_forward(head, h[:, None, :] * phi[None, :, :])              # [B, Q, W]
+    return np.transpose(z, (0, 2, 1))
+
+
+def verify(module, path: str, samples: int, tol: float) -> bool:
+    import torch
+
+    kind, blocks = read_native_model(path)
+    rng = np.random.default_rng(0)
+    in_dim = blocks[0][0][0].shape[1]
+    state = rng.uniform(0.0, 1.0, size=(samples, in_dim)).astype(np.float32)
+
+    with torch.no_grad():
+        if kind == KIND_MLP:
+            expected = module(torch.from_numpy(state)).numpy()
+            actual = mlp_forward(blocks[0], state)
+        else:
+            taus = quantile_samples()
+            tau_batch = np.broadcast_to(taus, (samples, len(taus))).copy()
+            expected = module(torch.from_numpy(state), torch.from_numpy(tau_batch)).numpy()
+            actual = iqn_forward(blocks, state, taus)
+
+    if expected.shape != actual.shape:
+        print(f"[verify] shape mismatch: torch {expected.shape} vs native {actual.shape}")
+        return False
+    err = np.abs(expected - actual)
+    scale = np.maximum(np.abs(expected), 1.0)
+    rel = float(np.max(err / scale))
+    print(f"[verify] {samples} samples, max abs err {float(np.max(err)):.3e}, "
+          f"max rel err {rel:.3e} (tol {tol:.0e})")
+    return rel <= tol
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Export TorchScript models for native inference')
+    parser.add_argument('--model', required=True, help='TorchScript model (.pt)')
+    parser.add_argument('--output', required=True, help='Output weight file (.bin)')
+    parser.add_argument('--kind', choices=['mlp', 'iqn'], required=True)
+    parser.add_argument('--state-prefix', default='state_net.', help='IQN state encoder prefix')
+    parser.add_argument('--cos-prefix', default='cos_embedding.', help='IQN cosine embedding prefix')
+    parser.add_argument('--head-prefix', default='head.', help='IQN output head prefix')
+    parser.add_argument('--verify', type=int, default=64, help='Random samples for parity check (0 = off)')
+    parser.add_argument('--tol', type=float, default=1e-4, help='Max relative error for parity check')
+    args = parser.parse_args()
+
+    import torch
+
+    module = torch.jit.load(args.model, map_location='cpu')
+    module.eval()
+    state_dict = module.state_dict()
+
+    with open(args.output, 'wb') as f:
+        if args.kind == 'mlp':
+            f.write(struct.pack('<4sII', MAGIC, VERSION, KIND_MLP))
+            layers = with_activations(collect_linear_layers(state_dict), final_relu=False)
+            write_mlp_block(f, layers)
+            print(f"MLP: {len(layers)} layers, input {layers[0][0].shape[1]}, "
+                  f"output {layers[-1][0].shape[0]}")
+        else:
+            f.write(struct.pack('<4sII', MAGIC, VERSION, KIND_IQN))
+            state_net = with_activations(
+                collect_linear_layers(state_dict, args.state_prefix), final_relu=True)
+            cos_net = with_activations(
+                collect_linear_layers(state_dict, args.cos_prefix), final_relu=True)
+            head = with_activations(
+                collect_linear_layers(state_dict, args.head_prefix), final_relu=False)
+            if len(cos_net) != 1:
+                raise ValueError('cosine embedding must be a single Linear layer')
+            for block in (state_net, cos_net, head):
+                write_mlp_block(f, block)
+            print(f"IQN: state {state_net[0][0].shape[1]} -> {state_net[-1][0].shape[0]}, "
+                  f"n_cos {cos_net[0][0].shape[1]}, {len(head)} head layers, "
+                  f"{head[-1][0].shape[0]} outputs")
+
+    print(f"Wrote {args.output}")
+
+    if args.verify > 0 and not verify(module, args.output, args.verify, args.tol):
+        print('[verify] FAILED: native weights do not reproduce the TorchScript model')
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
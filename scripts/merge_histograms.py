@@ -2,10 +2,18 @@
 """
 合并多个 HdrHistogram 文件并计算全局百分位
 
+编译出的 histogram_merge (tools/histogram_merge.cpp) 做同样的无损合并且不依赖 Python 包，
+本脚本保留用于没有构建目录的分析机器，以及旧版 CLASSIC 文本格式的 .hdr。
+
 用法:
     python3 merge_histograms.py \
         --inputs "results/exp_a/client_*/*.hdr" \
         --output "results/exp_a/combined_latency.csv"
+
+    # 区间日志 (.hlog) 无损合并，跳过 30s 预热
+    python3 merge_histograms.py \
+        --inputs "results/exp_a/client_*/e2e_latency.hlog" \
+        --output "results/exp_a/combined_latency.csv" --start_sec 30
 """
 
 import argparse
@@ -15,7 +23,7 @@ from pathlib import Path
 import sys
 
 
-def parse_hdr_classic(path: str) -> np.ndarray:
+def parse_hdr_classic(path: str) -> tuple:
     """
     解析 HdrHistogram 的 CLASSIC 格式输出
     
@@ -25,9 +33,13 @@ def parse_hdr_classic(path: str) -> np.ndarray:
     Value     Percentile TotalCount 1/(1-Percentile)
     1.000     0.000000      1        1.00
     ...
+    
+    TotalCount 是累计计数，相邻两行之差即该值的样本数。
+    精度受百分位表的行数限制，需要无损结果请使用 .hlog。
     """
     values = []
     counts = []
+    prev_total = 0
     
     with open(path, 'r') as f:
         for line in f:
@@ -39,37 +51,51 @@ def parse_hdr_classic(path: str) -> np.ndarray:
             if len(parts) >= 3:
                 try:
                     value = float(parts[0])
-                    count = int(float(parts[2]))
-                    
-                    # 下采样大量计数以控制内存
-                    sample_count = min(count, 1000)
-                    values.extend([value] * sample_count)
+                    total = int(float(parts[2]))
                 except (ValueError, IndexError):
                     continue
+                if total > prev_total:
+                    values.append(value)
+                    counts.append(total - prev_total)
+                    prev_total = total
     
-    return np.array(values)
+    return np.array(values), np.array(counts, dtype=np.int64)
 
 
-def parse_hdr_log(path: str) -> np.ndarray:
+def parse_hdr_log(path: str, start_sec: float = 0.0) -> tuple:
     """
-    解析 HdrHistogram Log 格式 (Base64 编码)
+    解析 HdrHistogram Log 格式 (.hlog，每行一个压缩 + base64 的区间直方图)
     
-    这是更紧凑的格式，需要专用库解析
-    简化版本：直接读取原始值
+    把 start_sec 之后的所有区间相加 (无损)，可用于跳过预热期。
+    需要 hdrh 包: pip install hdrhistogram
     """
-    # 对于 Log 格式，建议使用 hdrhistogram 包
-    # pip install hdrhistogram
     try:
-        from hdrhistogram import HdrHistogram
-        # TODO: 实现 Log 格式解析
-        pass
+        from hdrh.histogram import HdrHistogram
+        from hdrh.log import HistogramLogReader
     except ImportError:
-        pass
+        print(f"  hdrh not installed, skipping {path} (pip install hdrhistogram)",
+              file=sys.stderr)
+        return np.array([]), np.array([], dtype=np.int64)
+    
+    # 与 LatencyHistogram 的默认参数一致: 1ns - 10s, 3 位有效数字
+    total = HdrHistogram(1, 10_000_000_000, 3)
+    reader = HistogramLogReader(path, HdrHistogram(1, 10_000_000_000, 3))
+    while True:
+        interval = reader.get_next_interval_histogram(range_start_time_sec=start_sec)
+        if interval is None:
+            break
+        total.add(interval)
+    reader.close()
     
-    return np.array([])
+    values = []
+    counts = []
+    for item in total.get_recorded_iterator():
+        values.append(float(item.value_iterated_to))
+        counts.append(item.count_at_value_iterated_to)
+    return np.array(values), np.array(counts, dtype=np.int64)
 
 
-def parse_raw_csv(path: str) -> np.ndarray:
+def parse_raw_csv(path: str) -> tuple:
     """
     解析简单的 CSV 格式延迟数据
     
@@ -91,52 +117,62 @@ def parse_raw_csv(path: str) -> np.ndarray:
             except (ValueError, IndexError):
                 continue
     
-    return np.array(values)
+    return np.array(values), np.ones(len(values), dtype=np.int64)
 
 
-def load_latencies(path: str) -> np.ndarray:
+def load_latencies(path: str, start_sec: float = 0.0) -> tuple:
     """
     根据文件类型自动选择解析方法
+    
+    返回: (values, counts) 每个延迟值及其样本数
     """
-    if path.endswith('.hdr'):
-        return parse_hdr_classic(path)
+    if path.endswith('.hlog'):
+        return parse_hdr_log(path, start_sec)
     elif path.endswith('.csv'):
         return parse_raw_csv(path)
-    else:
-        # 尝试自动检测
-        with open(path, 'r') as f:
-            first_line = f.readline().strip()
-            
-        if first_line.startswith('#') or 'Value' in first_line:
-            return parse_hdr_classic(path)
-        else:
-            return parse_raw_csv(path)
+    
+    # .hdr 及其他: 按内容检测 (新版 .hdr 为日志格式，旧版为 CLASSIC 百分位表)
+    with open(path, 'r') as f:
+        first_line = f.readline().strip()
+        second_line = f.readline().strip()
+    
+    if 'Histogram log format' in first_line + second_line:
+        return parse_hdr_log(path, start_sec)
+    if path.endswith('.hdr') or first_line.startswith('#') or 'Value' in first_line:
+        return parse_hdr_classic(path)
+    return parse_raw_csv(path)
 
 
-def compute_percentiles(latencies: np.ndarray, percentiles: list) -> dict:
+def value_at_percentile(values: np.ndarray, cum_counts: np.ndarray, p: float):
+    """
+    加权百分位 (与 hdr_value_at_percentile 相同口径: 累计计数首次达到 p% 的值)
+    """
+    total = cum_counts[-1]
+    target = max(int(np.ceil(p / 100.0 * total)), 1)
+    idx = min(int(np.searchsorted(cum_counts, target)), len(values) - 1)
+    return values[idx]
+
+
+def compute_percentiles(values: np.ndarray, cum_counts: np.ndarray, percentiles: list) -> dict:
     """
     计算指定百分位
     """
     results = {}
     for p in percentiles:
-        results[f'P{p}'] = np.percentile(latencies, p)
+        results[f'P{p}'] = value_at_percentile(values, cum_counts, p)
     return results
 
 
-def generate_cdf(latencies: np.ndarray, num_points: int = 10000) -> np.ndarray:
+def generate_cdf(values: np.ndarray, cum_counts: np.ndarray, num_points: int = 10000) -> np.ndarray:
     """
     生成 CDF 数据点
     
     返回: [(percentile, latency), ...]
     """
-    sorted_lat = np.sort(latencies)
-    n = len(sorted_lat)
-    
     cdf = []
     for i in range(num_points + 1):
         p = i / num_points * 100
-        idx = min(int(p / 100 * n), n - 1)
-        cdf.append((p, sorted_lat[idx]))
+        cdf.append((p, value_at_percentile(values, cum_counts, p)))
     
     return np.array(cdf)
 
@@ -150,6 +186,9 @@ def main():
     parser.add_argument('--unit', type=str, default='us',
                        choices=['ns', 'us', 'ms'],
                        help='Output latency unit (default: us)')
+    parser.add_argument('--start_sec', type=float, default=0.0,
+                       help='For .hlog inputs, skip intervals before this many seconds '
+                            '(e.g. the warmup; default: 0)')
     args = parser.parse_args()
     
     # 查找所有输入文件
@@ -161,40 +200,54 @@ def main():
     print(f"Found {len(files)} input file(s)")
     
     # 加载所有延迟数据
-    all_latencies = []
+    all_values = []
+    all_counts = []
     for path in files:
         print(f"  Loading {path}...")
-        lat = load_latencies(path)
-        if len(lat) > 0:
-            all_latencies.append(lat)
-            print(f"    -> {len(lat)} samples, P50={np.median(lat)/1000:.2f}us")
+        values, counts = load_latencies(path, args.start_sec)
+        if counts.sum() > 0:
+            all_values.append(values)
+            all_counts.append(counts)
+            order = np.argsort(values, kind='stable')
+            p50 = value_at_percentile(values[order], np.cumsum(counts[order]), 50)
+            print(f"    -> {counts.sum()} samples, P50={p50/1000:.2f}us")
     
-    if not all_latencies:
+    if not all_values:
         print("No latency data found!", file=sys.stderr)
         sys.exit(1)
     
-    # 合并
-    combined = np.concatenate(all_latencies)
-    print(f"\nTotal samples: {len(combined)}")
+    # 合并: 按值排序后累计计数
+    values = np.concatenate(all_values)
+    counts = np.concatenate(all_counts)
+    order = np.argsort(values, kind='stable')
+    values = values[order]
+    counts = counts[order]
+    cum_counts = np.cumsum(counts)
+    total = int(cum_counts[-1])
+    print(f"\nTotal samples: {total}")
     
     # 单位转换
     divisor = {'ns': 1, 'us': 1000, 'ms': 1000000}[args.unit]
-    combined_scaled = combined / divisor
+    values_scaled = values / divisor
     
     # 计算统计
     percentiles = [50, 90, 95, 99, 99.5, 99.9, 99.99]
-    stats = compute_percentiles(combined_scaled, percentiles)
+    stats = compute_percentiles(values_scaled, cum_counts, percentiles)
+    mean = float(np.sum(values_scaled * counts) / total)
+    stddev = float(np.sqrt(np.sum(counts * (values_scaled - mean) ** 2) / total))
+    min_value = values_scaled[0]
+    max_value = values_scaled[-1]
     
     print(f"\n=== Combined Latency Statistics ({args.unit}) ===")
-    print(f"  Mean:   {np.mean(combined_scaled):.2f}")
-    print(f"  Stddev: {np.std(combined_scaled):.2f}")
-    print(f"  Min:    {np.min(combined_scaled):.2f}")
-    print(f"  Max:    {np.max(combined_scaled):.2f}")
+    print(f"  Mean:   {mean:.2f}")
+    print(f"  Stddev: {stddev:.2f}")
+    print(f"  Min:    {min_value:.2f}")
+    print(f"  Max:    {max_value:.2f}")
     for name, value in stats.items():
         print(f"  {name}: {value:.2f}")
     
     # 生成 CDF
-    cdf = generate_cdf(combined_scaled)
+    cdf = generate_cdf(values_scaled, cum_counts)
     
     # 导出
     output_path = Path(args.output)
@@ -210,12 +263,12 @@ def main():
     # 同时导出摘要
     summary_path = output_path.with_suffix('.summary.txt')
     with open(summary_path, 'w') as f:
-        f.write(f"Total Samples: {len(combined)}\n")
+        f.write(f"Total Samples: {total}\n")
         f.write(f"Unit: {args.unit}\n")
-        f.write(f"Mean: {np.mean(combined_scaled):.4f}\n")
-        f.write(f"Stddev: {np.std(combined_scaled):.4f}\n")
-        f.write(f"Min: {np.min(combined_scaled):.4f}\n")
-        f.write(f"Max: {np.max(combined_scaled):.4f}\n")
+        f.write(f"Mean: {mean:.4f}\n")
+        f.write(f"Stddev: {stddev:.4f}\n")
+        f.write(f"Min: {min_value:.4f}\n")
+        f.write(f"Max: {max_value:.4f}\n")
         for name, value in stats.items():
             f.write(f"{name}: {value:.4f}\n")
     
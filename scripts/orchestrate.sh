@@ -42,7 +42,10 @@ DURATION_SEC=120        # 每轮实验持续时间
 WARMUP_SEC=30           # 预热时间
 TARGET_RPS=500000       # 目标 RPS
 PARETO_ALPHA=1.2        # Pareto 分布参数 (重尾)
+ARRIVAL=poisson         # 到达过程 (deterministic|poisson|onoff|trace)
 SERVICE_TIME_MIN_US=10  # 最小服务时间
+LB_THREADS=2            # LB 派发线程数 (每线程一个 eRPC 端点)
+STATE_PUSH_US=100       # Worker 向 LB 推送状态的周期 (μs)
 
 # 模型路径
 MALCOLM_MODEL="$PROJECT_ROOT/models/malcolm_nash.pt"
@@ -184,14 +187,14 @@ start_workers() {
     # Fast Workers
     for node in "${FAST_WORKERS[@]}"; do
         log "  Starting $node (FAST, id=$worker_id)"
-        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $RESULTS_DIR && $BUILD_DIR/worker --id=$worker_id --port=31850 --mode=fast --scheduler=$scheduler --output=$RESULTS_DIR/worker_${worker_id} > $LOG_DIR/worker_${worker_id}.log 2>&1"
+        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $RESULTS_DIR && $BUILD_DIR/worker --id=$worker_id --port=31850 --mode=fast --scheduler=$scheduler --lb=${NODES[$LB_NODE]}:31850 --state_push_us=$STATE_PUSH_US --output=$RESULTS_DIR/worker_${worker_id} > $LOG_DIR/worker_${worker_id}.log 2>&1"
         ((worker_id++))
     done
     
     # Slow Workers - 使用 cgroups v2 限制到 20% CPU
     for node in "${SLOW_WORKERS[@]}"; do
         log "  Starting $node (SLOW, id=$worker_id) with 20% CPU limit"
-        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $RESULTS_DIR && (echo \$\$ | sudo tee /sys/fs/cgroup/malcolm_slow/cgroup.procs >/dev/null; exec $BUILD_DIR/worker --id=$worker_id --port=31850 --mode=slow --scheduler=$scheduler --output=$RESULTS_DIR/worker_${worker_id}) > $LOG_DIR/worker_${worker_id}.log 2>&1"
+        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $RESULTS_DIR && (echo \$\$ | sudo tee /sys/fs/cgroup/malcolm_slow/cgroup.procs >/dev/null; exec $BUILD_DIR/worker --id=$worker_id --port=31850 --mode=slow --scheduler=$scheduler --lb=${NODES[$LB_NODE]}:31850 --state_push_us=$STATE_PUSH_US --output=$RESULTS_DIR/worker_${worker_id}) > $LOG_DIR/worker_${worker_id}.log 2>&1"
         ((worker_id++))
     done
     
@@ -218,7 +221,7 @@ start_load_balancer() {
         model_opt="--model=$model_path"
     fi
     
-    ssh_run_bg "$LB_NODE" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR && $BUILD_DIR/load_balancer --algorithm=$algorithm --port=31850 --workers=$worker_list $model_opt > $LOG_DIR/lb.log 2>&1"
+    ssh_run_bg "$LB_NODE" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR && $BUILD_DIR/load_balancer --algorithm=$algorithm --port=31850 --workers=$worker_list --threads=$LB_THREADS $model_opt > $LOG_DIR/lb.log 2>&1"
     
     sleep 2
 }
@@ -232,7 +235,7 @@ start_clients() {
     
     for node in "${CLIENT_NODES[@]}"; do
         log "  Starting $node (client_id=$client_id, target_rps=$rps_per_client)"
-        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $output_dir && $BUILD_DIR/client --id=$client_id --lb=${NODES[$LB_NODE]}:31850 --threads=8 --target_rps=$rps_per_client --duration=$DURATION_SEC --warmup=$WARMUP_SEC --pareto_alpha=$PARETO_ALPHA --output=$output_dir/client_${client_id} > $LOG_DIR/client_${client_id}.log 2>&1"
+        ssh_run_bg "$node" "cd $PROJECT_ROOT && mkdir -p $LOG_DIR $output_dir && $BUILD_DIR/client --id=$client_id --lb=${NODES[$LB_NODE]}:31850 --lb_threads=$LB_THREADS --threads=8 --target_rps=$rps_per_client --arrival=$ARRIVAL --duration=$DURATION_SEC --warmup=$WARMUP_SEC --pareto_alpha=$PARETO_ALPHA --output=$output_dir/client_${client_id} > $LOG_DIR/client_${client_id}.log 2>&1"
         ((client_id++))
     done
 }
@@ -256,8 +259,13 @@ collect_results() {
         scp "${NODES[$node]}:$LOG_DIR/*.log" "$output_dir/" 2>/dev/null || true
     done
     
-    # 合并直方图
-    if [ -f "$SCRIPT_DIR/merge_histograms.py" ]; then
+    # 合并直方图 (优先使用编译出的无损合并工具)
+    if [ -x "$BUILD_DIR/histogram_merge" ]; then
+        "$BUILD_DIR/histogram_merge" \
+            --output="$output_dir/combined_latency" \
+            "$output_dir"/client_*/e2e_latency.hdr \
+            2>/dev/null || true
+    elif [ -f "$SCRIPT_DIR/merge_histograms.py" ]; then
         python3 "$SCRIPT_DIR/merge_histograms.py" \
             --inputs "$output_dir/client_*/*.hdr" \
             --output "$output_dir/combined_latency.csv" \
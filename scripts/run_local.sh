@@ -0,0 +1,105 @@
+#!/bin/bash
+# 单机端到端实验 (共享内存或 UDP 传输，不需要 RDMA 网卡)
+# 使用方法: ./scripts/run_local.sh [algorithm]
+# algorithm: po2, malcolm, malcolm_strict
+#
+# 可用环境变量覆盖: TRANSPORT(shm|udp) BUILD_DIR NUM_WORKERS DURATION WARMUP TARGET_RPS OUTPUT_DIR
+
+ALGORITHM=${1:-po2}
+TRANSPORT=${TRANSPORT:-shm}
+BUILD_DIR=${BUILD_DIR:-build}
+NUM_WORKERS=${NUM_WORKERS:-3}
+DURATION=${DURATION:-10}   # 秒
+WARMUP=${WARMUP:-2}
+TARGET_RPS=${TARGET_RPS:-20000}
+OUTPUT_DIR=${OUTPUT_DIR:-results/local_${TRANSPORT}_${ALGORITHM}}
+
+# 端口沿用多机部署的约定: Worker 31850+, LB 31860+ (udp 下每个 LB 线程占一个端口)
+WORKER_BASE_PORT=31850
+LB_PORT=31860
+LB_THREADS=2
+
+echo "=========================================="
+echo "Malcolm-Strict Local Experiment ($TRANSPORT transport)"
+echo "Algorithm: $ALGORITHM"
+echo "Workers:   $NUM_WORKERS"
+echo "Duration:  ${DURATION}s (warmup: ${WARMUP}s)"
+echo "Target RPS: $TARGET_RPS"
+echo "=========================================="
+
+for bin in worker load_balancer client; do
+    if [ ! -x "$BUILD_DIR/$bin" ]; then
+        echo "Missing $BUILD_DIR/$bin, build first (cmake -B $BUILD_DIR && cmake --build $BUILD_DIR)"
+        exit 1
+    fi
+done
+
+# 每个进程写自己的子目录 (二进制也会自行创建，这里提前建好便于检查权限)
+mkdir -p "$OUTPUT_DIR/lb" "$OUTPUT_DIR/client_0" logs || exit 1
+for ((i = 0; i < NUM_WORKERS; i++)); do
+    mkdir -p "$OUTPUT_DIR/worker_$i" || exit 1
+done
+PIDS=()
+
+cleanup() {
+    echo ""
+    echo "=== Cleaning up ==="
+    for pid in "${PIDS[@]}"; do
+        kill -INT "$pid" 2>/dev/null
+    done
+    wait
+    echo "Done"
+}
+
+trap cleanup EXIT
+
+# Step 1: 启动 Workers (第一个为 fast，其余 slow，模拟异构集群)
+echo ""
+echo "=== Step 1: Starting Workers ==="
+WORKER_LIST=""
+for ((i = 0; i < NUM_WORKERS; i++)); do
+    port=$((WORKER_BASE_PORT + i))
+    mode=slow
+    [ $i -eq 0 ] && mode=fast
+    WORKER_LIST="${WORKER_LIST:+$WORKER_LIST,}127.0.0.1:$port"
+    echo "Starting Worker $i on port $port ($mode)..."
+    "$BUILD_DIR/worker" --transport=$TRANSPORT --id=$i --port=$port --mode=$mode --threads=1 \
+        --lb=127.0.0.1:$LB_PORT --output="$OUTPUT_DIR/worker_$i" > logs/local_worker_$i.log 2>&1 &
+    PIDS+=($!)
+done
+
+# Step 2: 启动 Load Balancer
+echo ""
+echo "=== Step 2: Starting Load Balancer ==="
+"$BUILD_DIR/load_balancer" --transport=$TRANSPORT --port=$LB_PORT --workers=$WORKER_LIST \
+    --algorithm=$ALGORITHM --threads=$LB_THREADS --output="$OUTPUT_DIR/lb" > logs/local_lb.log 2>&1 &
+PIDS+=($!)
+
+# 会话在服务端就绪前自动重试，这里只是给进程留出初始化时间
+sleep 2
+
+# Step 3: 运行 Client (前台，跑完即结束)
+echo ""
+echo "=== Step 3: Running Client ==="
+"$BUILD_DIR/client" --transport=$TRANSPORT --id=0 --lb=127.0.0.1:$LB_PORT --lb_threads=$LB_THREADS \
+    --threads=2 --target_rps=$TARGET_RPS --duration=$DURATION --warmup=$WARMUP \
+    --output="$OUTPUT_DIR/client_0" 2>&1 | tee logs/local_client.log
+CLIENT_STATUS=${PIPESTATUS[0]}
+
+# Step 4: 停止 LB / Workers，等待它们导出指标
+cleanup
+trap - EXIT
+
+if [ ! -f "$OUTPUT_DIR/client_0/e2e_latency.hdr" ]; then
+    echo ""
+    echo "Missing $OUTPUT_DIR/client_0/e2e_latency.hdr, see logs/local_client.log"
+elif [ -x "$BUILD_DIR/histogram_merge" ]; then
+    echo ""
+    echo "=== Step 4: E2E Latency ==="
+    "$BUILD_DIR/histogram_merge" --output="$OUTPUT_DIR/combined_latency" \
+        "$OUTPUT_DIR"/client_*/e2e_latency.hdr
+fi
+
+echo ""
+echo "Results: $OUTPUT_DIR"
+exit $CLIENT_STATUS
@@ -10,14 +10,13 @@
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <memory>
 
 #include "../common/types.h"
 #include "../common/metrics.h"
 #include "../common/workload.h"
 #include "../common/rpc_types.h"
-
-// eRPC
-#include "rpc.h"
+#include "../transport/transport.h"
 
 namespace malcolm {
 
@@ -27,15 +26,19 @@ namespace malcolm {
 struct ClientConfig {
     uint8_t client_id = 0;
     std::string lb_address;         // Load Balancer 地址 (ip:port)
+    size_t lb_threads = constants::kDefaultLBThreads;  // LB 派发线程数 (须与 LB --threads 一致)
+    TransportType transport = kDefaultTransport;
     
-    size_t num_threads = 8;         // 并发发送线程数
-    uint64_t target_rps = 100000;   // 目标 RPS (总计)
+    size_t num_threads = 8;         // 发送线程数 (每个线程独立的传输端点)
+    uint64_t target_rps = 100000;   // 目标 RPS (总计，均分到各发送线程)
+    size_t max_inflight = 1024;     // 每个发送线程的在途请求上限 (= 缓冲区池大小)
     
     uint32_t duration_sec = 120;    // 实验持续时间
     uint32_t warmup_sec = 30;       // 预热时间 (不记录指标)
     
     // 工作负载配置
     RequestGenerator::Config workload;
+    ArrivalConfig arrival;          // 到达过程 (开环，默认 Poisson)
     
     // 模拟参数 - 命中 slow worker 的概率
     // Po2: ~0.6 (随机选2个，3/5是slow)
@@ -45,11 +48,61 @@ struct ClientConfig {
     
     // 输出
     std::string output_dir;
+    uint32_t metrics_interval_ms = 1000;  // 区间直方图时间序列周期 (0 = 只导出累计直方图)
     bool verbose = false;
 };
 
+class ClientContext;
+
+/**
+ * 发送线程上下文
+ *
+ * 传输端点 (eRPC 的 Rpc 等) 不是线程安全的，因此每个发送线程拥有:
+ * - 独立的传输端点 (rpc_id = 线程编号) 和到 LB 的会话
+ * - 独立的请求生成器和请求/响应缓冲区池 (空闲槽位栈，槽位号作为请求 tag)
+ * - 独立的指标收集器 (结束时合并)
+ * 计数器只由所属线程写入，主线程读取用于进度报告。
+ */
+struct ClientSender {
+    ClientSender(ClientContext* owner, size_t id, RequestGenerator&& generator,
+                 ArrivalProcess&& arrival_process)
+        : client(owner), thread_id(id), gen(std::move(generator)),
+          arrivals(std::move(arrival_process)) {}
+    
+    ClientContext* client;
+    size_t thread_id;
+    RequestGenerator gen;
+    ArrivalProcess arrivals;   // 计划发送时间 (相对连接建立时刻)
+    
+    std::unique_ptr<Transport> rpc;
+    int lb_session = -1;
+    
+    // 缓冲区池: 槽位 i 对应 req_bufs[i] / resp_bufs[i]
+    std::vector<MsgBuffer> req_bufs;
+    std::vector<MsgBuffer> resp_bufs;
+    std::vector<Timestamp> req_intended;    // 每个槽位请求的计划发送时间 (延迟从此起算)
+    std::vector<Timestamp> req_deadlines;   // 每个槽位请求的 Deadline (客户端时钟域)
+    std::vector<uint32_t> free_slots;       // 空闲槽位栈
+    
+    MetricsCollector metrics;
+    LatencyHistogram send_lag;   // 实际发送时间 - 计划发送时间
+    bool in_warmup = true;
+    
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> slot_stalls{0};  // 到了发送时间却没有空闲槽位的次数
+    
+    size_t inflight() const { return req_bufs.size() - free_slots.size(); }
+};
+
 /**
  * Client 运行时上下文
+ *
+ * 线程模型:
+ * - num_threads 个发送线程，各自运行传输端点的事件循环，按到达过程 (平均 target_rps / num_threads)
+ *   的计划时间开环发送: 落后时连续补发，延迟从计划时间起算，落后量记入 send_lag
+ * - 各发送线程连接 LB 的不同派发线程 (远端 rpc_id 按 client_id 和线程编号分散)
+ * - 调用 run() 的主线程只负责进度报告，结束后合并各线程的指标
  */
 class ClientContext {
 public:
@@ -65,7 +118,7 @@ public:
     /// 导出结果
     void export_results();
     
-    /// 获取统计摘要
+    /// 获取统计摘要 (延迟百分位在 run() 合并指标后才有效)
     struct Stats {
         uint64_t total_requests;
         uint64_t successful_requests;
@@ -78,55 +131,44 @@ public:
     Stats get_stats() const;
     
 private:
-    /// 发送线程主循环
+    /// 发送线程主循环 (创建传输端点、连接 LB、运行事件循环并发送)
     void sender_thread_main(size_t thread_id);
     
+    /// 在发送线程上发送一个计划在 intended 时刻发出的请求 (调用前须确认有空闲槽位)
+    void send_request(ClientSender* s, Timestamp intended);
+    
     /// 处理响应
     void handle_response(const ClientResponse* response);
     
-    /// 速率控制
-    void rate_limit(size_t thread_id);
-    
 private:
     ClientConfig config_;
     
     std::atomic<bool> running_{false};
-    std::atomic<bool> in_warmup_{true};
     std::vector<std::thread> threads_;
     
-    // 请求生成器
-    std::vector<RequestGenerator> generators_;
+    // 发送线程上下文 (下标 = rpc_id)
+    std::vector<std::unique_ptr<ClientSender>> senders_;
+    
+    // 一轮事件循环最多补发的请求数 (落后时仍保证及时处理响应)
+    static constexpr size_t kMaxSendBurst = 32;
     
-    // 指标收集
+    // 指标收集 (结束后由各发送线程的指标合并而成)
     MetricsCollector metrics_;
-    ThroughputCounter throughput_;
+    LatencyHistogram send_lag_;
     
-    // 计数器
-    std::atomic<uint64_t> sent_requests_{0};
-    std::atomic<uint64_t> completed_requests_{0};
+    // 区间直方图时间序列 (包含预热期，未启用时为空)
+    std::unique_ptr<IntervalMetricsLog> interval_log_;
+    IntervalHistogram* interval_latency_ = nullptr;
     
     // 时间控制
     Timestamp start_time_{0};
+    Timestamp warmup_end_{0};
     Timestamp end_time_{0};
     
-    // eRPC 上下文
-    erpc::Nexus* nexus_ = nullptr;
-    erpc::Rpc<erpc::CTransport>* rpc_ = nullptr;
-    int lb_session_ = -1;
-    
-    // 请求缓冲区池
-    std::vector<erpc::MsgBuffer> req_bufs_;
-    std::vector<erpc::MsgBuffer> resp_bufs_;
-    std::atomic<size_t> buf_idx_{0};
-
-    // [NEW] 本地存储每個 slot 對應請求的 Deadline (纳秒)
-    std::vector<Timestamp> req_deadlines_;
-    
-    // 并发控制 - 限制同时在途请求数
-    std::atomic<size_t> inflight_requests_{0};
-    static constexpr size_t kMaxInflight = 64;  // 最大同时在途请求
+    // 传输上下文 (所有发送线程共享)
+    std::unique_ptr<TransportNexus> nexus_;
     
-    // 响应回调
+    // 响应回调 (context 为 ClientSender*)
     static void response_callback(void* context, void* tag);
 };
 
@@ -1,5 +1,5 @@
 /**
- * Client 上下文实现 - 真正的 eRPC 客户端
+ * Client 上下文实现 - 经传输层 (eRPC / 共享内存) 连接 LB 的客户端
  */
 
 #include "client_context.h"
@@ -35,22 +35,52 @@ static std::string get_local_ip() {
     return result;
 }
 
-// 全局客户端上下文
-static ClientContext* g_client_ctx = nullptr;
-
 ClientContext::ClientContext(const ClientConfig& config)
     : config_(config) {
     
-    // 为每个线程创建独立的请求生成器
-    generators_.reserve(config_.num_threads);
+    if (config_.num_threads == 0) {
+        config_.num_threads = 1;
+    }
+    if (config_.max_inflight == 0) {
+        config_.max_inflight = 1;
+    }
+    
+    std::shared_ptr<const std::vector<Timestamp>> trace;
+    if (config_.arrival.pattern == ArrivalPattern::kTrace) {
+        auto arrivals = load_arrival_trace(config_.arrival.trace_path);
+        if (arrivals.size() < 2) {
+            fprintf(stderr, "[Client %u] Cannot read arrival trace %s, falling back to deterministic\n",
+                    config_.client_id, config_.arrival.trace_path.c_str());
+        } else {
+            printf("[Client %u] Replaying %zu arrivals from %s (%.1f s per loop)\n",
+                   config_.client_id, arrivals.size() - 1, config_.arrival.trace_path.c_str(),
+                   static_cast<double>(arrivals.back()) / 1e9);
+            trace = std::make_shared<const std::vector<Timestamp>>(std::move(arrivals));
+        }
+    }
+    
+    // 每个发送线程独立的请求生成器和到达过程 (种子固定，确保可重复)
+    // 总速率均分到各线程; trace 按到达顺序交错分给各线程
+    double thread_rps = static_cast<double>(config_.target_rps) / config_.num_threads;
     for (size_t i = 0; i < config_.num_threads; ++i) {
         RequestGenerator gen(config_.workload);
-        gen.set_seed(config_.client_id * 1000 + i);  // 确保可重复
-        generators_.push_back(std::move(gen));
+        gen.set_seed(config_.client_id * 1000 + i);
+        ArrivalProcess arrivals(config_.arrival, thread_rps,
+                                (static_cast<uint64_t>(config_.client_id) << 32) + i + 1,
+                                trace, i, config_.num_threads);
+        senders_.push_back(std::make_unique<ClientSender>(this, i, std::move(gen), std::move(arrivals)));
     }
     
-    printf("[Client %u] Initialized with %zu threads, target RPS=%lu\n",
-           config_.client_id, config_.num_threads, config_.target_rps);
+    if (!config_.output_dir.empty() && config_.metrics_interval_ms > 0) {
+        interval_log_ = std::make_unique<IntervalMetricsLog>(
+            config_.output_dir, config_.metrics_interval_ms);
+        interval_latency_ = &interval_log_->add_series("e2e_latency");
+    }
+    
+    printf("[Client %u] Initialized with %zu sender threads, target RPS=%lu (%s arrivals), "
+           "max inflight=%zu/thread\n",
+           config_.client_id, config_.num_threads, config_.target_rps,
+           arrival_pattern_name(senders_[0]->arrivals.pattern()), config_.max_inflight);
 }
 
 ClientContext::~ClientContext() {
@@ -62,172 +92,91 @@ void ClientContext::run() {
         return;
     }
     
-    g_client_ctx = this;
-    
-    // 初始化 eRPC
+    // 初始化传输上下文 (所有发送线程共享)
     // eRPC 要求端口在 31850-31881 范围内
     // Client 使用 31870 + client_id 避免与 Worker (31850-31859) 和 LB (31860-31869) 冲突
     uint16_t client_port = 31870 + config_.client_id;
     std::string local_ip = get_local_ip();
     std::string local_uri = local_ip + ":" + std::to_string(client_port);
-    printf("[Client %u] Using eRPC port %u, local IP %s\n", config_.client_id, client_port, local_ip.c_str());
-    nexus_ = new erpc::Nexus(local_uri, 0, 0);
-    
-    // Session management handler
-    auto sm_handler = [](int session_num, erpc::SmEventType sm_event_type,
-                         erpc::SmErrType sm_err_type, void *context) {
-        ClientContext* client = static_cast<ClientContext*>(context);
-        printf("[Client %u] Session %d event: %s, error: %s\n",
-               client->config_.client_id, session_num,
-               erpc::sm_event_type_str(sm_event_type).c_str(),
-               erpc::sm_err_type_str(sm_err_type).c_str());
-    };
-    
-    rpc_ = new erpc::Rpc<erpc::CTransport>(
-        nexus_,
-        this,
-        0,           // rpc_id  
-        sm_handler,  // sm_handler (必须提供)
-        1            // phy_port (10.10.1.x network)
-    );
-    
-    // 连接到 Load Balancer
-    printf("[Client %u] Connecting to LB at %s...\n", 
-           config_.client_id, config_.lb_address.c_str());
-    lb_session_ = rpc_->create_session(config_.lb_address, 0);
-    if (lb_session_ < 0) {
-        fprintf(stderr, "[Client %u] Failed to connect to LB\n", config_.client_id);
+    printf("[Client %u] Using %s transport, port %u, local IP %s\n", config_.client_id,
+           transport_type_name(config_.transport), client_port, local_ip.c_str());
+    nexus_ = create_transport_nexus(config_.transport, local_uri);
+    if (!nexus_) {
+        running_.store(false);
         return;
     }
     
-    // 等待连接建立
-    while (!rpc_->is_connected(lb_session_)) {
-        rpc_->run_event_loop_once();
-    }
-    printf("[Client %u] Connected to LB (session=%d)\n", 
-           config_.client_id, lb_session_);
-    
-    // 预分配请求/响应缓冲区
-    size_t buf_pool_size = config_.num_threads * 1000;  // 每线程 1000 个
-    req_bufs_.resize(buf_pool_size);
-    resp_bufs_.resize(buf_pool_size);
-    for (size_t i = 0; i < buf_pool_size; ++i) {
-        req_bufs_[i] = rpc_->alloc_msg_buffer_or_die(sizeof(RpcClientRequest));
-        resp_bufs_[i] = rpc_->alloc_msg_buffer_or_die(sizeof(RpcClientResponse));
-    }
-    // [NEW] 初始化本地 deadline 数组
-    req_deadlines_.resize(buf_pool_size, 0);
-    
     start_time_ = now_ns();
-    end_time_ = start_time_ + ms_to_ns(
-        (config_.warmup_sec + config_.duration_sec) * 1000
-    );
+    warmup_end_ = start_time_ + ms_to_ns(config_.warmup_sec * 1000);
+    end_time_ = warmup_end_ + ms_to_ns(config_.duration_sec * 1000);
     
     printf("[Client %u] Starting experiment (warmup=%us, duration=%us)\n",
            config_.client_id, config_.warmup_sec, config_.duration_sec);
     
-    // eRPC 要求所有 RPC 操作在创建 Rpc 的同一线程中执行
-    // 因此在主线程中同时运行事件循环和发送请求
-    printf("[Client %u] Running in single-threaded mode for eRPC compatibility\n",
-           config_.client_id);
+    if (interval_log_ && !interval_log_->start()) {
+        fprintf(stderr, "[Client %u] Interval metrics log incomplete under %s\n",
+                config_.client_id, config_.output_dir.c_str());
+    }
     
-    auto& gen = generators_[0];
-    uint64_t rps = config_.target_rps;
-    Timestamp interval_ns = rps > 0 ? 1'000'000'000 / rps : 1'000'000;
-    Timestamp next_send = now_ns();
-    uint64_t local_req_id = 0;
+    // 传输端点的所有操作都须在创建它的线程中执行，每个发送线程创建自己的端点
+    for (size_t i = 0; i < senders_.size(); ++i) {
+        threads_.emplace_back([this, i]() {
+            sender_thread_main(i);
+        });
+    }
     
-    // 进度监控变量
-    Timestamp warmup_end = start_time_ + ms_to_ns(config_.warmup_sec * 1000);
+    // 主线程只做进度报告 (读取各线程的计数器)
+    bool warmup_reported = false;
     Timestamp last_report = start_time_;
-    
-    printf("[Client %u] Starting main loop (interval=%lu ns)\n", 
-           config_.client_id, interval_ns);
-    
+    uint64_t last_completed = 0;
     while (running_.load() && now_ns() < end_time_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
         Timestamp now = now_ns();
         
-        // 运行 eRPC 事件循环处理响应 (需要多次调用以处理所有待处理事件)
-        // 增加到 200 次以确保响应被及时处理，尤其是当 inflight 较高时
-        for (int i = 0; i < 200; ++i) {
-            rpc_->run_event_loop_once();
+        if (!warmup_reported && now >= warmup_end_) {
+            warmup_reported = true;
+            printf("[Client %u] Warmup complete, starting measurement\n", config_.client_id);
         }
         
-        // 检查预热结束
-        if (in_warmup_.load() && now >= warmup_end) {
-            in_warmup_.store(false);
-            metrics_.reset();
-            printf("[Client %u] Warmup complete, starting measurement\n",
-                   config_.client_id);
-        }
-        
-        // 定期报告进度
         if (now - last_report >= ms_to_ns(5000)) {  // 每 5 秒
             auto stats = get_stats();
-            printf("[Client %u] Progress: sent=%lu completed=%lu inflight=%zu RPS=%.0f P99=%.1fus\n",
-                   config_.client_id,
-                   sent_requests_.load(),
-                   completed_requests_.load(),
-                   inflight_requests_.load(),
-                   stats.actual_rps,
-                   stats.p99_latency_us);
+            double rps = static_cast<double>(stats.successful_requests - last_completed) * 1e9 /
+                         static_cast<double>(now - last_report);
+            printf("[Client %u] Progress: sent=%lu completed=%lu inflight=%lu RPS=%.0f\n",
+                   config_.client_id, stats.total_requests, stats.successful_requests,
+                   stats.total_requests - stats.successful_requests, rps);
             last_report = now;
+            last_completed = stats.successful_requests;
         }
-        
-        // 发送请求 (如果到了发送时间且有可用槽位)
-        // 关键：不能让 inflight 超过缓冲区数量，否则缓冲区会被覆盖
-        size_t available_bufs = req_bufs_.size() - inflight_requests_.load();
-        if (now >= next_send && inflight_requests_.load() < kMaxInflight && available_bufs > 0) {
-            // 生成请求
-            ClientRequest creq = gen.generate();
-            creq.request_id = local_req_id++;
-            creq.client_send_time = now_ns();
-            
-            // 获取缓冲区 (使用 local_req_id 循环分配，确保不与在途请求冲突)
-            // 只要 inflight < buf_size，就不会有冲突
-            size_t idx = local_req_id % req_bufs_.size();
-            erpc::MsgBuffer& req_buf = req_bufs_[idx];
-            erpc::MsgBuffer& resp_buf = resp_bufs_[idx];
-            
-            // 填充 RPC 请求
-            auto* rpc_req = reinterpret_cast<RpcClientRequest*>(req_buf.buf_);
-            rpc_req->request_id = creq.request_id;
-            rpc_req->client_send_time = creq.client_send_time;
-            rpc_req->deadline = creq.deadline;
-            // [FIX] 使用生成器生成的原始服务时间，不基于 deadline 计算
-            rpc_req->service_time_hint = creq.expected_service_us;
-            rpc_req->client_id = config_.client_id;
-            rpc_req->request_type = static_cast<uint8_t>(creq.type);
-            rpc_req->payload_size = creq.payload_size;
-            
-            // 记录本 slot 的 Deadline (Client 时钟域)
-            req_deadlines_[idx] = creq.deadline;
-
-            // 增加在途请求计数
-            inflight_requests_.fetch_add(1, std::memory_order_relaxed);
-
-            // 发送请求，tag 传递 idx
-            rpc_->enqueue_request(
-                lb_session_,
-                kReqClientToLB,
-                &req_buf,
-                &resp_buf,
-                response_callback,
-                reinterpret_cast<void*>(idx)
-            );
-
-            sent_requests_.fetch_add(1, std::memory_order_relaxed);
-            
-            // 更新下次发送时间
-            next_send += interval_ns;
-            if (next_send < now) {
-                next_send = now;  // 防止累积
-            }
+    }
+    running_.store(false);
+    
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
         }
     }
+    threads_.clear();
     
     printf("[Client %u] Main loop ended\n", config_.client_id);
     
+    if (interval_log_) {
+        interval_log_->stop();
+    }
+    
+    // 合并各发送线程的指标
+    metrics_.reset();
+    send_lag_.reset();
+    for (const auto& s : senders_) {
+        metrics_.merge_from(s->metrics);
+        send_lag_.merge_from(s->send_lag);
+        uint64_t stalls = s->slot_stalls.load();
+        if (stalls > 0) {
+            printf("[Client %u][T%zu] %lu sends delayed by a full buffer pool (max_inflight=%zu)\n",
+                   config_.client_id, s->thread_id, stalls, config_.max_inflight);
+        }
+    }
+    
     // 打印最终结果
     auto stats = get_stats();
     printf("\n[Client %u] Experiment Complete\n", config_.client_id);
@@ -240,46 +189,177 @@ void ClientContext::run() {
     printf("  P50 Latency:     %.2f us\n", stats.p50_latency_us);
     printf("  P99 Latency:     %.2f us\n", stats.p99_latency_us);
     printf("  P99.9 Latency:   %.2f us\n", stats.p999_latency_us);
+    printf("  Send Lag:        P50=%.2f us P99=%.2f us P99.9=%.2f us max=%.2f us\n",
+           ns_to_us(send_lag_.percentile(50.0)), ns_to_us(send_lag_.percentile(99.0)),
+           ns_to_us(send_lag_.percentile(99.9)), ns_to_us(send_lag_.max()));
     
     // 导出结果
     if (!config_.output_dir.empty()) {
         export_results();
     }
     
-    // 清理 eRPC
-    for (auto& buf : req_bufs_) {
-        rpc_->free_msg_buffer(buf);
+    nexus_.reset();
+}
+
+void ClientContext::sender_thread_main(size_t thread_id) {
+    ClientSender* s = senders_[thread_id].get();
+    
+    // 创建本线程的传输端点
+    s->rpc = nexus_->create_rpc(
+        s,                                      // context
+        static_cast<uint8_t>(thread_id),        // rpc_id
+        1,                                      // phy_port (10.10.1.x network)
+        "Client " + std::to_string(config_.client_id) + " T" + std::to_string(thread_id)
+    );
+    
+    // 连接到 Load Balancer (按 client_id 和线程编号分散到 LB 的各派发线程)
+    uint8_t lb_rpc_id = static_cast<uint8_t>(
+        (config_.client_id * config_.num_threads + thread_id) %
+        std::max<size_t>(config_.lb_threads, 1));
+    s->lb_session = s->rpc->create_session(config_.lb_address, lb_rpc_id);
+    if (s->lb_session < 0) {
+        fprintf(stderr, "[Client %u][T%zu] Failed to connect to LB at %s\n",
+                config_.client_id, thread_id, config_.lb_address.c_str());
+        s->rpc.reset();
+        return;
+    }
+    while (running_.load() && !s->rpc->is_connected(s->lb_session)) {
+        s->rpc->run_event_loop_once();
+    }
+    printf("[Client %u][T%zu] Connected to LB (rpc_id=%u, session=%d)\n",
+           config_.client_id, thread_id, lb_rpc_id, s->lb_session);
+    
+    // 预分配请求/响应缓冲区池，槽位数 = 在途请求上限
+    size_t pool_size = config_.max_inflight;
+    s->req_bufs.resize(pool_size);
+    s->resp_bufs.resize(pool_size);
+    for (size_t i = 0; i < pool_size; ++i) {
+        s->req_bufs[i] = s->rpc->alloc_msg_buffer_or_die(sizeof(RpcClientRequest));
+        s->resp_bufs[i] = s->rpc->alloc_msg_buffer_or_die(sizeof(RpcClientResponse));
+    }
+    s->req_intended.assign(pool_size, 0);
+    s->req_deadlines.assign(pool_size, 0);
+    s->free_slots.reserve(pool_size);
+    for (size_t i = pool_size; i > 0; --i) {
+        s->free_slots.push_back(static_cast<uint32_t>(i - 1));
+    }
+    
+    // 开环发送: 按到达过程给出的计划时间发送，与响应何时返回无关
+    Timestamp base = now_ns();
+    Timestamp intended = base + s->arrivals.next();
+    bool stalled = false;
+    
+    while (running_.load(std::memory_order_relaxed)) {
+        s->rpc->run_event_loop_once();
+        
+        Timestamp now = now_ns();
+        if (now >= end_time_) break;
+        if (thread_id == 0) {
+            tsc_clock::maybe_reanchor();
+        }
+        
+        // 预热结束: 丢弃本线程预热期的指标
+        if (s->in_warmup && now >= warmup_end_) {
+            s->in_warmup = false;
+            s->metrics.reset();
+            s->send_lag.reset();
+        }
+        
+        // 发送所有已到计划时间的请求; 落后时连续补发 (每轮最多 kMaxSendBurst 个，
+        // 其余留到下一轮事件循环之后)，计划时间不会因落后而被推迟
+        for (size_t burst = 0; intended <= now && burst < kMaxSendBurst; ++burst) {
+            // 缓冲区池耗尽 (在途请求达到上限) 时等待响应归还槽位，延迟仍从计划时间起算
+            if (s->free_slots.empty()) {
+                if (!stalled) {
+                    stalled = true;
+                    s->slot_stalls.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+            stalled = false;
+            
+            send_request(s, intended);
+            intended = base + s->arrivals.next();
+        }
     }
-    for (auto& buf : resp_bufs_) {
-        rpc_->free_msg_buffer(buf);
+    
+    // 等待在途请求的响应 (最多 100ms)，再释放缓冲区
+    Timestamp drain_end = now_ns() + ms_to_ns(100);
+    while (s->inflight() > 0 && now_ns() < drain_end) {
+        s->rpc->run_event_loop_once();
     }
     
-    if (rpc_) {
-        delete rpc_;
-        rpc_ = nullptr;
+    for (auto& buf : s->req_bufs) {
+        s->rpc->free_msg_buffer(buf);
     }
-    if (nexus_) {
-        delete nexus_;
-        nexus_ = nullptr;
+    for (auto& buf : s->resp_bufs) {
+        s->rpc->free_msg_buffer(buf);
     }
+    s->rpc.reset();
     
-    g_client_ctx = nullptr;
+    printf("[Client %u][T%zu] Sender stopped (sent=%lu completed=%lu)\n",
+           config_.client_id, thread_id, s->sent.load(), s->completed.load());
+}
+
+void ClientContext::send_request(ClientSender* s, Timestamp intended) {
+    uint32_t slot = s->free_slots.back();
+    s->free_slots.pop_back();
+    
+    // 生成请求 (每线程独立 ID 空间)，截止时间从计划发送时间起算
+    ClientRequest creq = s->gen.generate();
+    creq.request_id = (static_cast<uint64_t>(s->thread_id) << 48) | s->sent.load(std::memory_order_relaxed);
+    creq.deadline = intended + (creq.deadline - creq.client_send_time);
+    creq.client_send_time = now_ns();
+    
+    // 落后于计划的时间
+    Timestamp lag = creq.client_send_time - intended;
+    if (!s->in_warmup) {
+        s->send_lag.record(static_cast<int64_t>(lag));
+    }
+    
+    // 填充 RPC 请求
+    auto* rpc_req = reinterpret_cast<RpcClientRequest*>(s->req_bufs[slot].buf_);
+    rpc_req->request_id = creq.request_id;
+    rpc_req->client_send_time = creq.client_send_time;
+    rpc_req->deadline = creq.deadline;
+    // [FIX] 使用生成器生成的原始服务时间，不基于 deadline 计算
+    rpc_req->service_time_hint = creq.expected_service_us;
+    rpc_req->client_id = config_.client_id;
+    rpc_req->request_type = static_cast<uint8_t>(creq.type);
+    rpc_req->payload_size = creq.payload_size;
+    
+    // 记录本 slot 的计划发送时间和 Deadline (Client 时钟域)
+    s->req_intended[slot] = intended;
+    s->req_deadlines[slot] = creq.deadline;
+    
+    // 发送请求，tag 传递槽位号
+    s->rpc->enqueue_request(
+        s->lb_session,
+        kReqClientToLB,
+        &s->req_bufs[slot],
+        &s->resp_bufs[slot],
+        response_callback,
+        reinterpret_cast<void*>(static_cast<uintptr_t>(slot))
+    );
+    
+    s->sent.fetch_add(1, std::memory_order_relaxed);
 }
 
 void ClientContext::stop() {
+    // 只翻转标志位: 发送线程自行退出事件循环并销毁传输端点，由 run() 回收线程和导出结果
     running_.store(false);
-    
-    for (auto& t : threads_) {
-        if (t.joinable()) {
-            t.join();
-        }
-    }
 }
 
 void ClientContext::export_results() {
     if (config_.output_dir.empty()) return;
     
-    metrics_.export_all(config_.output_dir);
+    bool success = metrics_.export_all(config_.output_dir);
+    success &= send_lag_.export_hdr(config_.output_dir + "/send_lag.hdr");
+    if (!success) {
+        fprintf(stderr, "[Client %u] Failed to export results to %s\n",
+                config_.client_id, config_.output_dir.c_str());
+        return;
+    }
     printf("[Client %u] Results exported to %s\n", 
            config_.client_id, config_.output_dir.c_str());
 }
@@ -287,8 +367,12 @@ void ClientContext::export_results() {
 ClientContext::Stats ClientContext::get_stats() const {
     Stats stats;
     
-    stats.total_requests = sent_requests_.load();
-    stats.successful_requests = completed_requests_.load();
+    stats.total_requests = 0;
+    stats.successful_requests = 0;
+    for (const auto& s : senders_) {
+        stats.total_requests += s->sent.load(std::memory_order_relaxed);
+        stats.successful_requests += s->completed.load(std::memory_order_relaxed);
+    }
     stats.deadline_misses = metrics_.deadline_misses();
     
     // 计算实际 RPS
@@ -308,108 +392,39 @@ ClientContext::Stats ClientContext::get_stats() const {
     return stats;
 }
 
-// 响应回调
+// 响应回调 (在发出该请求的发送线程中执行)
 void ClientContext::response_callback(void* context, void* tag) {
-    auto* client = static_cast<ClientContext*>(context);
-    if (!client) client = g_client_ctx;
-    if (!client) return;
+    auto* s = static_cast<ClientSender*>(context);
+    if (!s) return;
+    ClientContext* client = s->client;
     
     Timestamp recv_time = now_ns();
     
-    // 从 tag 恢复 index (发送时传入)
-    size_t idx = reinterpret_cast<size_t>(tag);
-    if (idx >= client->resp_bufs_.size()) return; // 防御性检查
+    // 从 tag 恢复槽位号 (发送时传入)
+    size_t slot = reinterpret_cast<uintptr_t>(tag);
+    if (slot >= s->resp_bufs.size()) return; // 防御性检查
 
-    auto* response = reinterpret_cast<const RpcClientResponse*>(client->resp_bufs_[idx].buf_);
-
-    // 计算端到端延迟
-    Timestamp e2e_latency = recv_time - response->client_send_time;
+    // 端到端延迟从计划发送时间起算 (包含发送方落后的时间，避免协调遗漏)
+    Timestamp e2e_latency = recv_time - s->req_intended[slot];
     
-    // 记录指标 (仅在非预热期)
-    if (!client->in_warmup_.load()) {
-        client->metrics_.record_latency(static_cast<int64_t>(e2e_latency));
-        
-        // 使用本地记录的 deadline 进行判定 (客户端时钟域)
-        Timestamp original_deadline = client->req_deadlines_[idx];
-        bool actual_deadline_met = (recv_time <= original_deadline);
-        if (!actual_deadline_met) {
-            client->metrics_.record_deadline_miss();
-        }
+    // 时间序列覆盖整个实验 (包括预热期)
+    if (client->interval_latency_) {
+        client->interval_latency_->record(static_cast<int64_t>(e2e_latency));
     }
     
-    // 减少在途请求计数
-    client->inflight_requests_.fetch_sub(1, std::memory_order_relaxed);
-    client->completed_requests_.fetch_add(1, std::memory_order_relaxed);
-    client->throughput_.record();
-}
-
-void ClientContext::sender_thread_main(size_t thread_id) {
-    printf("[Client %u] Thread %zu started\n", config_.client_id, thread_id);
-    
-    auto& gen = generators_[thread_id];
-    uint64_t rps_per_thread = config_.target_rps / config_.num_threads;
-    Timestamp interval_ns = rps_per_thread > 0 ? 
-                            1'000'000'000 / rps_per_thread : 1'000'000;
-    
-    Timestamp next_send = now_ns();
-    uint64_t local_req_id = thread_id * 1000000000ULL;  // 每线程独立 ID 空间
-    
-    while (running_.load() && now_ns() < end_time_) {
-        // 速率控制
-        Timestamp now = now_ns();
-        if (now < next_send) {
-            // 忙等待实现精确的发送间隔
-            while (now_ns() < next_send && running_.load()) {
-                asm volatile("pause" ::: "memory");
-            }
-        }
-        
-        // 生成请求
-        ClientRequest creq = gen.generate();
-        creq.request_id = local_req_id++;
-        creq.client_send_time = now_ns();
-        
-        // 获取缓冲区
-        size_t idx = buf_idx_.fetch_add(1) % req_bufs_.size();
-        erpc::MsgBuffer& req_buf = req_bufs_[idx];
-        erpc::MsgBuffer& resp_buf = resp_bufs_[idx];
-        
-        // 填充 RPC 请求
-        auto* rpc_req = reinterpret_cast<RpcClientRequest*>(req_buf.buf_);
-        rpc_req->request_id = creq.request_id;
-        rpc_req->client_send_time = creq.client_send_time;
-        rpc_req->deadline = creq.deadline;
-        // [FIX] 使用生成器生成的原始服务时间，不基于 deadline 计算
-        rpc_req->service_time_hint = creq.expected_service_us;
-        rpc_req->client_id = config_.client_id;
-        rpc_req->request_type = static_cast<uint8_t>(creq.type);
-        rpc_req->payload_size = creq.payload_size;
-        
-        // 记录本 slot 的 Deadline (Client 时钟域)
-        req_deadlines_[idx] = creq.deadline;
-
-        // 发送请求 (tag = idx)
-        rpc_->enqueue_request(
-            lb_session_,
-            kReqClientToLB,
-            &req_buf,
-            &resp_buf,
-            response_callback,
-            reinterpret_cast<void*>(idx)
-        );
-
-        sent_requests_.fetch_add(1, std::memory_order_relaxed);
-        
-        // 更新下次发送时间
-        next_send += interval_ns;
+    // 记录指标 (仅在非预热期)
+    if (!s->in_warmup) {
+        s->metrics.record_latency(static_cast<int64_t>(e2e_latency));
         
-        // 防止累积延迟
-        if (next_send < now_ns()) {
-            next_send = now_ns();
+        // 使用本地记录的 deadline 进行判定 (客户端时钟域)
+        if (recv_time > s->req_deadlines[slot]) {
+            s->metrics.record_deadline_miss();
         }
     }
     
-    printf("[Client %u] Thread %zu stopped\n", config_.client_id, thread_id);
+    // 归还槽位
+    s->free_slots.push_back(static_cast<uint32_t>(slot));
+    s->completed.fetch_add(1, std::memory_order_relaxed);
 }
 
 void ClientContext::handle_response(const ClientResponse* response) {
@@ -417,9 +432,4 @@ void ClientContext::handle_response(const ClientResponse* response) {
     // 已移到静态 response_callback
 }
 
-void ClientContext::rate_limit(size_t thread_id) {
-    (void)thread_id;
-    // 在 sender_thread_main 中直接实现
-}
-
 }  // namespace malcolm
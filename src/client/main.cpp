@@ -30,14 +30,24 @@ void print_usage(const char* prog) {
     printf("Options:\n");
     printf("  --id=N            Client ID (default: 0)\n");
     printf("  --lb=ADDR         Load Balancer address (ip:port)\n");
-    printf("  --threads=N       Number of sender threads (default: 8)\n");
+    printf("  --lb_threads=N    Number of LB dispatcher threads, must match LB --threads (default: %zu)\n",
+           constants::kDefaultLBThreads);
+    printf("  --transport=T     Transport backend: erpc, shm, udp (default: %s)\n",
+           transport_type_name(kDefaultTransport));
+    printf("  --threads=N       Number of sender threads, one transport endpoint each (default: 8)\n");
+    printf("  --max_inflight=N  Max in-flight requests per sender thread (default: 1024)\n");
     printf("  --target_rps=N    Target requests per second (default: 100000)\n");
+    printf("  --arrival=MODE    Arrival process: deterministic|poisson|onoff|trace (default: poisson)\n");
+    printf("  --burst_on_us=US  Mean ON period of onoff arrivals (default: 1000)\n");
+    printf("  --burst_off_us=US Mean OFF period of onoff arrivals (default: 1000)\n");
+    printf("  --trace=PATH      Inter-arrival gaps in microseconds, one per line (for --arrival=trace)\n");
     printf("  --duration=SEC    Experiment duration in seconds (default: 120)\n");
     printf("  --warmup=SEC      Warmup duration in seconds (default: 30)\n");
     printf("  --pareto_alpha=F  Pareto distribution alpha (default: 1.2)\n");
     printf("  --service_min=US  Minimum service time in microseconds (default: 10)\n");
     printf("  --slow_prob=F     Probability of hitting slow worker (default: 0.6)\n");
     printf("  --output=DIR      Output directory for results\n");
+    printf("  --interval_ms=N   Interval histogram log period, 0 = off (default: 1000)\n");
     printf("  --verbose         Enable verbose output\n");
     printf("  --help            Show this help\n");
 }
@@ -61,21 +71,29 @@ int main(int argc, char* argv[]) {
     static struct option long_options[] = {
         {"id",          required_argument, 0, 'i'},
         {"lb",          required_argument, 0, 'l'},
+        {"lb_threads",  required_argument, 0, 'L'},
         {"threads",     required_argument, 0, 't'},
+        {"max_inflight",required_argument, 0, 'I'},
         {"target_rps",  required_argument, 0, 'r'},
+        {"arrival",     required_argument, 0, 'A'},
+        {"burst_on_us", required_argument, 0, 'B'},
+        {"burst_off_us",required_argument, 0, 'F'},
+        {"trace",       required_argument, 0, 'T'},
         {"duration",    required_argument, 0, 'd'},
         {"warmup",      required_argument, 0, 'w'},
         {"pareto_alpha",required_argument, 0, 'a'},
         {"service_min", required_argument, 0, 's'},
         {"slow_prob",   required_argument, 0, 'p'},
         {"output",      required_argument, 0, 'o'},
+        {"interval_ms", required_argument, 0, 'M'},
         {"verbose",     no_argument,       0, 'v'},
+        {"transport",   required_argument, 0, 'X'},
         {"help",        no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "i:l:t:r:d:w:a:s:p:o:vh", 
+    while ((opt = getopt_long(argc, argv, "i:l:L:X:t:I:r:A:B:F:T:d:w:a:s:p:o:M:vh", 
                               long_options, nullptr)) != -1) {
         switch (opt) {
             case 'i':
@@ -84,12 +102,41 @@ int main(int argc, char* argv[]) {
             case 'l':
                 config.lb_address = optarg;
                 break;
+            case 'L':
+                config.lb_threads = std::stoul(optarg);
+                break;
             case 't':
                 config.num_threads = std::stoul(optarg);
                 break;
+            case 'I':
+                config.max_inflight = std::stoul(optarg);
+                break;
             case 'r':
                 config.target_rps = std::stoull(optarg);
                 break;
+            case 'A':
+                if (strcmp(optarg, "deterministic") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kDeterministic;
+                } else if (strcmp(optarg, "poisson") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kPoisson;
+                } else if (strcmp(optarg, "onoff") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kOnOff;
+                } else if (strcmp(optarg, "trace") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kTrace;
+                } else {
+                    fprintf(stderr, "Error: Unknown arrival process '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'B':
+                config.arrival.mean_on_us = std::stod(optarg);
+                break;
+            case 'F':
+                config.arrival.mean_off_us = std::stod(optarg);
+                break;
+            case 'T':
+                config.arrival.trace_path = optarg;
+                break;
             case 'd':
                 config.duration_sec = std::stoul(optarg);
                 break;
@@ -108,9 +155,18 @@ int main(int argc, char* argv[]) {
             case 'o':
                 config.output_dir = optarg;
                 break;
+            case 'M':
+                config.metrics_interval_ms = static_cast<uint32_t>(std::stoul(optarg));
+                break;
             case 'v':
                 config.verbose = true;
                 break;
+            case 'X':
+                if (!parse_transport_type(optarg, &config.transport)) {
+                    fprintf(stderr, "Unknown transport: %s\n", optarg);
+                    return 1;
+                }
+                break;
             case 'h':
             default:
                 print_usage(argv[0]);
@@ -118,6 +174,11 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (config.arrival.pattern == ArrivalPattern::kTrace && config.arrival.trace_path.empty()) {
+        fprintf(stderr, "Error: --arrival=trace requires --trace=PATH\n");
+        return 1;
+    }
+    
     if (config.lb_address.empty()) {
         fprintf(stderr, "Error: No Load Balancer address specified. Use --lb=...\n");
         print_usage(argv[0]);
@@ -129,8 +190,16 @@ int main(int argc, char* argv[]) {
     printf("========================================\n");
     printf("Client ID:    %u\n", config.client_id);
     printf("LB Address:   %s\n", config.lb_address.c_str());
-    printf("Threads:      %zu\n", config.num_threads);
+    printf("Transport:    %s\n", transport_type_name(config.transport));
+    printf("Threads:      %zu (max inflight %zu each)\n", config.num_threads, config.max_inflight);
     printf("Target RPS:   %lu\n", config.target_rps);
+    printf("Arrivals:     %s", arrival_pattern_name(config.arrival.pattern));
+    if (config.arrival.pattern == ArrivalPattern::kOnOff) {
+        printf(" (on %.0f us / off %.0f us)", config.arrival.mean_on_us, config.arrival.mean_off_us);
+    } else if (config.arrival.pattern == ArrivalPattern::kTrace) {
+        printf(" (%s)", config.arrival.trace_path.c_str());
+    }
+    printf("\n");
     printf("Duration:     %us (+%us warmup)\n", config.duration_sec, config.warmup_sec);
     printf("Pareto Alpha: %.2f\n", config.workload.pareto_alpha);
     printf("Service Min:  %.0fus\n", config.workload.service_time_min_us);
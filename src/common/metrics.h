@@ -4,19 +4,32 @@
  * 指标收集模块
  * 
  * 使用 HdrHistogram 进行高精度延迟分布收集
- * 支持并发安全的指标记录和导出
+ * MetricsCollector 由单个线程记录; 多线程记录使用 ConcurrentMetricsCollector (按线程分片)
+ * IntervalMetricsLog 周期性输出区间直方图 (HdrHistogram 日志格式的时间序列)
  */
 
 #include <hdr/hdr_histogram.h>
+#include <hdr/hdr_histogram_log.h>
+#include <hdr/hdr_interval_recorder.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <cerrno>
+#include <cstring>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <string>
 #include <fstream>
 #include <cstdio>
 #include <memory>
 #include <array>
+#include <algorithm>
 #include "types.h"
 
+#include <sys/stat.h>
+
 namespace malcolm {
 
 /**
@@ -131,16 +144,80 @@ public:
                static_cast<double>(max()) / 1000.0);
     }
     
-    /// 导出为 HDR 格式文件 (可用于后续合并和分析)
+    /**
+     * 导出为 HDR 格式文件 (可用于后续合并和分析)
+     * 
+     * 写成只有一个区间的 HdrHistogram 日志 (压缩 + base64 编码)，保留全部计数，
+     * 可被 histogram_merge / merge_from_file() / hdrh 等工具无损读回
+     */
     bool export_hdr(const std::string& path) const {
         FILE* fp = fopen(path.c_str(), "w");
         if (!fp) return false;
         
+        hdr_log_writer writer;
+        hdr_log_writer_init(&writer);
+        hdr_timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        hdr_timespec zero{};
+        bool ok = hdr_log_write_header(&writer, fp, "malcolm", &now) == 0 &&
+                  write_log_interval(&writer, fp, zero, zero);
+        ok = fclose(fp) == 0 && ok;
+        return ok;
+    }
+    
+    /// 导出百分位表 (HdrHistogram CLASSIC 文本格式，供人工查看)
+    bool export_percentiles(const std::string& path) const {
+        FILE* fp = fopen(path.c_str(), "w");
+        if (!fp) return false;
+        
         hdr_percentiles_print(hist_, fp, 5, 1.0, CLASSIC);
         fclose(fp);
         return true;
     }
     
+    /**
+     * 把 HdrHistogram 日志文件 (export_hdr 的 .hdr 或 IntervalMetricsLog 的 .hlog)
+     * 中的区间累加进本直方图
+     * 
+     * @param start_sec 跳过起点 (相对日志开始时间) 早于该值的区间，用于去掉预热期
+     * @param intervals 若非空，返回累加的区间数
+     * @return 文件无法打开或格式错误时返回 false (已读到的区间仍会累加)
+     */
+    bool merge_from_file(const std::string& path, double start_sec = 0.0,
+                         size_t* intervals = nullptr) {
+        FILE* fp = fopen(path.c_str(), "r");
+        if (!fp) return false;
+        
+        hdr_log_reader reader;
+        bool ok = hdr_log_reader_init(&reader) == 0 && hdr_log_read_header(&reader, fp) == 0;
+        size_t merged = 0;
+        while (ok) {
+            hdr_histogram* interval = nullptr;
+            hdr_timespec timestamp{};
+            hdr_timespec length{};
+            int rc = hdr_log_read(&reader, fp, &interval, &timestamp, &length);
+            if (rc != 0) {
+                ok = rc == EOF;
+                break;
+            }
+            double offset = static_cast<double>(timestamp.tv_sec) + timestamp.tv_nsec / 1e9;
+            if (offset >= start_sec) {
+                hdr_add(hist_, interval);
+                ++merged;
+            }
+            hdr_close(interval);
+        }
+        fclose(fp);
+        if (intervals) *intervals = merged;
+        return ok;
+    }
+    
+    /// 以 HdrHistogram 日志格式 (压缩 + base64) 追加一个区间 [start, end] 的记录
+    bool write_log_interval(hdr_log_writer* writer, FILE* fp,
+                            const hdr_timespec& start, const hdr_timespec& end) const {
+        return hdr_log_write(writer, fp, &start, &end, hist_) == 0;
+    }
+    
     /// 导出 CDF 数据为 CSV 格式 (用于绘图)
     bool export_cdf(const std::string& path, int num_points = 10000) const {
         std::ofstream out(path);
@@ -156,13 +233,40 @@ public:
     }
     
 private:
+    friend class IntervalHistogram;
+    
     hdr_histogram* hist_ = nullptr;
 };
 
+/// 递归创建输出目录 (mkdir -p)，已存在视为成功; 失败时打印原因
+inline bool ensure_directory(const std::string& dir) {
+    if (dir.empty()) return false;
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1)) {
+        std::string prefix = dir.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "[Metrics] Failed to create directory %s: %s\n",
+                    prefix.c_str(), strerror(errno));
+            return false;
+        }
+        if (pos == std::string::npos) break;
+    }
+    struct stat st;
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/// 记录线程在进程内的编号 (首次调用时按顺序分配，用于选择按线程的分片)
+inline size_t recording_thread_index() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
 /**
- * 线程安全的指标收集器
+ * 指标收集器
  * 
- * 收集端到端延迟、截止时间违约率等核心指标
+ * 收集端到端延迟、截止时间违约率等核心指标。
+ * 直方图记录不是线程安全的: 每个实例只能由一个线程记录 (LB 每个派发线程一个)，
+ * 多线程记录请使用 ConcurrentMetricsCollector。
  */
 class MetricsCollector {
 public:
@@ -194,6 +298,25 @@ public:
         }
     }
     
+    /**
+     * 记录 LB 侧完成的请求 (t7 未知): 端到端延迟截止到 t6，
+     * 违约按 t6 判断，每个 Worker 的直方图记录 Worker 内停留时间 (t5 - t4)
+     */
+    void record_lb_request(const RequestTrace& trace) {
+        e2e_latency_.record(trace.lb_e2e_latency_ns());
+        
+        if (trace.t6_lb_response > trace.deadline) {
+            deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+        }
+        total_requests_.fetch_add(1, std::memory_order_relaxed);
+        
+        lb_overhead_.record(trace.lb_overhead_ns());
+        
+        if (trace.target_worker_id < kMaxWorkers) {
+            per_worker_latency_[trace.target_worker_id].record(trace.worker_residence_ns());
+        }
+    }
+    
     /// 记录单个延迟值 (简化接口)
     void record_latency(int64_t latency_ns) {
         e2e_latency_.record(latency_ns);
@@ -245,6 +368,17 @@ public:
         deadline_misses_.store(0, std::memory_order_relaxed);
     }
     
+    /// 合并另一个收集器 (用于汇总各线程的独立收集器)
+    void merge_from(const MetricsCollector& other) {
+        e2e_latency_.merge_from(other.e2e_latency_);
+        lb_overhead_.merge_from(other.lb_overhead_);
+        for (size_t i = 0; i < kMaxWorkers; ++i) {
+            per_worker_latency_[i].merge_from(other.per_worker_latency_[i]);
+        }
+        total_requests_.fetch_add(other.total_requests(), std::memory_order_relaxed);
+        deadline_misses_.fetch_add(other.deadline_misses(), std::memory_order_relaxed);
+    }
+    
     /// 打印摘要
     void print_summary() const {
         printf("\n========== Metrics Summary ==========\n");
@@ -256,16 +390,19 @@ public:
         printf("=====================================\n");
     }
     
-    /// 导出所有指标到目录
+    /// 导出所有指标到目录 (不存在时创建)，任一文件写入失败返回 false
     bool export_all(const std::string& dir) {
+        if (!ensure_directory(dir)) return false;
         bool success = true;
         
         success &= e2e_latency_.export_hdr(dir + "/e2e_latency.hdr");
+        success &= e2e_latency_.export_percentiles(dir + "/e2e_latency_percentiles.txt");
         success &= e2e_latency_.export_cdf(dir + "/e2e_latency_cdf.csv");
         success &= lb_overhead_.export_hdr(dir + "/lb_overhead.hdr");
         
         // 导出摘要
         std::ofstream summary(dir + "/summary.txt");
+        success &= static_cast<bool>(summary);
         if (summary) {
             summary << "Total Requests: " << total_requests() << "\n";
             summary << "Deadline Misses: " << deadline_misses() << "\n";
@@ -279,8 +416,9 @@ public:
         // 导出每个 Worker 的统计
         for (size_t i = 0; i < kMaxWorkers; ++i) {
             if (per_worker_latency_[i].total_count() > 0) {
-                per_worker_latency_[i].export_cdf(
-                    dir + "/worker_" + std::to_string(i) + "_latency_cdf.csv");
+                std::string prefix = dir + "/worker_" + std::to_string(i) + "_latency";
+                success &= per_worker_latency_[i].export_hdr(prefix + ".hdr");
+                per_worker_latency_[i].export_cdf(prefix + "_cdf.csv");
             }
         }
         
@@ -296,10 +434,393 @@ private:
     std::atomic<uint64_t> deadline_misses_{0};
 };
 
+/**
+ * 多线程记录的指标收集器
+ *
+ * HdrHistogram 的记录不是线程安全的，多个线程共用一个 MetricsCollector 会丢失计数
+ * 甚至破坏直方图。这里每个记录线程拥有独立分片 (首次记录时创建)，记录路径无锁、
+ * 无共享写; 读取 / 导出时把各分片合并成一个 MetricsCollector。
+ * - 线程按进程内首次记录的顺序编号，前 kMaxShards 个线程各占一个分片，
+ *   之后的线程共用一个加锁的溢出分片 (正确但较慢)
+ * - reset() 只递增纪元: 各分片在下次记录时自行清空，读取时忽略纪元过期的分片，
+ *   因此可以与记录并发调用 (如预热结束时)
+ * - 合并 / 导出读取分片内容，须在记录线程停止后调用 (如 join 之后)
+ */
+class ConcurrentMetricsCollector {
+public:
+    static constexpr size_t kMaxShards = 64;
+    
+    ConcurrentMetricsCollector() {
+        for (auto& s : shards_) s.store(nullptr, std::memory_order_relaxed);
+    }
+    
+    ~ConcurrentMetricsCollector() {
+        for (auto& s : shards_) delete s.load(std::memory_order_relaxed);
+    }
+    
+    // 禁用拷贝
+    ConcurrentMetricsCollector(const ConcurrentMetricsCollector&) = delete;
+    ConcurrentMetricsCollector& operator=(const ConcurrentMetricsCollector&) = delete;
+    
+    void record_request(const RequestTrace& trace) {
+        with_shard([&](MetricsCollector& m) { m.record_request(trace); });
+    }
+    
+    void record_latency(int64_t latency_ns) {
+        with_shard([&](MetricsCollector& m) { m.record_latency(latency_ns); });
+    }
+    
+    void record_deadline_miss() {
+        with_shard([&](MetricsCollector& m) { m.record_deadline_miss(); });
+    }
+    
+    /// 丢弃此前记录的所有指标 (可与记录并发)
+    void reset() {
+        epoch_.fetch_add(1, std::memory_order_acq_rel);
+    }
+    
+    /// 合并所有分片 (记录线程停止后调用)
+    void merge_into(MetricsCollector& out) const {
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        for (const auto& slot : shards_) {
+            const Shard* shard = slot.load(std::memory_order_acquire);
+            if (shard && shard->epoch.load(std::memory_order_acquire) == epoch) {
+                out.merge_from(shard->metrics);
+            }
+        }
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        if (overflow_ && overflow_->epoch.load(std::memory_order_relaxed) == epoch) {
+            out.merge_from(overflow_->metrics);
+        }
+    }
+    
+    /// 导出所有指标到目录 (记录线程停止后调用)
+    bool export_all(const std::string& dir) const {
+        MetricsCollector merged;
+        merge_into(merged);
+        return merged.export_all(dir);
+    }
+    
+private:
+    struct Shard {
+        MetricsCollector metrics;
+        std::atomic<uint64_t> epoch{0};
+    };
+    
+    /// 按当前纪元准备分片 (过期则先清空)
+    void refresh(Shard& shard) {
+        uint64_t epoch = epoch_.load(std::memory_order_acquire);
+        if (shard.epoch.load(std::memory_order_relaxed) != epoch) {
+            shard.metrics.reset();
+            shard.epoch.store(epoch, std::memory_order_release);
+        }
+    }
+    
+    template<typename Fn>
+    void with_shard(Fn&& fn) {
+        size_t index = recording_thread_index();
+        if (index >= kMaxShards) {
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            if (!overflow_) {
+                overflow_ = std::make_unique<Shard>();
+                overflow_->epoch.store(epoch_.load(std::memory_order_acquire),
+                                       std::memory_order_relaxed);
+            }
+            refresh(*overflow_);
+            fn(overflow_->metrics);
+            return;
+        }
+        // 分片只由所属线程创建和写入
+        Shard* shard = shards_[index].load(std::memory_order_relaxed);
+        if (!shard) {
+            shard = new Shard();
+            shard->epoch.store(epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+            shards_[index].store(shard, std::memory_order_release);
+        }
+        refresh(*shard);
+        fn(shard->metrics);
+    }
+    
+    std::array<std::atomic<Shard*>, kMaxShards> shards_;
+    std::atomic<uint64_t> epoch_{0};
+    
+    mutable std::mutex overflow_mutex_;
+    std::unique_ptr<Shard> overflow_;
+};
+
+/**
+ * 区间直方图
+ *
+ * 周期性 "取走并清零" 的延迟直方图，用于输出延迟随时间变化的序列。
+ * 每个记录线程独占一个 hdr_interval_recorder 分片 (活跃 / 非活跃双缓冲 + 读写相位器):
+ * 记录路径只有分片内无竞争的原子操作，采样线程交换缓冲区后读取，不会与记录冲突。
+ * - 分片按 recording_thread_index() 选择，前 kMaxShards 个线程各占一个，
+ *   之后的线程共用一个加锁的溢出分片
+ * - sample_into() 只能由一个采样线程调用 (IntervalMetricsLog 的日志线程)
+ */
+class IntervalHistogram {
+public:
+    static constexpr size_t kMaxShards = ConcurrentMetricsCollector::kMaxShards;
+    
+    explicit IntervalHistogram(
+        int64_t lowest_trackable = 1,
+        int64_t highest_trackable = 10'000'000'000LL,  // 10 秒
+        int significant_figures = 3
+    ) : lowest_(lowest_trackable), highest_(highest_trackable),
+        significant_figures_(significant_figures) {
+        for (auto& s : shards_) s.store(nullptr, std::memory_order_relaxed);
+    }
+    
+    ~IntervalHistogram() {
+        for (auto& s : shards_) destroy(s.load(std::memory_order_relaxed));
+        destroy(overflow_.load(std::memory_order_relaxed));
+    }
+    
+    // 禁用拷贝
+    IntervalHistogram(const IntervalHistogram&) = delete;
+    IntervalHistogram& operator=(const IntervalHistogram&) = delete;
+    
+    /// 记录一个延迟值 (纳秒)
+    void record(int64_t value_ns) {
+        size_t index = recording_thread_index();
+        if (index >= kMaxShards) {
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            hdr_interval_recorder* r = overflow_.load(std::memory_order_relaxed);
+            if (!r) {
+                r = create();
+                overflow_.store(r, std::memory_order_release);
+            }
+            hdr_interval_recorder_record_value(r, value_ns);
+            return;
+        }
+        // 分片只由所属线程创建和记录
+        hdr_interval_recorder* r = shards_[index].load(std::memory_order_relaxed);
+        if (!r) {
+            r = create();
+            shards_[index].store(r, std::memory_order_release);
+        }
+        hdr_interval_recorder_record_value(r, value_ns);
+    }
+    
+    /// 取走各分片自上次采样以来的记录，累加到 out
+    void sample_into(LatencyHistogram& out) {
+        for (const auto& slot : shards_) {
+            sample_shard(slot.load(std::memory_order_acquire), out);
+        }
+        sample_shard(overflow_.load(std::memory_order_acquire), out);
+    }
+    
+private:
+    hdr_interval_recorder* create() const {
+        auto* r = new hdr_interval_recorder();
+        if (hdr_interval_recorder_init_all(r, lowest_, highest_, significant_figures_) != 0) {
+            delete r;
+            throw std::runtime_error("Failed to initialize HdrHistogram interval recorder");
+        }
+        return r;
+    }
+    
+    static void destroy(hdr_interval_recorder* r) {
+        if (r) {
+            hdr_interval_recorder_destroy(r);
+            delete r;
+        }
+    }
+    
+    static void sample_shard(hdr_interval_recorder* r, LatencyHistogram& out) {
+        if (!r) return;
+        // 交换后返回的是上一区间的活跃缓冲区，已无写者; 清零后留作下一区间的活跃缓冲区
+        hdr_histogram* interval = hdr_interval_recorder_sample(r);
+        hdr_add(out.hist_, interval);
+        hdr_reset(interval);
+    }
+    
+    int64_t lowest_;
+    int64_t highest_;
+    int significant_figures_;
+    
+    std::array<std::atomic<hdr_interval_recorder*>, kMaxShards> shards_;
+    std::atomic<hdr_interval_recorder*> overflow_{nullptr};
+    std::mutex overflow_mutex_;
+};
+
+/**
+ * 区间直方图日志
+ *
+ * 每个时间序列输出到 <dir>/<name>.hlog (HdrHistogram 日志格式: 每行一个区间的
+ * 压缩 + base64 直方图)，可直接交给 HistogramLogProcessor / hdrh 等工具画
+ * P99.9 随时间的曲线，也可以把所有区间相加得到无损的累计直方图。
+ * - 区间起点相对日志开始时间，开始时间 (墙上时钟) 写在文件头，便于对齐多个进程的日志
+ * - 日志线程每 interval_ms 采样一次，stop() 时补写最后一个不完整区间
+ * - 时间序列须在 start() 之前通过 add_series() 注册
+ */
+class IntervalMetricsLog {
+public:
+    IntervalMetricsLog(const std::string& dir, uint32_t interval_ms)
+        : dir_(dir), interval_ns_(ms_to_ns(std::max<uint32_t>(interval_ms, 1))) {}
+    
+    ~IntervalMetricsLog() {
+        stop();
+    }
+    
+    // 禁用拷贝
+    IntervalMetricsLog(const IntervalMetricsLog&) = delete;
+    IntervalMetricsLog& operator=(const IntervalMetricsLog&) = delete;
+    
+    /// 注册一个时间序列 (start() 之前调用)，返回的直方图在日志对象生命周期内有效
+    IntervalHistogram& add_series(const std::string& name) {
+        series_.push_back(std::make_unique<Series>(name));
+        return series_.back()->hist;
+    }
+    
+    /// 创建输出目录、打开各序列的日志文件并启动日志线程; 有文件打不开时返回 false
+    bool start() {
+        if (thread_.joinable()) return true;
+        
+        bool success = ensure_directory(dir_);
+        
+        timespec wall;
+        clock_gettime(CLOCK_REALTIME, &wall);
+        hdr_timespec start_time;
+        start_time.tv_sec = wall.tv_sec;
+        start_time.tv_nsec = wall.tv_nsec;
+        
+        for (auto& s : series_) {
+            std::string path = dir_ + "/" + s->name + ".hlog";
+            s->fp = fopen(path.c_str(), "w");
+            if (!s->fp) {
+                fprintf(stderr, "[Metrics] Failed to open interval log %s\n", path.c_str());
+                success = false;
+                continue;
+            }
+            hdr_log_writer_init(&s->writer);
+            hdr_log_write_header(&s->writer, s->fp, s->name.c_str(), &start_time);
+        }
+        
+        stopping_ = false;
+        start_ns_ = now_ns();
+        thread_ = std::thread([this]() { run(); });
+        return success;
+    }
+    
+    /// 停止日志线程 (写出最后一个区间) 并关闭文件
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        for (auto& s : series_) {
+            if (s->fp) {
+                fclose(s->fp);
+                s->fp = nullptr;
+            }
+        }
+    }
+    
+    Timestamp interval_ns() const { return interval_ns_; }
+    
+private:
+    struct Series {
+        explicit Series(const std::string& n) : name(n) {}
+        
+        std::string name;
+        IntervalHistogram hist;
+        FILE* fp = nullptr;
+        hdr_log_writer writer;
+    };
+    
+    static hdr_timespec to_timespec(Timestamp ns) {
+        hdr_timespec ts;
+        ts.tv_sec = static_cast<time_t>(ns / 1'000'000'000ULL);
+        ts.tv_nsec = static_cast<long>(ns % 1'000'000'000ULL);
+        return ts;
+    }
+    
+    void run() {
+        Timestamp interval_start = start_ns_;
+        Timestamp next = start_ns_ + interval_ns_;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            // 等到下一个区间边界或 stop()
+            Timestamp now = now_ns();
+            while (!stopping_ && now < next) {
+                cv_.wait_for(lock, std::chrono::nanoseconds(next - now));
+                now = now_ns();
+            }
+            bool last = stopping_;
+            lock.unlock();
+            tsc_clock::maybe_reanchor();
+            
+            // 按固定网格推进，唤醒抖动不会累积成区间漂移; 停止时截到当前时刻
+            Timestamp interval_end = last ? now : next;
+            write_interval(interval_start, interval_end);
+            if (last) break;
+            interval_start = interval_end;
+            next += interval_ns_;
+            lock.lock();
+        }
+    }
+    
+    void write_interval(Timestamp begin, Timestamp end) {
+        hdr_timespec start_ts = to_timespec(begin - start_ns_);
+        hdr_timespec end_ts = to_timespec(end - start_ns_);
+        for (auto& s : series_) {
+            scratch_.reset();
+            s->hist.sample_into(scratch_);
+            if (!s->fp) continue;
+            scratch_.write_log_interval(&s->writer, s->fp, start_ts, end_ts);
+            fflush(s->fp);
+        }
+    }
+    
+    std::string dir_;
+    Timestamp interval_ns_;
+    Timestamp start_ns_ = 0;
+    
+    std::vector<std::unique_ptr<Series>> series_;
+    LatencyHistogram scratch_;   // 仅日志线程使用
+    
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+};
+
+/**
+ * 与 MetricsCollector::record_request 同口径的区间时间序列
+ * (端到端延迟、LB 开销、每个 Worker 的延迟)，未注册的序列为空指针
+ */
+struct RequestIntervalSeries {
+    IntervalHistogram* e2e_latency = nullptr;
+    IntervalHistogram* lb_overhead = nullptr;
+    std::vector<IntervalHistogram*> worker_latency;
+    
+    void record_request(const RequestTrace& trace) {
+        if (e2e_latency) e2e_latency->record(trace.e2e_latency_ns());
+        if (lb_overhead) lb_overhead->record(trace.lb_overhead_ns());
+        if (trace.target_worker_id < worker_latency.size()) {
+            worker_latency[trace.target_worker_id]->record(trace.e2e_latency_ns());
+        }
+    }
+    
+    /// 与 MetricsCollector::record_lb_request 同口径
+    void record_lb_request(const RequestTrace& trace) {
+        if (e2e_latency) e2e_latency->record(trace.lb_e2e_latency_ns());
+        if (lb_overhead) lb_overhead->record(trace.lb_overhead_ns());
+        if (trace.target_worker_id < worker_latency.size()) {
+            worker_latency[trace.target_worker_id]->record(trace.worker_residence_ns());
+        }
+    }
+};
+
 /**
  * 吞吐量计数器
  * 
- * 使用滑动窗口计算 RPS
+ * 使用滑动窗口计算 RPS (可多线程并发记录)
  */
 class ThroughputCounter {
 public:
@@ -312,32 +833,49 @@ public:
     
     /// 记录一个请求完成
     void record() {
-        uint64_t now = now_ns();
-        size_t bucket = (now / kBucketDurationNs) % kWindowSize;
-        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        uint32_t period = static_cast<uint32_t>(now_ns() / kBucketDurationNs);
+        std::atomic<uint64_t>& bucket = buckets_[period % kWindowSize];
         
-        // 清理旧桶
-        size_t old_bucket = (bucket + 1) % kWindowSize;
-        if (last_bucket_ != bucket) {
-            buckets_[old_bucket].store(0, std::memory_order_relaxed);
-            last_bucket_ = bucket;
+        // 桶内打包 (时间桶序号 << 32 | 计数): 序号不符说明是上一轮窗口的旧桶，
+        // 由 CAS 成功的线程重置为本桶的第一次计数，其他线程重读后在新值上累加，不会丢计数
+        uint64_t v = bucket.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t next = tag_of(v) == period ? v + 1 : pack(period, 1);
+            if (bucket.compare_exchange_weak(v, next, std::memory_order_relaxed)) {
+                break;
+            }
         }
     }
     
-    /// 获取当前 RPS
-    double get_rps() const {
+    /// 最近 kWindowSize 个时间桶内的记录数 (跳过的空闲桶带着旧序号，不计入)
+    uint64_t window_count() const {
+        uint32_t period = static_cast<uint32_t>(now_ns() / kBucketDurationNs);
         uint64_t total = 0;
         for (const auto& c : buckets_) {
-            total += c.load(std::memory_order_relaxed);
+            uint64_t v = c.load(std::memory_order_relaxed);
+            if (static_cast<uint32_t>(period - tag_of(v)) < kWindowSize) {
+                total += v & kCountMask;
+            }
         }
+        return total;
+    }
+    
+    /// 获取当前 RPS
+    double get_rps() const {
         // 窗口时长 = kWindowSize * kBucketDurationNs / 1e9 秒
         double window_sec = static_cast<double>(kWindowSize * kBucketDurationNs) / 1e9;
-        return static_cast<double>(total) / window_sec;
+        return static_cast<double>(window_count()) / window_sec;
     }
     
 private:
+    static constexpr uint64_t kCountMask = 0xffffffffULL;
+    
+    static uint32_t tag_of(uint64_t v) { return static_cast<uint32_t>(v >> 32); }
+    static uint64_t pack(uint32_t period, uint32_t count) {
+        return (static_cast<uint64_t>(period) << 32) | count;
+    }
+    
     std::array<std::atomic<uint64_t>, kWindowSize> buckets_;
-    size_t last_bucket_ = 0;
 };
 
 }  // namespace malcolm
@@ -56,6 +56,28 @@ struct RpcWorkerRequest {
     uint16_t payload_size;        // 载荷大小
 } __attribute__((packed));
 
+// ==================== 松弛时间直方图量化 ====================
+// 每桶计数压缩为 1 字节 (4 位尾数的小浮点): 0~15 精确，更大的值相对误差 < 1/16
+// 解码取量化区间的中点
+
+inline uint8_t encode_slack_count(uint32_t count) {
+    if (count < 16) {
+        return static_cast<uint8_t>(count);
+    }
+    // count >> shift 落在 [8, 16)，shift ∈ [1, 28]
+    uint32_t shift = 28 - static_cast<uint32_t>(__builtin_clz(count));
+    return static_cast<uint8_t>(16 + (shift - 1) * 8 + ((count >> shift) - 8));
+}
+
+inline uint32_t decode_slack_count(uint8_t code) {
+    if (code < 16) {
+        return code;
+    }
+    uint32_t shift = (code - 16u) / 8 + 1;
+    uint32_t mantissa = (code - 16u) % 8 + 8;
+    return (mantissa << shift) + ((1u << shift) >> 1);
+}
+
 // ==================== Worker -> LB 响应 ====================
 struct RpcWorkerResponse {
     uint64_t request_id;          // 请求ID
@@ -66,6 +88,10 @@ struct RpcWorkerResponse {
     uint16_t queue_length;        // 当前队列长度
     uint8_t  worker_id;           // Worker ID
     uint8_t  success;             // 是否成功
+    
+    // Worker 状态摘要 (每个响应捎带，LB 收到即合并，不需要额外消息)
+    uint16_t active_requests;     // 在途请求数 (排队 + 执行中)
+    uint8_t  slack_digest[constants::kSlackHistogramBins];  // encode_slack_count() 量化
 } __attribute__((packed));
 
 // ==================== LB -> Client 响应 ====================
@@ -80,7 +106,8 @@ struct RpcClientResponse {
     uint8_t  _padding;
 } __attribute__((packed));
 
-// ==================== Worker 状态更新 (LB 轮询) ====================
+// ==================== Worker -> LB 状态推送 ====================
+// Worker 周期性 (或队列长度变化超过阈值时) 主动推送，LB 合并进 WorkerState
 struct RpcStateUpdate {
     uint16_t queue_length;        // 当前队列长度
     uint16_t active_requests;     // 正在处理的请求数
@@ -94,6 +121,11 @@ struct RpcStateUpdate {
     uint32_t slack_histogram[constants::kSlackHistogramBins];
 } __attribute__((packed));
 
+// LB -> Worker 状态推送确认 (eRPC 要求每个请求都有响应)
+struct RpcStateUpdateAck {
+    uint8_t accepted;             // worker_id 有效且已合并
+} __attribute__((packed));
+
 // ==================== 消息大小限制 ====================
 constexpr size_t kMaxPayloadSize = 4096;
 constexpr size_t kMaxRequestSize = sizeof(RpcClientRequest) + kMaxPayloadSize;
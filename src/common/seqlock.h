@@ -0,0 +1,139 @@
+#pragma once
+
+/**
+ * 多写者 SeqLock
+ *
+ * 读者完全无锁: 读取序号 -> 复制数据 -> 再次校验序号，期间若有写入则重试。
+ * 写者之间通过对序号的 CAS (偶数 -> 奇数) 互斥，写入完成后序号 +1 回到偶数。
+ * 读者永远不会阻塞写者，写者也不会阻塞读者 (读者只会重试)。
+ *
+ * 数据以 atomic<uint64_t> 字数组存放并使用 relaxed 原子读写，
+ * 避免对普通内存的并发读写 (C++ 内存模型中的数据竞争)。
+ *
+ * 适用于小而读多写少 (或写很短) 的 POD 结构，例如 LB 侧的 Worker 状态。
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace malcolm {
+
+template<typename T>
+class alignas(64) SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SeqLock payload must be trivially copyable");
+
+public:
+    SeqLock() { store(T{}); }
+    explicit SeqLock(const T& value) { store(value); }
+
+    // 禁用拷贝
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /**
+     * 无锁读取一致的副本
+     *
+     * @return 读到的版本号 (偶数)，可用于判断之后数据是否变化
+     */
+    uint64_t load(T& out) const {
+        uint64_t buf[kWords];
+        uint32_t spins = 0;
+        while (true) {
+            uint64_t s1 = seq_.load(std::memory_order_acquire);
+            if (s1 & 1) {
+                backoff(spins);
+                continue;
+            }
+            for (size_t i = 0; i < kWords; ++i) {
+                buf[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == s1) {
+                std::memcpy(&out, buf, sizeof(T));
+                return s1;
+            }
+            backoff(spins);
+        }
+    }
+
+    T load() const {
+        T out;
+        load(out);
+        return out;
+    }
+
+    /// 当前版本号 (奇数表示正在写入)
+    uint64_t version() const {
+        return seq_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * 读-改-写更新
+     *
+     * @param fn 形如 void(T&) 的修改函数，在写锁内执行，应尽量短
+     */
+    template<typename Fn>
+    void update(Fn&& fn) {
+        uint64_t s = lock();
+
+        uint64_t buf[kWords];
+        for (size_t i = 0; i < kWords; ++i) {
+            buf[i] = words_[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, buf, sizeof(T));
+
+        fn(value);
+
+        std::memcpy(buf, &value, sizeof(T));
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(buf[i], std::memory_order_relaxed);
+        }
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    /// 整体覆盖写入
+    void store(const T& value) {
+        update([&value](T& v) { v = value; });
+    }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    /// 获取写锁: 序号从偶数 CAS 为奇数
+    uint64_t lock() {
+        uint64_t s = seq_.load(std::memory_order_relaxed);
+        uint32_t spins = 0;
+        while (true) {
+            if (!(s & 1) &&
+                seq_.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                           std::memory_order_relaxed)) {
+                // 保证数据写入不会先于奇数序号对读者可见
+                std::atomic_thread_fence(std::memory_order_release);
+                return s;
+            }
+            backoff(spins);
+            s = seq_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// 自旋等待; 持锁写者被抢占时 (线程数多于核数) 让出 CPU 避免空转整个时间片
+    static void backoff(uint32_t& spins) {
+        if (++spins < kSpinLimit) {
+            asm volatile("pause" ::: "memory");
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    static constexpr uint32_t kSpinLimit = 128;
+
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> words_[kWords] = {};
+};
+
+}  // namespace malcolm
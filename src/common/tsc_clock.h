@@ -0,0 +1,239 @@
+#pragma once
+
+/**
+ * 基于 TSC 的零系统调用时钟
+ *
+ * now_ns() 原先经 std::chrono::steady_clock (vDSO clock_gettime)，每次约 20~50ns，
+ * 且在虚拟化环境下可能退化为真正的系统调用。这里改为读取 TSC 后线性换算:
+ *   ns = base_ns + (tsc - base_tsc) × mult / 2^32
+ * - 进程内首次调用时与 steady_clock 对齐校准 (约 10ms 忙等)，因此时间戳的单位和起点
+ *   与原实现相同 (CLOCK_MONOTONIC 纳秒)，跨进程 / 跨节点的比较语义不变
+ * - 仅在 CPU 声明 invariant TSC (CPUID 0x80000007 EDX[8]) 时启用，否则回退到 steady_clock
+ * - 环境变量 MALCOLM_CLOCK=steady 可强制回退 (用于对比或排查)
+ *
+ * 10ms 校准窗口的频率误差约 0.1ppm (实测约 0.1μs/s 漂移)，长时间运行会累积。
+ * 已有的周期线程 (区间日志、Worker 状态推送、LB / Client 的 0 号线程) 调用 maybe_reanchor()，
+ * 每 kReanchorIntervalNs 与 steady_clock 重新对齐一次:
+ * - 频率按首次校准至今的长基线重新估计
+ * - 累积偏差在下一个周期内通过微调斜率消化 (slew)，锚点处连续，时间戳不回退
+ * 锚点放在 SeqLock 中，now() 读取无锁。
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "seqlock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define MALCOLM_HAS_TSC 1
+#endif
+
+namespace malcolm {
+
+/// 原实现: steady_clock 纳秒 (校准基准 / 回退路径)
+inline uint64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+namespace tsc_clock {
+
+// 换算需要 128 位中间结果 (__extension__ 避免 -Wpedantic 警告)
+__extension__ typedef __int128 int128_t;
+__extension__ typedef unsigned __int128 uint128_t;
+
+/// 读取 TSC (不串行化，适合时间戳)
+inline uint64_t rdtsc() {
+#ifdef MALCOLM_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/// 读取 TSC，等待之前的指令执行完成 (适合测量区间的结束点)
+inline uint64_t rdtscp() {
+#ifdef MALCOLM_HAS_TSC
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return 0;
+#endif
+}
+
+/// CPU 是否声明 invariant TSC (频率恒定，且不随 C/P 状态停止)
+inline bool has_invariant_tsc() {
+#ifdef MALCOLM_HAS_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+constexpr uint64_t kReanchorIntervalNs = 1'000'000'000;   // 重新对齐周期
+constexpr int64_t kMaxSlewPpb = 500'000;                   // 消化偏差时斜率最多调整 500ppm
+
+/// 换算锚点: ns = base_ns + (tsc - base_tsc) × mult / 2^32
+struct Anchor {
+    uint64_t base_tsc = 0;
+    uint64_t base_ns = 0;
+    uint64_t mult = 0;        // 每 tick 的纳秒数 × 2^32
+};
+
+struct Calibration {
+    bool enabled = false;     // false: 回退到 steady_clock
+    uint64_t origin_tsc = 0;  // 首次校准的起点 (长基线频率估计)
+    uint64_t origin_ns = 0;
+    Anchor anchor;            // 初始锚点
+    double ghz = 0.0;         // TSC 频率 (仅用于日志)
+};
+
+/**
+ * 取一对 (steady, tsc) 读数，取 16 次中读数间隔最短的一次，减小被中断打断造成的误差
+ */
+inline void sample_pair(uint64_t& ns, uint64_t& tsc) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 16; ++i) {
+        uint64_t t0 = rdtsc();
+        uint64_t n = steady_now_ns();
+        uint64_t t1 = rdtsc();
+        if (t1 - t0 < best) {
+            best = t1 - t0;
+            ns = n;
+            tsc = t0 + (t1 - t0) / 2;
+        }
+    }
+}
+
+/// 按锚点换算 (有符号差值: 各核 TSC 之间可能有几个周期的偏差，读数略早于 base_tsc 时不回绕)
+inline uint64_t convert(const Anchor& a, uint64_t tsc) {
+    int64_t delta = static_cast<int64_t>(tsc - a.base_tsc);
+    return a.base_ns + static_cast<uint64_t>(static_cast<int64_t>(
+        (static_cast<int128_t>(delta) * static_cast<int128_t>(a.mult)) >> 32));
+}
+
+/**
+ * 与 steady_clock 对齐校准
+ *
+ * 在 calibration_ns 窗口的两端各取一对 (steady, tsc)
+ */
+inline Calibration calibrate(uint64_t calibration_ns = 10'000'000) {
+    Calibration cal;
+    const char* env = std::getenv("MALCOLM_CLOCK");
+    if ((env && std::strcmp(env, "steady") == 0) || !has_invariant_tsc()) {
+        return cal;
+    }
+
+    uint64_t ns0 = 0, tsc0 = 0, ns1 = 0, tsc1 = 0;
+    sample_pair(ns0, tsc0);
+    while (steady_now_ns() - ns0 < calibration_ns) {}
+    sample_pair(ns1, tsc1);
+    if (tsc1 <= tsc0 || ns1 <= ns0) {
+        return cal;
+    }
+
+    cal.enabled = true;
+    cal.origin_tsc = tsc0;
+    cal.origin_ns = ns0;
+    cal.anchor.base_tsc = tsc1;
+    cal.anchor.base_ns = ns1;
+    cal.anchor.mult = static_cast<uint64_t>(
+        (static_cast<uint128_t>(ns1 - ns0) << 32) / (tsc1 - tsc0));
+    cal.ghz = static_cast<double>(tsc1 - tsc0) / static_cast<double>(ns1 - ns0);
+    return cal;
+}
+
+/// 进程级校准结果 (首次调用时校准，线程安全)
+inline const Calibration& calibration() {
+    static const Calibration cal = calibrate();
+    return cal;
+}
+
+/// 当前锚点 (首次使用时取校准结果)
+inline SeqLock<Anchor>& anchor() {
+    static SeqLock<Anchor> a(calibration().anchor);
+    return a;
+}
+
+/// TSC 换算的纳秒时间戳 (未启用时回退到 steady_clock)
+inline uint64_t now() {
+    const Calibration& cal = calibration();
+    if (!cal.enabled) {
+        return steady_now_ns();
+    }
+    Anchor a;
+    anchor().load(a);
+    return convert(a, rdtsc());
+}
+
+/**
+ * 与 steady_clock 重新对齐 (任意线程可调用，并发调用时只有一个生效)
+ *
+ * 新锚点取在当前 TSC 读数处、值为旧锚点换算的时间 (连续)，斜率取长基线频率，
+ * 再叠加在 kReanchorIntervalNs 内消化当前偏差所需的调整 (限幅 kMaxSlewPpb)。
+ *
+ * @return 重新对齐前 now() 相对 steady_clock 的偏差 (ns，正数表示 now() 偏快)
+ */
+inline int64_t reanchor() {
+    const Calibration& cal = calibration();
+    if (!cal.enabled) {
+        return 0;
+    }
+    static std::atomic<bool> busy{false};
+    if (busy.exchange(true, std::memory_order_acquire)) {
+        return 0;
+    }
+
+    uint64_t ns = 0, tsc = 0;
+    sample_pair(ns, tsc);
+    SeqLock<Anchor>& lock = anchor();
+    Anchor cur = lock.load();
+    uint64_t t = convert(cur, tsc);
+    int64_t skew = static_cast<int64_t>(t - ns);
+
+    if (tsc > cal.origin_tsc && ns > cal.origin_ns) {
+        int64_t mult = static_cast<int64_t>(
+            (static_cast<uint128_t>(ns - cal.origin_ns) << 32) / (tsc - cal.origin_tsc));
+        int64_t slew_ppb = std::clamp<int64_t>(
+            static_cast<int64_t>(-static_cast<int128_t>(skew) * 1'000'000'000 / kReanchorIntervalNs),
+            -kMaxSlewPpb, kMaxSlewPpb);
+        Anchor next;
+        next.base_tsc = tsc;
+        next.base_ns = t;
+        next.mult = static_cast<uint64_t>(mult + static_cast<int64_t>(
+            static_cast<int128_t>(mult) * slew_ppb / 1'000'000'000));
+        lock.store(next);
+    }
+    busy.store(false, std::memory_order_release);
+    return skew;
+}
+
+/// 距上次对齐超过 interval_ns 时重新对齐 (供周期线程调用，未到期时只有一次 now() 的开销)
+inline void maybe_reanchor(uint64_t interval_ns = kReanchorIntervalNs) {
+    const Calibration& cal = calibration();
+    if (!cal.enabled) {
+        return;
+    }
+    Anchor a;
+    anchor().load(a);
+    if (static_cast<int64_t>(convert(a, rdtsc()) - a.base_ns) >= static_cast<int64_t>(interval_ns)) {
+        reanchor();
+    }
+}
+
+}  // namespace tsc_clock
+}  // namespace malcolm
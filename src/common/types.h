@@ -10,6 +10,8 @@
 #include <chrono>
 #include <string>
 
+#include "tsc_clock.h"
+
 namespace malcolm {
 
 // ==================== 时间工具 ====================
@@ -17,11 +19,9 @@ namespace malcolm {
 using Timestamp = uint64_t;  // 纳秒级时间戳
 using Duration = int64_t;    // 纳秒级时间间隔 (可为负)
 
-/// 获取当前高精度时间戳 (纳秒)
+/// 获取当前高精度时间戳 (纳秒，CLOCK_MONOTONIC 起点; 支持 invariant TSC 时不进内核)
 inline Timestamp now_ns() {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()
-    ).count();
+    return tsc_clock::now();
 }
 
 /// 微秒转纳秒
@@ -40,6 +40,7 @@ namespace constants {
     constexpr uint16_t kDefaultPort = 31850;
     constexpr size_t kMaxPayloadSize = 4096;      // 最大请求负载大小
     constexpr size_t kMaxWorkers = 16;            // 最大 Worker 数量
+    constexpr size_t kDefaultLBThreads = 8;       // LB 派发线程数 (Client --lb_threads 默认与之一致)
     
     // 调度参数
     constexpr size_t kSlackHistogramBins = 32;    // 松弛时间直方图桶数
@@ -141,6 +142,16 @@ struct RequestTrace {
         return slack_time_ns() < 0; 
     }
     
+    // LB 视角的端到端延迟 (LB 看不到 t7，截止到 LB 收到 Worker 响应)
+    Timestamp lb_e2e_latency_ns() const {
+        return t6_lb_response - t1_client_send;
+    }
+    
+    // Worker 内停留时间 (排队 + 服务)
+    Timestamp worker_residence_ns() const {
+        return t5_worker_done - t4_worker_recv;
+    }
+    
     // LB 调度开销
     Timestamp lb_overhead_ns() const {
         return t3_lb_dispatch - t2_lb_receive;
@@ -160,8 +171,8 @@ struct WorkerState {
     std::string address;          // IP:Port
     
     // 负载指标
-    uint32_t queue_length;        // 当前队列长度
-    uint32_t active_requests;     // 正在处理的请求数
+    uint32_t queue_length;        // 等待队列长度 (不含执行中的任务)
+    uint32_t active_requests;     // 在途请求数 (排队 + 执行中)
     double load_ema;              // 负载指数移动平均
     
     // 松弛时间直方图 (用于 Malcolm-Strict)
@@ -202,6 +213,33 @@ inline const char* scheduler_type_name(SchedulerType type) {
     }
 }
 
+/// Power-of-d 比较候选 Worker 时使用的负载指标
+enum class LoadMetric {
+    kLoadEma,          // load_ema (默认)
+    kQueueLength,      // 等待队列长度 (Worker 上报值，两次上报之间 LB 按派发累加; 不含执行中的任务)
+    kOutstandingWork,  // (在途请求数 active_requests + 1) × 平均服务时间
+};
+
+inline const char* load_metric_name(LoadMetric metric) {
+    switch (metric) {
+        case LoadMetric::kLoadEma: return "load_ema";
+        case LoadMetric::kQueueLength: return "queue_length";
+        case LoadMetric::kOutstandingWork: return "outstanding_work";
+        default: return "unknown";
+    }
+}
+
+/// 解析命令行中的负载指标名称，无法识别时返回 false
+inline bool parse_load_metric(const std::string& name, LoadMetric* metric) {
+    for (LoadMetric m : {LoadMetric::kLoadEma, LoadMetric::kQueueLength, LoadMetric::kOutstandingWork}) {
+        if (name == load_metric_name(m)) {
+            *metric = m;
+            return true;
+        }
+    }
+    return false;
+}
+
 // ==================== 节点内调度策略 ====================
 
 enum class LocalSchedulerType {
@@ -1,7 +1,36 @@
 #include "workload.h"
 
+#include <fstream>
+#include <sstream>
+
 namespace malcolm {
 
 // 大部分实现在头文件中
 
+std::vector<Timestamp> load_arrival_trace(const std::string& path) {
+    std::vector<Timestamp> arrivals;
+    std::ifstream in(path);
+    if (!in) return arrivals;
+    
+    double t_ns = 0.0;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') continue;
+        
+        double gap_us = 0.0;
+        std::istringstream fields(line);
+        if (!(fields >> gap_us) || gap_us < 0.0) continue;
+        
+        t_ns += gap_us * 1e3;
+        arrivals.push_back(static_cast<Timestamp>(t_ns));
+    }
+    if (arrivals.empty()) return arrivals;
+    
+    // 周期 = 最后一次到达 + 平均间隔 (循环回放时首尾之间也保持间隔)
+    Timestamp period = arrivals.back() + std::max<Timestamp>(arrivals.back() / arrivals.size(), 1);
+    arrivals.push_back(period);
+    return arrivals;
+}
+
 }  // namespace malcolm
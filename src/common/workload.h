@@ -5,12 +5,16 @@
  * 
  * 生成符合重尾分布 (Pareto/Lognormal) 的服务时间请求
  * 这是触发 "方差陷阱" 的关键
+ * 以及开环负载的到达时间序列 (ArrivalProcess)
  */
 
 #include <random>
 #include <cmath>
 #include <algorithm>
 #include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 #include "../common/types.h"
 
 namespace malcolm {
@@ -146,6 +150,38 @@ struct RequestGeneratorConfig {
     // 剩余为 Compute
 };
 
+/**
+ * Worker 服务时间模型 (Worker 的忙等模拟和离散事件模拟器共用)
+ * 
+ * 期望服务时间先按容量因子缩放 (Slow Node capacity_factor < 1 服务时间更长)，
+ * 再按请求类型乘以开销系数
+ * 
+ * @return 服务时间 (纳秒，按微秒取整)
+ */
+inline Timestamp modeled_service_time_ns(RequestType type, uint32_t expected_us,
+                                         double capacity_factor) {
+    uint64_t adjusted_us = static_cast<uint64_t>(expected_us / capacity_factor);
+    
+    switch (type) {
+        case RequestType::kGetRequest:
+            // 轻量级读取
+            break;
+        case RequestType::kPutRequest:
+            // 中等写入
+            adjusted_us = static_cast<uint64_t>(adjusted_us * 1.2);
+            break;
+        case RequestType::kScanRequest:
+            // 重量级扫描
+            adjusted_us = static_cast<uint64_t>(adjusted_us * 2.0);
+            break;
+        case RequestType::kCompute:
+            // 计算密集型
+            adjusted_us = static_cast<uint64_t>(adjusted_us * 1.5);
+            break;
+    }
+    return us_to_ns(adjusted_us);
+}
+
 /**
  * 请求生成器
  * 
@@ -234,4 +270,154 @@ private:
     uint64_t next_id_{0};  // Not thread-safe, each thread should have its own generator
 };
 
+
+/**
+ * 到达过程类型
+ */
+enum class ArrivalPattern {
+    kDeterministic,   // 固定间隔 1/rate
+    kPoisson,         // 指数分布间隔 (默认，与实验设计一致)
+    kOnOff,           // 突发: ON/OFF 两状态 (MMPP-2 且 OFF 速率为 0)，时长服从指数分布
+    kTrace            // 按文件中的到达时间回放
+};
+
+inline const char* arrival_pattern_name(ArrivalPattern p) {
+    switch (p) {
+        case ArrivalPattern::kDeterministic: return "deterministic";
+        case ArrivalPattern::kPoisson:       return "poisson";
+        case ArrivalPattern::kOnOff:         return "onoff";
+        case ArrivalPattern::kTrace:         return "trace";
+    }
+    return "unknown";
+}
+
+/**
+ * 到达过程配置
+ */
+struct ArrivalConfig {
+    ArrivalPattern pattern = ArrivalPattern::kPoisson;
+    
+    // On/Off 参数: ON 期间以 rate * (on + off) / on 发送，使平均速率仍为 rate
+    double mean_on_us = 1000.0;      // ON 状态平均时长 (μs)
+    double mean_off_us = 1000.0;     // OFF 状态平均时长 (μs)
+    
+    // Trace 参数: 每行一个到达间隔 (μs)，回放到结尾后循环
+    std::string trace_path;
+};
+
+/**
+ * 加载到达时间 trace (每行一个到达间隔，单位 μs，# 开头为注释)
+ * 
+ * @return 各次到达相对 trace 开始的时间 (ns)，最后一个元素为整个 trace 的周期;
+ *         文件无法读取或没有有效行时返回空
+ */
+std::vector<Timestamp> load_arrival_trace(const std::string& path);
+
+/**
+ * 开环到达过程
+ * 
+ * 给出每个请求的计划发送时间 (相对实验开始的偏移)，与请求何时完成无关:
+ * 发送方落后于计划时应连续补发，并从计划时间起计算延迟，避免协调遗漏。
+ * 多个发送线程各持一个实例: 随机过程按线程速率独立采样; trace 按
+ * stream / num_streams 交错切分 (线程 i 回放第 i, i+n, i+2n, ... 次到达)。
+ * 不是线程安全的。
+ */
+class ArrivalProcess {
+public:
+    /**
+     * @param rate_rps 本实例的平均速率 (trace 模式忽略)
+     * @param trace load_arrival_trace() 的结果 (仅 trace 模式，可在线程间共享)
+     */
+    ArrivalProcess(const ArrivalConfig& config, double rate_rps, uint64_t seed,
+                   std::shared_ptr<const std::vector<Timestamp>> trace = nullptr,
+                   size_t stream = 0, size_t num_streams = 1)
+        : config_(config),
+          mean_gap_ns_(rate_rps > 0 ? 1e9 / rate_rps : 1e6),
+          rng_(seed),
+          trace_(std::move(trace)),
+          trace_index_(stream),
+          trace_stride_(std::max<size_t>(num_streams, 1)) {
+        if (config_.pattern == ArrivalPattern::kOnOff) {
+            double on = std::max(config_.mean_on_us, 1e-3) * 1e3;
+            double off = std::max(config_.mean_off_us, 0.0) * 1e3;
+            on_gap_ns_ = mean_gap_ns_ * on / (on + off);
+            on_mean_ns_ = on;
+            off_mean_ns_ = off;
+            state_end_ns_ = exponential(on_mean_ns_);
+        }
+        if (config_.pattern == ArrivalPattern::kTrace && (!trace_ || trace_->size() < 2)) {
+            // trace 无效时退化为固定间隔，避免无限循环
+            config_.pattern = ArrivalPattern::kDeterministic;
+        }
+        // 各线程的随机过程从随机相位开始，避免所有线程在 t=0 同时发送
+        if (config_.pattern == ArrivalPattern::kDeterministic) {
+            time_ns_ = mean_gap_ns_ * uniform_(rng_);
+        }
+    }
+    
+    /// 下一个请求的计划发送时间 (相对开始时间，ns，单调不减)
+    Timestamp next() {
+        switch (config_.pattern) {
+            case ArrivalPattern::kDeterministic:
+                time_ns_ += mean_gap_ns_;
+                break;
+            case ArrivalPattern::kPoisson:
+                time_ns_ += exponential(mean_gap_ns_);
+                break;
+            case ArrivalPattern::kOnOff:
+                next_on_off();
+                break;
+            case ArrivalPattern::kTrace: {
+                // 最后一个元素是周期，前面的是一个周期内的到达时间
+                size_t n = trace_->size() - 1;
+                size_t lap = trace_index_ / n;
+                time_ns_ = static_cast<double>(lap) * static_cast<double>(trace_->back()) +
+                           static_cast<double>((*trace_)[trace_index_ % n]);
+                trace_index_ += trace_stride_;
+                break;
+            }
+        }
+        return static_cast<Timestamp>(time_ns_);
+    }
+    
+    ArrivalPattern pattern() const { return config_.pattern; }
+    
+private:
+    double exponential(double mean) {
+        // 1 - u ∈ (0, 1]，避免 log(0)
+        return -mean * std::log(1.0 - uniform_(rng_));
+    }
+    
+    /// ON 状态内按 Poisson 到达; 越过 ON 结束时刻则跳过 OFF 期，从下一个 ON 期开始计
+    void next_on_off() {
+        double t = time_ns_ + exponential(on_gap_ns_);
+        while (t > state_end_ns_) {
+            // 无记忆性: 超出 ON 期的部分直接平移到下一个 ON 期
+            double overshoot = t - state_end_ns_;
+            double on_start = state_end_ns_ + exponential(off_mean_ns_);
+            state_end_ns_ = on_start + exponential(on_mean_ns_);
+            t = on_start + overshoot;
+        }
+        time_ns_ = t;
+    }
+    
+    ArrivalConfig config_;
+    double mean_gap_ns_;
+    double time_ns_ = 0.0;
+    
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+    
+    // On/Off 状态
+    double on_gap_ns_ = 0.0;
+    double on_mean_ns_ = 0.0;
+    double off_mean_ns_ = 0.0;
+    double state_end_ns_ = 0.0;   // 当前 ON 期的结束时刻
+    
+    // Trace 回放
+    std::shared_ptr<const std::vector<Timestamp>> trace_;
+    size_t trace_index_;
+    size_t trace_stride_;
+};
+
 }  // namespace malcolm
@@ -0,0 +1,391 @@
+#pragma once
+
+/**
+ * 无 LibTorch 依赖的原生推理引擎 (header-only)
+ *
+ * Malcolm (Nash Q 网络) 和 Malcolm-Strict (IQN) 都是小型 MLP，
+ * 用 torch::jit 推理会把整个运行时拉进 LB，且每次调用有数微秒的框架开销。
+ * 这里直接加载 scripts/export_native_model.py 导出的扁平权重文件，
+ * 用 simd_kernels.h 中的 GEMV 核完成前向传播，热路径上不分配内存。
+ *
+ * 文件格式 (小端):
+ *   char[4] magic = "MSNN", u32 version = 1, u32 kind (1 = MLP, 2 = IQN)
+ *   kind = MLP : <MLP 块>
+ *   kind = IQN : <MLP 块: 状态编码 ψ(s)> <MLP 块: 余弦嵌入 φ(τ)，单层> <MLP 块: 输出头 f>
+ *   MLP 块     : u32 num_layers，随后每层
+ *                u32 in, u32 out, u32 activation (0 = 无, 1 = ReLU),
+ *                float weight[out][in] (行主序), float bias[out]
+ *
+ * IQN 前向 (Dabney et al. 2018):
+ *   h = ψ(s)
+ *   φ(τ) = ReLU(W_cos · [cos(π·i·τ)]_{i=0..n_cos-1} + b_cos)
+ *   Z(s, τ) = f(h ⊙ φ(τ))   -> 每个 Worker 在分位数 τ 处的延迟估计
+ * 分位数采样点在调度器中是固定的，因此 φ(τ) 在 set_quantiles() 时预先计算。
+ *
+ * 线程模型: 模型对象内含激活缓冲区，每个调度器实例 (即每个派发线程) 独占一个。
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "simd_kernels.h"
+
+namespace malcolm {
+
+enum class NativeModelKind : uint32_t {
+    kMLP = 1,
+    kIQN = 2,
+};
+
+/**
+ * 全连接层 (权重行跨度补齐到 kSimdPad，补齐部分为 0)
+ */
+class NativeDense {
+public:
+    enum Activation : uint32_t { kNone = 0, kReLU = 1 };
+
+    size_t in_dim() const { return in_; }
+    size_t out_dim() const { return out_; }
+    size_t in_stride() const { return in_stride_; }
+    size_t out_stride() const { return simd_padded(out_); }
+
+    /**
+     * y = act(W x + b)
+     *
+     * @param x 长度 in_stride()，尾部为 0
+     * @param y 长度 out_stride()，输出尾部置 0 以便作为下一层输入
+     */
+    void forward(const float* x, float* y) const {
+        simd_gemv(weight_.data(), out_, in_stride_, x, bias_.data(), y);
+        for (size_t i = out_; i < out_stride(); ++i) {
+            y[i] = 0.0f;
+        }
+        if (act_ == kReLU) {
+            simd_relu(y, out_stride());
+        }
+    }
+
+    /**
+     * 对 n 个输入做前向: Y[k] = act(W X[k] + b)
+     *
+     * @param x [n][in_stride()]，每行尾部为 0
+     * @param y [n][out_stride()]，每行尾部置 0
+     */
+    void forward_batch(const float* x, size_t n, float* y) const {
+        size_t ys = out_stride();
+        simd_gemm(weight_.data(), out_, in_stride_, x, n, bias_.data(), y, ys);
+        for (size_t k = 0; k < n; ++k) {
+            for (size_t i = out_; i < ys; ++i) {
+                y[k * ys + i] = 0.0f;
+            }
+        }
+        if (act_ == kReLU) {
+            simd_relu(y, n * ys);
+        }
+    }
+
+    bool read(std::FILE* f) {
+        uint32_t hdr[3];
+        if (std::fread(hdr, sizeof(uint32_t), 3, f) != 3) return false;
+        in_ = hdr[0];
+        out_ = hdr[1];
+        act_ = hdr[2];
+        if (in_ == 0 || out_ == 0 || act_ > kReLU) return false;
+
+        in_stride_ = simd_padded(in_);
+        weight_.assign(out_ * in_stride_, 0.0f);
+        for (size_t r = 0; r < out_; ++r) {
+            if (std::fread(&weight_[r * in_stride_], sizeof(float), in_, f) != in_) {
+                return false;
+            }
+        }
+        bias_.assign(out_stride(), 0.0f);
+        return std::fread(bias_.data(), sizeof(float), out_, f) == out_;
+    }
+
+private:
+    size_t in_ = 0;
+    size_t out_ = 0;
+    size_t in_stride_ = 0;
+    uint32_t act_ = kNone;
+    AlignedFloats weight_;
+    AlignedFloats bias_;
+};
+
+/**
+ * 多层感知机 (层间使用两块乒乓缓冲区)
+ */
+class NativeMLP {
+public:
+    size_t input_dim() const { return layers_.front().in_dim(); }
+    size_t input_stride() const { return layers_.front().in_stride(); }
+    size_t output_dim() const { return layers_.back().out_dim(); }
+    size_t num_layers() const { return layers_.size(); }
+
+    /**
+     * @param x 长度 input_stride()，尾部为 0
+     * @return 指向内部缓冲区的输出 (长度 output_dim()，下次调用前有效)
+     */
+    const float* forward(const float* x) {
+        const float* in = x;
+        float* out = buf_[0].data();
+        for (size_t i = 0; i < layers_.size(); ++i) {
+            out = buf_[i & 1].data();
+            layers_[i].forward(in, out);
+            in = out;
+        }
+        return out;
+    }
+
+    /// 批量前向的输出行跨度
+    size_t output_stride() const { return layers_.back().out_stride(); }
+
+    /**
+     * 批量前向 (需先 reserve_batch(n))
+     *
+     * @param x [n][input_stride()]，每行尾部为 0
+     * @return [n][output_stride()]，指向内部缓冲区，下次调用前有效
+     */
+    const float* forward_batch(const float* x, size_t n) {
+        const float* in = x;
+        float* out = batch_buf_[0].data();
+        for (size_t i = 0; i < layers_.size(); ++i) {
+            out = batch_buf_[i & 1].data();
+            layers_[i].forward_batch(in, n, out);
+            in = out;
+        }
+        return out;
+    }
+
+    /// 为最多 n 个输入的批量前向分配缓冲区
+    void reserve_batch(size_t n) {
+        batch_buf_[0].assign(n * buf_[0].size(), 0.0f);
+        batch_buf_[1].assign(n * buf_[0].size(), 0.0f);
+    }
+
+    bool read(std::FILE* f) {
+        uint32_t n = 0;
+        if (std::fread(&n, sizeof(n), 1, f) != 1 || n == 0) return false;
+        layers_.resize(n);
+        size_t width = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            if (!layers_[i].read(f)) return false;
+            if (i > 0 && layers_[i].in_dim() != layers_[i - 1].out_dim()) return false;
+            width = std::max(width, layers_[i].out_stride());
+        }
+        buf_[0].assign(width, 0.0f);
+        buf_[1].assign(width, 0.0f);
+        return true;
+    }
+
+private:
+    std::vector<NativeDense> layers_;
+    AlignedFloats buf_[2];
+    AlignedFloats batch_buf_[2];
+};
+
+namespace detail {
+
+/// 读取并校验文件头，返回模型类型 (失败返回 0)
+inline uint32_t read_native_header(std::FILE* f) {
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t kind = 0;
+    if (std::fread(magic, 1, 4, f) != 4 || std::memcmp(magic, "MSNN", 4) != 0) return 0;
+    if (std::fread(&version, sizeof(version), 1, f) != 1 || version != 1) return 0;
+    if (std::fread(&kind, sizeof(kind), 1, f) != 1) return 0;
+    return kind;
+}
+
+}  // namespace detail
+
+/**
+ * 纯 MLP 模型 (Malcolm Nash Q 网络: 状态 -> 每个 Worker 的 Q 值)
+ */
+class NativeMLPModel {
+public:
+    bool load(const std::string& path) {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            fprintf(stderr, "[Native] Cannot open model: %s\n", path.c_str());
+            return false;
+        }
+        bool ok = detail::read_native_header(f) == static_cast<uint32_t>(NativeModelKind::kMLP)
+                  && mlp_.read(f);
+        std::fclose(f);
+        if (!ok) {
+            fprintf(stderr, "[Native] Invalid MLP model file: %s\n", path.c_str());
+            return false;
+        }
+        input_.assign(mlp_.input_stride(), 0.0f);
+        return true;
+    }
+
+    size_t input_dim() const { return mlp_.input_dim(); }
+    size_t output_dim() const { return mlp_.output_dim(); }
+
+    /**
+     * @param state 长度必须等于 input_dim()
+     * @return 输出 (长度 output_dim()，下次调用前有效)
+     */
+    const float* forward(const float* state) {
+        std::memcpy(input_.data(), state, input_dim() * sizeof(float));
+        return mlp_.forward(input_.data());
+    }
+
+private:
+    NativeMLP mlp_;
+    AlignedFloats input_;
+};
+
+/**
+ * IQN 模型 (Malcolm-Strict: 状态 + 分位数 -> 每个 Worker 的延迟分位数)
+ */
+class NativeIQNModel {
+public:
+    bool load(const std::string& path) {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            fprintf(stderr, "[Native] Cannot open model: %s\n", path.c_str());
+            return false;
+        }
+        bool ok = detail::read_native_header(f) == static_cast<uint32_t>(NativeModelKind::kIQN)
+                  && state_net_.read(f) && cos_net_.read(f) && head_.read(f)
+                  && cos_net_.num_layers() == 1
+                  && cos_net_.output_dim() == state_net_.output_dim()
+                  && head_.input_dim() == state_net_.output_dim();
+        std::fclose(f);
+        if (!ok) {
+            fprintf(stderr, "[Native] Invalid IQN model file: %s\n", path.c_str());
+            return false;
+        }
+        input_.assign(state_net_.input_stride(), 0.0f);
+        embed_stride_ = simd_padded(state_net_.output_dim());
+        cos_.assign(cos_net_.input_stride(), 0.0f);
+        return true;
+    }
+
+    size_t input_dim() const { return state_net_.input_dim(); }
+    size_t num_outputs() const { return head_.output_dim(); }
+    size_t num_quantiles() const { return num_quantiles_; }
+    size_t embedding_dim() const { return state_net_.output_dim(); }
+
+    /**
+     * 设置分位数采样点并预计算 φ(τ)
+     */
+    void set_quantiles(const float* taus, size_t n) {
+        num_quantiles_ = n;
+        size_t stride = embed_stride_;
+        phi_.assign(n * stride, 0.0f);
+        embed_.assign(n * stride, 0.0f);
+        head_.reserve_batch(n);
+        size_t n_cos = cos_net_.input_dim();
+        for (size_t q = 0; q < n; ++q) {
+            for (size_t i = 0; i < n_cos; ++i) {
+                cos_[i] = static_cast<float>(std::cos(M_PI * static_cast<double>(i) * taus[q]));
+            }
+            const float* phi = cos_net_.forward(cos_.data());
+            std::memcpy(&phi_[q * stride], phi, stride * sizeof(float));
+        }
+    }
+
+    /**
+     * 前向传播
+     *
+     * @param state 长度必须等于 input_dim()
+     * @param out 输出 [num_outputs()][num_quantiles()] (与 TorchScript 模型的 [W, Q] 布局一致)
+     */
+    void forward(const float* state, float* out) {
+        std::memcpy(input_.data(), state, input_dim() * sizeof(float));
+        const float* h = state_net_.forward(input_.data());
+
+        // 各分位数的输入 h ⊙ φ(τ_q) 拼成 [Q][stride]，输出头做一次小 GEMM
+        for (size_t q = 0; q < num_quantiles_; ++q) {
+            simd_mul(h, &phi_[q * embed_stride_], &embed_[q * embed_stride_], embed_stride_);
+        }
+        const float* z = head_.forward_batch(embed_.data(), num_quantiles_);
+        transpose_quantiles(z, out);
+    }
+
+    /**
+     * 批量前向: 状态编码 ψ 对整批做一次 GEMM，输出头对 [n·Q] 行做一次 GEMM
+     *
+     * 缓冲区按出现过的最大批量增长，批量稳定后热路径上不再分配。
+     *
+     * @param states [n][input_dim()] (行间无填充)
+     * @param out 输出 [n][num_outputs()][num_quantiles()]
+     */
+    void forward_batch(const float* states, size_t n, float* out) {
+        reserve_batch(n);
+        size_t in_dim = input_dim();
+        size_t in_stride = state_net_.input_stride();
+        for (size_t b = 0; b < n; ++b) {
+            std::memcpy(&batch_input_[b * in_stride], states + b * in_dim, in_dim * sizeof(float));
+        }
+        const float* h = state_net_.forward_batch(batch_input_.data(), n);
+
+        // [n][Q][stride]: 第 b 个状态的 h ⊙ φ(τ_q)
+        for (size_t b = 0; b < n; ++b) {
+            for (size_t q = 0; q < num_quantiles_; ++q) {
+                simd_mul(&h[b * embed_stride_], &phi_[q * embed_stride_],
+                         &batch_embed_[(b * num_quantiles_ + q) * embed_stride_], embed_stride_);
+            }
+        }
+        const float* z = head_.forward_batch(batch_embed_.data(), n * num_quantiles_);
+
+        size_t block = num_outputs() * num_quantiles_;
+        size_t z_block = num_quantiles_ * head_.output_stride();
+        for (size_t b = 0; b < n; ++b) {
+            transpose_quantiles(z + b * z_block, out + b * block);
+        }
+    }
+
+private:
+    /// 输出头的 [Q][output stride] 转成 [num_outputs()][Q]
+    void transpose_quantiles(const float* z, float* out) const {
+        size_t outputs = num_outputs();
+        size_t z_stride = head_.output_stride();
+        for (size_t q = 0; q < num_quantiles_; ++q) {
+            for (size_t w = 0; w < outputs; ++w) {
+                out[w * num_quantiles_ + q] = z[q * z_stride + w];
+            }
+        }
+    }
+
+    void reserve_batch(size_t n) {
+        if (n <= batch_capacity_) return;
+        batch_capacity_ = n;
+        batch_input_.assign(n * state_net_.input_stride(), 0.0f);
+        batch_embed_.assign(n * num_quantiles_ * embed_stride_, 0.0f);
+        state_net_.reserve_batch(n);
+        head_.reserve_batch(n * num_quantiles_);
+    }
+
+    NativeMLP state_net_;
+    NativeMLP cos_net_;
+    NativeMLP head_;
+
+    size_t num_quantiles_ = 0;
+    AlignedFloats input_;
+    AlignedFloats cos_;
+    AlignedFloats phi_;      // [Q][embedding stride]
+    size_t embed_stride_ = 0;
+    AlignedFloats embed_;    // [Q][embedding stride]
+
+    // 批量前向缓冲区
+    size_t batch_capacity_ = 0;
+    AlignedFloats batch_input_;   // [n][input stride]
+    AlignedFloats batch_embed_;   // [n][Q][embedding stride]
+};
+
+/// 是否为原生权重文件 (按扩展名 .bin 区分于 TorchScript 的 .pt)
+inline bool is_native_model_path(const std::string& path) {
+    return path.size() > 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+}
+
+}  // namespace malcolm
@@ -0,0 +1,275 @@
+#pragma once
+
+/**
+ * 原生推理用的 SIMD 计算核
+ *
+ * 指令集在编译期选择 (CMake NATIVE_SIMD / -march):
+ * - AVX-512F : 每次 16 个 float
+ * - AVX2+FMA : 每次 8 个 float
+ * - 标量     : 其他平台
+ *
+ * 约定: 向量长度 (矩阵行跨度) 已补齐到 kSimdPad 的整数倍且尾部为 0，
+ * 缓冲区按 kSimdAlign 字节对齐，核函数内部不处理尾部。
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(__AVX512F__) && !defined(MALCOLM_SIMD_NO_AVX512)
+#define MALCOLM_SIMD_AVX512 1
+#include <immintrin.h>
+#elif defined(__AVX2__) && defined(__FMA__) && !defined(MALCOLM_SIMD_NO_AVX2)
+#define MALCOLM_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace malcolm {
+
+constexpr size_t kSimdAlign = 64;   // 一个 cache line / 一个 zmm 寄存器
+constexpr size_t kSimdPad = 16;     // 行跨度补齐单位 (float 个数)
+
+/// 向上补齐到 kSimdPad 的整数倍
+constexpr size_t simd_padded(size_t n) {
+    return (n + kSimdPad - 1) / kSimdPad * kSimdPad;
+}
+
+/// 当前编译选择的指令集名称
+inline const char* simd_isa_name() {
+#if defined(MALCOLM_SIMD_AVX512)
+    return "AVX-512";
+#elif defined(MALCOLM_SIMD_AVX2)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * 64 字节对齐分配器 (用于权重和激活缓冲区)
+ */
+template<typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() = default;
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + kSimdAlign - 1) / kSimdAlign * kSimdAlign;
+        void* p = std::aligned_alloc(kSimdAlign, bytes);
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t) { std::free(p); }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U>&) const { return true; }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+#if defined(MALCOLM_SIMD_AVX512) || defined(MALCOLM_SIMD_AVX2)
+inline float hsum256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+#endif
+
+#if defined(MALCOLM_SIMD_AVX512)
+// 不用 _mm512_reduce_add_ps / extract / shuffle: GCC 12 对其内部的 undefined 寄存器
+// 报 -Wmaybe-uninitialized。每行只归约一次，经栈中转的开销可以忽略
+inline float hsum512(__m512 v) {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, v);
+    return hsum256(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+}
+#endif
+
+/**
+ * y = W x + b
+ *
+ * @param w 行主序权重 [rows][stride]
+ * @param stride 行跨度 (kSimdPad 的整数倍，x 同长且尾部为 0)
+ * 一次处理 4 行以复用 x 的加载
+ */
+inline void simd_gemv(const float* __restrict w, size_t rows, size_t stride,
+                      const float* __restrict x, const float* __restrict b,
+                      float* __restrict y) {
+    size_t r = 0;
+#if defined(MALCOLM_SIMD_AVX512)
+    for (; r + 4 <= rows; r += 4) {
+        const float* w0 = w + r * stride;
+        const float* w1 = w0 + stride;
+        const float* w2 = w1 + stride;
+        const float* w3 = w2 + stride;
+        __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+        __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+        for (size_t i = 0; i < stride; i += 16) {
+            __m512 xv = _mm512_load_ps(x + i);
+            a0 = _mm512_fmadd_ps(_mm512_load_ps(w0 + i), xv, a0);
+            a1 = _mm512_fmadd_ps(_mm512_load_ps(w1 + i), xv, a1);
+            a2 = _mm512_fmadd_ps(_mm512_load_ps(w2 + i), xv, a2);
+            a3 = _mm512_fmadd_ps(_mm512_load_ps(w3 + i), xv, a3);
+        }
+        y[r]     = hsum512(a0) + b[r];
+        y[r + 1] = hsum512(a1) + b[r + 1];
+        y[r + 2] = hsum512(a2) + b[r + 2];
+        y[r + 3] = hsum512(a3) + b[r + 3];
+    }
+    for (; r < rows; ++r) {
+        const float* wr = w + r * stride;
+        __m512 acc = _mm512_setzero_ps();
+        for (size_t i = 0; i < stride; i += 16) {
+            acc = _mm512_fmadd_ps(_mm512_load_ps(wr + i), _mm512_load_ps(x + i), acc);
+        }
+        y[r] = hsum512(acc) + b[r];
+    }
+#elif defined(MALCOLM_SIMD_AVX2)
+    for (; r + 4 <= rows; r += 4) {
+        const float* w0 = w + r * stride;
+        const float* w1 = w0 + stride;
+        const float* w2 = w1 + stride;
+        const float* w3 = w2 + stride;
+        __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+        for (size_t i = 0; i < stride; i += 8) {
+            __m256 xv = _mm256_load_ps(x + i);
+            a0 = _mm256_fmadd_ps(_mm256_load_ps(w0 + i), xv, a0);
+            a1 = _mm256_fmadd_ps(_mm256_load_ps(w1 + i), xv, a1);
+            a2 = _mm256_fmadd_ps(_mm256_load_ps(w2 + i), xv, a2);
+            a3 = _mm256_fmadd_ps(_mm256_load_ps(w3 + i), xv, a3);
+        }
+        y[r]     = hsum256(a0) + b[r];
+        y[r + 1] = hsum256(a1) + b[r + 1];
+        y[r + 2] = hsum256(a2) + b[r + 2];
+        y[r + 3] = hsum256(a3) + b[r + 3];
+    }
+    for (; r < rows; ++r) {
+        const float* wr = w + r * stride;
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t i = 0; i < stride; i += 8) {
+            acc = _mm256_fmadd_ps(_mm256_load_ps(wr + i), _mm256_load_ps(x + i), acc);
+        }
+        y[r] = hsum256(acc) + b[r];
+    }
+#else
+    for (; r < rows; ++r) {
+        const float* wr = w + r * stride;
+        float acc = 0.0f;
+        for (size_t i = 0; i < stride; ++i) {
+            acc += wr[i] * x[i];
+        }
+        y[r] = acc + b[r];
+    }
+#endif
+}
+
+/**
+ * Y[k] = W X[k] + b，k = 0..n-1 (同一权重作用于 n 个输入)
+ *
+ * 每 4 个输入一组共享一次权重加载，使 IQN 输出头在各分位数上的计算从
+ * 访存受限的 GEMV 变成计算受限的小 GEMM; 余下不足 4 个的输入退回 simd_gemv。
+ *
+ * @param x 输入 [n][stride]
+ * @param y 输出 [n][y_stride]
+ */
+inline void simd_gemm(const float* __restrict w, size_t rows, size_t stride,
+                      const float* __restrict x, size_t n,
+                      const float* __restrict b, float* __restrict y, size_t y_stride) {
+    size_t k = 0;
+#if defined(MALCOLM_SIMD_AVX512) || defined(MALCOLM_SIMD_AVX2)
+    for (; k + 4 <= n; k += 4) {
+        const float* x0 = x + k * stride;
+        const float* x1 = x0 + stride;
+        const float* x2 = x1 + stride;
+        const float* x3 = x2 + stride;
+        float* y0 = y + k * y_stride;
+        for (size_t r = 0; r < rows; ++r) {
+            const float* wr = w + r * stride;
+#if defined(MALCOLM_SIMD_AVX512)
+            __m512 a0 = _mm512_setzero_ps(), a1 = _mm512_setzero_ps();
+            __m512 a2 = _mm512_setzero_ps(), a3 = _mm512_setzero_ps();
+            for (size_t i = 0; i < stride; i += 16) {
+                __m512 wv = _mm512_load_ps(wr + i);
+                a0 = _mm512_fmadd_ps(wv, _mm512_load_ps(x0 + i), a0);
+                a1 = _mm512_fmadd_ps(wv, _mm512_load_ps(x1 + i), a1);
+                a2 = _mm512_fmadd_ps(wv, _mm512_load_ps(x2 + i), a2);
+                a3 = _mm512_fmadd_ps(wv, _mm512_load_ps(x3 + i), a3);
+            }
+            y0[r]                = hsum512(a0) + b[r];
+            y0[y_stride + r]     = hsum512(a1) + b[r];
+            y0[2 * y_stride + r] = hsum512(a2) + b[r];
+            y0[3 * y_stride + r] = hsum512(a3) + b[r];
+#else
+            __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+            __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+            for (size_t i = 0; i < stride; i += 8) {
+                __m256 wv = _mm256_load_ps(wr + i);
+                a0 = _mm256_fmadd_ps(wv, _mm256_load_ps(x0 + i), a0);
+                a1 = _mm256_fmadd_ps(wv, _mm256_load_ps(x1 + i), a1);
+                a2 = _mm256_fmadd_ps(wv, _mm256_load_ps(x2 + i), a2);
+                a3 = _mm256_fmadd_ps(wv, _mm256_load_ps(x3 + i), a3);
+            }
+            y0[r]                = hsum256(a0) + b[r];
+            y0[y_stride + r]     = hsum256(a1) + b[r];
+            y0[2 * y_stride + r] = hsum256(a2) + b[r];
+            y0[3 * y_stride + r] = hsum256(a3) + b[r];
+#endif
+        }
+    }
+#endif
+    for (; k < n; ++k) {
+        simd_gemv(w, rows, stride, x + k * stride, b, y + k * y_stride);
+    }
+}
+
+/// x = max(x, 0)，n 为 kSimdPad 的整数倍
+inline void simd_relu(float* __restrict x, size_t n) {
+#if defined(MALCOLM_SIMD_AVX512)
+    // maskz 形式: 全 1 掩码下与 _mm512_max_ps 等价，但不经过 undefined 寄存器 (见 hsum512)
+    const __m512 zero = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        _mm512_store_ps(x + i, _mm512_maskz_max_ps(0xFFFF, _mm512_load_ps(x + i), zero));
+    }
+#elif defined(MALCOLM_SIMD_AVX2)
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        _mm256_store_ps(x + i, _mm256_max_ps(_mm256_load_ps(x + i), zero));
+    }
+#else
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+    }
+#endif
+}
+
+/// out = a ⊙ b (逐元素乘)，n 为 kSimdPad 的整数倍
+inline void simd_mul(const float* __restrict a, const float* __restrict b,
+                     float* __restrict out, size_t n) {
+#if defined(MALCOLM_SIMD_AVX512)
+    for (size_t i = 0; i < n; i += 16) {
+        _mm512_store_ps(out + i, _mm512_mul_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i)));
+    }
+#elif defined(MALCOLM_SIMD_AVX2)
+    for (size_t i = 0; i < n; i += 8) {
+        _mm256_store_ps(out + i, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+    }
+#else
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * b[i];
+    }
+#endif
+}
+
+}  // namespace malcolm
@@ -12,15 +12,15 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
 
 #include "../common/types.h"
 #include "../common/metrics.h"
 #include "../common/rpc_types.h"
 #include "../scheduler/scheduler.h"
-
-// eRPC
-#include "rpc.h"
+#include "../transport/transport.h"
+#include "pending_table.h"
+#include "request_pool.h"
+#include "worker_state_table.h"
 
 namespace malcolm {
 
@@ -30,30 +30,112 @@ namespace malcolm {
 struct LBConfig {
     std::string listen_uri;         // 监听地址 (如 "0.0.0.0:31850")
     uint16_t port = constants::kDefaultPort;
+    TransportType transport = kDefaultTransport;
     
     std::vector<std::string> worker_addresses;  // Worker 地址列表
     
     SchedulerType algorithm = SchedulerType::kPowerOf2;
     std::string model_path;         // DRL 模型路径
+    size_t po2_choices = 2;         // Power-of-d 的候选数 d
+    LoadMetric po2_metric = LoadMetric::kLoadEma;  // Power-of-d 的负载指标
+    
+    size_t num_rpc_threads = constants::kDefaultLBThreads;  // 派发线程数 (每线程一个传输端点)
+    size_t max_inflight_requests = 16384;  // 在途请求上限 (pending table 槽位数)
     
-    size_t num_rpc_threads = 8;     // eRPC 服务线程数
+    // 批量调度: 一轮事件循环中到达的请求攒批后一次调度
+    size_t sched_batch_size = 1;           // 每批最多请求数 (1 = 不攒批，逐个调度)
+    Timestamp sched_batch_budget_ns = 0;   // 最早请求最多等待时间 (0 = 每轮事件循环结束即调度)
     
     // 状态更新间隔
     Timestamp state_update_interval_ns = us_to_ns(100);  // 100μs
     
     // 输出
     std::string metrics_output_dir;
+    uint32_t metrics_interval_ms = 1000;   // 区间直方图时间序列周期 (0 = 只导出累计直方图)
+};
+
+/**
+ * LB 在途请求 (槽位句柄作为请求 tag，仅由所属派发线程访问)
+ */
+struct PendingRequest {
+    uint64_t request_id;
+    Timestamp send_time;
+    Timestamp deadline;
+    Timestamp lb_recv_time;         // t2: LB 收到客户端请求
+    Timestamp dispatch_time;        // t3: 调度完成、转发给 Worker
+    ReqHandle* client_handle;
+    LBRequestContext* ctx;
+    uint8_t target_worker;
+};
+
+/**
+ * 等待批量调度的客户端请求
+ */
+struct BatchedRequest {
+    ReqHandle* req_handle;
+    RpcClientRequest request;   // 拷贝: 单包请求的 msgbuf 指向 RX ring，handler 返回后即失效
+    Timestamp recv_time;
+};
+
+class LBContext;
+
+/**
+ * 派发线程上下文
+ *
+ * 传输端点 (eRPC 的 Rpc 等) 不是线程安全的，因此每个派发线程拥有:
+ * - 独立的传输端点 (rpc_id = 线程编号) 和到每个 Worker 的会话
+ * - 独立的调度器实例、在途请求表和转发上下文池
+ * - 独立的指标收集器 (导出时合并)
+ * 线程之间只共享 Worker 状态表 (SeqLock 发布，读取无锁)。
+ */
+struct LBDispatcher {
+    LBDispatcher(LBContext* owner, size_t id, size_t max_inflight)
+        : lb(owner), thread_id(id), pending_requests(max_inflight) {}
+    
+    LBContext* lb;
+    size_t thread_id;
+    
+    std::unique_ptr<Transport> rpc;
+    std::vector<int> worker_sessions;              // 到每个 Worker 的会话
+    std::unique_ptr<LBRequestPool> request_pool;   // 转发上下文 + MsgBuffer 池
+    
+    std::unique_ptr<Scheduler> scheduler;
+    
+    // Worker 状态私有视图 (调度前从 WorkerStateTable 无锁同步)
+    std::vector<WorkerState> state_view;
+    std::vector<uint64_t> state_versions;
+    
+    // 批量调度缓冲区 (容量预留为 sched_batch_size)
+    std::vector<BatchedRequest> batch;
+    std::vector<ClientRequest> batch_requests;
+    std::vector<ScheduleDecision> batch_decisions;
+    
+    PendingTable<PendingRequest> pending_requests;
+    uint64_t pending_table_full = 0;   // 因在途请求表已满被拒绝的请求数
+    
+    // Worker 状态推送 (控制流量) 统计
+    uint64_t state_updates = 0;
+    uint64_t state_update_bytes = 0;   // 推送 + 确认字节数
+    
+    MetricsCollector metrics;
+    LatencyHistogram scheduling_latency;
 };
 
 /**
  * Load Balancer 运行时上下文
+ *
+ * 线程模型:
+ * - 派发线程 0 运行在调用 start() 的主线程，其余 num_rpc_threads-1 个为后台线程
+ * - 客户端按 client_id 选择远端 rpc_id，从而分散到各派发线程
+ * - 状态更新线程定期衰减 Worker 负载估计
+ * - Worker 主动推送的状态 (kReqStateUpdate) 由派发线程 0 接收并合并进状态表
  */
 class LBContext {
 public:
     explicit LBContext(const LBConfig& config);
     ~LBContext();
     
-    /// 启动 LB 服务
+    /// 启动 LB 服务 (阻塞，直到 stop() 被调用)
     void start();
     
     /// 停止 LB 服务
@@ -72,6 +154,9 @@ private:
     /// 处理 Worker 响应
     void handle_worker_response(const WorkerResponse* response);
     
+    /// 派发线程主循环 (创建传输端点、连接 Worker、运行事件循环)
+    void dispatcher_thread_main(size_t thread_id);
+    
     /// 状态更新线程
     void state_update_thread_main();
     
@@ -81,6 +166,27 @@ private:
     /// 更新 Worker 状态
     void update_worker_states();
     
+    /// 调度当前攒下的一批请求并转发
+    void flush_batch(LBDispatcher* d);
+    
+    /// 把 Worker 状态变化同步到派发线程的私有视图，并推送给该线程的调度器
+    void sync_state_view(LBDispatcher* d);
+    
+    /// 按调度决策把请求转发给目标 Worker
+    static void dispatch_request(LBDispatcher* d,
+                                 ReqHandle* req_handle,
+                                 const RpcClientRequest* request,
+                                 const ScheduleDecision& decision,
+                                 Timestamp recv_time);
+    
+    /// 事件循环退出后回收线程和传输资源
+    void shutdown();
+    
+    /// 无法转发时直接向客户端返回失败响应 (传输层要求每个请求都必须响应)
+    static void reject_client_request(LBDispatcher* d,
+                                      ReqHandle* req_handle,
+                                      const RpcClientRequest* request);
+    
 private:
     LBConfig config_;
     
@@ -88,35 +194,25 @@ private:
     std::vector<std::thread> threads_;
     std::thread state_thread_;
     
-    // 调度器
-    std::unique_ptr<Scheduler> scheduler_;
-    
-    // Worker 状态
-    std::vector<WorkerState> worker_states_;
-    mutable std::mutex state_mutex_;
-    
-    // 未完成请求追踪
-    struct PendingRequest {
-        uint64_t request_id;
-        Timestamp send_time;
-        Timestamp deadline;
-        void* client_handle;
-        uint8_t target_worker;
-    };
-    std::unordered_map<uint64_t, PendingRequest> pending_requests_;
-    std::mutex pending_mutex_;
-    
-    // 指标收集
-    MetricsCollector metrics_;
-    LatencyHistogram scheduling_latency_;
-    
-    // eRPC 上下文
-    erpc::Nexus* nexus_ = nullptr;
-    erpc::Rpc<erpc::CTransport>* rpc_ = nullptr;
-    std::vector<int> worker_sessions_;  // 到每个 Worker 的会话
-    
-    // RPC 回调
-    static void client_request_handler(erpc::ReqHandle* req_handle, void* context);
+    // 派发线程上下文 (下标 = rpc_id)
+    std::vector<std::unique_ptr<LBDispatcher>> dispatchers_;
+    
+    // Worker 状态 (所有派发线程共享，逐 Worker SeqLock)
+    std::unique_ptr<WorkerStateTable> worker_table_;
+    
+    // 传输上下文 (所有派发线程共享)
+    std::unique_ptr<TransportNexus> nexus_;
+    
+    Timestamp start_time_ = 0;
+    
+    // 区间直方图时间序列 (所有派发线程共同记录，未启用时为空)
+    std::unique_ptr<IntervalMetricsLog> interval_log_;
+    RequestIntervalSeries interval_series_;
+    IntervalHistogram* interval_scheduling_ = nullptr;
+    
+    // RPC 回调 (context 为 LBDispatcher*)
+    static void client_request_handler(ReqHandle* req_handle, void* context);
+    static void state_update_handler(ReqHandle* req_handle, void* context);
     static void worker_response_callback(void* context, void* tag);
 };
 
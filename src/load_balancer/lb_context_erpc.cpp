@@ -1,48 +1,24 @@
 /**
- * Load Balancer 上下文实现 - 真正的 eRPC 服务
+ * Load Balancer 上下文实现 - 经传输层 (eRPC / 共享内存) 收发请求
  */
 
 #include "lb_context.h"
-#include "../scheduler/po2_scheduler.h"
-#include "../scheduler/malcolm_scheduler.h"
-#include "../scheduler/malcolm_strict_scheduler.h"
 #include <chrono>
 #include <iostream>
 
 namespace malcolm {
 
-// eRPC 请求上下文，存储在 heap 上直到响应返回
-struct LBRequestContext {
-    erpc::ReqHandle* client_handle;
-    erpc::MsgBuffer req_buf;
-    erpc::MsgBuffer resp_buf;
-};
-
-// 全局 LB 上下文指针
-static LBContext* g_lb_ctx = nullptr;
-
 LBContext::LBContext(const LBConfig& config)
     : config_(config) {
     
-    // 创建调度器
-    switch (config_.algorithm) {
-        case SchedulerType::kPowerOf2:
-            scheduler_ = std::make_unique<Po2Scheduler>();
-            break;
-        case SchedulerType::kMalcolm:
-            scheduler_ = std::make_unique<MalcolmScheduler>(config_.model_path);
-            break;
-        case SchedulerType::kMalcolmStrict:
-            scheduler_ = std::make_unique<MalcolmStrictScheduler>(config_.model_path);
-            break;
+    if (config_.num_rpc_threads == 0) {
+        config_.num_rpc_threads = 1;
     }
     
-    printf("[LB] Using scheduler: %s\n", scheduler_->name().c_str());
-    
     // 初始化 Worker 状态
-    worker_states_.resize(config_.worker_addresses.size());
-    for (size_t i = 0; i < worker_states_.size(); ++i) {
-        auto& ws = worker_states_[i];
+    std::vector<WorkerState> worker_states(config_.worker_addresses.size(), WorkerState{});
+    for (size_t i = 0; i < worker_states.size(); ++i) {
+        auto& ws = worker_states[i];
         ws.worker_id = static_cast<uint8_t>(i);
         ws.address = config_.worker_addresses[i];
         ws.is_healthy = true;
@@ -51,10 +27,40 @@ LBContext::LBContext(const LBConfig& config)
         ws.queue_length = 0;
         memset(ws.slack_histogram, 0, sizeof(ws.slack_histogram));
     }
+    worker_table_ = std::make_unique<WorkerStateTable>(worker_states);
+    
+    // 每个派发线程独立的调度器、状态视图、在途请求表和指标
+    for (size_t i = 0; i < config_.num_rpc_threads; ++i) {
+        auto d = std::make_unique<LBDispatcher>(this, i, config_.max_inflight_requests);
+        d->scheduler = SchedulerFactory::create(config_.algorithm, config_.model_path,
+                                                config_.po2_choices, config_.po2_metric);
+        d->worker_sessions.resize(config_.worker_addresses.size(), -1);
+        worker_table_->init_view(d->state_view, d->state_versions);
+        d->batch.reserve(config_.sched_batch_size);
+        d->batch_requests.reserve(config_.sched_batch_size);
+        d->batch_decisions.reserve(config_.sched_batch_size);
+        dispatchers_.push_back(std::move(d));
+    }
     
-    worker_sessions_.resize(config_.worker_addresses.size(), -1);
+    if (!config_.metrics_output_dir.empty() && config_.metrics_interval_ms > 0) {
+        interval_log_ = std::make_unique<IntervalMetricsLog>(
+            config_.metrics_output_dir, config_.metrics_interval_ms);
+        interval_series_.e2e_latency = &interval_log_->add_series("e2e_latency");
+        interval_series_.lb_overhead = &interval_log_->add_series("lb_overhead");
+        for (size_t i = 0; i < config_.worker_addresses.size(); ++i) {
+            interval_series_.worker_latency.push_back(
+                &interval_log_->add_series("worker_" + std::to_string(i) + "_latency"));
+        }
+        interval_scheduling_ = &interval_log_->add_series("scheduling_latency");
+    }
     
-    printf("[LB] Initialized with %zu workers\n", worker_states_.size());
+    printf("[LB] Using scheduler: %s (%zu dispatcher threads)\n",
+           dispatchers_[0]->scheduler->name().c_str(), dispatchers_.size());
+    printf("[LB] Initialized with %zu workers\n", worker_table_->size());
+    if (config_.sched_batch_size > 1) {
+        printf("[LB] Batched scheduling: up to %zu requests, budget %lu ns\n",
+               config_.sched_batch_size, config_.sched_batch_budget_ns);
+    }
 }
 
 LBContext::~LBContext() {
@@ -66,81 +72,121 @@ void LBContext::start() {
         return;
     }
     
-    g_lb_ctx = this;
+    printf("[LB] Starting %s transport on %s...\n",
+           transport_type_name(config_.transport), config_.listen_uri.c_str());
     
-    printf("[LB] Starting eRPC on %s...\n", config_.listen_uri.c_str());
-    
-    // 初始化 eRPC Nexus
-    nexus_ = new erpc::Nexus(config_.listen_uri, 0, 0);
+    // 初始化传输上下文 (所有派发线程共享)
+    nexus_ = create_transport_nexus(config_.transport, config_.listen_uri);
+    if (!nexus_) {
+        running_.store(false);
+        return;
+    }
     
-    // 注册客户端请求处理函数
+    // 注册客户端请求和 Worker 状态推送处理函数
     nexus_->register_req_func(kReqClientToLB, client_request_handler);
+    nexus_->register_req_func(kReqStateUpdate, state_update_handler);
+    start_time_ = now_ns();
     
-    // Session management handler
-    auto sm_handler = [](int session_num, erpc::SmEventType sm_event_type,
-                         erpc::SmErrType sm_err_type, void *context) {
-        LBContext* lb = static_cast<LBContext*>(context);
-        printf("[LB] Session %d event: %s, error: %s\n",
-               session_num,
-               erpc::sm_event_type_str(sm_event_type).c_str(),
-               erpc::sm_err_type_str(sm_err_type).c_str());
-    };
-    
-    // 创建 RPC 端点
-    rpc_ = new erpc::Rpc<erpc::CTransport>(
-        nexus_, 
-        this,                           // context
-        0,                              // rpc_id
-        sm_handler,                     // sm_handler (必须提供)
-        1                               // phy_port (10.10.1.x network)
+    if (interval_log_ && !interval_log_->start()) {
+        fprintf(stderr, "[LB] Interval metrics log incomplete under %s\n",
+                config_.metrics_output_dir.c_str());
+    }
+    
+    // 启动后台派发线程 (线程 0 运行在当前线程)
+    for (size_t i = 1; i < dispatchers_.size(); ++i) {
+        threads_.emplace_back([this, i]() {
+            dispatcher_thread_main(i);
+        });
+    }
+    
+    // 启动状态更新线程
+    state_thread_ = std::thread([this]() {
+        state_update_thread_main();
+    });
+    
+    printf("[LB] Running, press Ctrl+C to stop...\n");
+    
+    // 传输端点要求在创建它的同一线程中运行事件循环
+    dispatcher_thread_main(0);
+    
+    shutdown();
+}
+
+void LBContext::dispatcher_thread_main(size_t thread_id) {
+    LBDispatcher* d = dispatchers_[thread_id].get();
+    
+    // 创建本线程的传输端点
+    d->rpc = nexus_->create_rpc(
+        d,                                      // context
+        static_cast<uint8_t>(thread_id),        // rpc_id
+        1,                                      // phy_port (10.10.1.x network)
+        "LB T" + std::to_string(thread_id)
     );
     
+    // 预分配转发上下文池 (与 pending table 同容量)
+    d->request_pool = std::make_unique<LBRequestPool>(d->rpc.get(), config_.max_inflight_requests);
+    
     // 连接到所有 Workers
-    printf("[LB] Connecting to %zu workers...\n", config_.worker_addresses.size());
     for (size_t i = 0; i < config_.worker_addresses.size(); ++i) {
-        std::string worker_uri = config_.worker_addresses[i];
-        int session = rpc_->create_session(worker_uri, 0);
+        const std::string& worker_uri = config_.worker_addresses[i];
+        int session = d->rpc->create_session(worker_uri, 0);
         if (session < 0) {
-            fprintf(stderr, "[LB] Failed to connect to worker %zu at %s\n",
-                    i, worker_uri.c_str());
+            fprintf(stderr, "[LB][T%zu] Failed to connect to worker %zu at %s\n",
+                    thread_id, i, worker_uri.c_str());
         } else {
-            worker_sessions_[i] = session;
-            printf("[LB] Connected to worker %zu at %s (session=%d)\n",
-                   i, worker_uri.c_str(), session);
+            d->worker_sessions[i] = session;
         }
     }
     
     // 等待所有会话建立
-    while (true) {
+    while (running_.load()) {
         bool all_connected = true;
-        for (size_t i = 0; i < worker_sessions_.size(); ++i) {
-            if (worker_sessions_[i] >= 0 && 
-                !rpc_->is_connected(worker_sessions_[i])) {
+        for (int session : d->worker_sessions) {
+            if (session >= 0 && !d->rpc->is_connected(session)) {
                 all_connected = false;
                 break;
             }
         }
         if (all_connected) break;
-        rpc_->run_event_loop_once();
+        d->rpc->run_event_loop_once();
     }
-    printf("[LB] All workers connected\n");
+    printf("[LB][T%zu] rpc_id=%zu connected to %zu workers, event loop started\n",
+           thread_id, thread_id, d->worker_sessions.size());
     
-    // 启动状态更新线程
-    state_thread_ = std::thread([this]() {
-        state_update_thread_main();
-    });
+    while (running_.load(std::memory_order_relaxed)) {
+        d->rpc->run_event_loop_once();
+        
+        // 本轮事件循环收到的请求在预算内统一调度
+        if (!d->batch.empty() &&
+            now_ns() - d->batch.front().recv_time >= config_.sched_batch_budget_ns) {
+            flush_batch(d);
+        }
+        if (thread_id == 0) {
+            tsc_clock::maybe_reanchor();
+        }
+    }
     
-    // eRPC 要求在创建 Rpc 的同一线程中调用 run_event_loop
-    // 因此在主线程中运行事件循环
-    printf("[LB] Running\n");
-    printf("[LB] Running, press Ctrl+C to stop...\n");
-    printf("[LB] RPC event loop started in main thread\n");
+    // 攒批中还未派发的请求: Worker 的响应已等不到，直接拒绝，并跑一轮事件循环把拒绝响应发出
+    if (!d->batch.empty()) {
+        printf("[LB][T%zu] Rejecting %zu batched requests on shutdown\n",
+               thread_id, d->batch.size());
+        for (const auto& entry : d->batch) {
+            reject_client_request(d, entry.req_handle, &entry.request);
+        }
+        d->batch.clear();
+        d->rpc->run_event_loop_once();
+    }
     
-    while (running_.load()) {
-        rpc_->run_event_loop_once();
+    // 清理本线程的传输资源 (上下文池持有的 MsgBuffer 需在端点销毁前释放)
+    if (d->request_pool->exhausted_count() > 0) {
+        printf("[LB][T%zu] Request pool exhausted %lu times (capacity=%zu)\n",
+               thread_id, d->request_pool->exhausted_count(),
+               d->request_pool->capacity());
     }
+    d->request_pool.reset();
+    d->rpc.reset();
     
-    printf("[LB] RPC event loop stopped\n");
+    printf("[LB][T%zu] RPC event loop stopped\n", thread_id);
 }
 
 void LBContext::stop() {
@@ -148,33 +194,32 @@ void LBContext::stop() {
         return;
     }
     
+    // 只翻转标志位: 各派发线程退出事件循环后自行销毁传输端点，
+    // 由 start() 中的 shutdown() 完成回收和指标导出
     printf("[LB] Stopping...\n");
-    
-    if (state_thread_.joinable()) {
-        state_thread_.join();
-    }
-    
+}
+
+void LBContext::shutdown() {
     for (auto& t : threads_) {
         if (t.joinable()) {
             t.join();
         }
     }
+    threads_.clear();
     
-    // 清理 eRPC
-    if (rpc_) {
-        delete rpc_;
-        rpc_ = nullptr;
+    if (state_thread_.joinable()) {
+        state_thread_.join();
     }
-    if (nexus_) {
-        delete nexus_;
-        nexus_ = nullptr;
+    
+    nexus_.reset();
+    
+    if (interval_log_) {
+        interval_log_->stop();
     }
     
     if (!config_.metrics_output_dir.empty()) {
         export_metrics();
     }
-    
-    g_lb_ctx = nullptr;
 }
 
 void LBContext::wait() {
@@ -188,21 +233,32 @@ void LBContext::wait() {
     }
 }
 
-// 静态客户端请求处理回调
-void LBContext::client_request_handler(erpc::ReqHandle* req_handle, void* context) {
-    auto* lb = static_cast<LBContext*>(context);
-    if (!lb) lb = g_lb_ctx;
-    if (!lb) return;
+// 静态客户端请求处理回调 (在接收该请求的派发线程中执行)
+void LBContext::client_request_handler(ReqHandle* req_handle, void* context) {
+    auto* d = static_cast<LBDispatcher*>(context);
+    if (!d) return;
+    LBContext* lb = d->lb;
     
     Timestamp recv_time = now_ns();
     
     // 获取请求数据
-    const erpc::MsgBuffer* req_msgbuf = req_handle->get_req_msgbuf();
+    const MsgBuffer* req_msgbuf = req_handle->get_req_msgbuf();
     auto* request = reinterpret_cast<const RpcClientRequest*>(req_msgbuf->buf_);
     
     // [DEBUG LOG] 只印前5个避免刷屏
     if (request->request_id < 5) {
-        printf("[LB] Received Req %lu from Client, dispatching...\n", request->request_id);
+        printf("[LB][T%zu] Received Req %lu from Client, dispatching...\n",
+               d->thread_id, request->request_id);
+    }
+    
+    // 批量模式: 先攒批，满批立即调度，否则留到本轮事件循环结束
+    // (停止后最后一轮事件循环收到的请求不再攒批，否则没有下一轮来调度它们)
+    if (lb->config_.sched_batch_size > 1 && lb->running_.load(std::memory_order_relaxed)) {
+        d->batch.push_back({req_handle, *request, recv_time});
+        if (d->batch.size() >= lb->config_.sched_batch_size) {
+            lb->flush_batch(d);
+        }
+        return;
     }
     
     // 构造内部请求格式
@@ -212,49 +268,134 @@ void LBContext::client_request_handler(erpc::ReqHandle* req_handle, void* contex
     creq.deadline = request->deadline;
     creq.type = static_cast<RequestType>(request->request_type);
     creq.payload_size = request->payload_size;
+    creq.expected_service_us = request->service_time_hint;
     
-    // 调度决策
-    ScheduleDecision decision;
-    {
-        std::lock_guard<std::mutex> lock(lb->state_mutex_);
-        decision = lb->scheduler_->schedule(creq, lb->worker_states_);
-    }
+    // 调度决策 (先无锁同步发生变化的 Worker 状态)
+    lb->sync_state_view(d);
+    ScheduleDecision decision = d->scheduler->schedule(creq, d->state_view);
     
     // 记录调度延迟
-    lb->scheduling_latency_.record(decision.decision_time);
-    
-    // 记录待处理请求
-    {
-        std::lock_guard<std::mutex> lock(lb->pending_mutex_);
-        PendingRequest pending;
-        pending.request_id = request->request_id;
-        pending.send_time = request->client_send_time;
-        pending.deadline = request->deadline;
-        pending.client_handle = req_handle;
-        pending.target_worker = decision.target_worker_id;
-        lb->pending_requests_[request->request_id] = pending;
-    }
-    
-    // 更新目标 Worker 的负载估计
-    {
-        std::lock_guard<std::mutex> lock(lb->state_mutex_);
-        auto& ws = lb->worker_states_[decision.target_worker_id];
-        ws.queue_length++;
-        ws.update_load_ema(ws.queue_length);
+    d->scheduling_latency.record(decision.decision_time);
+    if (lb->interval_scheduling_) {
+        lb->interval_scheduling_->record(decision.decision_time);
     }
     
-    // 构造发往 Worker 的请求
-    int session = lb->worker_sessions_[decision.target_worker_id];
+    dispatch_request(d, req_handle, request, decision, recv_time);
+}
+
+// 静态 Worker 状态推送处理回调 (在接收该推送的派发线程中执行)
+void LBContext::state_update_handler(ReqHandle* req_handle, void* context) {
+    auto* d = static_cast<LBDispatcher*>(context);
+    if (!d) return;
+    LBContext* lb = d->lb;
+    
+    const MsgBuffer* req_msgbuf = req_handle->get_req_msgbuf();
+    auto* update = reinterpret_cast<const RpcStateUpdate*>(req_msgbuf->buf_);
+    
+    bool accepted = update->worker_id < lb->worker_table_->size();
+    if (accepted) {
+        // Worker 上报的是权威值，覆盖 LB 按派发/响应计数推断的队列长度
+        Timestamp now = now_ns();
+        lb->worker_table_->update(update->worker_id, [update, now](WorkerStateSnapshot& ws) {
+            ws.queue_length = update->queue_length;
+            ws.active_requests = update->active_requests;
+            ws.load_ema = update->load_ema;
+            std::memcpy(ws.slack_histogram, update->slack_histogram, sizeof(ws.slack_histogram));
+            ws.is_healthy = update->is_healthy != 0;
+            ws.last_heartbeat = now;
+        });
+    }
+    d->state_updates++;
+    d->state_update_bytes += sizeof(RpcStateUpdate) + sizeof(RpcStateUpdateAck);
+    
+    MsgBuffer& resp_msgbuf = req_handle->pre_resp_msgbuf_;
+    d->rpc->resize_msg_buffer(&resp_msgbuf, sizeof(RpcStateUpdateAck));
+    auto* ack = reinterpret_cast<RpcStateUpdateAck*>(resp_msgbuf.buf_);
+    ack->accepted = accepted ? 1 : 0;
+    d->rpc->enqueue_response(req_handle, &resp_msgbuf);
+}
+
+void LBContext::sync_state_view(LBDispatcher* d) {
+    Scheduler* scheduler = d->scheduler.get();
+    worker_table_->refresh(d->state_view, d->state_versions,
+                           [scheduler](size_t worker_id, const WorkerState& ws) {
+        scheduler->update_worker_state(static_cast<uint8_t>(worker_id), ws);
+    });
+}
+
+void LBContext::flush_batch(LBDispatcher* d) {
+    d->batch_requests.clear();
+    for (const auto& entry : d->batch) {
+        const RpcClientRequest& request = entry.request;
+        ClientRequest creq;
+        creq.request_id = request.request_id;
+        creq.client_send_time = request.client_send_time;
+        creq.deadline = request.deadline;
+        creq.type = static_cast<RequestType>(request.request_type);
+        creq.payload_size = request.payload_size;
+        creq.expected_service_us = request.service_time_hint;
+        d->batch_requests.push_back(creq);
+    }
+    
+    // 整批共用一次状态同步和一次调度 (学习型调度器只做一次批量推理)
+    sync_state_view(d);
+    d->scheduler->schedule_batch(d->batch_requests, d->state_view, d->batch_decisions);
+    
+    for (size_t i = 0; i < d->batch.size(); ++i) {
+        const ScheduleDecision& decision = d->batch_decisions[i];
+        d->scheduling_latency.record(decision.decision_time);
+        if (interval_scheduling_) {
+            interval_scheduling_->record(decision.decision_time);
+        }
+        dispatch_request(d, d->batch[i].req_handle, &d->batch[i].request,
+                         decision, d->batch[i].recv_time);
+    }
+    d->batch.clear();
+}
+
+void LBContext::dispatch_request(LBDispatcher* d,
+                                 ReqHandle* req_handle,
+                                 const RpcClientRequest* request,
+                                 const ScheduleDecision& decision,
+                                 Timestamp recv_time) {
+    LBContext* lb = d->lb;
+    
+    int session = d->worker_sessions[decision.target_worker_id];
     if (session < 0) {
         fprintf(stderr, "[LB] Worker %u not connected\n", decision.target_worker_id);
+        reject_client_request(d, req_handle, request);
+        return;
+    }
+    
+    // 记录待处理请求 (槽位句柄随请求 tag 返回)
+    PendingTable<PendingRequest>::Handle handle;
+    PendingRequest* pending = d->pending_requests.acquire(handle);
+    if (!pending) {
+        if (d->pending_table_full++ == 0) {
+            fprintf(stderr, "[LB][T%zu] Pending table full (%zu in-flight), rejecting requests\n",
+                    d->thread_id, d->pending_requests.capacity());
+        }
+        reject_client_request(d, req_handle, request);
         return;
     }
+    pending->request_id = request->request_id;
+    pending->send_time = request->client_send_time;
+    pending->deadline = request->deadline;
+    pending->lb_recv_time = recv_time;
+    pending->dispatch_time = now_ns();
+    pending->client_handle = req_handle;
+    pending->target_worker = decision.target_worker_id;
+    
+    // 更新目标 Worker 的负载估计 (下一次上报前按派发累加)
+    lb->worker_table_->update(decision.target_worker_id, [](WorkerStateSnapshot& ws) {
+        ws.queue_length++;
+        ws.active_requests++;
+        ws.update_load_ema(ws.queue_length);
+    });
     
-    // 分配请求和响应缓冲区 (存储在 heap 上以保持有效)
-    auto* ctx = new LBRequestContext();
-    ctx->client_handle = req_handle;
-    ctx->req_buf = lb->rpc_->alloc_msg_buffer_or_die(sizeof(RpcWorkerRequest));
-    ctx->resp_buf = lb->rpc_->alloc_msg_buffer_or_die(sizeof(RpcWorkerResponse));
+    // 从池中取预分配的请求/响应缓冲区
+    LBRequestContext* ctx = d->request_pool->acquire();
+    pending->ctx = ctx;
     
     auto* wreq = reinterpret_cast<RpcWorkerRequest*>(ctx->req_buf.buf_);
     wreq->request_id = request->request_id;
@@ -267,25 +408,53 @@ void LBContext::client_request_handler(erpc::ReqHandle* req_handle, void* contex
     wreq->payload_size = request->payload_size;
 
     // 发送请求到 Worker
-    lb->rpc_->enqueue_request(
+    d->rpc->enqueue_request(
         session, 
         kReqLBToWorker, 
         &ctx->req_buf, 
         &ctx->resp_buf,
         worker_response_callback, 
-        ctx
+        PendingTable<PendingRequest>::to_tag(handle)
     );
 }
 
-// 静态 Worker 响应回调
+void LBContext::reject_client_request(LBDispatcher* d,
+                                      ReqHandle* req_handle,
+                                      const RpcClientRequest* request) {
+    MsgBuffer& client_resp_buf = req_handle->pre_resp_msgbuf_;
+    d->rpc->resize_msg_buffer(&client_resp_buf, sizeof(RpcClientResponse));
+    
+    auto* cresp = reinterpret_cast<RpcClientResponse*>(client_resp_buf.buf_);
+    cresp->request_id = request->request_id;
+    cresp->client_send_time = request->client_send_time;
+    cresp->e2e_latency_ns = now_ns() - request->client_send_time;
+    cresp->service_time_us = 0;
+    cresp->worker_id = 0;
+    cresp->deadline_met = 0;
+    cresp->success = 0;
+    
+    d->rpc->enqueue_response(req_handle, &client_resp_buf);
+}
+
+// 静态 Worker 响应回调 (在发出该请求的派发线程中执行)
 void LBContext::worker_response_callback(void* context, void* tag) {
-    auto* lb = static_cast<LBContext*>(context);
-    if (!lb) lb = g_lb_ctx;
-    if (!lb) return;
+    auto* d = static_cast<LBDispatcher*>(context);
+    if (!d) return;
+    LBContext* lb = d->lb;
+    
+    // 根据 tag 中的句柄取回待处理请求
+    auto handle = PendingTable<PendingRequest>::from_tag(tag);
+    PendingRequest* slot = d->pending_requests.lookup(handle);
+    if (!slot) {
+        fprintf(stderr, "[LB][T%zu] Unknown response handle %#lx\n", d->thread_id, handle);
+        return;
+    }
+    PendingRequest pending = *slot;
+    d->pending_requests.release(handle);
     
-    auto* ctx = static_cast<LBRequestContext*>(tag);
-    erpc::ReqHandle* client_handle = ctx->client_handle;
-    erpc::MsgBuffer& worker_resp_buf = ctx->resp_buf;
+    LBRequestContext* ctx = pending.ctx;
+    ReqHandle* client_handle = pending.client_handle;
+    MsgBuffer& worker_resp_buf = ctx->resp_buf;
     
     Timestamp complete_time = now_ns();
     
@@ -294,61 +463,50 @@ void LBContext::worker_response_callback(void* context, void* tag) {
     
     // [DEBUG LOG] 只印前5个避免刷屏
     if (wresp->request_id < 5) {
-        printf("[LB] Received Resp %lu from Worker %u\n", wresp->request_id, wresp->worker_id);
-    }
-    
-    // 获取待处理请求信息
-    PendingRequest pending;
-    {
-        std::lock_guard<std::mutex> lock(lb->pending_mutex_);
-        auto it = lb->pending_requests_.find(wresp->request_id);
-        if (it == lb->pending_requests_.end()) {
-            fprintf(stderr, "[LB] Unknown response for request %lu\n", 
-                    wresp->request_id);
-            lb->rpc_->free_msg_buffer(ctx->req_buf);
-            lb->rpc_->free_msg_buffer(ctx->resp_buf);
-            delete ctx;
-            return;
-        }
-        pending = it->second;
-        lb->pending_requests_.erase(it);
+        printf("[LB][T%zu] Received Resp %lu from Worker %u\n",
+               d->thread_id, wresp->request_id, wresp->worker_id);
     }
     
-    // 更新 Worker 状态
-    {
-        std::lock_guard<std::mutex> lock(lb->state_mutex_);
-        auto& ws = lb->worker_states_[wresp->worker_id];
-        if (ws.queue_length > 0) {
-            ws.queue_length--;
+    // 更新 Worker 状态: 合并响应捎带的状态摘要 (Worker 的权威值，取代按派发/响应计数的推断)
+    Timestamp service_time = us_to_ns(wresp->service_time_us);
+    lb->worker_table_->update(wresp->worker_id,
+                              [wresp, service_time, complete_time](WorkerStateSnapshot& ws) {
+        ws.queue_length = wresp->queue_length;
+        ws.active_requests = wresp->active_requests;
+        for (size_t b = 0; b < constants::kSlackHistogramBins; ++b) {
+            ws.slack_histogram[b] = decode_slack_count(wresp->slack_digest[b]);
         }
+        ws.last_heartbeat = complete_time;
         ws.update_load_ema(ws.queue_length);
         
         // 更新服务时间统计
-        Timestamp service_time = us_to_ns(wresp->service_time_us);
         ws.avg_service_time = static_cast<Timestamp>(
             0.9 * ws.avg_service_time + 0.1 * service_time
         );
-    }
+    });
     
-    // 构造请求追踪
-    RequestTrace trace;
+    // 构造请求追踪 (LB 侧: t7 未知，按 t6 记录)
+    RequestTrace trace{};
     trace.request_id = wresp->request_id;
     trace.deadline = pending.deadline;
     trace.t1_client_send = pending.send_time;
+    trace.t2_lb_receive = pending.lb_recv_time;
+    trace.t3_lb_dispatch = pending.dispatch_time;
     trace.t4_worker_recv = wresp->worker_recv_time;
     trace.t5_worker_done = wresp->worker_done_time;
     trace.t6_lb_response = complete_time;
     trace.target_worker_id = wresp->worker_id;
     
     // 记录指标
-    lb->metrics_.record_request(trace);
+    d->metrics.record_lb_request(trace);
+    lb->interval_series_.record_lb_request(trace);
     
     // 反馈给调度器 (用于学习)
-    lb->scheduler_->on_request_complete(trace);
+    d->scheduler->on_request_complete(trace);
     
     // 构造客户端响应
-    erpc::MsgBuffer& client_resp_buf = client_handle->pre_resp_msgbuf_;
-    lb->rpc_->resize_msg_buffer(&client_resp_buf, sizeof(RpcClientResponse));
+    MsgBuffer& client_resp_buf = client_handle->pre_resp_msgbuf_;
+    d->rpc->resize_msg_buffer(&client_resp_buf, sizeof(RpcClientResponse));
     
     auto* cresp = reinterpret_cast<RpcClientResponse*>(client_resp_buf.buf_);
     cresp->request_id = wresp->request_id;
@@ -360,20 +518,44 @@ void LBContext::worker_response_callback(void* context, void* tag) {
     cresp->success = wresp->success;
     
     // 发送响应给客户端
-    lb->rpc_->enqueue_response(client_handle, &client_resp_buf);
+    d->rpc->enqueue_response(client_handle, &client_resp_buf);
     
-    // 清理请求上下文
-    lb->rpc_->free_msg_buffer(ctx->req_buf);
-    lb->rpc_->free_msg_buffer(ctx->resp_buf);
-    delete ctx;
+    // 归还请求上下文
+    d->request_pool->release(ctx);
 }
 
 void LBContext::export_metrics() {
     if (config_.metrics_output_dir.empty()) return;
     
-    metrics_.export_all(config_.metrics_output_dir);
-    scheduling_latency_.export_hdr(config_.metrics_output_dir + "/scheduling_latency.hdr");
+    // 合并各派发线程的指标
+    MetricsCollector metrics;
+    LatencyHistogram scheduling_latency;
+    uint64_t state_updates = 0;
+    uint64_t state_update_bytes = 0;
+    for (const auto& d : dispatchers_) {
+        metrics.merge_from(d->metrics);
+        scheduling_latency.merge_from(d->scheduling_latency);
+        state_updates += d->state_updates;
+        state_update_bytes += d->state_update_bytes;
+        if (d->pending_table_full > 0) {
+            printf("[LB][T%zu] Rejected %lu requests (pending table full, capacity=%zu)\n",
+                   d->thread_id, d->pending_table_full, d->pending_requests.capacity());
+        }
+    }
+    
+    bool success = metrics.export_all(config_.metrics_output_dir);
+    success &= scheduling_latency.export_hdr(config_.metrics_output_dir + "/scheduling_latency.hdr");
+    
+    if (state_updates > 0) {
+        double secs = static_cast<double>(now_ns() - start_time_) / 1e9;
+        printf("[LB] Worker state updates: %lu (%lu bytes, %.1f B/s)\n",
+               state_updates, state_update_bytes, secs > 0 ? state_update_bytes / secs : 0.0);
+    }
     
+    if (!success) {
+        fprintf(stderr, "[LB] Failed to export metrics to %s\n", config_.metrics_output_dir.c_str());
+        return;
+    }
     printf("[LB] Metrics exported to %s\n", config_.metrics_output_dir.c_str());
 }
 
@@ -410,17 +592,17 @@ void LBContext::state_update_thread_main() {
 }
 
 void LBContext::update_worker_states() {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    
     Timestamp now = now_ns();
-    for (auto& ws : worker_states_) {
-        // 检查心跳超时
-        if (now - ws.last_heartbeat > ms_to_ns(1000)) {
-            // ws.is_healthy = false;
-        }
-        
-        // 负载衰减 (如果没有收到请求，负载应该下降)
-        ws.load_ema *= 0.99;
+    for (size_t i = 0; i < worker_table_->size(); ++i) {
+        worker_table_->update(i, [now](WorkerStateSnapshot& ws) {
+            // 检查心跳超时
+            if (now - ws.last_heartbeat > ms_to_ns(1000)) {
+                // ws.is_healthy = false;
+            }
+            
+            // 负载衰减 (如果没有收到请求，负载应该下降)
+            ws.load_ema *= 0.99;
+        });
     }
 }
 
@@ -7,6 +7,7 @@
  *                   --model=models/iqn.pt
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <csignal>
@@ -60,8 +61,17 @@ void print_usage(const char* prog) {
     printf("  --workers=LIST    Comma-separated worker addresses (ip:port)\n");
     printf("  --algorithm=ALG   Scheduling algorithm: po2, malcolm, malcolm_strict\n");
     printf("  --model=PATH      Path to DRL model (for malcolm/malcolm_strict)\n");
-    printf("  --threads=N       Number of RPC threads (default: 8)\n");
+    printf("  --po2_d=N         Candidates per decision for po2, 1-8 (default: 2)\n");
+    printf("  --po2_metric=M    Load metric for po2: load_ema, queue_length, outstanding_work\n");
+    printf("  --transport=T     Transport backend: erpc, shm, udp (default: %s)\n",
+           transport_type_name(kDefaultTransport));
+    printf("  --threads=N       Number of RPC threads, must match client --lb_threads (default: %zu)\n",
+           constants::kDefaultLBThreads);
+    printf("  --max_inflight=N  Max in-flight requests per RPC endpoint (default: 16384)\n");
+    printf("  --batch=N         Schedule up to N queued requests at once (default: 1, no batching)\n");
+    printf("  --batch_budget_us=N  Max wait of the oldest batched request (default: 0)\n");
     printf("  --output=DIR      Metrics output directory\n");
+    printf("  --interval_ms=N   Interval histogram log period, 0 = off (default: 1000)\n");
     printf("  --help            Show this help\n");
 }
 
@@ -84,21 +94,28 @@ int main(int argc, char* argv[]) {
     LBConfig config;
     config.port = constants::kDefaultPort;
     config.algorithm = SchedulerType::kPowerOf2;
-    config.num_rpc_threads = 8;
+    config.num_rpc_threads = constants::kDefaultLBThreads;
     
     static struct option long_options[] = {
         {"port",      required_argument, 0, 'p'},
         {"workers",   required_argument, 0, 'w'},
         {"algorithm", required_argument, 0, 'a'},
         {"model",     required_argument, 0, 'm'},
+        {"po2_d",     required_argument, 0, 'd'},
+        {"po2_metric", required_argument, 0, 'L'},
         {"threads",   required_argument, 0, 't'},
+        {"max_inflight", required_argument, 0, 'I'},
+        {"batch",     required_argument, 0, 'b'},
+        {"batch_budget_us", required_argument, 0, 'B'},
         {"output",    required_argument, 0, 'o'},
+        {"interval_ms", required_argument, 0, 'M'},
+        {"transport", required_argument, 0, 'X'},
         {"help",      no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "p:w:a:m:t:o:h", 
+    while ((opt = getopt_long(argc, argv, "p:w:a:m:d:L:X:t:I:b:B:o:M:h", 
                               long_options, nullptr)) != -1) {
         switch (opt) {
             case 'p':
@@ -122,12 +139,39 @@ int main(int argc, char* argv[]) {
             case 'm':
                 config.model_path = optarg;
                 break;
+            case 'd':
+                config.po2_choices = std::stoul(optarg);
+                break;
+            case 'L':
+                if (!parse_load_metric(optarg, &config.po2_metric)) {
+                    fprintf(stderr, "Unknown load metric: %s\n", optarg);
+                    return 1;
+                }
+                break;
             case 't':
                 config.num_rpc_threads = std::stoul(optarg);
                 break;
+            case 'I':
+                config.max_inflight_requests = std::stoul(optarg);
+                break;
+            case 'b':
+                config.sched_batch_size = std::max<size_t>(1, std::stoul(optarg));
+                break;
+            case 'B':
+                config.sched_batch_budget_ns = us_to_ns(std::stoul(optarg));
+                break;
             case 'o':
                 config.metrics_output_dir = optarg;
                 break;
+            case 'M':
+                config.metrics_interval_ms = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'X':
+                if (!parse_transport_type(optarg, &config.transport)) {
+                    fprintf(stderr, "Unknown transport: %s\n", optarg);
+                    return 1;
+                }
+                break;
             case 'h':
             default:
                 print_usage(argv[0]);
@@ -148,9 +192,13 @@ int main(int argc, char* argv[]) {
     printf("Malcolm-Strict Load Balancer\n");
     printf("========================================\n");
     printf("Listen:     %s\n", config.listen_uri.c_str());
+    printf("Transport:  %s\n", transport_type_name(config.transport));
+    printf("Clock:      %s\n", tsc_clock::calibration().enabled ? "TSC" : "steady_clock");
     printf("Algorithm:  %s\n", scheduler_type_name(config.algorithm));
     printf("Model:      %s\n", config.model_path.empty() ? "(none)" : config.model_path.c_str());
     printf("Threads:    %zu\n", config.num_rpc_threads);
+    printf("Batch:      %zu (budget %lu us)\n",
+           config.sched_batch_size, config.sched_batch_budget_ns / 1000);
     printf("Workers:    %zu\n", config.worker_addresses.size());
     for (size_t i = 0; i < config.worker_addresses.size(); ++i) {
         printf("  [%zu] %s\n", i, config.worker_addresses[i].c_str());
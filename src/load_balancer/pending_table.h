@@ -0,0 +1,140 @@
+#pragma once
+
+/**
+ * 在途请求表 (Pending Request Table)
+ *
+ * 替代 std::unordered_map<uint64_t, PendingRequest> + mutex:
+ * - 预分配固定数量的槽位，运行期间零分配
+ * - 槽位下标 + 代数 (generation) 编码为 64 位句柄，随 eRPC tag 传递
+ * - 派发 (acquire) 和完成 (lookup/release) 均为 O(1)，无哈希
+ *
+ * 线程模型:
+ * 表由创建它的 eRPC 事件循环线程独占 (请求回调与响应回调都在该线程执行)，
+ * 因此无需任何锁或原子操作。每个 Rpc 端点持有自己的表。
+ *
+ * 代数标签用于识别过期句柄: 槽位释放后代数加 1，
+ * 迟到/重复的响应携带的旧句柄会查找失败而不是命中被复用的槽位。
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace malcolm {
+
+template<typename T>
+class PendingTable {
+public:
+    using Handle = uint64_t;
+    static constexpr Handle kInvalidHandle = ~0ULL;
+
+    /**
+     * @param capacity 最大在途请求数 (槽位数)
+     */
+    explicit PendingTable(size_t capacity)
+        : slots_(capacity) {
+        // 构建空闲链表: 0 -> 1 -> ... -> capacity-1 -> kNil
+        for (size_t i = 0; i < capacity; ++i) {
+            slots_[i].next_free = (i + 1 < capacity)
+                                  ? static_cast<uint32_t>(i + 1) : kNil;
+        }
+        free_head_ = capacity > 0 ? 0 : kNil;
+    }
+
+    // 禁用拷贝
+    PendingTable(const PendingTable&) = delete;
+    PendingTable& operator=(const PendingTable&) = delete;
+
+    /**
+     * 分配一个槽位
+     *
+     * @param handle 输出: 槽位句柄 (用作 eRPC tag)
+     * @return 槽位数据指针，表满时返回 nullptr
+     */
+    T* acquire(Handle& handle) {
+        if (free_head_ == kNil) {
+            handle = kInvalidHandle;
+            return nullptr;
+        }
+
+        uint32_t idx = free_head_;
+        Slot& slot = slots_[idx];
+        free_head_ = slot.next_free;
+        slot.next_free = kInUse;
+        ++size_;
+
+        handle = encode(idx, slot.generation);
+        return &slot.value;
+    }
+
+    /**
+     * 根据句柄查找槽位
+     *
+     * @return 槽位数据指针，句柄无效或已过期时返回 nullptr
+     */
+    T* lookup(Handle handle) {
+        uint32_t idx = static_cast<uint32_t>(handle);
+        if (idx >= slots_.size()) return nullptr;
+
+        Slot& slot = slots_[idx];
+        if (slot.next_free != kInUse ||
+            slot.generation != static_cast<uint32_t>(handle >> 32)) {
+            return nullptr;
+        }
+        return &slot.value;
+    }
+
+    /**
+     * 释放槽位 (代数加 1，使旧句柄失效)
+     *
+     * @return 句柄是否有效
+     */
+    bool release(Handle handle) {
+        if (lookup(handle) == nullptr) return false;
+
+        uint32_t idx = static_cast<uint32_t>(handle);
+        Slot& slot = slots_[idx];
+        ++slot.generation;
+        slot.next_free = free_head_;
+        free_head_ = idx;
+        --size_;
+        return true;
+    }
+
+    /// 当前在途请求数
+    size_t size() const { return size_; }
+
+    /// 槽位总数
+    size_t capacity() const { return slots_.size(); }
+
+    bool full() const { return free_head_ == kNil; }
+
+    /// 句柄 <-> eRPC tag 转换
+    static void* to_tag(Handle handle) {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(handle));
+    }
+
+    static Handle from_tag(void* tag) {
+        return static_cast<Handle>(reinterpret_cast<uintptr_t>(tag));
+    }
+
+private:
+    static constexpr uint32_t kNil = ~0U;         // 空闲链表结尾
+    static constexpr uint32_t kInUse = ~0U - 1;   // 槽位占用标记
+
+    struct Slot {
+        T value{};
+        uint32_t generation = 0;
+        uint32_t next_free = kNil;  // 空闲时指向下一个空闲槽位，占用时为 kInUse
+    };
+
+    static Handle encode(uint32_t idx, uint32_t generation) {
+        return (static_cast<Handle>(generation) << 32) | idx;
+    }
+
+    std::vector<Slot> slots_;
+    uint32_t free_head_ = kNil;
+    size_t size_ = 0;
+};
+
+}  // namespace malcolm
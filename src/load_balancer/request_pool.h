@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ * LB 转发路径的请求上下文池
+ *
+ * 每个转发请求需要一对 MsgBuffer (RpcWorkerRequest / RpcWorkerResponse)。
+ * 原实现每个请求 new 一个上下文并调用两次 alloc_msg_buffer_or_die，
+ * 响应返回后再释放。这里在启动时按在途请求上限一次性预分配，
+ * 通过侵入式空闲链表回收复用，热路径上不再触碰分配器。
+ *
+ * 线程模型: 与所属 Rpc 端点绑定，仅由该端点的事件循环线程访问。
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "../common/rpc_types.h"
+#include "../transport/transport.h"
+
+namespace malcolm {
+
+/**
+ * 转发请求上下文 (池化对象)
+ */
+struct LBRequestContext {
+    MsgBuffer req_buf;
+    MsgBuffer resp_buf;
+    LBRequestContext* next_free = nullptr;
+};
+
+class LBRequestPool {
+public:
+    /**
+     * @param rpc 所属传输端点 (必须在该端点的线程中构造和析构)
+     * @param capacity 预分配上下文数量 (通常等于在途请求上限)
+     */
+    LBRequestPool(Transport* rpc, size_t capacity)
+        : rpc_(rpc), storage_(capacity) {
+        for (auto& ctx : storage_) {
+            init_context(&ctx);
+            ctx.next_free = free_head_;
+            free_head_ = &ctx;
+        }
+    }
+
+    ~LBRequestPool() {
+        for (auto& ctx : storage_) {
+            free_context(&ctx);
+        }
+        for (auto& ctx : overflow_) {
+            free_context(ctx.get());
+        }
+    }
+
+    // 禁用拷贝
+    LBRequestPool(const LBRequestPool&) = delete;
+    LBRequestPool& operator=(const LBRequestPool&) = delete;
+
+    /**
+     * 获取一个上下文
+     *
+     * 池耗尽时额外分配一个并计入 exhausted_count()，
+     * 该对象释放后同样进入空闲链表，池随之增长。
+     */
+    LBRequestContext* acquire() {
+        LBRequestContext* ctx = free_head_;
+        if (ctx) {
+            free_head_ = ctx->next_free;
+        } else {
+            ++exhausted_count_;
+            overflow_.push_back(std::make_unique<LBRequestContext>());
+            ctx = overflow_.back().get();
+            init_context(ctx);
+        }
+        ctx->next_free = nullptr;
+        ++in_use_;
+        return ctx;
+    }
+
+    /**
+     * 归还上下文
+     *
+     * 传输层会把响应缓冲区缩小到实际收到的大小，这里恢复为预设大小
+     */
+    void release(LBRequestContext* ctx) {
+        Transport::resize_msg_buffer(&ctx->req_buf, sizeof(RpcWorkerRequest));
+        Transport::resize_msg_buffer(&ctx->resp_buf, sizeof(RpcWorkerResponse));
+        ctx->next_free = free_head_;
+        free_head_ = ctx;
+        --in_use_;
+    }
+
+    /// 预分配容量
+    size_t capacity() const { return storage_.size(); }
+
+    /// 当前借出数量
+    size_t in_use() const { return in_use_; }
+
+    /// 池耗尽 (需要额外分配) 的次数
+    uint64_t exhausted_count() const { return exhausted_count_; }
+
+private:
+    void init_context(LBRequestContext* ctx) {
+        ctx->req_buf = rpc_->alloc_msg_buffer_or_die(sizeof(RpcWorkerRequest));
+        ctx->resp_buf = rpc_->alloc_msg_buffer_or_die(sizeof(RpcWorkerResponse));
+    }
+
+    void free_context(LBRequestContext* ctx) {
+        rpc_->free_msg_buffer(ctx->req_buf);
+        rpc_->free_msg_buffer(ctx->resp_buf);
+    }
+
+    Transport* rpc_;
+    std::vector<LBRequestContext> storage_;
+    std::vector<std::unique_ptr<LBRequestContext>> overflow_;
+    LBRequestContext* free_head_ = nullptr;
+    size_t in_use_ = 0;
+    uint64_t exhausted_count_ = 0;
+};
+
+}  // namespace malcolm
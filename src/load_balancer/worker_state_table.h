@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * LB 侧 Worker 状态表
+ *
+ * 取代 state_mutex_ + std::vector<WorkerState>:
+ * - 每个 Worker 的数值状态放在独立的 SeqLock 中 (独占 cache line)
+ * - 派发线程在 schedule() 之前把状态同步到自己的私有视图，
+ *   只复制版本号发生变化的 Worker，读取过程无锁、不阻塞写者
+ * - 派发路径 / 响应路径 / 状态更新线程通过 update() 做短小的读-改-写
+ *
+ * 这样调度器看到的每个 Worker 状态都是一致的快照，
+ * 而状态更新线程和响应回调永远不会阻塞调度决策。
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/types.h"
+#include "../common/seqlock.h"
+
+namespace malcolm {
+
+/**
+ * WorkerState 的数值部分 (平凡可拷贝，可在 SeqLock 下复制)
+ *
+ * address 等不变的字段不参与同步，由 WorkerStateTable 单独保存
+ */
+struct WorkerStateSnapshot {
+    uint8_t worker_id;
+    uint32_t queue_length;
+    uint32_t active_requests;
+    double load_ema;
+    uint32_t slack_histogram[constants::kSlackHistogramBins];
+    Timestamp avg_service_time;
+    Timestamp p99_latency;
+    double deadline_miss_rate;
+    double capacity_factor;
+    bool is_healthy;
+    Timestamp last_heartbeat;
+
+    // 与 WorkerState::update_load_ema 相同
+    void update_load_ema(double new_load, double alpha = 0.1) {
+        load_ema = alpha * new_load + (1.0 - alpha) * load_ema;
+    }
+
+    static WorkerStateSnapshot from(const WorkerState& ws) {
+        WorkerStateSnapshot s;
+        s.worker_id = ws.worker_id;
+        s.queue_length = ws.queue_length;
+        s.active_requests = ws.active_requests;
+        s.load_ema = ws.load_ema;
+        std::memcpy(s.slack_histogram, ws.slack_histogram, sizeof(s.slack_histogram));
+        s.avg_service_time = ws.avg_service_time;
+        s.p99_latency = ws.p99_latency;
+        s.deadline_miss_rate = ws.deadline_miss_rate;
+        s.capacity_factor = ws.capacity_factor;
+        s.is_healthy = ws.is_healthy;
+        s.last_heartbeat = ws.last_heartbeat;
+        return s;
+    }
+
+    void apply_to(WorkerState& ws) const {
+        ws.worker_id = worker_id;
+        ws.queue_length = queue_length;
+        ws.active_requests = active_requests;
+        ws.load_ema = load_ema;
+        std::memcpy(ws.slack_histogram, slack_histogram, sizeof(slack_histogram));
+        ws.avg_service_time = avg_service_time;
+        ws.p99_latency = p99_latency;
+        ws.deadline_miss_rate = deadline_miss_rate;
+        ws.capacity_factor = capacity_factor;
+        ws.is_healthy = is_healthy;
+        ws.last_heartbeat = last_heartbeat;
+    }
+};
+
+class WorkerStateTable {
+public:
+    static constexpr uint64_t kNoVersion = ~0ULL;
+
+    explicit WorkerStateTable(const std::vector<WorkerState>& initial)
+        : size_(initial.size()),
+          slots_(new SeqLock<WorkerStateSnapshot>[initial.size()]) {
+        addresses_.reserve(size_);
+        for (size_t i = 0; i < size_; ++i) {
+            slots_[i].store(WorkerStateSnapshot::from(initial[i]));
+            addresses_.push_back(initial[i].address);
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    /**
+     * 读-改-写单个 Worker 的状态
+     *
+     * @param fn 形如 void(WorkerStateSnapshot&) 的修改函数，在该 Worker 的写锁内执行
+     */
+    template<typename Fn>
+    void update(size_t worker_id, Fn&& fn) {
+        slots_[worker_id].update(std::forward<Fn>(fn));
+    }
+
+    /**
+     * 初始化调用线程的私有视图 (含 address 等静态字段)
+     */
+    void init_view(std::vector<WorkerState>& view, std::vector<uint64_t>& versions) const {
+        view.assign(size_, WorkerState{});
+        versions.assign(size_, kNoVersion);
+        for (size_t i = 0; i < size_; ++i) {
+            view[i].address = addresses_[i];
+        }
+        refresh(view, versions);
+    }
+
+    /**
+     * 把版本号变化的 Worker 同步到私有视图 (无锁)
+     *
+     * @return 本次复制的 Worker 数量
+     */
+    size_t refresh(std::vector<WorkerState>& view, std::vector<uint64_t>& versions) const {
+        return refresh(view, versions, [](size_t, const WorkerState&) {});
+    }
+
+    /**
+     * 同上，每同步一个 Worker 调用一次 on_change(worker_id, 新状态)
+     */
+    template<typename OnChange>
+    size_t refresh(std::vector<WorkerState>& view, std::vector<uint64_t>& versions,
+                   OnChange&& on_change) const {
+        size_t copied = 0;
+        WorkerStateSnapshot snap;
+        for (size_t i = 0; i < size_; ++i) {
+            if (slots_[i].version() == versions[i]) continue;
+            versions[i] = slots_[i].load(snap);
+            snap.apply_to(view[i]);
+            on_change(i, view[i]);
+            ++copied;
+        }
+        return copied;
+    }
+
+private:
+    size_t size_;
+    std::unique_ptr<SeqLock<WorkerStateSnapshot>[]> slots_;
+    std::vector<std::string> addresses_;
+};
+
+}  // namespace malcolm
@@ -0,0 +1,140 @@
+#pragma once
+
+/**
+ * 从 IQN 分位数输出计算 CVaR (Conditional Value at Risk)
+ *
+ * CVaR_α = E[X | X >= VaR_α]
+ * 表示在最差 (1-α) 情况下的期望损失
+ *
+ * 输入为模型输出 [num_workers][num_quantiles]。VaR 只需第 k 小的值，CVaR 只需
+ * 不小于它的那一段之和，均值与顺序无关，因此不需要完整排序:
+ * - 采样点 τ 单调递增，训练好的 IQN 输出通常也单调。先用 SIMD 一次扫描同时求和
+ *   并检查单调性，单调时直接按下标取 VaR / CVaR
+ * - 不单调时拷贝到栈上数组做 std::nth_element (O(n)，不分配内存)
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "../inference/simd_kernels.h"
+
+namespace malcolm {
+
+struct CVaREstimate {
+    double var;    // Value at Risk
+    double cvar;   // Conditional VaR
+    double mean;   // 期望值
+};
+
+/// 非单调输出回退路径的栈上缓冲区容量 (单个 Worker 的分位数个数上限)
+constexpr size_t kMaxCVaRQuantiles = 256;
+
+/// VaR 在升序分位数中的下标
+inline size_t cvar_var_index(double alpha, size_t num_quantiles) {
+    size_t idx = static_cast<size_t>(alpha * num_quantiles);
+    return std::min(idx, num_quantiles - 1);
+}
+
+namespace detail {
+
+/**
+ * 一次扫描: 返回 n 个值之和，并检查是否非递减
+ */
+inline float sum_and_check_sorted(const float* q, size_t n, bool& sorted) {
+    float sum = 0.0f;
+    size_t i = 0;  // 已求和的元素数
+    size_t j = 0;  // 已检查的相邻对 (q[k], q[k+1])，k < j
+    sorted = true;
+
+#if defined(MALCOLM_SIMD_AVX512)
+    __m512 acc = _mm512_setzero_ps();
+    for (; i < n / 16 * 16; i += 16) {
+        acc = _mm512_add_ps(acc, _mm512_loadu_ps(q + i));
+    }
+    __mmask16 descending = 0;
+    for (; n > 16 && j < (n - 1) / 16 * 16; j += 16) {
+        descending |= _mm512_cmp_ps_mask(_mm512_loadu_ps(q + j + 1), _mm512_loadu_ps(q + j),
+                                         _CMP_LT_OQ);
+    }
+    sum = hsum512(acc);
+    sorted = descending == 0;
+#elif defined(MALCOLM_SIMD_AVX2)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i < n / 8 * 8; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_loadu_ps(q + i));
+    }
+    __m256 descending = _mm256_setzero_ps();
+    for (; n > 8 && j < (n - 1) / 8 * 8; j += 8) {
+        descending = _mm256_or_ps(descending, _mm256_cmp_ps(_mm256_loadu_ps(q + j + 1),
+                                                             _mm256_loadu_ps(q + j), _CMP_LT_OQ));
+    }
+    sum = hsum256(acc);
+    sorted = _mm256_movemask_ps(descending) == 0;
+#endif
+
+    for (; i < n; ++i) {
+        sum += q[i];
+    }
+    for (; j + 1 < n; ++j) {
+        if (q[j + 1] < q[j]) sorted = false;
+    }
+    return sum;
+}
+
+}  // namespace detail
+
+/**
+ * 单个 Worker 的 CVaR
+ *
+ * @param quantiles num_quantiles 个分位数估计 (任意顺序)
+ */
+inline CVaREstimate compute_cvar(const float* quantiles, size_t num_quantiles, double alpha) {
+    CVaREstimate result{0.0, 0.0, 0.0};
+    if (num_quantiles == 0) {
+        return result;
+    }
+
+    bool sorted = true;
+    float sum = detail::sum_and_check_sorted(quantiles, num_quantiles, sorted);
+    result.mean = sum / num_quantiles;
+
+    size_t var_idx = cvar_var_index(alpha, num_quantiles);
+    const float* tail = quantiles;
+
+    std::array<float, kMaxCVaRQuantiles> scratch;
+    if (!sorted) {
+        // 第 var_idx 小的值就位，其后均不小于它
+        size_t n = std::min(num_quantiles, kMaxCVaRQuantiles);
+        var_idx = std::min(var_idx, n - 1);
+        std::copy(quantiles, quantiles + n, scratch.begin());
+        std::nth_element(scratch.begin(), scratch.begin() + var_idx, scratch.begin() + n);
+        tail = scratch.data();
+        num_quantiles = n;
+    }
+
+    // VaR: alpha 分位数; CVaR: VaR 以上的平均值
+    result.var = tail[var_idx];
+    double cvar_sum = 0.0;
+    for (size_t i = var_idx; i < num_quantiles; ++i) {
+        cvar_sum += tail[i];
+    }
+    result.cvar = cvar_sum / (num_quantiles - var_idx);
+
+    return result;
+}
+
+/**
+ * 整个模型输出的 CVaR
+ *
+ * @param quantiles [num_workers][num_quantiles]，行连续
+ * @param out 输出 num_workers 个估计
+ */
+inline void compute_cvar_batch(const float* quantiles, size_t num_workers, size_t num_quantiles,
+                               double alpha, CVaREstimate* out) {
+    for (size_t w = 0; w < num_workers; ++w) {
+        out[w] = compute_cvar(quantiles + w * num_quantiles, num_quantiles, alpha);
+    }
+}
+
+}  // namespace malcolm
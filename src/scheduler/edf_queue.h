@@ -13,8 +13,10 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <memory>
 #include <optional>
 #include "../common/types.h"
+#include "slack_histogram.h"
 
 namespace malcolm {
 
@@ -37,6 +39,8 @@ struct Task {
     Timestamp actual_service_time_us = 0; // 实际服务时间 (μs)
     Timestamp queue_time_ns = 0;         // 排队时间 (ns)
     
+    uint64_t slack_epoch = 0;            // 松弛时间直方图中的纪元 (SlackHistogram::add 返回值)
+    
     // EDF 比较: 截止时间越早优先级越高
     bool operator>(const Task& other) const {
         return deadline > other.deadline;
@@ -132,61 +136,78 @@ private:
  * 方案 B: 分层时间轮 (Hierarchical Timing Wheel)
  * 
  * 适用场景: 超高吞吐 (> 500K RPS/Worker)
- * 优点: O(1) 入队，分桶减少锁竞争
- * 缺点: 精度受桶宽度限制，需要定期扫描
+ * 优点: O(1) 入队/出队，无比较、无堆调整
+ * 缺点: 精度受最低层桶宽度限制 (~1μs)，桶内按到达顺序
+ * 
+ * 设计 (按 deadline 分桶，而非按当前时间触发):
+ * - 三层，每层 128 桶，桶宽为 2 的幂以便用移位计算下标:
+ *     L0: 1.024μs × 128 = 131μs
+ *     L1: 131μs   × 128 = 16.8ms
+ *     L2: 16.8ms  × 128 = 2.1s
+ *   更远的 deadline 进入溢出链表
+ * - 游标 cursor_ (L0 刻度) 是所有在队任务刻度的下界。任务按与游标的公共前缀
+ *   放入能区分它的最低层，因此每层内桶下标顺序即时间顺序，且游标之前的桶必为空
+ * - 每层一个 128 位占用位图，取最早任务 = 最低非空层的 find-first-set
+ * - L0 为空时把 L1 (或 L2) 最早的非空桶整体降级 (cascade) 到低层，
+ *   每个任务最多降级两次，均摊 O(1)
+ * - 桶为侵入式单链表 (头/尾指针)，节点来自池，稳态不分配内存
+ * - 新任务早于游标时把游标降到该任务: 与新游标前缀不同的低层桶整体拼接到
+ *   上一层的一个桶中 (O(非空桶数)，不逐个移动任务)，之后照常降级
  * 
- * 设计:
- * - 将 deadline 按时间桶分组
- * - 每个桶内按到达顺序 (近似 EDF，因为同桶内 deadline 接近)
- * - 工作线程优先从当前/过期桶获取任务
+ * 出队顺序与按 deadline 的最小堆在 L0 刻度上完全一致，同一刻度内按到达顺序。
+ * 线程安全: 单个互斥锁保护 (临界区为 O(1) 链表操作)。
  */
 class HierarchicalTimingWheel {
 public:
-    static constexpr size_t kNumBuckets = 1024;         // 2^10 个桶
-    static constexpr Timestamp kBucketWidthNs = 1000;   // 1μs 每桶
-    // 总覆盖范围: 1024 * 1μs = ~1ms
+    static constexpr size_t kLevels = 3;
+    static constexpr size_t kBucketBits = 7;
+    static constexpr size_t kNumBuckets = size_t{1} << kBucketBits;   // 每层 128 桶
+    static constexpr size_t kTickShift = 10;                           // L0 桶宽 1024ns
+    static constexpr Timestamp kBucketWidthNs = Timestamp{1} << kTickShift;
+    static constexpr size_t kPoolChunk = 4096;                         // 节点池每次扩容的节点数
     
-    HierarchicalTimingWheel() {
-        current_tick_.store(now_ns() / kBucketWidthNs);
-    }
+    HierarchicalTimingWheel() = default;
+    
+    // 禁用拷贝
+    HierarchicalTimingWheel(const HierarchicalTimingWheel&) = delete;
+    HierarchicalTimingWheel& operator=(const HierarchicalTimingWheel&) = delete;
     
     /// 入队
     void insert(Task&& task) {
-        size_t bucket_idx = (task.deadline / kBucketWidthNs) % kNumBuckets;
-        auto& bucket = buckets_[bucket_idx];
+        std::lock_guard<std::mutex> lock(mutex_);
+        Node* node = alloc_node();
+        node->tick = task.deadline >> kTickShift;
+        node->task = std::move(task);
         
-        std::lock_guard<std::mutex> lock(bucket.mutex);
-        bucket.tasks.push_back(std::move(task));
+        if (total_size_.load(std::memory_order_relaxed) == 0) {
+            cursor_ = node->tick;  // 空轮: 游标直接跳到新任务
+        } else if (node->tick < cursor_) {
+            lower_cursor(node->tick);
+        }
+        place(node);
         total_size_.fetch_add(1, std::memory_order_relaxed);
     }
     
-    /// 获取最紧急的到期/即将到期任务
-    bool try_get_urgent(Timestamp now, Task& out_task) {
-        size_t current_bucket = (now / kBucketWidthNs) % kNumBuckets;
+    /// 取出 deadline 最早的任务 (同一 L0 桶内按到达顺序)
+    bool try_pop(Task& out_task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (total_size_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
         
-        // 扫描当前及之前的几个桶 (处理过期任务)
-        for (size_t offset = 0; offset < kNumBuckets / 8; ++offset) {
-            size_t idx = (current_bucket - offset + kNumBuckets) % kNumBuckets;
-            auto& bucket = buckets_[idx];
-            
-            std::lock_guard<std::mutex> lock(bucket.mutex);
-            if (!bucket.tasks.empty()) {
-                // 找到桶内 deadline 最早的任务
-                auto it = std::min_element(bucket.tasks.begin(), bucket.tasks.end());
-                
-                out_task = std::move(*it);
-                bucket.tasks.erase(it);
-                total_size_.fetch_sub(1, std::memory_order_relaxed);
-                return true;
-            }
+        while (levels_[0].empty()) {
+            advance();
         }
-        return false;
-    }
-    
-    /// 获取下一个任务 (不考虑是否过期)
-    bool try_pop(Task& out_task) {
-        Timestamp now = now_ns();
-        return try_get_urgent(now, out_task);
+        
+        Level& l0 = levels_[0];
+        size_t idx = l0.first();
+        Node* node = l0.pop_front(idx);
+        cursor_ = (cursor_ & ~(Timestamp{kNumBuckets} - 1)) | idx;
+        
+        out_task = std::move(node->task);
+        free_node(node);
+        total_size_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
     }
     
     /// 总任务数
@@ -198,41 +219,188 @@ public:
         return size() == 0;
     }
     
-    /// 获取松弛时间分布直方图 (用于状态向量)
-    void get_slack_histogram(Timestamp now, 
-                             std::array<uint32_t, constants::kSlackHistogramBins>& hist) const {
-        hist.fill(0);
+private:
+    struct Node {
+        Task task;
+        Timestamp tick;   // deadline 的 L0 刻度
+        Node* next;
+    };
+    
+    struct Bucket {
+        Node* head = nullptr;
+        Node* tail = nullptr;
+        
+        void push_back(Node* node) {
+            node->next = nullptr;
+            if (tail) tail->next = node; else head = node;
+            tail = node;
+        }
+        
+        /// 摘下整条链表
+        Node* take_all() {
+            Node* list = head;
+            head = tail = nullptr;
+            return list;
+        }
+        
+        /// 把 other 整条链表接到末尾 (O(1))
+        void splice(Bucket& other) {
+            if (!other.head) return;
+            if (tail) tail->next = other.head; else head = other.head;
+            tail = other.tail;
+            other.head = other.tail = nullptr;
+        }
+    };
+    
+    struct Level {
+        std::array<Bucket, kNumBuckets> buckets;
+        uint64_t occupied[kNumBuckets / 64] = {0, 0};
+        
+        bool empty() const { return (occupied[0] | occupied[1]) == 0; }
+        
+        /// 最低的非空桶下标 (调用方保证非空)
+        size_t first() const {
+            return occupied[0] ? static_cast<size_t>(__builtin_ctzll(occupied[0]))
+                               : 64 + static_cast<size_t>(__builtin_ctzll(occupied[1]));
+        }
+        
+        void push_back(size_t idx, Node* node) {
+            buckets[idx].push_back(node);
+            occupied[idx / 64] |= uint64_t{1} << (idx % 64);
+        }
+        
+        Node* pop_front(size_t idx) {
+            Bucket& b = buckets[idx];
+            Node* node = b.head;
+            b.head = node->next;
+            if (!b.head) {
+                b.tail = nullptr;
+                occupied[idx / 64] &= ~(uint64_t{1} << (idx % 64));
+            }
+            return node;
+        }
         
-        for (const auto& bucket : buckets_) {
-            std::lock_guard<std::mutex> lock(bucket.mutex);
-            for (const auto& task : bucket.tasks) {
-                Duration slack = task.slack_time(now);
-                
-                // 将松弛时间映射到直方图桶
-                // 负值 (过期) -> 桶 0
-                // 0 ~ kSlackBinWidth -> 桶 1
-                // ...
-                size_t bin = 0;
-                if (slack > 0) {
-                    bin = std::min<size_t>(
-                        static_cast<size_t>(slack / constants::kSlackBinWidth) + 1,
-                        constants::kSlackHistogramBins - 1
-                    );
+        Node* take_all(size_t idx) {
+            occupied[idx / 64] &= ~(uint64_t{1} << (idx % 64));
+            return buckets[idx].take_all();
+        }
+        
+        /// 按下标顺序把所有非空桶拼接到 out 并清空本层
+        void splice_all(Bucket& out) {
+            for (size_t word = 0; word < kNumBuckets / 64; ++word) {
+                while (occupied[word]) {
+                    size_t idx = word * 64 + static_cast<size_t>(__builtin_ctzll(occupied[word]));
+                    occupied[word] &= occupied[word] - 1;
+                    out.splice(buckets[idx]);
                 }
-                ++hist[bin];
             }
         }
+    };
+    
+    /// 按与游标的公共前缀放入能区分它的最低层 (要求 node->tick >= cursor_)
+    void place(Node* node) {
+        Timestamp tick = node->tick;
+        for (size_t level = 0; level < kLevels; ++level) {
+            size_t shift = level * kBucketBits;
+            if ((tick >> (shift + kBucketBits)) == (cursor_ >> (shift + kBucketBits))) {
+                levels_[level].push_back((tick >> shift) & (kNumBuckets - 1), node);
+                return;
+            }
+        }
+        overflow_.push_back(node);
     }
     
-private:
-    struct Bucket {
-        mutable std::mutex mutex;
-        std::vector<Task> tasks;
-    };
+    /// L0 为空: 把游标推进到更高层最早的非空桶，并把该桶降级到低层
+    void advance() {
+        for (size_t level = 1; level < kLevels; ++level) {
+            Level& l = levels_[level];
+            if (l.empty()) continue;
+            
+            size_t idx = l.first();
+            size_t shift = level * kBucketBits;
+            Timestamp high_mask = ~((Timestamp{1} << (shift + kBucketBits)) - 1);
+            cursor_ = (cursor_ & high_mask) | (static_cast<Timestamp>(idx) << shift);
+            cascade(l.take_all(idx));
+            return;
+        }
+        
+        // 三层都空: 游标跳到溢出链表中最早的任务，再整体重新放置
+        Timestamp min_tick = overflow_.head->tick;
+        for (Node* node = overflow_.head; node; node = node->next) {
+            min_tick = std::min(min_tick, node->tick);
+        }
+        cursor_ = min_tick;
+        cascade(overflow_.take_all());
+    }
+    
+    /**
+     * 把游标降到 tick (< cursor_)
+     * 
+     * 设新旧游标在第 L 层以上前缀相同。低于 L 层的任务都与旧游标共享 L 层前缀，
+     * 即在新游标下同属 L 层的一个桶 (旧游标所在的桶，按不变式当前为空)，
+     * 因此整体拼接过去即可; L 层及以上的放置不受影响。
+     */
+    void lower_cursor(Timestamp tick) {
+        size_t level = 0;
+        while (level < kLevels &&
+               (tick >> ((level + 1) * kBucketBits)) != (cursor_ >> ((level + 1) * kBucketBits))) {
+            ++level;
+        }
+        
+        if (level > 0) {
+            Bucket merged;
+            for (size_t l = 0; l < level; ++l) {
+                levels_[l].splice_all(merged);
+            }
+            if (merged.head) {
+                if (level < kLevels) {
+                    size_t idx = (cursor_ >> (level * kBucketBits)) & (kNumBuckets - 1);
+                    Level& target = levels_[level];
+                    target.buckets[idx].splice(merged);
+                    target.occupied[idx / 64] |= uint64_t{1} << (idx % 64);
+                } else {
+                    overflow_.splice(merged);
+                }
+            }
+        }
+        cursor_ = tick;
+    }
+    
+    void cascade(Node* list) {
+        while (list) {
+            Node* next = list->next;
+            place(list);
+            list = next;
+        }
+    }
+    
+    Node* alloc_node() {
+        if (!free_list_) {
+            pool_.emplace_back(new Node[kPoolChunk]);
+            Node* chunk = pool_.back().get();
+            for (size_t i = 0; i < kPoolChunk; ++i) {
+                chunk[i].next = free_list_;
+                free_list_ = &chunk[i];
+            }
+        }
+        Node* node = free_list_;
+        free_list_ = node->next;
+        return node;
+    }
     
-    std::array<Bucket, kNumBuckets> buckets_;
+    void free_node(Node* node) {
+        node->next = free_list_;
+        free_list_ = node;
+    }
+    
+    mutable std::mutex mutex_;
+    std::array<Level, kLevels> levels_;
+    Bucket overflow_;
+    Timestamp cursor_ = 0;   // L0 刻度，所有在队任务刻度的下界
     std::atomic<size_t> total_size_{0};
-    std::atomic<uint64_t> current_tick_;
+    
+    std::vector<std::unique_ptr<Node[]>> pool_;
+    Node* free_list_ = nullptr;
 };
 
 /**
@@ -251,6 +419,7 @@ public:
         : impl_(impl) {}
     
     void push(Task&& task) {
+        task.slack_epoch = slack_hist_.add(task.deadline, now_ns());
         switch (impl_) {
             case Implementation::kLocked:
                 locked_queue_.push(std::move(task));
@@ -262,13 +431,19 @@ public:
     }
     
     bool try_pop(Task& task) {
+        bool popped = false;
         switch (impl_) {
             case Implementation::kLocked:
-                return locked_queue_.try_pop(task);
+                popped = locked_queue_.try_pop(task);
+                break;
             case Implementation::kTimingWheel:
-                return timing_wheel_.try_pop(task);
+                popped = timing_wheel_.try_pop(task);
+                break;
+        }
+        if (popped) {
+            slack_hist_.remove(task.slack_epoch, now_ns());
         }
-        return false;
+        return popped;
     }
     
     size_t size() const {
@@ -283,15 +458,15 @@ public:
     
     bool empty() const { return size() == 0; }
     
-    /// 获取松弛时间直方图
+    /// 获取松弛时间直方图 (入队/出队时增量维护，无锁读取)
     void get_slack_histogram(
         std::array<uint32_t, constants::kSlackHistogramBins>& hist) const {
-        Timestamp now = now_ns();
-        timing_wheel_.get_slack_histogram(now, hist);
+        slack_hist_.snapshot(now_ns(), hist);
     }
     
 private:
     Implementation impl_;
+    SlackHistogram slack_hist_;
     EDFQueueLocked locked_queue_;
     HierarchicalTimingWheel timing_wheel_;
 };
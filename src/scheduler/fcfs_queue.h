@@ -10,6 +10,8 @@
 #include <queue>
 #include <mutex>
 #include <atomic>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include "../common/types.h"
 #include "edf_queue.h"  // 复用 Task 结构
@@ -136,6 +138,99 @@ private:
     alignas(64) std::atomic<size_t> tail_{0};
 };
 
+/**
+ * 有界无锁 MPMC (Multi-Producer-Multi-Consumer) 队列
+ * 
+ * Vyukov 环形缓冲区: 每个槽位带一个序号，生产者/消费者各自 CAS 推进位置，
+ * 再通过槽位序号的 release/acquire 交接数据。无锁、无分配，满/空时立即返回 false。
+ * 容量在构造时确定并向上取整到 2 的幂。
+ */
+template<typename T>
+class MPMCQueue {
+public:
+    explicit MPMCQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        slots_.reset(new Slot[cap]);
+        for (size_t i = 0; i < cap; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    // 禁用拷贝
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+    
+    /// 尝试入队 (非阻塞)，失败时 item 保持不变
+    bool try_push(T&& item) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(item);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列满
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    /// 尝试出队 (非阻塞)
+    bool try_pop(T& item) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(slot.value);
+                    slot.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // 队列空
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    /// 近似大小 (非精确)
+    size_t size_approx() const {
+        size_t head = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t tail = dequeue_pos_.load(std::memory_order_relaxed);
+        return head > tail ? head - tail : 0;
+    }
+    
+    bool empty() const {
+        return size_approx() == 0;
+    }
+    
+    size_t capacity() const {
+        return mask_ + 1;
+    }
+    
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> seq{0};
+        T value{};
+    };
+    
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<size_t> dequeue_pos_{0};
+};
+
 /**
  * FCFS 队列统一接口
  */
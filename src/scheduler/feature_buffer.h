@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * 调度模型输入特征的持久缓冲区
+ *
+ * 布局: [请求特征 (request_dim)] [Worker 0 特征 (worker_dim)] [Worker 1 特征] ...
+ *
+ * 原实现每次调度都新建 std::vector<float>，并重新归一化所有 Worker 的状态
+ * (含 32 桶松弛时间直方图)。这里把 Worker 段常驻在一块 64 字节对齐的缓冲区中:
+ * - 增量模式: 调用方通过 Scheduler::update_worker_state() 推送状态变化，
+ *   只重新编码变化的 Worker，每次调度只写入请求特征
+ * - 全量模式: 调用方从不推送 (如离线基准)，每次调度从传入的状态重新编码，
+ *   行为与原实现一致，但不再分配内存
+ * 增量模式下 Worker 数变化或仍有 Worker 未推送过时，自动按传入状态整体重建一次。
+ *
+ * 线程模型: 属于单个调度器实例，不加锁。
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../common/types.h"
+#include "../inference/simd_kernels.h"
+
+namespace malcolm {
+
+class StateFeatureBuffer {
+public:
+    StateFeatureBuffer(size_t request_dim, size_t worker_dim)
+        : request_dim_(request_dim), worker_dim_(worker_dim) {
+        resize(0);
+    }
+
+    size_t request_dim() const { return request_dim_; }
+    size_t worker_dim() const { return worker_dim_; }
+    size_t num_workers() const { return num_workers_; }
+
+    /// 特征总长度 (模型输入维度)
+    size_t size() const { return request_dim_ + num_workers_ * worker_dim_; }
+
+    const float* data() const { return data_.data(); }
+    float* request_features() { return data_.data(); }
+    float* worker_features(size_t w) { return data_.data() + request_dim_ + w * worker_dim_; }
+
+    /**
+     * 推送单个 Worker 的状态变化 (切换到增量模式)
+     *
+     * @param encode 形如 void(const WorkerState&, float* out) 的编码函数
+     */
+    template<typename Encode>
+    void update_worker(size_t w, const WorkerState& ws, Encode&& encode) {
+        incremental_ = true;
+        if (w >= num_workers_) {
+            return;  // 下次 sync() 时按实际 Worker 数整体重建
+        }
+        encode(ws, worker_features(w));
+        if (!valid_[w]) {
+            valid_[w] = 1;
+            ++num_valid_;
+        }
+    }
+
+    /**
+     * 使 Worker 段与 worker_states 一致，返回缓冲区首地址
+     *
+     * 增量模式且所有 Worker 段有效时不做任何工作
+     */
+    template<typename Encode>
+    const float* sync(const std::vector<WorkerState>& worker_states, Encode&& encode) {
+        if (incremental_ && num_workers_ == worker_states.size() && num_valid_ == num_workers_) {
+            return data_.data();
+        }
+        if (num_workers_ != worker_states.size()) {
+            resize(worker_states.size());
+        }
+        for (size_t w = 0; w < num_workers_; ++w) {
+            encode(worker_states[w], worker_features(w));
+            valid_[w] = 1;
+        }
+        num_valid_ = num_workers_;
+        return data_.data();
+    }
+
+private:
+    void resize(size_t num_workers) {
+        num_workers_ = num_workers;
+        data_.assign(simd_padded(request_dim_ + num_workers * worker_dim_), 0.0f);
+        valid_.assign(num_workers, 0);
+        num_valid_ = 0;
+    }
+
+    size_t request_dim_;
+    size_t worker_dim_;
+    size_t num_workers_ = 0;
+    size_t num_valid_ = 0;
+    bool incremental_ = false;
+    AlignedFloats data_;
+    std::vector<uint8_t> valid_;
+};
+
+}  // namespace malcolm
@@ -15,6 +15,7 @@
  */
 
 #include "scheduler.h"
+#include "feature_buffer.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
@@ -24,6 +25,10 @@
 #include <torch/script.h>
 #endif
 
+#ifdef USE_NATIVE_INFERENCE
+#include "../inference/native_model.h"
+#endif
+
 namespace malcolm {
 
 /**
@@ -35,6 +40,9 @@ namespace malcolm {
  */
 class MalcolmScheduler : public Scheduler {
 public:
+    static constexpr size_t kRequestFeatures = 3;  // 每请求特征数
+    static constexpr size_t kWorkerFeatures = 4;   // 每 Worker 特征数
+    
     /**
      * @param model_path PyTorch 模型路径 (可选)
      * @param use_heuristic 是否使用启发式模式
@@ -42,7 +50,20 @@ public:
     explicit MalcolmScheduler(
         const std::string& model_path = "",
         bool use_heuristic = true
-    ) : use_heuristic_(use_heuristic) {
+    ) : use_heuristic_(use_heuristic), features_(kRequestFeatures, kWorkerFeatures) {
+        
+#ifdef USE_NATIVE_INFERENCE
+        // scripts/export_native_model.py 导出的 .bin 权重走原生 SIMD 引擎
+        if (is_native_model_path(model_path) && !use_heuristic_) {
+            native_loaded_ = native_model_.load(model_path);
+            use_heuristic_ = !native_loaded_;
+            if (native_loaded_) {
+                printf("[Malcolm] Native model loaded: %s (%s)\n",
+                       model_path.c_str(), simd_isa_name());
+            }
+            return;
+        }
+#endif
         
 #ifdef USE_LIBTORCH
         if (!model_path.empty() && !use_heuristic_) {
@@ -86,6 +107,10 @@ public:
         return {target, confidence, now_ns() - start};
     }
     
+    void update_worker_state(uint8_t worker_id, const WorkerState& new_state) override {
+        features_.update_worker(worker_id, new_state, encode_worker_features);
+    }
+    
     std::string name() const override {
         return use_heuristic_ ? "Malcolm-Heuristic" : "Malcolm-Model";
     }
@@ -166,19 +191,25 @@ private:
         const std::vector<WorkerState>& worker_states,
         double& confidence
     ) {
+#ifdef USE_NATIVE_INFERENCE
+        if (native_loaded_) {
+            return schedule_native(request, worker_states, confidence);
+        }
+#endif
+        
 #ifdef USE_LIBTORCH
         if (!model_loaded_) {
             return schedule_heuristic(request, worker_states, confidence);
         }
         
         // 构建状态向量
-        std::vector<float> state = build_state_vector(request, worker_states);
+        const float* state = prepare_features(request, worker_states);
         
         torch::NoGradGuard no_grad;
         
         auto input = torch::from_blob(
-            state.data(),
-            {1, static_cast<long>(state.size())},
+            const_cast<float*>(state),
+            {1, static_cast<long>(features_.size())},
             torch::kFloat32
         ).clone();  // clone 确保内存安全
         
@@ -204,29 +235,72 @@ private:
 #endif
     }
     
+    /**
+     * 原生 SIMD 引擎推理: 输出为每个 Worker 的 Q 值，选 Q 值最大的健康 Worker
+     */
+    uint8_t schedule_native(
+        const ClientRequest& request,
+        const std::vector<WorkerState>& worker_states,
+        double& confidence
+    ) {
+#ifdef USE_NATIVE_INFERENCE
+        const float* state = prepare_features(request, worker_states);
+        if (features_.size() != native_model_.input_dim() ||
+            worker_states.size() > native_model_.output_dim()) {
+            if (!native_mismatch_reported_) {
+                fprintf(stderr, "[Malcolm] Native model expects state_dim=%zu, %zu workers; "
+                        "got state_dim=%zu, %zu workers. Falling back to heuristic\n",
+                        native_model_.input_dim(), native_model_.output_dim(),
+                        features_.size(), worker_states.size());
+                native_mismatch_reported_ = true;
+            }
+            return schedule_heuristic(request, worker_states, confidence);
+        }
+        
+        const float* q_values = native_model_.forward(state);
+        
+        uint8_t best_worker = 0;
+        float best_q = -std::numeric_limits<float>::max();
+        for (size_t i = 0; i < worker_states.size(); ++i) {
+            if (worker_states[i].is_healthy && q_values[i] > best_q) {
+                best_q = q_values[i];
+                best_worker = static_cast<uint8_t>(i);
+            }
+        }
+        
+        confidence = static_cast<double>(best_q);
+        return best_worker;
+#else
+        return schedule_heuristic(request, worker_states, confidence);
+#endif
+    }
+    
     /**
      * 构建状态向量 (用于模型输入)
+     * 
+     * Worker 段由 features_ 常驻并增量维护，每次调度只写入请求特征。
+     * 返回的指针在下一次调用前有效，长度为 features_.size()
      */
-    std::vector<float> build_state_vector(
+    const float* prepare_features(
         const ClientRequest& request,
         const std::vector<WorkerState>& worker_states
     ) {
-        std::vector<float> state;
+        features_.sync(worker_states, encode_worker_features);
         
         // 请求特征
-        state.push_back(static_cast<float>(request.type));
-        state.push_back(static_cast<float>(request.payload_size) / 1000.0f);
-        state.push_back(static_cast<float>(request.expected_service_us) / 100.0f);
-        
-        // 各 Worker 状态
-        for (const auto& ws : worker_states) {
-            state.push_back(static_cast<float>(ws.load_ema));
-            state.push_back(static_cast<float>(ws.queue_length) / 100.0f);
-            state.push_back(static_cast<float>(ws.capacity_factor));
-            state.push_back(ws.is_healthy ? 1.0f : 0.0f);
-        }
+        float* out = features_.request_features();
+        out[0] = static_cast<float>(request.type);
+        out[1] = static_cast<float>(request.payload_size) / 1000.0f;
+        out[2] = static_cast<float>(request.expected_service_us) / 100.0f;
         
-        return state;
+        return features_.data();
+    }
+    
+    static void encode_worker_features(const WorkerState& ws, float* out) {
+        out[0] = static_cast<float>(ws.load_ema);
+        out[1] = static_cast<float>(ws.queue_length) / 100.0f;
+        out[2] = static_cast<float>(ws.capacity_factor);
+        out[3] = ws.is_healthy ? 1.0f : 0.0f;
     }
     
     void warmup() {
@@ -242,10 +316,17 @@ private:
 private:
     bool use_heuristic_;
     bool model_loaded_ = false;
+    bool native_loaded_ = false;
+    StateFeatureBuffer features_;  // 模型输入 (Worker 段增量更新)
     
 #ifdef USE_LIBTORCH
     torch::jit::script::Module model_;
 #endif
+
+#ifdef USE_NATIVE_INFERENCE
+    NativeMLPModel native_model_;
+    bool native_mismatch_reported_ = false;
+#endif
 };
 
 }  // namespace malcolm
@@ -16,6 +16,8 @@
  */
 
 #include "scheduler.h"
+#include "cvar.h"
+#include "feature_buffer.h"
 #include <vector>
 #include <array>
 #include <cmath>
@@ -26,19 +28,11 @@
 #include <torch/script.h>
 #endif
 
-namespace malcolm {
+#ifdef USE_NATIVE_INFERENCE
+#include "../inference/native_model.h"
+#endif
 
-/**
- * CVaR (Conditional Value at Risk) 计算
- * 
- * CVaR_α = E[X | X >= VaR_α]
- * 表示在最差 (1-α) 情况下的期望损失
- */
-struct CVaREstimate {
-    double var;    // Value at Risk
-    double cvar;   // Conditional VaR
-    double mean;   // 期望值
-};
+namespace malcolm {
 
 /**
  * Malcolm-Strict 调度器
@@ -50,6 +44,8 @@ class MalcolmStrictScheduler : public Scheduler {
 public:
     static constexpr double kDefaultCVaRAlpha = 0.95;  // 关注最差 5%
     static constexpr size_t kNumQuantileSamples = 32;  // 分位数采样数
+    static constexpr size_t kRequestFeatures = 4;      // 每请求特征数
+    static constexpr size_t kWorkerFeatures = 7 + constants::kSlackHistogramBins;  // 每 Worker 特征数
     
     /**
      * @param model_path IQN 模型路径
@@ -58,7 +54,21 @@ public:
     explicit MalcolmStrictScheduler(
         const std::string& model_path = "",
         double cvar_alpha = kDefaultCVaRAlpha
-    ) : cvar_alpha_(cvar_alpha) {
+    ) : cvar_alpha_(cvar_alpha), features_(kRequestFeatures, kWorkerFeatures) {
+        
+#ifdef USE_NATIVE_INFERENCE
+        // scripts/export_native_model.py 导出的 .bin 权重走原生 SIMD 引擎
+        if (is_native_model_path(model_path)) {
+            if (native_model_.load(model_path)) {
+                generate_quantile_samples();
+                native_model_.set_quantiles(quantile_samples_.data(), kNumQuantileSamples);
+                native_loaded_ = true;
+                printf("[Malcolm-Strict] Native model loaded: %s (%s), CVaR alpha=%.2f\n",
+                       model_path.c_str(), simd_isa_name(), cvar_alpha_);
+            }
+            return;
+        }
+#endif
         
 #ifdef USE_LIBTORCH
         if (!model_path.empty()) {
@@ -98,6 +108,8 @@ public:
         
         if (model_loaded_) {
             target = schedule_iqn(request, worker_states, confidence);
+        } else if (native_loaded_) {
+            target = schedule_native(request, worker_states, confidence);
         } else {
             target = schedule_heuristic(request, worker_states, confidence);
         }
@@ -105,6 +117,31 @@ public:
         return {target, confidence, now_ns() - start};
     }
     
+    /**
+     * 批量调度: 整批请求只做一次 IQN 推理
+     * 
+     * 无模型时退回基类的逐个调度
+     */
+    void schedule_batch(
+        const std::vector<ClientRequest>& requests,
+        const std::vector<WorkerState>& worker_states,
+        std::vector<ScheduleDecision>& decisions
+    ) override {
+        if ((!model_loaded_ && !native_loaded_) || requests.size() <= 1 ||
+            worker_states.empty()) {
+            Scheduler::schedule_batch(requests, worker_states, decisions);
+            return;
+        }
+        schedule_batch_iqn(requests, worker_states, decisions);
+    }
+    
+    /**
+     * Worker 状态变化时只重新编码该 Worker 的特征段
+     */
+    void update_worker_state(uint8_t worker_id, const WorkerState& new_state) override {
+        features_.update_worker(worker_id, new_state, encode_worker_features);
+    }
+    
     void on_request_complete(const RequestTrace& trace) override {
         // 可用于在线学习或统计收集
         // 当前版本使用离线训练的模型
@@ -121,7 +158,7 @@ public:
     
 private:
     /**
-     * IQN 模型推理调度
+     * IQN 模型推理调度 (LibTorch)
      * 
      * 1. 构建状态向量 (含松弛时间直方图)
      * 2. 对每个 Worker 估计延迟分布
@@ -136,20 +173,22 @@ private:
         torch::NoGradGuard no_grad;
         
         // 构建状态向量
-        std::vector<float> state = build_state_vector(request, worker_states);
+        const float* state = prepare_features(request, worker_states);
         
+        // from_blob 不拷贝: features_ 与 quantile_samples_ 在 forward 返回前一直有效，
+        // 且模型不会原地修改输入
         auto state_tensor = torch::from_blob(
-            state.data(),
-            {1, static_cast<long>(state.size())},
+            const_cast<float*>(state),
+            {1, static_cast<long>(features_.size())},
             torch::kFloat32
-        ).clone();
+        );
         
         // 分位数采样张量
         auto tau_tensor = torch::from_blob(
             quantile_samples_.data(),
             {1, static_cast<long>(kNumQuantileSamples)},
             torch::kFloat32
-        ).clone();
+        );
         
         // IQN 前向传播
         // 输入: (state, tau) -> 输出: 每个 Worker 在各分位数的延迟估计
@@ -157,78 +196,268 @@ private:
         inputs.push_back(state_tensor);
         inputs.push_back(tau_tensor);
         
-        auto output = model_.forward(inputs).toTensor();
+        auto output = model_.forward(inputs).toTensor().contiguous();
         // output 形状: [1, num_workers, num_quantiles]
+        if (!torch_output_ok(output, 1, worker_states.size())) {
+            return schedule_heuristic(request, worker_states, confidence);
+        }
         
-        size_t num_workers = worker_states.size();
-        uint8_t best_worker = 0;
-        double min_cvar = std::numeric_limits<double>::max();
+        return select_min_risk(request, worker_states, output.data_ptr<float>(),
+                               nullptr, now_ns(), confidence);
+#else
+        return schedule_heuristic(request, worker_states, confidence);
+#endif
+    }
+    
+    /**
+     * IQN 模型推理调度 (原生 SIMD 引擎)
+     */
+    uint8_t schedule_native(
+        const ClientRequest& request,
+        const std::vector<WorkerState>& worker_states,
+        double& confidence
+    ) {
+#ifdef USE_NATIVE_INFERENCE
+        const float* state = prepare_features(request, worker_states);
+        if (!native_input_ok(features_.size(), worker_states.size())) {
+            return schedule_heuristic(request, worker_states, confidence);
+        }
+        
+        native_output_.resize(native_model_.num_outputs() * kNumQuantileSamples);
+        native_model_.forward(state, native_output_.data());
+        
+        return select_min_risk(request, worker_states, native_output_.data(),
+                               nullptr, now_ns(), confidence);
+#else
+        return schedule_heuristic(request, worker_states, confidence);
+#endif
+    }
+    
+    /**
+     * 批量 IQN 推理调度
+     * 
+     * 1. 整批状态拼成 [B, state_dim] 做一次前向，得到 [B, num_workers, num_quantiles]
+     *    (原生引擎: 状态编码和输出头各一次 GEMM)
+     * 2. 按 deadline 从紧到松依次分配: 状态向量只反映批开始时的负载，
+     *    因此对本批已分到某 Worker 的每个请求，把它的预计服务时间
+     *    叠加到该 Worker 的延迟分位数上，再计算 CVaR 和 deadline 惩罚
+     */
+    void schedule_batch_iqn(
+        const std::vector<ClientRequest>& requests,
+        const std::vector<WorkerState>& worker_states,
+        std::vector<ScheduleDecision>& decisions
+    ) {
+        Timestamp start = now_ns();
+        size_t batch = requests.size();
+        
+        size_t request_stride = 0;
+        const float* quantiles = infer_batch(requests, worker_states, request_stride);
+        if (!quantiles) {
+            Scheduler::schedule_batch(requests, worker_states, decisions);
+            return;
+        }
+        
+        // 按 deadline 升序分配，紧急请求优先挑选 Worker
+        batch_order_.resize(batch);
+        std::iota(batch_order_.begin(), batch_order_.end(), 0);
+        std::sort(batch_order_.begin(), batch_order_.end(), [&](size_t a, size_t b) {
+            return requests[a].deadline < requests[b].deadline;
+        });
+        
+        batch_assigned_.assign(worker_states.size(), 0.0);
+        decisions.resize(batch);
+        Timestamp now = now_ns();
+        
+        for (size_t b : batch_order_) {
+            double confidence = 0.0;
+            uint8_t target = select_min_risk(requests[b], worker_states,
+                                             quantiles + b * request_stride,
+                                             batch_assigned_.data(), now, confidence);
+            batch_assigned_[target] += expected_service_ns(requests[b], worker_states[target]);
+            decisions[b].target_worker_id = target;
+            decisions[b].confidence = confidence;
+        }
+        
+        // 决策耗时均摊到每个请求
+        Timestamp per_request = (now_ns() - start) / batch;
+        for (auto& decision : decisions) {
+            decision.decision_time = per_request;
+        }
+    }
+    
+    /**
+     * 整批推理
+     * 
+     * @param request_stride 输出: 相邻两个请求的分位数块之间的 float 个数
+     * @return [B][模型输出 Worker 数][kNumQuantileSamples]，推理不可用时返回 nullptr
+     */
+    const float* infer_batch(
+        const std::vector<ClientRequest>& requests,
+        const std::vector<WorkerState>& worker_states,
+        size_t& request_stride
+    ) {
+        size_t batch = requests.size();
         
-        for (size_t w = 0; w < num_workers; ++w) {
-            if (!worker_states[w].is_healthy) continue;
+#ifdef USE_NATIVE_INFERENCE
+        if (native_loaded_) {
+            // 构建 [B, state_dim] 状态矩阵 (复用缓冲区)，Worker 段整批相同
+            batch_states_.clear();
+            for (const auto& request : requests) {
+                const float* state = prepare_features(request, worker_states);
+                batch_states_.insert(batch_states_.end(), state, state + features_.size());
+            }
+            if (!native_input_ok(features_.size(), worker_states.size())) {
+                return nullptr;
+            }
             
-            // 计算该 Worker 的 CVaR
-            CVaREstimate cvar = compute_cvar_from_quantiles(output, w);
+            request_stride = native_model_.num_outputs() * kNumQuantileSamples;
+            native_output_.resize(batch * request_stride);
+            native_model_.forward_batch(batch_states_.data(), batch, native_output_.data());
+            return native_output_.data();
+        }
+#endif
+        
+#ifdef USE_LIBTORCH
+        if (model_loaded_) {
+            torch::NoGradGuard no_grad;
             
-            // 考虑 deadline 约束
-            Duration slack = static_cast<Duration>(request.deadline - now_ns());
-            double deadline_penalty = compute_deadline_penalty(cvar, slack);
+            // 构建 [B, state_dim] 状态矩阵 (复用缓冲区)，Worker 段整批相同
+            batch_states_.clear();
+            size_t state_dim = 0;
+            for (const auto& request : requests) {
+                const float* state = prepare_features(request, worker_states);
+                state_dim = features_.size();
+                batch_states_.insert(batch_states_.end(), state, state + state_dim);
+            }
+            
+            auto state_tensor = torch::from_blob(
+                batch_states_.data(),
+                {static_cast<long>(batch), static_cast<long>(state_dim)},
+                torch::kFloat32
+            );
+            auto tau_tensor = torch::from_blob(
+                quantile_samples_.data(),
+                {1, static_cast<long>(kNumQuantileSamples)},
+                torch::kFloat32
+            ).expand({static_cast<long>(batch), static_cast<long>(kNumQuantileSamples)});
             
-            double risk_score = cvar.cvar + deadline_penalty;
+            std::vector<torch::jit::IValue> inputs;
+            inputs.push_back(state_tensor);
+            inputs.push_back(tau_tensor);
             
-            if (risk_score < min_cvar) {
-                min_cvar = risk_score;
-                best_worker = static_cast<uint8_t>(w);
+            // output 形状: [B, num_workers, num_quantiles]，保留到本批分配结束
+            batch_output_ = model_.forward(inputs).toTensor().contiguous();
+            if (!torch_output_ok(batch_output_, batch, worker_states.size())) {
+                return nullptr;
             }
+            request_stride = static_cast<size_t>(batch_output_.size(1) * batch_output_.size(2));
+            return batch_output_.data_ptr<float>();
         }
-        
-        confidence = 1.0 / (1.0 + min_cvar / 1e6);  // 归一化置信度
-        return best_worker;
-#else
-        return schedule_heuristic(request, worker_states, confidence);
 #endif
+        
+        (void)batch;
+        (void)worker_states;
+        request_stride = 0;
+        return nullptr;
     }
     
     /**
-     * 从分位数估计计算 CVaR
+     * 根据各 Worker 的延迟分位数选择风险最小的 Worker
+     * 
+     * @param quantiles [num_workers][kNumQuantileSamples]
+     * @param assigned 本批已分配到各 Worker 的请求的预计服务时间之和 (ns，单请求调度时为 nullptr)
      */
-    CVaREstimate compute_cvar_from_quantiles(
-        [[maybe_unused]] const torch::Tensor& quantiles,
-        [[maybe_unused]] size_t worker_idx
+    uint8_t select_min_risk(
+        const ClientRequest& request,
+        const std::vector<WorkerState>& worker_states,
+        const float* quantiles,
+        const double* assigned,
+        Timestamp now,
+        double& confidence
     ) {
-        CVaREstimate result{0.0, 0.0, 0.0};
+        Duration slack = static_cast<Duration>(request.deadline - now);
         
-#ifdef USE_LIBTORCH
-        auto worker_quantiles = quantiles[0][worker_idx].contiguous();
-        auto q = worker_quantiles.accessor<float, 1>();
+        // 一次算出所有 Worker 的 CVaR
+        cvar_estimates_.resize(worker_states.size());
+        compute_cvar_batch(quantiles, worker_states.size(), kNumQuantileSamples,
+                           cvar_alpha_, cvar_estimates_.data());
         
-        // 排序分位数值
-        std::vector<float> sorted_q;
-        for (size_t i = 0; i < kNumQuantileSamples; ++i) {
-            sorted_q.push_back(q[i]);
+        uint8_t best_worker = 0;
+        double min_risk = std::numeric_limits<double>::max();
+        
+        for (size_t w = 0; w < worker_states.size(); ++w) {
+            const auto& ws = worker_states[w];
+            if (!ws.is_healthy) continue;
+            
+            CVaREstimate cvar = cvar_estimates_[w];
+            
+            // 本批已分配到该 Worker 的请求排在本请求之前，整个延迟分布右移它们的服务时间
+            if (assigned && assigned[w] > 0.0) {
+                cvar.mean += assigned[w];
+                cvar.cvar += assigned[w];
+            }
+            
+            // 考虑 deadline 约束
+            double risk_score = cvar.cvar + compute_deadline_penalty(cvar, slack);
+            
+            if (risk_score < min_risk) {
+                min_risk = risk_score;
+                best_worker = static_cast<uint8_t>(w);
+            }
+        }
+        
+        confidence = 1.0 / (1.0 + min_risk / 1e6);  // 归一化置信度
+        return best_worker;
+    }
+    
+    /// 请求的预计服务时间 (ns)，请求未给出时用该 Worker 的平均服务时间
+    static double expected_service_ns(const ClientRequest& request, const WorkerState& ws) {
+        if (request.expected_service_us > 0) {
+            return static_cast<double>(us_to_ns(request.expected_service_us));
         }
-        std::sort(sorted_q.begin(), sorted_q.end());
-        
-        // 计算均值
-        result.mean = std::accumulate(sorted_q.begin(), sorted_q.end(), 0.0f) 
-                     / kNumQuantileSamples;
-        
-        // VaR: alpha 分位数
-        size_t var_idx = static_cast<size_t>(cvar_alpha_ * kNumQuantileSamples);
-        result.var = sorted_q[var_idx];
-        
-        // CVaR: VaR 以上的平均值
-        double cvar_sum = 0.0;
-        size_t cvar_count = 0;
-        for (size_t i = var_idx; i < kNumQuantileSamples; ++i) {
-            cvar_sum += sorted_q[i];
-            ++cvar_count;
+        return static_cast<double>(ws.avg_service_time);
+    }
+    
+#ifdef USE_NATIVE_INFERENCE
+    /// 状态维度 / Worker 数与导出模型不一致时回退启发式 (只报告一次)
+    bool native_input_ok(size_t state_dim, size_t num_workers) {
+        if (state_dim == native_model_.input_dim() &&
+            num_workers <= native_model_.num_outputs()) {
+            return true;
         }
-        result.cvar = cvar_count > 0 ? cvar_sum / cvar_count : result.var;
+        if (!native_mismatch_reported_) {
+            fprintf(stderr, "[Malcolm-Strict] Native model expects state_dim=%zu, %zu workers; "
+                    "got state_dim=%zu, %zu workers. Falling back to heuristic\n",
+                    native_model_.input_dim(), native_model_.num_outputs(),
+                    state_dim, num_workers);
+            native_mismatch_reported_ = true;
+        }
+        return false;
+    }
 #endif
-        
-        return result;
+    
+#ifdef USE_LIBTORCH
+    /// 模型输出不是 [batch, >= num_workers, kNumQuantileSamples] 时回退启发式 (只报告一次)
+    bool torch_output_ok(const torch::Tensor& output, size_t batch, size_t num_workers) {
+        if (output.dim() == 3 && output.scalar_type() == torch::kFloat32 &&
+            output.size(0) == static_cast<int64_t>(batch) &&
+            output.size(1) >= static_cast<int64_t>(num_workers) &&
+            output.size(2) == static_cast<int64_t>(kNumQuantileSamples)) {
+            return true;
+        }
+        if (!torch_mismatch_reported_) {
+            std::string shape;
+            for (int64_t d = 0; d < output.dim(); ++d) {
+                shape += (d ? ", " : "") + std::to_string(output.size(d));
+            }
+            fprintf(stderr, "[Malcolm-Strict] Model output [%s] does not match "
+                    "[%zu, >= %zu workers, %zu quantiles]. Falling back to heuristic\n",
+                    shape.c_str(), batch, num_workers, kNumQuantileSamples);
+            torch_mismatch_reported_ = true;
+        }
+        return false;
     }
+#endif
     
     /**
      * 计算 Deadline 违约惩罚 (Barrier Function)
@@ -327,41 +556,45 @@ private:
      * - 请求特征
      * - 各 Worker 的松弛时间直方图
      * - 各 Worker 的基本状态
+     * 
+     * Worker 段由 features_ 常驻并增量维护，每次调度只写入 kRequestFeatures 个请求特征。
+     * 返回的指针在下一次调用前有效，长度为 features_.size()
      */
-    std::vector<float> build_state_vector(
+    const float* prepare_features(
         const ClientRequest& request,
         const std::vector<WorkerState>& worker_states
     ) {
-        std::vector<float> state;
-        state.reserve(128);  // 预分配
+        features_.sync(worker_states, encode_worker_features);
         
-        // 请求特征
-        state.push_back(static_cast<float>(request.type));
-        state.push_back(static_cast<float>(request.payload_size) / 1000.0f);
-        state.push_back(static_cast<float>(request.expected_service_us) / 100.0f);
+        float* out = features_.request_features();
+        out[0] = static_cast<float>(request.type);
+        out[1] = static_cast<float>(request.payload_size) / 1000.0f;
+        out[2] = static_cast<float>(request.expected_service_us) / 100.0f;
         
         // 计算到 deadline 的剩余时间
         Duration slack = static_cast<Duration>(request.deadline - now_ns());
-        state.push_back(static_cast<float>(slack) / 1e6f);  // 归一化到毫秒
-        
-        // 各 Worker 状态
-        for (const auto& ws : worker_states) {
-            // 基本状态
-            state.push_back(static_cast<float>(ws.load_ema));
-            state.push_back(static_cast<float>(ws.queue_length) / 100.0f);
-            state.push_back(static_cast<float>(ws.capacity_factor));
-            state.push_back(static_cast<float>(ws.avg_service_time) / 1e6f);
-            state.push_back(static_cast<float>(ws.p99_latency) / 1e6f);
-            state.push_back(static_cast<float>(ws.deadline_miss_rate));
-            state.push_back(ws.is_healthy ? 1.0f : 0.0f);
-            
-            // 松弛时间直方图 (关键特征!)
-            for (size_t b = 0; b < constants::kSlackHistogramBins; ++b) {
-                state.push_back(static_cast<float>(ws.slack_histogram[b]) / 100.0f);
-            }
-        }
+        out[3] = static_cast<float>(slack) / 1e6f;  // 归一化到毫秒
+        
+        return features_.data();
+    }
+    
+    /**
+     * 编码单个 Worker 的特征段 (kWorkerFeatures 个 float)
+     */
+    static void encode_worker_features(const WorkerState& ws, float* out) {
+        // 基本状态
+        out[0] = static_cast<float>(ws.load_ema);
+        out[1] = static_cast<float>(ws.queue_length) / 100.0f;
+        out[2] = static_cast<float>(ws.capacity_factor);
+        out[3] = static_cast<float>(ws.avg_service_time) / 1e6f;
+        out[4] = static_cast<float>(ws.p99_latency) / 1e6f;
+        out[5] = static_cast<float>(ws.deadline_miss_rate);
+        out[6] = ws.is_healthy ? 1.0f : 0.0f;
         
-        return state;
+        // 松弛时间直方图 (关键特征!)
+        for (size_t b = 0; b < constants::kSlackHistogramBins; ++b) {
+            out[7 + b] = static_cast<float>(ws.slack_histogram[b]) / 100.0f;
+        }
     }
     
     /**
@@ -408,11 +641,27 @@ private:
     
 private:
     double cvar_alpha_;
-    bool model_loaded_ = false;
+    bool model_loaded_ = false;    // LibTorch 模型
+    bool native_loaded_ = false;   // 原生 SIMD 模型
     std::vector<float> quantile_samples_;
+    StateFeatureBuffer features_;  // 模型输入 (Worker 段增量更新)
+    
+    // 批量调度缓冲区 (复用容量)
+    std::vector<float> batch_states_;
+    std::vector<size_t> batch_order_;
+    std::vector<double> batch_assigned_;   // 本批已分配到各 Worker 的预计服务时间 (ns)
+    std::vector<CVaREstimate> cvar_estimates_;
     
 #ifdef USE_LIBTORCH
     torch::jit::script::Module model_;
+    torch::Tensor batch_output_;
+    bool torch_mismatch_reported_ = false;
+#endif
+
+#ifdef USE_NATIVE_INFERENCE
+    NativeIQNModel native_model_;
+    std::vector<float> native_output_;   // [B][num_outputs][kNumQuantileSamples]
+    bool native_mismatch_reported_ = false;
 #endif
 };
 
@@ -1,103 +1,204 @@
 #pragma once
 
 /**
- * Power-of-2 Choices 调度器
- * 
+ * Power-of-d Choices 调度器
+ *
  * Baseline 1: 随机探针，贪婪选择
- * 
+ *
  * 算法:
- * 1. 随机选择 2 个候选 Worker
- * 2. 选择负载更低的那个
- * 
+ * 1. 从健康 Worker 中无放回地随机选择 d 个候选 (默认 d = 2)
+ * 2. 按负载指标选择负载最低的那个
+ *
  * 预期表现:
  * - 在同构环境下表现良好
  * - 在异构环境下出现严重的长尾效应
+ *
+ * 实现: 候选放在栈上，随机数用 xoshiro256** + Lemire 无偏有界采样，
+ * 调度路径不分配内存、不加锁，避免 baseline 被分配器噪声拖累。
  */
 
 #include "scheduler.h"
+#include <array>
 #include <random>
 #include <algorithm>
 
 namespace malcolm {
 
+/**
+ * xoshiro256** 伪随机数生成器 (splitmix64 播种)
+ */
+class Xoshiro256 {
+public:
+    explicit Xoshiro256(uint64_t seed) { this->seed(seed); }
+
+    void seed(uint64_t seed) {
+        for (auto& s : s_) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            s = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s_[1] * 5, 7) * 9;
+        uint64_t t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+    /// [0, range) 内均匀分布 (Lemire 乘法 + 拒绝，range 须 > 0)
+    uint32_t bounded(uint32_t range) {
+        uint64_t m = (next() >> 32) * range;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < range) {
+            uint32_t threshold = (0u - range) % range;
+            while (low < threshold) {
+                m = (next() >> 32) * range;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::array<uint64_t, 4> s_;
+};
+
 class Po2Scheduler : public Scheduler {
 public:
-    explicit Po2Scheduler(size_t num_choices = 2)
-        : num_choices_(num_choices),
-          rng_(std::random_device{}()) {}
-    
+    static constexpr size_t kMaxChoices = 8;
+    static constexpr size_t kMaxWorkers = 256;     // worker_id 为 uint8_t
+    static constexpr size_t kRejectionRounds = 4;  // 拒绝采样最多尝试 d × 4 次
+
+    explicit Po2Scheduler(
+        size_t num_choices = 2,
+        LoadMetric metric = LoadMetric::kLoadEma,
+        uint64_t seed = std::random_device{}()
+    ) : num_choices_(std::clamp<size_t>(num_choices, 1, kMaxChoices)),
+        metric_(metric),
+        rng_(seed) {}
+
     ScheduleDecision schedule(
         const ClientRequest& request,
         const std::vector<WorkerState>& worker_states
     ) override {
         (void)request;  // Po2 不关心请求内容
-        
+
         Timestamp start = now_ns();
-        
-        if (worker_states.empty()) {
+
+        size_t num_workers = std::min(worker_states.size(), kMaxWorkers);
+        std::array<uint8_t, kMaxChoices> candidates;
+        size_t k = sample_candidates(worker_states, num_workers, candidates);
+
+        if (k == 0) {
+            // 没有健康 Worker
             return {0, 0.0, now_ns() - start};
         }
-        
-        size_t num_workers = worker_states.size();
-        
-        // 随机选择 num_choices_ 个候选
-        std::vector<size_t> candidates;
-        candidates.reserve(num_choices_);
-        
-        std::uniform_int_distribution<size_t> dist(0, num_workers - 1);
-        
-        for (size_t i = 0; i < num_choices_; ++i) {
-            size_t idx = dist(rng_);
-            // 避免重复选择同一个 Worker
-            bool duplicate = false;
-            for (size_t c : candidates) {
-                if (c == idx) {
-                    duplicate = true;
-                    break;
-                }
-            }
-            if (!duplicate || candidates.size() < num_choices_) {
-                candidates.push_back(idx);
-            }
-        }
-        
+
         // 选择负载最低的候选
         size_t best_idx = candidates[0];
-        double best_load = worker_states[candidates[0]].load_ema;
-        
-        for (size_t i = 1; i < candidates.size(); ++i) {
-            size_t idx = candidates[i];
-            const auto& state = worker_states[idx];
-            
-            // 跳过不健康的 Worker
-            if (!state.is_healthy) continue;
-            
-            double load = state.load_ema;
+        double best_load = load_of(worker_states[best_idx]);
+
+        for (size_t i = 1; i < k; ++i) {
+            double load = load_of(worker_states[candidates[i]]);
             if (load < best_load) {
                 best_load = load;
-                best_idx = idx;
+                best_idx = candidates[i];
             }
         }
-        
+
         ScheduleDecision decision;
         decision.target_worker_id = static_cast<uint8_t>(best_idx);
-        decision.confidence = 1.0 - best_load;  // 负载越低置信度越高
+        decision.confidence = 1.0 - worker_states[best_idx].load_ema;  // 负载越低置信度越高
         decision.decision_time = now_ns() - start;
-        
+
         return decision;
     }
-    
+
     std::string name() const override {
-        return "Power-of-" + std::to_string(num_choices_);
+        std::string name = "Power-of-" + std::to_string(num_choices_);
+        if (metric_ != LoadMetric::kLoadEma) {
+            name += std::string(" (") + load_metric_name(metric_) + ")";
+        }
+        return name;
     }
-    
+
     SchedulerType type() const override {
         return SchedulerType::kPowerOf2;
     }
-    
+
+    /// 重新播种 (模拟器等需要可复现结果的场景)
+    void set_seed(uint64_t seed) { rng_.seed(seed); }
+
 private:
+    double load_of(const WorkerState& ws) const {
+        switch (metric_) {
+            case LoadMetric::kQueueLength:
+                return static_cast<double>(ws.queue_length);
+            case LoadMetric::kOutstandingWork:
+                // 在途请求 (排队 + 执行中，含本次) × 该 Worker 的平均服务时间;
+                // (queue_length 只是等待队列，线程全忙而队列为空的 Worker 会被当成零负载)
+                return (ws.active_requests + 1.0) * static_cast<double>(ws.avg_service_time);
+            case LoadMetric::kLoadEma:
+            default:
+                return ws.load_ema;
+        }
+    }
+
+    static bool contains(const std::array<uint8_t, kMaxChoices>& c, size_t k, size_t idx) {
+        for (size_t i = 0; i < k; ++i) {
+            if (c[i] == idx) return true;
+        }
+        return false;
+    }
+
+    /**
+     * 从健康 Worker 中无放回均匀抽取 min(d, 健康数) 个候选，返回抽到的个数
+     *
+     * 多数 Worker 健康时拒绝采样期望 O(d); 健康 Worker 很少 (或 d 接近健康数) 时
+     * 改为枚举剩余健康 Worker 做部分 Fisher-Yates，两段合起来仍是均匀的无放回抽样。
+     */
+    size_t sample_candidates(const std::vector<WorkerState>& worker_states, size_t num_workers,
+                             std::array<uint8_t, kMaxChoices>& candidates) {
+        if (num_workers == 0) return 0;
+
+        uint32_t range = static_cast<uint32_t>(num_workers);
+        size_t k = 0;
+        for (size_t attempt = 0; k < num_choices_ && attempt < num_choices_ * kRejectionRounds;
+             ++attempt) {
+            uint32_t idx = rng_.bounded(range);
+            if (!worker_states[idx].is_healthy || contains(candidates, k, idx)) continue;
+            candidates[k++] = static_cast<uint8_t>(idx);
+        }
+        if (k == num_choices_) return k;
+
+        std::array<uint8_t, kMaxWorkers> pool;
+        uint32_t m = 0;
+        for (size_t i = 0; i < num_workers; ++i) {
+            if (worker_states[i].is_healthy && !contains(candidates, k, i)) {
+                pool[m++] = static_cast<uint8_t>(i);
+            }
+        }
+        while (k < num_choices_ && m > 0) {
+            uint32_t j = rng_.bounded(m);
+            candidates[k++] = pool[j];
+            pool[j] = pool[--m];
+        }
+        return k;
+    }
+
     size_t num_choices_;
-    std::mt19937 rng_;
+    LoadMetric metric_;
+    Xoshiro256 rng_;
 };
 
 }  // namespace malcolm
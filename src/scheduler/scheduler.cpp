@@ -0,0 +1,47 @@
+#include "scheduler.h"
+#include "po2_scheduler.h"
+#include "malcolm_scheduler.h"
+#include "malcolm_strict_scheduler.h"
+
+namespace malcolm {
+
+void Scheduler::schedule_batch(
+    const std::vector<ClientRequest>& requests,
+    const std::vector<WorkerState>& worker_states,
+    std::vector<ScheduleDecision>& decisions
+) {
+    decisions.clear();
+    batch_view_ = worker_states;
+    
+    for (const auto& request : requests) {
+        ScheduleDecision decision = schedule(request, batch_view_);
+        decisions.push_back(decision);
+        
+        // 与 LB 派发路径相同的负载估计更新
+        auto& ws = batch_view_[decision.target_worker_id];
+        ws.queue_length++;
+        ws.active_requests++;
+        ws.update_load_ema(ws.queue_length);
+        update_worker_state(decision.target_worker_id, ws);
+    }
+}
+
+std::unique_ptr<Scheduler> SchedulerFactory::create(
+    SchedulerType type,
+    const std::string& model_path,
+    size_t po2_choices,
+    LoadMetric po2_metric
+) {
+    switch (type) {
+        case SchedulerType::kPowerOf2:
+            return std::make_unique<Po2Scheduler>(po2_choices, po2_metric);
+        case SchedulerType::kMalcolm:
+            // 给定模型时使用模型推理，否则使用启发式
+            return std::make_unique<MalcolmScheduler>(model_path, model_path.empty());
+        case SchedulerType::kMalcolmStrict:
+            return std::make_unique<MalcolmStrictScheduler>(model_path);
+    }
+    return std::make_unique<Po2Scheduler>();
+}
+
+}  // namespace malcolm
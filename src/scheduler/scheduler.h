@@ -43,9 +43,30 @@ public:
         const std::vector<WorkerState>& worker_states
     ) = 0;
     
+    /**
+     * 为一批请求选择目标 Worker
+     * 
+     * LB 把同一轮事件循环中到达的请求攒成一批调用此接口。
+     * 默认实现逐个调用 schedule()，并在本地视图上累加每次分配带来的负载，
+     * 使同一批内的后续请求能看到前面的分配 (同时经 update_worker_state() 通知调度器)。
+     * 学习型调度器可重写为单次批量推理。
+     * 
+     * @param requests 本批请求
+     * @param worker_states 所有 Worker 的状态 (批开始时的快照)
+     * @param decisions 输出，与 requests 一一对应；decision_time 为均摊到每个请求的耗时
+     */
+    virtual void schedule_batch(
+        const std::vector<ClientRequest>& requests,
+        const std::vector<WorkerState>& worker_states,
+        std::vector<ScheduleDecision>& decisions
+    );
+    
     /**
      * 更新 Worker 状态 (可选，用于学习型调度器)
      * 
+     * LB 在同步到 Worker 状态变化时调用，学习型调度器借此增量维护模型输入特征。
+     * 一旦收到过推送，调用方需保证之后每次变化都会推送。
+     * 
      * @param worker_id Worker ID
      * @param new_state 新状态
      */
@@ -72,6 +93,10 @@ public:
      * 获取调度器类型
      */
     virtual SchedulerType type() const = 0;
+    
+protected:
+    // schedule_batch 默认实现使用的本地视图 (复用容量，避免每批分配)
+    std::vector<WorkerState> batch_view_;
 };
 
 /**
@@ -79,9 +104,12 @@ public:
  */
 class SchedulerFactory {
 public:
+    /// po2_choices / po2_metric 只对 Power-of-d 生效
     static std::unique_ptr<Scheduler> create(
         SchedulerType type,
-        const std::string& model_path = ""
+        const std::string& model_path = "",
+        size_t po2_choices = 2,
+        LoadMetric po2_metric = LoadMetric::kLoadEma
     );
 };
 
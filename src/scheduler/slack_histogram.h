@@ -0,0 +1,177 @@
+#pragma once
+
+/**
+ * 增量维护的松弛时间直方图
+ *
+ * 直方图定义 (与 WorkerState::slack_histogram 一致):
+ *   桶 0       : 已过期 (slack <= 0)
+ *   桶 k (>=1) : slack 落在第 k 个 kSlackBinWidth 窗口
+ *   最后一桶   : 其余更远的任务
+ *
+ * 实现: 按 deadline 所在的绝对时间窗口 (纪元 = deadline / kSlackBinWidth) 计数，
+ * kRingSlots 个槽位组成环形数组。时间推进时直方图整体"左移"不需要搬动任何计数，
+ * 读取时按当前纪元取相应槽位即可 (滚动数组)。
+ * - 每个槽位是一个 64 位原子量: 高位为纪元标签，低 kCountBits 位为计数。
+ *   标签不等于任务纪元说明该纪元已被淘汰 (并入 expired_)，出队时改减 expired_
+ * - 写者 (入队/出队) 顺带把已过去的纪元并入 expired_，均摊每 100μs 一次
+ * - 超出环形范围的 deadline 记在范围内最远的纪元 (只影响最后一桶)
+ *
+ * 线程安全: 入队/出队可多线程并发 (CAS)，读取无锁、O(kSlackHistogramBins)。
+ * 读取结果是近似快照，与并发的入队/出队不保证严格一致。
+ * add() 返回任务所在纪元，调用方保存 (如 Task::slack_epoch)，出队时传给 remove()。
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "../common/types.h"
+
+namespace malcolm {
+
+class SlackHistogram {
+public:
+    static constexpr size_t kRingSlots = 256;      // 256 × 100μs = 25.6ms
+    static constexpr size_t kCountBits = 24;
+    static constexpr uint64_t kCountMask = (uint64_t{1} << kCountBits) - 1;
+
+    SlackHistogram() {
+        uint64_t epoch = epoch_of(now_ns());
+        rolled_epoch_.store(epoch, std::memory_order_relaxed);
+        // 每个槽位的初始标签为它在当前环内对应的纪元
+        for (size_t i = 0; i < kRingSlots; ++i) {
+            uint64_t e = epoch + ((i + kRingSlots - epoch % kRingSlots) % kRingSlots);
+            slots_[i].store(pack(e, 0), std::memory_order_relaxed);
+        }
+    }
+
+    // 禁用拷贝
+    SlackHistogram(const SlackHistogram&) = delete;
+    SlackHistogram& operator=(const SlackHistogram&) = delete;
+
+    /// 任务入队，返回其纪元 (出队时传给 remove())
+    uint64_t add(Timestamp deadline, Timestamp now) {
+        uint64_t current = epoch_of(now);
+        roll(current);
+
+        uint64_t epoch = std::min<uint64_t>(epoch_of(deadline), current + kRingSlots - 1);
+        total_.fetch_add(1, std::memory_order_relaxed);
+
+        if (epoch < rolled_epoch_.load(std::memory_order_relaxed)) {
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            return epoch;
+        }
+
+        auto& slot = slots_[epoch % kRingSlots];
+        uint64_t v = slot.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t tag = tag_of(v);
+            if (tag > epoch) {
+                // 该槽位已属于更晚的纪元，说明本任务的纪元已过去
+                expired_.fetch_add(1, std::memory_order_relaxed);
+                return epoch;
+            }
+            uint64_t count = tag == epoch ? count_of(v) + 1 : 1;
+            if (slot.compare_exchange_weak(v, pack(epoch, count), std::memory_order_relaxed)) {
+                if (tag < epoch) {
+                    // 淘汰旧纪元: 其计数并入已过期
+                    expired_.fetch_add(static_cast<int64_t>(count_of(v)), std::memory_order_relaxed);
+                }
+                return epoch;
+            }
+        }
+    }
+
+    /// 任务出队 (epoch 为 add() 的返回值)
+    void remove(uint64_t epoch, Timestamp now) {
+        roll(epoch_of(now));
+        total_.fetch_sub(1, std::memory_order_relaxed);
+
+        auto& slot = slots_[epoch % kRingSlots];
+        uint64_t v = slot.load(std::memory_order_relaxed);
+        while (tag_of(v) == epoch && count_of(v) > 0) {
+            if (slot.compare_exchange_weak(v, v - 1, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        expired_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /// 无锁读取，O(kSlackHistogramBins); 队列为空时直接返回全 0
+    void snapshot(Timestamp now,
+                  std::array<uint32_t, constants::kSlackHistogramBins>& hist) const {
+        constexpr size_t kBins = constants::kSlackHistogramBins;
+        if (total_.load(std::memory_order_relaxed) <= 0) {
+            // 空队列时 rolled_epoch_ 不再推进，下面补算过期纪元的循环最长要扫完整个环
+            hist.fill(0);
+            return;
+        }
+        uint64_t current = epoch_of(now);
+        uint64_t rolled = rolled_epoch_.load(std::memory_order_relaxed);
+
+        // 桶 0: 已并入 expired_ 的任务 + 尚未滚动的已过去纪元 (通常 0~1 个)
+        int64_t expired = expired_.load(std::memory_order_relaxed);
+        for (uint64_t e = rolled; e < current && e < rolled + kRingSlots; ++e) {
+            expired += count_at(e);
+        }
+        int64_t remaining = total_.load(std::memory_order_relaxed) - expired;
+        hist[0] = static_cast<uint32_t>(std::max<int64_t>(expired, 0));
+
+        // 桶 1..kBins-2: 当前及之后各纪元; 最后一桶: 其余
+        for (size_t b = 1; b + 1 < kBins; ++b) {
+            uint64_t n = count_at(current + b - 1);
+            hist[b] = static_cast<uint32_t>(n);
+            remaining -= static_cast<int64_t>(n);
+        }
+        hist[kBins - 1] = static_cast<uint32_t>(std::max<int64_t>(remaining, 0));
+    }
+
+    /// 在队任务数
+    size_t size() const {
+        return static_cast<size_t>(std::max<int64_t>(total_.load(std::memory_order_relaxed), 0));
+    }
+
+private:
+    static uint64_t epoch_of(Timestamp t) { return t / constants::kSlackBinWidth; }
+    static uint64_t pack(uint64_t epoch, uint64_t count) { return (epoch << kCountBits) | count; }
+    static uint64_t tag_of(uint64_t v) { return v >> kCountBits; }
+    static uint64_t count_of(uint64_t v) { return v & kCountMask; }
+
+    uint64_t count_at(uint64_t epoch) const {
+        uint64_t v = slots_[epoch % kRingSlots].load(std::memory_order_relaxed);
+        return tag_of(v) == epoch ? count_of(v) : 0;
+    }
+
+    /**
+     * 把 [rolled_epoch_, current) 内的纪元并入 expired_ (由写者顺带执行)
+     *
+     * 淘汰时标签推进一整圈，之后该纪元任务的出队会改减 expired_
+     */
+    void roll(uint64_t current) {
+        uint64_t rolled = rolled_epoch_.load(std::memory_order_relaxed);
+        if (rolled >= current ||
+            !rolled_epoch_.compare_exchange_strong(rolled, current, std::memory_order_relaxed)) {
+            return;
+        }
+        uint64_t end = std::min<uint64_t>(current, rolled + kRingSlots);
+        for (uint64_t e = rolled; e < end; ++e) {
+            auto& slot = slots_[e % kRingSlots];
+            uint64_t v = slot.load(std::memory_order_relaxed);
+            while (tag_of(v) < current) {
+                if (slot.compare_exchange_weak(v, pack(tag_of(v) + kRingSlots, 0),
+                                               std::memory_order_relaxed)) {
+                    expired_.fetch_add(static_cast<int64_t>(count_of(v)), std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+    }
+
+    alignas(64) std::array<std::atomic<uint64_t>, kRingSlots> slots_;
+    alignas(64) std::atomic<uint64_t> rolled_epoch_{0};   // 之前的纪元都已并入 expired_
+    std::atomic<int64_t> expired_{0};
+    std::atomic<int64_t> total_{0};
+};
+
+}  // namespace malcolm
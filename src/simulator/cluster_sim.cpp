@@ -0,0 +1,496 @@
+/**
+ * 离散事件集群模拟器实现
+ */
+
+#include "cluster_sim.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+#include "../common/rpc_types.h"
+#include "../scheduler/po2_scheduler.h"
+
+namespace malcolm {
+
+namespace {
+
+std::shared_ptr<const std::vector<Timestamp>> load_trace_if_needed(const ArrivalConfig& config) {
+    if (config.pattern != ArrivalPattern::kTrace) {
+        return nullptr;
+    }
+    auto trace = std::make_shared<std::vector<Timestamp>>(load_arrival_trace(config.trace_path));
+    if (trace->empty()) {
+        fprintf(stderr, "[Sim] Cannot load arrival trace %s, falling back to deterministic\n",
+                config.trace_path.c_str());
+    }
+    return trace;
+}
+
+}  // namespace
+
+ClusterSimulator::ClusterSimulator(const SimConfig& config)
+    : config_(config),
+      scheduler_(SchedulerFactory::create(config.algorithm, config.model_path,
+                                          config.po2_choices, config.po2_metric)),
+      generator_(config.workload),
+      arrivals_(config.arrival, config.target_rps, config.seed, load_trace_if_needed(config.arrival)) {
+    if (config_.workers.empty() || config_.workers.size() > 256) {
+        throw std::invalid_argument("Simulator needs 1..256 workers");
+    }
+    generator_.set_seed(config_.seed);
+    if (auto* po2 = dynamic_cast<Po2Scheduler*>(scheduler_.get())) {
+        po2->set_seed(config_.seed);   // 随机探针也由 --seed 决定，结果可复现
+    }
+
+    // LB 视图的初始状态与 LBContext 一致
+    view_.assign(config_.workers.size(), WorkerState{});
+    for (size_t i = 0; i < view_.size(); ++i) {
+        auto& ws = view_[i];
+        ws.worker_id = static_cast<uint8_t>(i);
+        ws.address = "sim:" + std::to_string(i);
+        ws.is_healthy = true;
+        ws.capacity_factor = 1.0;
+        ws.load_ema = 0.0;
+        ws.queue_length = 0;
+        std::memset(ws.slack_histogram, 0, sizeof(ws.slack_histogram));
+    }
+
+    // SlackHistogram 以构造时的 now_ns() 为起点，须在 run() 取模拟时钟起点之前创建
+    workers_.resize(config_.workers.size());
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].config = config_.workers[i];
+        workers_[i].config.num_threads = std::max<size_t>(workers_[i].config.num_threads, 1);
+        workers_[i].slack = std::make_unique<SlackHistogram>();
+    }
+
+    size_t expected_inflight = static_cast<size_t>(config_.target_rps * 1e-3) + 1024;
+    records_.reserve(expected_inflight);
+    free_records_.reserve(expected_inflight);
+    events_.reserve(expected_inflight);
+}
+
+ClusterSimulator::~ClusterSimulator() = default;
+
+uint32_t ClusterSimulator::alloc_record() {
+    if (!free_records_.empty()) {
+        uint32_t id = free_records_.back();
+        free_records_.pop_back();
+        return id;
+    }
+    records_.emplace_back();
+    return static_cast<uint32_t>(records_.size() - 1);
+}
+
+void ClusterSimulator::push_event(Timestamp time, uint32_t id, EventKind kind) {
+    events_.push_back({time, id, kind});
+    std::push_heap(events_.begin(), events_.end(), std::greater<Event>());
+}
+
+SimStats ClusterSimulator::run() {
+    base_ = now_ns();
+    warmup_end_ = base_ + config_.warmup_ns;
+    end_time_ = base_ + config_.duration_ns;
+    lb_free_at_.assign(std::max<size_t>(config_.lb_dispatchers, 1), base_);
+    lb_next_free_ = base_;
+    last_dispatch_ = base_;
+    next_send_ = base_ + arrivals_.next();
+    sending_ = next_send_ < end_time_;
+
+    // 各 Worker 的周期推送错开相位
+    if (config_.state_push_interval_ns > 0) {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i].last_push = base_;
+            push_event(base_ + config_.state_push_interval_ns * (i + 1) / workers_.size(),
+                       static_cast<uint32_t>(i), EventKind::kStatePush);
+        }
+    }
+
+    enum Source { kNone, kClientRecv, kLBRecv, kHeap, kWorkerRecv, kLBSchedule, kClientSend };
+
+    Timestamp wall_start = now_ns();
+    Timestamp now = base_;
+    while (true) {
+        // 取最早的事件源; 同一时刻按上面枚举的顺序 (先交付消息、再完成计算，最后发送新请求)
+        Timestamp t = UINT64_MAX;
+        Source source = kNone;
+        auto consider = [&](Timestamp when, Source s) {
+            if (when < t) {
+                t = when;
+                source = s;
+            }
+        };
+        if (!lb_to_client_.empty()) consider(lb_to_client_.front().arrive, kClientRecv);
+        if (!worker_to_lb_.empty()) consider(worker_to_lb_.front().arrive, kLBRecv);
+        if (!events_.empty()) consider(events_.front().time, kHeap);
+        if (!lb_to_worker_.empty()) consider(lb_to_worker_.front().arrive, kWorkerRecv);
+        if (!client_to_lb_.empty()) {
+            // 派发线程全忙时请求在 LB 排队
+            consider(std::max(client_to_lb_.front().arrive, lb_next_free_), kLBSchedule);
+        }
+        if (sending_) consider(next_send_, kClientSend);
+
+        if (source == kNone) {
+            break;
+        }
+        now = t;
+        ++stats_.events;
+
+        switch (source) {
+            case kClientRecv:
+                on_client_receive(now);
+                break;
+            case kLBRecv:
+                on_lb_receive(now);
+                break;
+            case kHeap: {
+                std::pop_heap(events_.begin(), events_.end(), std::greater<Event>());
+                Event ev = events_.back();
+                events_.pop_back();
+                if (ev.kind == EventKind::kCompletion) {
+                    on_completion(now, ev.id);
+                } else {
+                    on_state_push_timer(now, ev.id);
+                }
+                break;
+            }
+            case kWorkerRecv:
+                on_worker_receive(now);
+                break;
+            case kLBSchedule:
+                on_lb_schedule(now);
+                break;
+            case kClientSend:
+                on_client_send(now);
+                break;
+            case kNone:
+                break;
+        }
+    }
+
+    stats_.wall_seconds = static_cast<double>(now_ns() - wall_start) / 1e9;
+    stats_.sim_time_ns = now - base_;
+    return stats_;
+}
+
+void ClusterSimulator::on_client_send(Timestamp now) {
+    uint32_t id = alloc_record();
+    Record& r = records_[id];
+    r.kind = RecordKind::kRequest;
+    r.req = generator_.generate();
+    // 截止时间从计划发送时间起算 (与 Client 一致)
+    r.req.deadline = now + (r.req.deadline - r.req.client_send_time);
+    r.req.client_send_time = now;
+
+    client_to_lb_.push({now + config_.net_delay_ns, id});
+    ++outstanding_;
+    ++stats_.generated;
+
+    next_send_ = base_ + arrivals_.next();
+    sending_ = next_send_ < end_time_;
+}
+
+void ClusterSimulator::on_lb_schedule(Timestamp now) {
+    InFlight msg = client_to_lb_.pop();
+    Record& r = records_[msg.id];
+    r.t2_lb_receive = msg.arrive;
+
+    // 调度器按 deadline - now_ns() 计算 slack: 把时间戳平移到墙上时钟
+    // (模 2^64 运算，模拟时间超前于墙上时钟时同样成立)
+    ClientRequest request = r.req;
+    Timestamp shift = now_ns() - now;
+    request.deadline += shift;
+    request.client_send_time += shift;
+
+    ScheduleDecision decision = scheduler_->schedule(request, view_);
+    uint8_t target = decision.target_worker_id < view_.size() ? decision.target_worker_id : 0;
+    if (now >= warmup_end_) {
+        scheduling_latency_.record(static_cast<int64_t>(decision.decision_time));
+    }
+
+    Timestamp cost = config_.lb_cost_ns >= 0 ? static_cast<Timestamp>(config_.lb_cost_ns)
+                                             : decision.decision_time;
+    r.worker_id = target;
+
+    // 交给最早空闲的派发线程 (此时 lb_next_free_ <= now)。实测耗时下后开始的决策可能先结束，
+    // 延迟线要求按发送顺序到达，离开时刻取 max(本次完成, 上一个离开) (相差仅几十 ns)
+    auto dispatcher = std::min_element(lb_free_at_.begin(), lb_free_at_.end());
+    r.t3_lb_dispatch = std::max(now + cost, last_dispatch_);
+    last_dispatch_ = r.t3_lb_dispatch;
+    *dispatcher = now + cost;
+    lb_next_free_ = *std::min_element(lb_free_at_.begin(), lb_free_at_.end());
+
+    // 派发时按 LB 的推断更新队列长度 (与 LBContext 一致)
+    WorkerState& ws = view_[target];
+    ws.queue_length++;
+    ws.active_requests++;
+    ws.update_load_ema(ws.queue_length);
+    sync_worker_state(target);
+
+    lb_to_worker_.push({r.t3_lb_dispatch + config_.net_delay_ns, msg.id});
+}
+
+void ClusterSimulator::on_worker_receive(Timestamp now) {
+    uint32_t id = lb_to_worker_.pop().id;
+    Record& r = records_[id];
+    uint8_t worker_id = r.worker_id;
+    Worker& w = workers_[worker_id];
+    r.t4_worker_recv = now;
+    ++w.dispatched;
+
+    // 在途任务达到上限时立即回复失败 (与 Worker 的准入一致)
+    if (w.active >= config_.max_queue_size + w.config.num_threads) {
+        r.success = false;
+        r.service_ns = 0;
+        r.t5_worker_done = now;
+        ++w.rejected;
+        fill_digest(w, r, now);
+        worker_to_lb_.push({now + config_.net_delay_ns, id});
+        return;
+    }
+    r.success = true;
+    ++w.active;
+
+    if (w.busy_threads < w.config.num_threads) {
+        start_task(w, id, now);
+        return;
+    }
+
+    r.slack_epoch = w.slack->add(r.req.deadline, now);
+    if (config_.local_scheduler == LocalSchedulerType::kEDF) {
+        w.edf.emplace_back(r.req.deadline, id);
+        std::push_heap(w.edf.begin(), w.edf.end(), std::greater<>());
+    } else {
+        w.fcfs.push(id);
+    }
+    maybe_push_state(worker_id, now, false);
+}
+
+void ClusterSimulator::start_task(Worker& w, uint32_t id, Timestamp now) {
+    Record& r = records_[id];
+    ++w.busy_threads;
+    r.t_start = now;
+
+    uint32_t expected_us = r.req.expected_service_us > 0 ? r.req.expected_service_us : 10;
+    r.service_ns = modeled_service_time_ns(r.req.type, expected_us, w.config.capacity_factor);
+    // 人工延迟在计算之后注入，期间线程仍被占用
+    push_event(now + r.service_ns + w.config.artificial_delay_ns, id, EventKind::kCompletion);
+}
+
+void ClusterSimulator::on_completion(Timestamp now, uint32_t id) {
+    Record& r = records_[id];
+    uint8_t worker_id = r.worker_id;
+    Worker& w = workers_[worker_id];
+    --w.busy_threads;
+    --w.active;
+    ++w.completed;
+    w.busy_ns += now - r.t_start;
+    r.t5_worker_done = now;
+
+    // 空出的计算线程立即取下一个任务，响应捎带的摘要反映出队后的队列
+    bool dequeued = w.waiting() > 0;
+    if (dequeued) {
+        uint32_t next;
+        if (config_.local_scheduler == LocalSchedulerType::kEDF) {
+            std::pop_heap(w.edf.begin(), w.edf.end(), std::greater<>());
+            next = w.edf.back().second;
+            w.edf.pop_back();
+        } else {
+            next = w.fcfs.pop();
+        }
+        w.slack->remove(records_[next].slack_epoch, now);
+        start_task(w, next, now);
+    }
+
+    fill_digest(w, r, now);
+    worker_to_lb_.push({now + config_.net_delay_ns, id});
+
+    // 状态推送会分配记录，r 之后不再有效
+    if (dequeued) {
+        maybe_push_state(worker_id, now, false);
+    }
+}
+
+void ClusterSimulator::fill_digest(Worker& w, Record& r, Timestamp now) {
+    if (!config_.response_digest) {
+        return;
+    }
+    r.queue_length = static_cast<uint32_t>(std::min<size_t>(w.waiting(), UINT16_MAX));
+    r.active_requests = std::min<uint32_t>(w.active, UINT16_MAX);
+
+    // 响应里的松弛时间直方图经 encode_slack_count() 量化，LB 看到的是解码值
+    std::array<uint32_t, constants::kSlackHistogramBins> hist;
+    w.slack->snapshot(now, hist);
+    for (size_t b = 0; b < hist.size(); ++b) {
+        r.slack_histogram[b] = decode_slack_count(encode_slack_count(hist[b]));
+    }
+}
+
+void ClusterSimulator::on_state_push_timer(Timestamp now, uint32_t worker_id) {
+    // 请求全部完成后不再重排定时器，事件源耗尽即结束
+    if (!sending_ && outstanding_ == 0) {
+        return;
+    }
+    Worker& w = workers_[worker_id];
+    if (now >= w.last_push + config_.state_push_interval_ns) {
+        maybe_push_state(worker_id, now, true);
+    }
+    // 按需推送可能已把周期往后推; 上一次推送未确认时等到确认
+    Timestamp next = std::max(w.last_push + config_.state_push_interval_ns, w.push_ack_time);
+    push_event(std::max(next, now + 1), worker_id, EventKind::kStatePush);
+}
+
+void ClusterSimulator::maybe_push_state(uint32_t worker_id, Timestamp now, bool periodic) {
+    Worker& w = workers_[worker_id];
+    if (config_.state_push_interval_ns == 0 || now < w.push_ack_time) {
+        return;
+    }
+    uint32_t queue_len = static_cast<uint32_t>(w.waiting());
+    if (!periodic) {
+        uint32_t delta = queue_len > w.last_push_queue_length ? queue_len - w.last_push_queue_length
+                                                              : w.last_push_queue_length - queue_len;
+        if (config_.state_push_queue_delta == 0 || delta < config_.state_push_queue_delta) {
+            return;
+        }
+    }
+
+    w.push_load_ema = 0.1 * queue_len + 0.9 * w.push_load_ema;
+    w.last_push = now;
+    w.push_ack_time = now + 2 * config_.net_delay_ns;
+    w.last_push_queue_length = queue_len;
+
+    uint32_t id = alloc_record();
+    Record& r = records_[id];
+    r.kind = RecordKind::kStatePush;
+    r.worker_id = static_cast<uint8_t>(worker_id);
+    r.queue_length = std::min<uint32_t>(queue_len, UINT16_MAX);
+    r.active_requests = std::min<uint32_t>(w.active, UINT16_MAX);
+    r.load_ema = static_cast<float>(w.push_load_ema);
+
+    // 状态推送携带未量化的直方图
+    std::array<uint32_t, constants::kSlackHistogramBins> hist;
+    w.slack->snapshot(now, hist);
+    std::memcpy(r.slack_histogram, hist.data(), sizeof(r.slack_histogram));
+
+    worker_to_lb_.push({now + config_.net_delay_ns, id});
+    ++stats_.state_pushes;
+}
+
+void ClusterSimulator::on_lb_receive(Timestamp now) {
+    uint32_t id = worker_to_lb_.pop().id;
+    Record& r = records_[id];
+    WorkerState& ws = view_[r.worker_id];
+
+    if (r.kind == RecordKind::kStatePush) {
+        // Worker 上报的是权威值，覆盖 LB 按派发推断的队列长度
+        ws.queue_length = r.queue_length;
+        ws.active_requests = r.active_requests;
+        ws.load_ema = r.load_ema;
+        std::memcpy(ws.slack_histogram, r.slack_histogram, sizeof(ws.slack_histogram));
+        ws.is_healthy = true;
+        ws.last_heartbeat = now;
+        sync_worker_state(r.worker_id);
+        free_record(id);
+        return;
+    }
+
+    // 合并响应捎带的状态摘要 (与 LBContext 的响应处理一致，服务时间按微秒上报);
+    // 不捎带摘要时 LB 只能按派发 / 响应计数推断队列长度
+    Timestamp service_time = us_to_ns(r.service_ns / 1000);
+    if (config_.response_digest) {
+        ws.queue_length = r.queue_length;
+        ws.active_requests = r.active_requests;
+        std::memcpy(ws.slack_histogram, r.slack_histogram, sizeof(ws.slack_histogram));
+        ws.last_heartbeat = now;
+    } else {
+        ws.queue_length -= ws.queue_length > 0;
+        ws.active_requests -= ws.active_requests > 0;
+    }
+    ws.update_load_ema(ws.queue_length);
+    ws.avg_service_time = static_cast<Timestamp>(0.9 * ws.avg_service_time + 0.1 * service_time);
+    sync_worker_state(r.worker_id);
+
+    r.t6_lb_response = now;
+    scheduler_->on_request_complete(make_trace(r));
+
+    lb_to_client_.push({now + config_.net_delay_ns, id});
+}
+
+void ClusterSimulator::on_client_receive(Timestamp now) {
+    uint32_t id = lb_to_client_.pop().id;
+    const Record& r = records_[id];
+    --outstanding_;
+    ++stats_.completed;
+
+    // 只统计预热结束后发送的请求
+    if (r.req.client_send_time >= warmup_end_) {
+        if (r.success) {
+            RequestTrace trace = make_trace(r);
+            trace.t7_client_recv = now;
+            metrics_.record_request(trace);
+        } else {
+            ++stats_.rejected;
+        }
+    }
+    free_record(id);
+}
+
+RequestTrace ClusterSimulator::make_trace(const Record& r) {
+    RequestTrace trace{};
+    trace.request_id = r.req.request_id;
+    trace.deadline = r.req.deadline;
+    trace.t1_client_send = r.req.client_send_time;
+    trace.t2_lb_receive = r.t2_lb_receive;
+    trace.t3_lb_dispatch = r.t3_lb_dispatch;
+    trace.t4_worker_recv = r.t4_worker_recv;
+    trace.t5_worker_done = r.t5_worker_done;
+    trace.t6_lb_response = r.t6_lb_response;
+    trace.target_worker_id = r.worker_id;
+    trace.type = r.req.type;
+    return trace;
+}
+
+void ClusterSimulator::print_summary() const {
+    metrics_.print_summary();
+    scheduling_latency_.print_summary("Scheduling");
+
+    constexpr size_t kMaxPrinted = 16;
+    double sim_sec = static_cast<double>(stats_.sim_time_ns) / 1e9;
+    printf("Workers (utilization over %.3fs simulated):\n", sim_sec);
+    for (size_t i = 0; i < workers_.size() && i < kMaxPrinted; ++i) {
+        const Worker& w = workers_[i];
+        double util = stats_.sim_time_ns > 0
+            ? static_cast<double>(w.busy_ns) / (static_cast<double>(stats_.sim_time_ns) * w.config.num_threads)
+            : 0.0;
+        printf("  [%3zu] cap=%.2f threads=%zu dispatched=%lu rejected=%lu util=%.1f%%\n",
+               i, w.config.capacity_factor, w.config.num_threads, w.dispatched, w.rejected, util * 100);
+    }
+    if (workers_.size() > kMaxPrinted) {
+        printf("  ... %zu more (see workers.csv)\n", workers_.size() - kMaxPrinted);
+    }
+}
+
+bool ClusterSimulator::export_all(const std::string& dir) {
+    bool success = metrics_.export_all(dir);  // 负责创建目录
+    success &= scheduling_latency_.export_hdr(dir + "/scheduling_latency.hdr");
+
+    std::ofstream csv(dir + "/workers.csv");
+    if (!csv) {
+        return false;
+    }
+    csv << "worker_id,capacity_factor,threads,dispatched,rejected,completed,utilization\n";
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        const Worker& w = workers_[i];
+        double util = stats_.sim_time_ns > 0
+            ? static_cast<double>(w.busy_ns) / (static_cast<double>(stats_.sim_time_ns) * w.config.num_threads)
+            : 0.0;
+        csv << i << "," << w.config.capacity_factor << "," << w.config.num_threads << ","
+            << w.dispatched << "," << w.rejected << "," << w.completed << "," << util << "\n";
+    }
+    return success;
+}
+
+}  // namespace malcolm
@@ -0,0 +1,283 @@
+#pragma once
+
+/**
+ * 离散事件集群模拟器
+ *
+ * 在单线程里模拟 Client → LB → N 个 Worker → LB → Client 的完整请求路径，
+ * 调度决策直接调用真实的 Scheduler::schedule() (SchedulerFactory 创建)，
+ * 请求由真实的 RequestGenerator / ArrivalProcess 生成，用于在没有集群时按负载扫参。
+ *
+ * 模型 (与真实进程保持同样的口径):
+ * - LB: lb_dispatchers 个派发线程 (默认与 LB 的 --threads 相同) 组成的多服务台 FIFO 队列，
+ *   请求按到达顺序交给最早空闲的派发线程，每次决策占用该线程 lb_cost_ns (默认取调度器实测耗时);
+ *   各派发线程共用一个调度器和 Worker 视图 (相当于状态表同步没有延迟)。
+ *   派发时 queue_length++ / active_requests++ 并更新 load_ema，收到响应 / 状态推送时按 Worker 的摘要覆盖
+ *   (response_digest 关闭时响应只让 queue_length-- / active_requests--，即响应不捎带摘要的旧协议，状态推送照常)，
+ *   每次变化都经 update_worker_state() 通知调度器
+ * - Worker: num_threads 个计算线程，服务时间用 modeled_service_time_ns() (与 Worker 忙等一致)，
+ *   slow 节点的人工延迟占用线程但不计入上报的服务时间; 在途任务超过
+ *   max_queue_size + num_threads 时拒绝; 本地队列 FCFS 或 EDF，等待中的任务计入 SlackHistogram
+ * - 网络: 每一跳固定单向延迟 net_delay_ns
+ *
+ * 调度器内部用 now_ns() 计算 slack，调用前把请求的 deadline / 发送时间平移到墙上时钟，
+ * 使 deadline - now_ns() 等于模拟时间下的剩余时间。
+ *
+ * 事件组织: 固定网络延迟下每一跳的消息按发送顺序到达，用 FIFO 延迟线代替事件堆 (O(1));
+ * 只有计算完成和状态推送定时器进入小顶堆。请求记录放在按下标复用的对象池中，
+ * 事件只携带下标，稳态运行不分配内存。
+ */
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../common/metrics.h"
+#include "../common/types.h"
+#include "../common/workload.h"
+#include "../scheduler/scheduler.h"
+#include "../scheduler/slack_histogram.h"
+
+namespace malcolm {
+
+/**
+ * 单个模拟 Worker 的配置 (默认值与 worker --mode=fast 一致)
+ */
+struct SimWorkerConfig {
+    double capacity_factor = 1.0;
+    size_t num_threads = 8;
+    Timestamp artificial_delay_ns = 0;
+};
+
+/**
+ * 模拟器配置
+ */
+struct SimConfig {
+    std::vector<SimWorkerConfig> workers;
+    SchedulerType algorithm = SchedulerType::kPowerOf2;
+    std::string model_path;
+    size_t po2_choices = 2;
+    LoadMetric po2_metric = LoadMetric::kLoadEma;
+
+    LocalSchedulerType local_scheduler = LocalSchedulerType::kFCFS;
+    size_t max_queue_size = 10000;
+
+    RequestGeneratorConfig workload;
+    ArrivalConfig arrival;
+    double target_rps = 100000.0;
+    Timestamp duration_ns = ms_to_ns(10'000);   // 模拟时长 (不含排空)
+    Timestamp warmup_ns = ms_to_ns(1'000);      // 此前发送的请求不计入指标
+
+    Timestamp net_delay_ns = us_to_ns(5);       // 每一跳的单向网络延迟
+    Duration lb_cost_ns = -1;                   // 每次调度占用 LB 的时间 (< 0 = 实测决策耗时)
+    size_t lb_dispatchers = constants::kDefaultLBThreads;   // 并行派发线程数
+
+    bool response_digest = true;                // 响应捎带 Worker 状态摘要 (RpcWorkerResponse)
+
+    // Worker -> LB 状态推送 (与 Worker 的默认值一致)，interval 为 0 时不推送
+    Timestamp state_push_interval_ns = us_to_ns(100);
+    uint32_t state_push_queue_delta = 8;
+
+    uint64_t seed = 42;
+};
+
+/**
+ * 模拟结果统计
+ */
+struct SimStats {
+    uint64_t generated = 0;        // 生成的请求数
+    uint64_t completed = 0;        // 返回 Client 的请求数 (含被拒绝的)
+    uint64_t rejected = 0;         // 被 Worker 拒绝的请求数 (预热后)
+    uint64_t state_pushes = 0;
+    uint64_t events = 0;           // 处理的事件数
+    Timestamp sim_time_ns = 0;     // 模拟时长 (含排空)
+    double wall_seconds = 0.0;     // 实际耗时
+};
+
+class ClusterSimulator {
+public:
+    explicit ClusterSimulator(const SimConfig& config);
+    ~ClusterSimulator();
+
+    // 禁用拷贝
+    ClusterSimulator(const ClusterSimulator&) = delete;
+    ClusterSimulator& operator=(const ClusterSimulator&) = delete;
+
+    /// 运行到所有请求完成，只能调用一次
+    SimStats run();
+
+    /// Client 视角的指标 (预热后发送的成功请求)
+    const MetricsCollector& metrics() const { return metrics_; }
+
+    /// 打印摘要 (整体指标 + 各 Worker 的派发数、拒绝数、利用率)
+    void print_summary() const;
+
+    /**
+     * 导出到目录: MetricsCollector::export_all() 的全部文件 (与 Client 相同)，
+     * 加上 scheduling_latency.hdr (与 LB 相同) 和 workers.csv
+     */
+    bool export_all(const std::string& dir);
+
+private:
+    /// 按下标复用的环形 FIFO (容量按 2 的幂增长，只增不减)
+    template <typename T>
+    class Ring {
+    public:
+        bool empty() const { return head_ == tail_; }
+        size_t size() const { return tail_ - head_; }
+        const T& front() const { return buf_[head_ & mask_]; }
+
+        void push(const T& v) {
+            if (size() == buf_.size()) {
+                grow();
+            }
+            buf_[tail_++ & mask_] = v;
+        }
+
+        T pop() { return buf_[head_++ & mask_]; }
+
+    private:
+        void grow() {
+            std::vector<T> next(buf_.empty() ? 64 : buf_.size() * 2);
+            for (size_t i = 0; i < size(); ++i) {
+                next[i] = buf_[(head_ + i) & mask_];
+            }
+            tail_ = size();
+            head_ = 0;
+            buf_.swap(next);
+            mask_ = buf_.size() - 1;
+        }
+
+        std::vector<T> buf_;
+        size_t mask_ = 0;
+        size_t head_ = 0;
+        size_t tail_ = 0;
+    };
+
+    /// 网络延迟线上的消息: 到达时间 + 记录下标
+    struct InFlight {
+        Timestamp arrive;
+        uint32_t id;
+    };
+
+    enum class RecordKind : uint8_t { kRequest, kStatePush };
+
+    /// 请求 (或状态推送) 记录，时间戳均为模拟时间
+    struct Record {
+        ClientRequest req;
+        Timestamp t2_lb_receive;
+        Timestamp t3_lb_dispatch;
+        Timestamp t4_worker_recv;
+        Timestamp t_start;              // 开始计算
+        Timestamp t5_worker_done;
+        Timestamp t6_lb_response;
+        Timestamp service_ns;           // 计算时间 (不含人工延迟)
+        uint64_t slack_epoch;
+
+        // Worker 状态摘要 (响应捎带或状态推送)
+        uint32_t queue_length;
+        uint32_t active_requests;
+        float load_ema;
+        uint32_t slack_histogram[constants::kSlackHistogramBins];
+
+        uint8_t worker_id;
+        RecordKind kind;
+        bool success;
+    };
+
+    enum class EventKind : uint32_t { kCompletion, kStatePush };
+
+    /// 堆事件 (计算完成: id 为记录下标; 状态推送定时器: id 为 Worker 编号)
+    struct Event {
+        Timestamp time;
+        uint32_t id;
+        EventKind kind;
+
+        bool operator>(const Event& other) const { return time > other.time; }
+    };
+
+    struct Worker {
+        SimWorkerConfig config;
+        size_t busy_threads = 0;
+        uint32_t active = 0;                 // 已接收未完成 (含排队和计算中)
+
+        Ring<uint32_t> fcfs;
+        std::vector<std::pair<Timestamp, uint32_t>> edf;   // (deadline, 记录下标) 小顶堆
+        std::unique_ptr<SlackHistogram> slack;            // 排队中任务的松弛时间
+
+        // 状态推送
+        double push_load_ema = 0.0;
+        Timestamp last_push = 0;
+        Timestamp push_ack_time = 0;         // 上一次推送的确认到达时间 (此前不再推送)
+        uint32_t last_push_queue_length = 0;
+
+        // 统计
+        uint64_t dispatched = 0;
+        uint64_t rejected = 0;
+        uint64_t completed = 0;
+        Timestamp busy_ns = 0;               // 计算线程占用时间 (含人工延迟)
+
+        size_t waiting() const { return fcfs.size() + edf.size(); }
+    };
+
+    uint32_t alloc_record();
+    void free_record(uint32_t id) { free_records_.push_back(id); }
+    void push_event(Timestamp time, uint32_t id, EventKind kind);
+
+    // 事件处理
+    void on_client_send(Timestamp now);
+    void on_lb_schedule(Timestamp now);
+    void on_worker_receive(Timestamp now);
+    void on_completion(Timestamp now, uint32_t id);
+    void on_state_push_timer(Timestamp now, uint32_t worker_id);
+    void on_lb_receive(Timestamp now);
+    void on_client_receive(Timestamp now);
+
+    static RequestTrace make_trace(const Record& r);
+    void start_task(Worker& w, uint32_t id, Timestamp now);
+    void fill_digest(Worker& w, Record& r, Timestamp now);
+    void maybe_push_state(uint32_t worker_id, Timestamp now, bool periodic);
+
+    /// 更新 LB 视图中的 Worker 状态并通知调度器
+    void sync_worker_state(uint8_t worker_id) {
+        scheduler_->update_worker_state(worker_id, view_[worker_id]);
+    }
+
+    SimConfig config_;
+    std::unique_ptr<Scheduler> scheduler_;
+    RequestGenerator generator_;
+    ArrivalProcess arrivals_;
+
+    std::vector<WorkerState> view_;          // LB 看到的 Worker 状态
+    std::vector<Worker> workers_;
+
+    // 对象池
+    std::vector<Record> records_;
+    std::vector<uint32_t> free_records_;
+
+    // 四段网络延迟线和事件堆
+    Ring<InFlight> client_to_lb_;
+    Ring<InFlight> lb_to_worker_;
+    Ring<InFlight> worker_to_lb_;
+    Ring<InFlight> lb_to_client_;
+    std::vector<Event> events_;
+
+    // 模拟时钟: 模拟时间 = base_ + 偏移 (base_ 取运行开始时的 now_ns()，
+    // 与 SlackHistogram 的时间轴一致)
+    Timestamp base_ = 0;
+    Timestamp warmup_end_ = 0;
+    Timestamp end_time_ = 0;
+    Timestamp next_send_ = 0;
+    bool sending_ = false;
+    std::vector<Timestamp> lb_free_at_;      // 各派发线程空闲的时刻
+    Timestamp lb_next_free_ = 0;             // min(lb_free_at_)
+    Timestamp last_dispatch_ = 0;            // 上一个请求离开 LB 的时刻
+    uint64_t outstanding_ = 0;
+
+    MetricsCollector metrics_;
+    LatencyHistogram scheduling_latency_;
+    SimStats stats_;
+};
+
+}  // namespace malcolm
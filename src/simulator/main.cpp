@@ -0,0 +1,300 @@
+/**
+ * 集群模拟器主程序入口
+ *
+ * 用法:
+ *   ./simulator --algorithm=malcolm_strict --workers=fast*4,slow*12 \
+ *               --target_rps=500000 --duration=5 --warmup=1 --output=results/sim/
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <string>
+#include <getopt.h>
+
+#include "cluster_sim.h"
+
+using namespace malcolm;
+
+void print_usage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Options:\n");
+    printf("  --workers=SPEC    Comma-separated workers, each 'fast', 'slow' or CAP:THREADS[:DELAY_US],\n");
+    printf("                    optionally repeated with *N (default: fast,slow*2)\n");
+    printf("  --algorithm=ALG   Scheduling algorithm: po2, malcolm, malcolm_strict\n");
+    printf("  --model=PATH      Path to DRL model (for malcolm/malcolm_strict)\n");
+    printf("  --po2_d=N         Candidates per decision for po2, 1-8 (default: 2)\n");
+    printf("  --po2_metric=M    Load metric for po2: load_ema, queue_length, outstanding_work\n");
+    printf("  --scheduler=S     Worker local scheduler: 'fcfs' or 'edf' (default: fcfs)\n");
+    printf("  --queue_size=N    Worker task queue capacity (default: 10000)\n");
+    printf("  --target_rps=N    Target requests per second (default: 100000)\n");
+    printf("  --arrival=MODE    Arrival process: deterministic|poisson|onoff|trace (default: poisson)\n");
+    printf("  --burst_on_us=US  Mean ON period of onoff arrivals (default: 1000)\n");
+    printf("  --burst_off_us=US Mean OFF period of onoff arrivals (default: 1000)\n");
+    printf("  --trace=PATH      Inter-arrival gaps in microseconds, one per line (for --arrival=trace)\n");
+    printf("  --duration=SEC    Simulated duration in seconds, fractional allowed (default: 10)\n");
+    printf("  --warmup=SEC      Simulated warmup in seconds (default: 1)\n");
+    printf("  --pareto_alpha=F  Pareto distribution alpha (default: 1.2)\n");
+    printf("  --service_min=US  Minimum service time in microseconds (default: 10)\n");
+    printf("  --net_delay_us=N  One-way network delay per hop (default: 5)\n");
+    printf("  --lb_cost_ns=N    LB time per scheduling decision, -1 = measured (default: -1)\n");
+    printf("  --lb_dispatchers=N Parallel LB dispatcher threads, same as load_balancer --threads\n");
+    printf("                    (default: %zu)\n", constants::kDefaultLBThreads);
+    printf("  --digest=0|1      Worker responses carry the state digest (default: 1)\n");
+    printf("  --push_us=N       Worker state push interval, 0 = off (default: 100)\n");
+    printf("  --push_delta=N    Queue length change that triggers a push, 0 = periodic only (default: 8)\n");
+    printf("  --seed=N          Random seed for workload and arrivals (default: 42)\n");
+    printf("  --output=DIR      Output directory for results\n");
+    printf("  --help            Show this help\n");
+}
+
+/// 解析 --workers: fast / slow 沿用 worker --mode 的默认参数
+bool parse_worker_spec(const char* spec, std::vector<SimWorkerConfig>& workers) {
+    workers.clear();
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+
+        size_t count = 1;
+        size_t star = item.find('*');
+        if (star != std::string::npos) {
+            count = std::stoul(item.substr(star + 1));
+            item = item.substr(0, star);
+        }
+
+        SimWorkerConfig w;
+        if (item == "fast") {
+            w.capacity_factor = 1.0;
+            w.num_threads = 8;
+        } else if (item == "slow") {
+            w.capacity_factor = 0.2;
+            w.num_threads = 2;
+            w.artificial_delay_ns = 500000;
+        } else {
+            double cap = 0;
+            unsigned long threads = 0, delay_us = 0;
+            int n = sscanf(item.c_str(), "%lf:%lu:%lu", &cap, &threads, &delay_us);
+            if (n < 2 || cap <= 0 || threads == 0) {
+                return false;
+            }
+            w.capacity_factor = cap;
+            w.num_threads = threads;
+            w.artificial_delay_ns = us_to_ns(delay_us);
+        }
+        workers.insert(workers.end(), count, w);
+    }
+    return !workers.empty();
+}
+
+int main(int argc, char* argv[]) {
+    SimConfig config;
+    std::string output_dir;
+    parse_worker_spec("fast,slow*2", config.workers);
+
+    // 默认工作负载配置 (与 Client 一致)
+    config.workload.distribution = WorkloadDistribution::kPareto;
+    config.workload.pareto_alpha = 1.2;
+    config.workload.service_time_min_us = 10;
+    config.workload.deadline_multiplier = 100.0;
+
+    static struct option long_options[] = {
+        {"workers",     required_argument, 0, 'W'},
+        {"algorithm",   required_argument, 0, 'a'},
+        {"model",       required_argument, 0, 'm'},
+        {"po2_d",       required_argument, 0, 'k'},
+        {"po2_metric",  required_argument, 0, 'L'},
+        {"scheduler",   required_argument, 0, 'S'},
+        {"queue_size",  required_argument, 0, 'q'},
+        {"target_rps",  required_argument, 0, 'r'},
+        {"arrival",     required_argument, 0, 'A'},
+        {"burst_on_us", required_argument, 0, 'B'},
+        {"burst_off_us",required_argument, 0, 'F'},
+        {"trace",       required_argument, 0, 'T'},
+        {"duration",    required_argument, 0, 'd'},
+        {"warmup",      required_argument, 0, 'w'},
+        {"pareto_alpha",required_argument, 0, 'p'},
+        {"service_min", required_argument, 0, 's'},
+        {"net_delay_us",required_argument, 0, 'n'},
+        {"lb_cost_ns",  required_argument, 0, 'c'},
+        {"lb_dispatchers", required_argument, 0, 'N'},
+        {"digest",      required_argument, 0, 'g'},
+        {"push_us",     required_argument, 0, 'P'},
+        {"push_delta",  required_argument, 0, 'D'},
+        {"seed",        required_argument, 0, 'e'},
+        {"output",      required_argument, 0, 'o'},
+        {"help",        no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "W:a:m:k:L:S:q:r:A:B:F:T:d:w:p:s:n:c:N:g:P:D:e:o:h",
+                              long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'W':
+                if (!parse_worker_spec(optarg, config.workers)) {
+                    fprintf(stderr, "Invalid worker spec: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'a':
+                if (strcmp(optarg, "po2") == 0) {
+                    config.algorithm = SchedulerType::kPowerOf2;
+                } else if (strcmp(optarg, "malcolm") == 0) {
+                    config.algorithm = SchedulerType::kMalcolm;
+                } else if (strcmp(optarg, "malcolm_strict") == 0) {
+                    config.algorithm = SchedulerType::kMalcolmStrict;
+                } else {
+                    fprintf(stderr, "Unknown algorithm: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'm':
+                config.model_path = optarg;
+                break;
+            case 'k':
+                config.po2_choices = std::stoul(optarg);
+                break;
+            case 'L':
+                if (!parse_load_metric(optarg, &config.po2_metric)) {
+                    fprintf(stderr, "Unknown load metric: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'S':
+                if (strcmp(optarg, "edf") == 0) {
+                    config.local_scheduler = LocalSchedulerType::kEDF;
+                } else if (strcmp(optarg, "fcfs") == 0) {
+                    config.local_scheduler = LocalSchedulerType::kFCFS;
+                } else {
+                    fprintf(stderr, "Unknown local scheduler: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q':
+                config.max_queue_size = std::stoul(optarg);
+                break;
+            case 'r':
+                config.target_rps = std::stod(optarg);
+                break;
+            case 'A':
+                if (strcmp(optarg, "deterministic") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kDeterministic;
+                } else if (strcmp(optarg, "poisson") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kPoisson;
+                } else if (strcmp(optarg, "onoff") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kOnOff;
+                } else if (strcmp(optarg, "trace") == 0) {
+                    config.arrival.pattern = ArrivalPattern::kTrace;
+                } else {
+                    fprintf(stderr, "Error: Unknown arrival process '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'B':
+                config.arrival.mean_on_us = std::stod(optarg);
+                break;
+            case 'F':
+                config.arrival.mean_off_us = std::stod(optarg);
+                break;
+            case 'T':
+                config.arrival.trace_path = optarg;
+                break;
+            case 'd':
+                config.duration_ns = static_cast<Timestamp>(std::stod(optarg) * 1e9);
+                break;
+            case 'w':
+                config.warmup_ns = static_cast<Timestamp>(std::stod(optarg) * 1e9);
+                break;
+            case 'p':
+                config.workload.pareto_alpha = std::stod(optarg);
+                break;
+            case 's':
+                config.workload.service_time_min_us = std::stod(optarg);
+                break;
+            case 'n':
+                config.net_delay_ns = us_to_ns(std::stoul(optarg));
+                break;
+            case 'c':
+                config.lb_cost_ns = std::stol(optarg);
+                break;
+            case 'N':
+                config.lb_dispatchers = std::max<size_t>(std::stoul(optarg), 1);
+                break;
+            case 'g':
+                config.response_digest = std::stoul(optarg) != 0;
+                break;
+            case 'P':
+                config.state_push_interval_ns = us_to_ns(std::stoul(optarg));
+                break;
+            case 'D':
+                config.state_push_queue_delta = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'e':
+                config.seed = std::stoull(optarg);
+                break;
+            case 'o':
+                output_dir = optarg;
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    size_t total_threads = 0;
+    for (const auto& w : config.workers) {
+        total_threads += w.num_threads;
+    }
+
+    printf("========================================\n");
+    printf("Malcolm-Strict Cluster Simulator\n");
+    printf("========================================\n");
+    printf("Algorithm:       %s\n", scheduler_type_name(config.algorithm));
+    printf("Workers:         %zu (%zu compute threads)\n", config.workers.size(), total_threads);
+    printf("Local Scheduler: %s\n",
+           config.local_scheduler == LocalSchedulerType::kEDF ? "EDF" : "FCFS");
+    printf("Target RPS:      %.0f (%s)\n", config.target_rps, arrival_pattern_name(config.arrival.pattern));
+    printf("Duration:        %.3f s (warmup: %.3f s, simulated)\n",
+           config.duration_ns / 1e9, config.warmup_ns / 1e9);
+    printf("Network Delay:   %lu us per hop\n", config.net_delay_ns / 1000);
+    if (config.lb_cost_ns >= 0) {
+        printf("LB Cost:         %ld ns per decision, %zu dispatchers\n",
+               config.lb_cost_ns, config.lb_dispatchers);
+    } else {
+        printf("LB Cost:         measured, %zu dispatchers\n", config.lb_dispatchers);
+    }
+    printf("State Push:      %lu us (delta %u), response digest %s\n",
+           config.state_push_interval_ns / 1000, config.state_push_queue_delta,
+           config.response_digest ? "on" : "off");
+    printf("========================================\n");
+
+    try {
+        ClusterSimulator sim(config);
+        SimStats stats = sim.run();
+
+        sim.print_summary();
+        printf("\nSimulated %lu requests (%lu rejected) in %.3fs simulated time\n",
+               stats.generated, stats.rejected, stats.sim_time_ns / 1e9);
+        printf("Wall time: %.3fs, %.2fM requests/s, %.2fM events/s\n",
+               stats.wall_seconds,
+               stats.generated / stats.wall_seconds / 1e6,
+               stats.events / stats.wall_seconds / 1e6);
+
+        if (!output_dir.empty()) {
+            if (!sim.export_all(output_dir)) {
+                fprintf(stderr, "Failed to export results to %s\n", output_dir.c_str());
+                return 1;
+            }
+            printf("Results exported to %s\n", output_dir.c_str());
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * eRPC 传输后端实现
+ */
+
+#include "erpc_transport.h"
+
+#include <cstdio>
+#include <utility>
+
+namespace malcolm {
+
+namespace {
+
+// 256 种请求类型各一个跳板函数 (eRPC 的请求处理函数不带请求类型)
+template <size_t... kTypes>
+constexpr std::array<erpc::erpc_req_func_t, sizeof...(kTypes)>
+make_req_trampolines(std::index_sequence<kTypes...>) {
+    return {{&ErpcTransport::req_trampoline<static_cast<uint8_t>(kTypes)>...}};
+}
+
+constexpr auto kReqTrampolines = make_req_trampolines(std::make_index_sequence<256>{});
+
+// 把上层缓冲区的大小同步到 eRPC 缓冲区
+inline erpc::MsgBuffer* sync_erpc_buffer(MsgBuffer* msgbuf) {
+    auto* erpc_buf = static_cast<erpc::MsgBuffer*>(msgbuf->backend_);
+    erpc::Rpc<erpc::CTransport>::resize_msg_buffer(erpc_buf, msgbuf->data_size_);
+    return erpc_buf;
+}
+
+}  // namespace
+
+// ==================== ErpcNexus ====================
+
+// eRPC 要求端口在 31850-31881 范围内，local_uri 直接交给 erpc::Nexus
+ErpcNexus::ErpcNexus(const std::string& local_uri)
+    : nexus_(local_uri, 0, 0) {}
+
+void ErpcNexus::register_req_func(uint8_t req_type, ReqFunc req_func) {
+    req_funcs_[req_type] = req_func;
+    nexus_.register_req_func(req_type, kReqTrampolines[req_type]);
+}
+
+std::unique_ptr<Transport> ErpcNexus::create_rpc(void* context, uint8_t rpc_id,
+                                                 uint8_t phy_port, const std::string& name) {
+    return std::make_unique<ErpcTransport>(this, context, rpc_id, phy_port, name);
+}
+
+// ==================== ErpcTransport ====================
+
+ErpcTransport::ErpcTransport(ErpcNexus* nexus, void* context, uint8_t rpc_id,
+                             uint8_t phy_port, const std::string& name)
+    : nexus_(nexus),
+      context_(context),
+      name_(name),
+      rpc_(nexus->nexus(), this, rpc_id, sm_handler, phy_port) {}
+
+ErpcTransport::~ErpcTransport() = default;
+
+void ErpcTransport::sm_handler(int session_num, erpc::SmEventType sm_event_type,
+                               erpc::SmErrType sm_err_type, void* context) {
+    auto* transport = static_cast<ErpcTransport*>(context);
+    printf("[%s] Session %d event: %s, error: %s\n",
+           transport->name_.c_str(), session_num,
+           erpc::sm_event_type_str(sm_event_type).c_str(),
+           erpc::sm_err_type_str(sm_err_type).c_str());
+}
+
+int ErpcTransport::create_session(const std::string& remote_uri, uint8_t remote_rpc_id) {
+    return rpc_.create_session(remote_uri, remote_rpc_id);
+}
+
+bool ErpcTransport::is_connected(int session) const {
+    return rpc_.is_connected(session);
+}
+
+void ErpcTransport::run_event_loop_once() {
+    rpc_.run_event_loop_once();
+}
+
+MsgBuffer ErpcTransport::alloc_msg_buffer_or_die(size_t max_data_size) {
+    auto* erpc_buf = new erpc::MsgBuffer(rpc_.alloc_msg_buffer_or_die(max_data_size));
+    MsgBuffer msgbuf;
+    msgbuf.buf_ = erpc_buf->buf_;
+    msgbuf.max_data_size_ = max_data_size;
+    msgbuf.data_size_ = max_data_size;
+    msgbuf.backend_ = erpc_buf;
+    return msgbuf;
+}
+
+void ErpcTransport::free_msg_buffer(MsgBuffer& msgbuf) {
+    auto* erpc_buf = static_cast<erpc::MsgBuffer*>(msgbuf.backend_);
+    if (!erpc_buf) return;
+    rpc_.free_msg_buffer(*erpc_buf);
+    delete erpc_buf;
+    msgbuf = MsgBuffer{};
+}
+
+void ErpcTransport::enqueue_request(int session, uint8_t req_type,
+                                    MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                                    ContFunc cont_func, void* tag) {
+    PendingCont* pc = free_conts_;
+    if (pc) {
+        free_conts_ = pc->next_free;
+    } else {
+        conts_.emplace_back();
+        pc = &conts_.back();
+    }
+    pc->cont_func = cont_func;
+    pc->tag = tag;
+    pc->resp_msgbuf = resp_msgbuf;
+
+    // 响应缓冲区按分配时的容量接收 (eRPC 会把它缩小到实际响应大小)
+    resp_msgbuf->data_size_ = resp_msgbuf->max_data_size_;
+    rpc_.enqueue_request(session, req_type, sync_erpc_buffer(req_msgbuf),
+                         sync_erpc_buffer(resp_msgbuf), cont_trampoline, pc);
+}
+
+void ErpcTransport::cont_trampoline(void* context, void* tag) {
+    auto* transport = static_cast<ErpcTransport*>(context);
+    auto* pc = static_cast<PendingCont*>(tag);
+
+    MsgBuffer* resp_msgbuf = pc->resp_msgbuf;
+    resp_msgbuf->data_size_ = static_cast<erpc::MsgBuffer*>(resp_msgbuf->backend_)->data_size_;
+    ContFunc cont_func = pc->cont_func;
+    void* user_tag = pc->tag;
+
+    // 先归还记录: continuation 中可能再次 enqueue_request
+    pc->next_free = transport->free_conts_;
+    transport->free_conts_ = pc;
+
+    cont_func(transport->context_, user_tag);
+}
+
+void ErpcTransport::dispatch_request(uint8_t req_type, erpc::ReqHandle* erpc_handle) {
+    ReqFunc req_func = nexus_->req_func(req_type);
+
+    ErpcReqHandle* handle = free_handles_;
+    if (handle) {
+        free_handles_ = handle->next_free;
+    } else {
+        handles_.emplace_back();
+        handle = &handles_.back();
+    }
+    handle->erpc_handle = erpc_handle;
+    handle->next_free = nullptr;
+
+    const erpc::MsgBuffer* req = erpc_handle->get_req_msgbuf();
+    handle->req_msgbuf_.buf_ = req->buf_;
+    handle->req_msgbuf_.max_data_size_ = req->data_size_;
+    handle->req_msgbuf_.data_size_ = req->data_size_;
+    handle->req_msgbuf_.backend_ = nullptr;
+
+    erpc::MsgBuffer& pre_resp = erpc_handle->pre_resp_msgbuf_;
+    handle->pre_resp_msgbuf_.buf_ = pre_resp.buf_;
+    handle->pre_resp_msgbuf_.max_data_size_ = pre_resp.max_data_size_;
+    handle->pre_resp_msgbuf_.data_size_ = pre_resp.data_size_;
+    handle->pre_resp_msgbuf_.backend_ = &pre_resp;
+
+    req_func(handle, context_);
+}
+
+void ErpcTransport::enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) {
+    auto* handle = static_cast<ErpcReqHandle*>(req_handle);
+    rpc_.enqueue_response(handle->erpc_handle, sync_erpc_buffer(resp_msgbuf));
+
+    handle->erpc_handle = nullptr;
+    handle->next_free = free_handles_;
+    free_handles_ = handle;
+}
+
+}  // namespace malcolm
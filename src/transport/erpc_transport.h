@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * eRPC 传输后端
+ *
+ * 对 erpc::Nexus / erpc::Rpc 的薄封装:
+ * - eRPC 的请求处理函数和 continuation 以本端点为上下文，经跳板函数转发给上层注册的函数
+ * - ReqHandle 和 continuation 记录从空闲链表中取用，预热后热路径上不再分配
+ * - MsgBuffer 与 erpc::MsgBuffer 共享内存，只在入队前同步 data_size_
+ */
+
+#include <array>
+#include <deque>
+#include <string>
+
+#include "transport.h"
+
+// eRPC
+#include "rpc.h"
+
+namespace malcolm {
+
+class ErpcNexus : public TransportNexus {
+public:
+    explicit ErpcNexus(const std::string& local_uri);
+
+    void register_req_func(uint8_t req_type, ReqFunc req_func) override;
+
+    std::unique_ptr<Transport> create_rpc(void* context, uint8_t rpc_id,
+                                          uint8_t phy_port, const std::string& name) override;
+
+    erpc::Nexus* nexus() { return &nexus_; }
+    ReqFunc req_func(uint8_t req_type) const { return req_funcs_[req_type]; }
+
+private:
+    erpc::Nexus nexus_;
+    std::array<ReqFunc, 256> req_funcs_{};
+};
+
+class ErpcTransport : public Transport {
+public:
+    ErpcTransport(ErpcNexus* nexus, void* context, uint8_t rpc_id,
+                  uint8_t phy_port, const std::string& name);
+    ~ErpcTransport() override;
+
+    int create_session(const std::string& remote_uri, uint8_t remote_rpc_id) override;
+    bool is_connected(int session) const override;
+    void run_event_loop_once() override;
+
+    MsgBuffer alloc_msg_buffer_or_die(size_t max_data_size) override;
+    void free_msg_buffer(MsgBuffer& msgbuf) override;
+
+    void enqueue_request(int session, uint8_t req_type,
+                         MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                         ContFunc cont_func, void* tag) override;
+    void enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) override;
+
+    /// eRPC 请求处理函数跳板 (每种请求类型一个实例，context 为 ErpcTransport*)
+    template <uint8_t kReqType>
+    static void req_trampoline(erpc::ReqHandle* erpc_handle, void* context) {
+        static_cast<ErpcTransport*>(context)->dispatch_request(kReqType, erpc_handle);
+    }
+
+private:
+    struct ErpcReqHandle : ReqHandle {
+        erpc::ReqHandle* erpc_handle = nullptr;
+        ErpcReqHandle* next_free = nullptr;
+    };
+
+    struct PendingCont {
+        ContFunc cont_func = nullptr;
+        void* tag = nullptr;
+        MsgBuffer* resp_msgbuf = nullptr;
+        PendingCont* next_free = nullptr;
+    };
+
+    void dispatch_request(uint8_t req_type, erpc::ReqHandle* erpc_handle);
+
+    static void sm_handler(int session_num, erpc::SmEventType sm_event_type,
+                           erpc::SmErrType sm_err_type, void* context);
+    static void cont_trampoline(void* context, void* tag);
+
+    ErpcNexus* nexus_;
+    void* context_;
+    std::string name_;
+    erpc::Rpc<erpc::CTransport> rpc_;
+
+    // 池化对象 (deque 保证地址稳定)
+    std::deque<ErpcReqHandle> handles_;
+    ErpcReqHandle* free_handles_ = nullptr;
+    std::deque<PendingCont> conts_;
+    PendingCont* free_conts_ = nullptr;
+};
+
+}  // namespace malcolm
@@ -0,0 +1,379 @@
+/**
+ * 共享内存传输后端实现
+ */
+
+#include "shm_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace malcolm {
+
+namespace {
+
+constexpr uint64_t kRingMask = shm::kRingSlots - 1;
+static_assert((shm::kRingSlots & kRingMask) == 0, "kRingSlots must be a power of 2");
+
+// 服务端未启动时的重连间隔
+constexpr Timestamp kConnectRetryNs = ms_to_ns(10);
+
+// 从 "ip:port" 中取端口号，解析失败返回 0
+uint16_t parse_port(const std::string& uri) {
+    size_t colon = uri.rfind(':');
+    const char* digits = uri.c_str() + (colon == std::string::npos ? 0 : colon + 1);
+    return static_cast<uint16_t>(strtoul(digits, nullptr, 10));
+}
+
+bool process_alive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+void fill_slot(shm::Slot& slot, uint32_t req_idx, uint8_t req_type, const MsgBuffer* msgbuf) {
+    size_t size = std::min(msgbuf->data_size_, shm::kMaxMsgSize);
+    slot.header.req_idx = req_idx;
+    slot.header.data_size = static_cast<uint16_t>(size);
+    slot.header.req_type = req_type;
+    std::memcpy(slot.data, msgbuf->buf_, size);
+}
+
+}  // namespace
+
+std::string shm::endpoint_name(uint16_t port, uint8_t rpc_id) {
+    return "/malcolm_shm_" + std::to_string(port) + "_" + std::to_string(rpc_id);
+}
+
+// ==================== ShmNexus ====================
+
+ShmNexus::ShmNexus(const std::string& local_uri)
+    : port_(parse_port(local_uri)) {}
+
+void ShmNexus::register_req_func(uint8_t req_type, ReqFunc req_func) {
+    if (!req_funcs_[req_type]) {
+        ++num_req_funcs_;
+    }
+    req_funcs_[req_type] = req_func;
+}
+
+std::unique_ptr<Transport> ShmNexus::create_rpc(void* context, uint8_t rpc_id,
+                                                uint8_t phy_port, const std::string& name) {
+    (void)phy_port;
+    return std::make_unique<ShmTransport>(this, context, rpc_id, name);
+}
+
+// ==================== ShmTransport ====================
+
+ShmTransport::ShmTransport(ShmNexus* nexus, void* context, uint8_t rpc_id, const std::string& name)
+    : nexus_(nexus), context_(context), name_(name) {
+
+    // 只有需要接收请求的端点才创建共享内存段
+    if (!nexus_->has_req_funcs()) {
+        return;
+    }
+
+    endpoint_name_ = shm::endpoint_name(nexus_->port(), rpc_id);
+    shm_unlink(endpoint_name_.c_str());  // 清理上次异常退出遗留的段
+    int fd = shm_open(endpoint_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open(" + endpoint_name_ + ") failed: " + strerror(errno));
+    }
+    if (ftruncate(fd, sizeof(shm::Endpoint)) != 0) {
+        close(fd);
+        shm_unlink(endpoint_name_.c_str());
+        throw std::runtime_error("ftruncate(" + endpoint_name_ + ") failed: " + strerror(errno));
+    }
+    void* mapping = mmap(nullptr, sizeof(shm::Endpoint), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(endpoint_name_.c_str());
+        throw std::runtime_error("mmap(" + endpoint_name_ + ") failed: " + strerror(errno));
+    }
+
+    // 新段由内核清零，环和会话计数即为初始状态; magic 最后写入，客户端看到它才会占用会话块
+    endpoint_ = static_cast<shm::Endpoint*>(mapping);
+    endpoint_->server_pid = static_cast<int32_t>(getpid());
+    endpoint_->magic.store(shm::kEndpointMagic, std::memory_order_release);
+    servers_.reserve(shm::kMaxSessions);
+
+    printf("[%s] Shared-memory endpoint %s ready\n", name_.c_str(), endpoint_name_.c_str());
+}
+
+ShmTransport::~ShmTransport() {
+    for (auto& cs : clients_) {
+        if (cs.mapping) {
+            munmap(cs.mapping, sizeof(shm::Endpoint));
+        }
+    }
+    if (endpoint_) {
+        munmap(endpoint_, sizeof(shm::Endpoint));
+        shm_unlink(endpoint_name_.c_str());
+    }
+}
+
+int ShmTransport::create_session(const std::string& remote_uri, uint8_t remote_rpc_id) {
+    uint16_t port = parse_port(remote_uri);
+    if (port == 0) {
+        fprintf(stderr, "[%s] Invalid remote address %s\n", name_.c_str(), remote_uri.c_str());
+        return -1;
+    }
+
+    clients_.emplace_back();
+    ClientSession& cs = clients_.back();
+    cs.remote_name = shm::endpoint_name(port, remote_rpc_id);
+    ++num_connecting_;
+    try_connect(cs);
+    return static_cast<int>(clients_.size() - 1);
+}
+
+bool ShmTransport::try_connect(ClientSession& cs) {
+    cs.next_retry = now_ns() + kConnectRetryNs;
+
+    int fd = shm_open(cs.remote_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(shm::Endpoint)) {
+        close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(shm::Endpoint), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    auto* ep = static_cast<shm::Endpoint*>(mapping);
+    if (ep->magic.load(std::memory_order_acquire) != shm::kEndpointMagic ||
+        !process_alive(ep->server_pid)) {
+        munmap(mapping, sizeof(shm::Endpoint));
+        return false;
+    }
+
+    uint32_t idx = ep->num_sessions.fetch_add(1, std::memory_order_acq_rel);
+    if (idx >= shm::kMaxSessions) {
+        fprintf(stderr, "[%s] %s has no free session slot (max %zu)\n",
+                name_.c_str(), cs.remote_name.c_str(), shm::kMaxSessions);
+        munmap(mapping, sizeof(shm::Endpoint));
+        cs.next_retry = UINT64_MAX;
+        --num_connecting_;
+        return false;
+    }
+
+    cs.mapping = mapping;
+    cs.block = &ep->sessions[idx];
+    cs.tx.ring = &cs.block->req_ring;
+    cs.block->ready.store(1, std::memory_order_release);
+    --num_connecting_;
+
+    printf("[%s] Session %zu connected to %s (slot %u)\n",
+           name_.c_str(), static_cast<size_t>(&cs - clients_.data()), cs.remote_name.c_str(), idx);
+    return true;
+}
+
+bool ShmTransport::is_connected(int session) const {
+    return session >= 0 && static_cast<size_t>(session) < clients_.size() &&
+           clients_[session].block != nullptr;
+}
+
+void ShmTransport::accept_sessions() {
+    uint32_t claimed = std::min<uint32_t>(
+        endpoint_->num_sessions.load(std::memory_order_acquire),
+        static_cast<uint32_t>(shm::kMaxSessions));
+    // 按占用顺序接受，前一个会话块尚未就绪时下一轮再看
+    while (servers_.size() < claimed) {
+        shm::SessionBlock* block = &endpoint_->sessions[servers_.size()];
+        if (!block->ready.load(std::memory_order_acquire)) {
+            break;
+        }
+        servers_.emplace_back();
+        servers_.back().block = block;
+        servers_.back().tx.ring = &block->resp_ring;
+    }
+}
+
+void ShmTransport::run_event_loop_once() {
+    if (num_connecting_ > 0) {
+        Timestamp now = now_ns();
+        for (auto& cs : clients_) {
+            if (!cs.block && now >= cs.next_retry) {
+                try_connect(cs);
+            }
+        }
+    }
+
+    if (endpoint_) {
+        accept_sessions();
+    }
+
+    for (auto& cs : clients_) {
+        if (cs.block) {
+            flush(cs.tx);
+            poll_responses(cs);
+        }
+    }
+
+    for (size_t i = 0; i < servers_.size(); ++i) {
+        flush(servers_[i].tx);
+        poll_requests(static_cast<uint32_t>(i));
+    }
+}
+
+MsgBuffer ShmTransport::alloc_msg_buffer_or_die(size_t max_data_size) {
+    if (max_data_size > shm::kMaxMsgSize) {
+        fprintf(stderr, "[%s] Message size %zu exceeds shm transport limit %zu\n",
+                name_.c_str(), max_data_size, shm::kMaxMsgSize);
+        std::abort();
+    }
+    MsgBuffer msgbuf;
+    msgbuf.buf_ = new uint8_t[shm::kMaxMsgSize];
+    msgbuf.max_data_size_ = max_data_size;
+    msgbuf.data_size_ = max_data_size;
+    return msgbuf;
+}
+
+void ShmTransport::free_msg_buffer(MsgBuffer& msgbuf) {
+    delete[] msgbuf.buf_;
+    msgbuf = MsgBuffer{};
+}
+
+void ShmTransport::send(TxQueue& tx, uint32_t req_idx, uint8_t req_type, const MsgBuffer* msgbuf) {
+    if (tx.ring && tx.backlog.empty()) {
+        shm::Ring* ring = tx.ring;
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) < shm::kRingSlots) {
+            fill_slot(ring->slots[head & kRingMask], req_idx, req_type, msgbuf);
+            ring->head.store(head + 1, std::memory_order_release);
+            return;
+        }
+    }
+    tx.backlog.emplace_back();
+    fill_slot(tx.backlog.back(), req_idx, req_type, msgbuf);
+}
+
+void ShmTransport::flush(TxQueue& tx) {
+    if (tx.backlog.empty() || !tx.ring) {
+        return;
+    }
+    shm::Ring* ring = tx.ring;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    uint64_t start = head;
+    while (!tx.backlog.empty() && head - tail < shm::kRingSlots) {
+        ring->slots[head & kRingMask] = tx.backlog.front();
+        tx.backlog.pop_front();
+        ++head;
+    }
+    if (head != start) {
+        ring->head.store(head, std::memory_order_release);
+    }
+}
+
+void ShmTransport::poll_responses(ClientSession& cs) {
+    shm::Ring* ring = &cs.block->resp_ring;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t end = std::min(head, tail + kRxBatch);
+
+    for (uint64_t pos = tail; pos < end; ++pos) {
+        const shm::Slot& slot = ring->slots[pos & kRingMask];
+        uint32_t req_idx = slot.header.req_idx;
+        if (req_idx >= pending_.size() || !pending_[req_idx].cont_func) {
+            fprintf(stderr, "[%s] Response for unknown request %u\n", name_.c_str(), req_idx);
+            continue;
+        }
+        PendingReq pr = pending_[req_idx];
+        pending_[req_idx].cont_func = nullptr;
+        free_req_idx_.push_back(req_idx);
+
+        size_t size = std::min<size_t>(slot.header.data_size, pr.resp_msgbuf->max_data_size_);
+        std::memcpy(pr.resp_msgbuf->buf_, slot.data, size);
+        pr.resp_msgbuf->data_size_ = size;
+
+        pr.cont_func(context_, pr.tag);
+    }
+
+    if (end != tail) {
+        ring->tail.store(end, std::memory_order_release);
+    }
+}
+
+void ShmTransport::poll_requests(uint32_t session_idx) {
+    shm::Ring* ring = &servers_[session_idx].block->req_ring;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t end = std::min(head, tail + kRxBatch);
+
+    for (uint64_t pos = tail; pos < end; ++pos) {
+        shm::Slot& slot = ring->slots[pos & kRingMask];
+
+        ShmReqHandle* handle = free_handles_;
+        if (handle) {
+            free_handles_ = handle->next_free;
+        } else {
+            handles_.emplace_back();
+            handle = &handles_.back();
+        }
+        handle->next_free = nullptr;
+        handle->session = session_idx;
+        handle->req_idx = slot.header.req_idx;
+
+        // 请求数据直接指向环中的槽位: 本批处理完之后才推进 tail，处理函数返回前一直有效
+        handle->req_msgbuf_.buf_ = slot.data;
+        handle->req_msgbuf_.max_data_size_ = slot.header.data_size;
+        handle->req_msgbuf_.data_size_ = slot.header.data_size;
+        handle->pre_resp_msgbuf_.buf_ = handle->resp_storage;
+        handle->pre_resp_msgbuf_.max_data_size_ = shm::kMaxMsgSize;
+        handle->pre_resp_msgbuf_.data_size_ = shm::kMaxMsgSize;
+
+        ReqFunc req_func = nexus_->req_func(slot.header.req_type);
+        if (!req_func) {
+            // 与 eRPC 一样每个请求都必须有响应，未注册的类型回复空消息
+            fprintf(stderr, "[%s] No handler for request type %u\n",
+                    name_.c_str(), slot.header.req_type);
+            resize_msg_buffer(&handle->pre_resp_msgbuf_, 0);
+            enqueue_response(handle, &handle->pre_resp_msgbuf_);
+            continue;
+        }
+        req_func(handle, context_);
+    }
+
+    if (end != tail) {
+        ring->tail.store(end, std::memory_order_release);
+    }
+}
+
+void ShmTransport::enqueue_request(int session, uint8_t req_type,
+                                   MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                                   ContFunc cont_func, void* tag) {
+    uint32_t req_idx;
+    if (!free_req_idx_.empty()) {
+        req_idx = free_req_idx_.back();
+        free_req_idx_.pop_back();
+    } else {
+        req_idx = static_cast<uint32_t>(pending_.size());
+        pending_.emplace_back();
+    }
+    pending_[req_idx] = {cont_func, tag, resp_msgbuf};
+
+    send(clients_[session].tx, req_idx, req_type, req_msgbuf);
+}
+
+void ShmTransport::enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) {
+    auto* handle = static_cast<ShmReqHandle*>(req_handle);
+    send(servers_[handle->session].tx, handle->req_idx, 0, resp_msgbuf);
+
+    handle->next_free = free_handles_;
+    free_handles_ = handle;
+}
+
+}  // namespace malcolm
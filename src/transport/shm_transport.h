@@ -0,0 +1,187 @@
+#pragma once
+
+/**
+ * 共享内存传输后端
+ *
+ * 每个注册了请求处理函数的端点 (进程端口 + rpc_id) 创建一个 POSIX 共享内存段
+ * /malcolm_shm_<port>_<rpc_id>，其中包含 kMaxSessions 个会话块。客户端 create_session()
+ * 时映射该段并原子地占用一个会话块; 每个会话块含两条单生产者单消费者环形队列:
+ *
+ *   req_ring:  客户端端点 → 服务端端点 (请求)
+ *   resp_ring: 服务端端点 → 客户端端点 (响应)
+ *
+ * 每条环只有一个生产者和一个消费者 (各自是单线程的 Transport)，因此只需 acquire/release 的
+ * head / tail 计数器，不需要锁或 CAS。消息定长 (kSlotSize)，内容按值拷贝进槽位，
+ * 不跨进程共享指针。请求通过客户端本地的请求编号与响应关联。
+ *
+ * 服务端尚未启动时会话保持 "连接中"，事件循环中定期重试，因此各进程的启动顺序无关。
+ * 环满时消息在本地排队，后续事件循环中按序发出 (与 eRPC 一样 enqueue 不会失败)。
+ */
+
+#include <atomic>
+#include <array>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "transport.h"
+#include "../common/types.h"
+
+namespace malcolm {
+
+namespace shm {
+
+constexpr size_t kSlotSize = 256;                  // 单条消息槽位 (含头部)
+constexpr size_t kRingSlots = 512;                 // 每条环的槽位数 (2 的幂)
+constexpr size_t kMaxSessions = 64;                // 每个端点最多接受的会话数
+constexpr uint64_t kEndpointMagic = 0x4d414c434f4c4d31ULL;  // "MALCOLM1"
+
+struct MsgHeader {
+    uint32_t req_idx;      // 请求方本地的请求编号 (响应原样带回)
+    uint16_t data_size;
+    uint8_t  req_type;
+    uint8_t  _padding;
+};
+
+constexpr size_t kMaxMsgSize = kSlotSize - sizeof(MsgHeader);
+
+struct Slot {
+    MsgHeader header;
+    uint8_t data[kMaxMsgSize];
+};
+static_assert(sizeof(Slot) == kSlotSize, "slot layout");
+
+/**
+ * 单生产者单消费者环 (位于共享内存，零初始化即为空)
+ */
+struct Ring {
+    alignas(64) std::atomic<uint64_t> head;   // 生产者写入位置
+    alignas(64) std::atomic<uint64_t> tail;   // 消费者读取位置
+    alignas(64) Slot slots[kRingSlots];
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring counters must be lock-free");
+
+struct SessionBlock {
+    std::atomic<uint32_t> ready;   // 客户端完成占用后置 1
+    Ring req_ring;
+    Ring resp_ring;
+};
+
+struct Endpoint {
+    std::atomic<uint64_t> magic;          // 服务端初始化完成后写入
+    int32_t server_pid;                   // 用于识别异常退出后遗留的段
+    std::atomic<uint32_t> num_sessions;   // 已被占用的会话块数 (客户端 fetch_add 占用)
+    SessionBlock sessions[kMaxSessions];
+};
+
+/// 共享内存段名称
+std::string endpoint_name(uint16_t port, uint8_t rpc_id);
+
+}  // namespace shm
+
+class ShmNexus : public TransportNexus {
+public:
+    explicit ShmNexus(const std::string& local_uri);
+
+    void register_req_func(uint8_t req_type, ReqFunc req_func) override;
+
+    std::unique_ptr<Transport> create_rpc(void* context, uint8_t rpc_id,
+                                          uint8_t phy_port, const std::string& name) override;
+
+    uint16_t port() const { return port_; }
+    bool has_req_funcs() const { return num_req_funcs_ > 0; }
+    ReqFunc req_func(uint8_t req_type) const { return req_funcs_[req_type]; }
+
+private:
+    uint16_t port_;
+    std::array<ReqFunc, 256> req_funcs_{};
+    size_t num_req_funcs_ = 0;
+};
+
+class ShmTransport : public Transport {
+public:
+    ShmTransport(ShmNexus* nexus, void* context, uint8_t rpc_id, const std::string& name);
+    ~ShmTransport() override;
+
+    int create_session(const std::string& remote_uri, uint8_t remote_rpc_id) override;
+    bool is_connected(int session) const override;
+    void run_event_loop_once() override;
+
+    MsgBuffer alloc_msg_buffer_or_die(size_t max_data_size) override;
+    void free_msg_buffer(MsgBuffer& msgbuf) override;
+
+    void enqueue_request(int session, uint8_t req_type,
+                         MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                         ContFunc cont_func, void* tag) override;
+    void enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) override;
+
+    /// 一轮事件循环中每条环最多处理的消息数
+    static constexpr size_t kRxBatch = 32;
+
+private:
+    /// 发送方向 (一条环 + 环满时的本地积压)
+    struct TxQueue {
+        shm::Ring* ring = nullptr;
+        std::deque<shm::Slot> backlog;
+    };
+
+    /// 本端点发起的会话 (客户端角色)
+    struct ClientSession {
+        std::string remote_name;
+        Timestamp next_retry = 0;         // UINT64_MAX 表示放弃 (远端会话块已满)
+        void* mapping = nullptr;
+        shm::SessionBlock* block = nullptr;
+        TxQueue tx;                       // req_ring
+    };
+
+    /// 远端发起的会话 (服务端角色)
+    struct ServerSession {
+        shm::SessionBlock* block = nullptr;
+        TxQueue tx;                       // resp_ring
+    };
+
+    struct ShmReqHandle : ReqHandle {
+        uint32_t session = 0;             // servers_ 下标
+        uint32_t req_idx = 0;
+        ShmReqHandle* next_free = nullptr;
+        uint8_t resp_storage[shm::kMaxMsgSize];
+    };
+
+    struct PendingReq {
+        ContFunc cont_func = nullptr;
+        void* tag = nullptr;
+        MsgBuffer* resp_msgbuf = nullptr;
+    };
+
+    bool try_connect(ClientSession& cs);
+    void accept_sessions();
+
+    /// 写入一条消息; 环满 (或已有积压) 时进入本地积压
+    static void send(TxQueue& tx, uint32_t req_idx, uint8_t req_type, const MsgBuffer* msgbuf);
+    static void flush(TxQueue& tx);
+
+    void poll_responses(ClientSession& cs);
+    void poll_requests(uint32_t session_idx);
+
+    ShmNexus* nexus_;
+    void* context_;
+    std::string name_;
+
+    // 服务端角色: 本端点的共享内存段 (未注册请求处理函数时为空)
+    std::string endpoint_name_;
+    shm::Endpoint* endpoint_ = nullptr;
+    std::vector<ServerSession> servers_;
+
+    std::vector<ClientSession> clients_;
+    size_t num_connecting_ = 0;           // 尚未连上的会话数 (为 0 时事件循环不检查重试)
+
+    // 在途请求表 (下标即 req_idx，空闲编号栈复用)
+    std::vector<PendingReq> pending_;
+    std::vector<uint32_t> free_req_idx_;
+
+    // 请求句柄池 (deque 保证地址稳定)
+    std::deque<ShmReqHandle> handles_;
+    ShmReqHandle* free_handles_ = nullptr;
+};
+
+}  // namespace malcolm
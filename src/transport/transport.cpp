@@ -0,0 +1,48 @@
+/**
+ * 传输后端工厂
+ */
+
+#include "transport.h"
+#include "shm_transport.h"
+#include "udp_transport.h"
+
+#ifdef MALCOLM_HAVE_ERPC
+#include "erpc_transport.h"
+#endif
+
+#include <cstdio>
+
+namespace malcolm {
+
+bool parse_transport_type(const std::string& name, TransportType* type) {
+    if (name == "erpc") {
+        *type = TransportType::kERPC;
+    } else if (name == "shm") {
+        *type = TransportType::kShm;
+    } else if (name == "udp") {
+        *type = TransportType::kUdp;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<TransportNexus> create_transport_nexus(TransportType type,
+                                                       const std::string& local_uri) {
+    switch (type) {
+        case TransportType::kERPC:
+#ifdef MALCOLM_HAVE_ERPC
+            return std::make_unique<ErpcNexus>(local_uri);
+#else
+            fprintf(stderr, "eRPC transport not built (configure with USE_RDMA or USE_DPDK)\n");
+            return nullptr;
+#endif
+        case TransportType::kShm:
+            return std::make_unique<ShmNexus>(local_uri);
+        case TransportType::kUdp:
+            return std::make_unique<UdpNexus>(local_uri);
+    }
+    return nullptr;
+}
+
+}  // namespace malcolm
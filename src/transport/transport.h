@@ -0,0 +1,156 @@
+#pragma once
+
+/**
+ * 传输层接口
+ *
+ * Client / LB / Worker 只依赖这里的接口，不直接依赖 eRPC。接口按 eRPC 的使用方式抽取
+ * (Nexus 注册请求处理函数、每线程一个 Rpc 端点、会话、enqueue_request/enqueue_response、
+ * 事件循环、MsgBuffer)，语义也与 eRPC 保持一致:
+ * - 每个请求必须且只能得到一个响应，响应按 (会话, 请求) 关联后回调 continuation
+ * - 请求处理函数中 req_msgbuf 只在处理函数返回前有效，需要延后处理的数据须拷贝
+ * - ReqHandle 在 enqueue_response() 之前一直有效，响应可以在之后的事件循环中发出
+ * - Transport 不是线程安全的，所有操作都必须在创建它的线程中执行
+ *
+ * 后端:
+ * - erpc: RDMA / DPDK 上的 eRPC (编译时找到 eRPC 才可用)
+ * - shm:  POSIX 共享内存上的单生产者单消费者环形队列，同一台 Linux 主机上的进程 (或线程) 之间通信，
+ *         不需要网卡，用于开发机 / CI 上运行完整链路，并把 LB / Worker 开销与网卡开销分开测量
+ * - udp:  内核 UDP socket，recvmmsg / sendmmsg 批量收发，单机多进程或普通以太网上运行
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace malcolm {
+
+// ==================== 后端类型 ====================
+
+enum class TransportType {
+    kERPC,   // eRPC (RDMA / DPDK)
+    kShm,    // 共享内存环形队列 (单机)
+    kUdp,    // 内核 UDP (单机或普通以太网)
+};
+
+#ifdef MALCOLM_HAVE_ERPC
+constexpr TransportType kDefaultTransport = TransportType::kERPC;
+#else
+constexpr TransportType kDefaultTransport = TransportType::kShm;
+#endif
+
+inline const char* transport_type_name(TransportType type) {
+    switch (type) {
+        case TransportType::kERPC: return "erpc";
+        case TransportType::kShm: return "shm";
+        case TransportType::kUdp: return "udp";
+        default: return "unknown";
+    }
+}
+
+/// 解析命令行中的后端名称，无法识别时返回 false
+bool parse_transport_type(const std::string& name, TransportType* type);
+
+// ==================== 消息缓冲区 ====================
+
+/**
+ * 消息缓冲区 (字段名与 erpc::MsgBuffer 一致)
+ *
+ * 由 Transport::alloc_msg_buffer_or_die() 分配，必须由同一个 Transport 释放。
+ * 作为响应缓冲区时，收到响应后 data_size_ 被设置为实际收到的字节数。
+ */
+struct MsgBuffer {
+    uint8_t* buf_ = nullptr;
+    size_t max_data_size_ = 0;
+    size_t data_size_ = 0;
+    void* backend_ = nullptr;    // 后端私有数据 (eRPC: 对应的 erpc::MsgBuffer)
+};
+
+/**
+ * 服务端收到的请求句柄 (后端派生并池化)
+ */
+struct ReqHandle {
+    MsgBuffer req_msgbuf_;        // 请求数据 (只在请求处理函数返回前有效)
+    MsgBuffer pre_resp_msgbuf_;   // 预分配的响应缓冲区 (单包大小)
+
+    const MsgBuffer* get_req_msgbuf() const { return &req_msgbuf_; }
+};
+
+/// 请求处理函数 (context 为创建 Transport 时传入的上下文)
+using ReqFunc = void (*)(ReqHandle* req_handle, void* context);
+
+/// 响应回调 (context 为创建 Transport 时传入的上下文，tag 为 enqueue_request 传入的 tag)
+using ContFunc = void (*)(void* context, void* tag);
+
+// ==================== 传输端点 ====================
+
+/**
+ * 每线程一个的传输端点 (对应 erpc::Rpc)
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /// 建立到远端 (uri, rpc_id) 的会话，失败返回负数; 会话建立是异步的，用 is_connected() 轮询
+    virtual int create_session(const std::string& remote_uri, uint8_t remote_rpc_id) = 0;
+
+    virtual bool is_connected(int session) const = 0;
+
+    /// 处理一轮收发 (执行到达请求的处理函数和到达响应的回调)
+    virtual void run_event_loop_once() = 0;
+
+    /// 分配消息缓冲区，超过后端支持的最大消息大小时终止进程
+    virtual MsgBuffer alloc_msg_buffer_or_die(size_t max_data_size) = 0;
+
+    virtual void free_msg_buffer(MsgBuffer& msgbuf) = 0;
+
+    /// 设置缓冲区中有效数据的大小 (不超过分配时的大小)
+    static void resize_msg_buffer(MsgBuffer* msgbuf, size_t data_size) {
+        msgbuf->data_size_ = data_size <= msgbuf->max_data_size_ ? data_size : msgbuf->max_data_size_;
+    }
+
+    /**
+     * 发送请求 (不会失败: 发送队列满时在本地排队，后续事件循环中发出)
+     *
+     * resp_msgbuf 在响应回调执行前必须保持有效
+     */
+    virtual void enqueue_request(int session, uint8_t req_type,
+                                 MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                                 ContFunc cont_func, void* tag) = 0;
+
+    /// 回复请求，调用后 req_handle 失效
+    virtual void enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) = 0;
+};
+
+/**
+ * 每进程一个的传输上下文 (对应 erpc::Nexus)
+ */
+class TransportNexus {
+public:
+    virtual ~TransportNexus() = default;
+
+    /// 注册请求处理函数 (必须在 create_rpc() 之前调用)
+    virtual void register_req_func(uint8_t req_type, ReqFunc req_func) = 0;
+
+    /**
+     * 创建传输端点 (之后的所有操作都必须在调用线程中执行)
+     *
+     * @param context 传给请求处理函数和响应回调的上下文
+     * @param rpc_id 本进程内的端点编号 (远端 create_session 时使用)
+     * @param phy_port 物理端口 (仅 eRPC 使用)
+     * @param name 日志前缀 (如 "LB T0")
+     */
+    virtual std::unique_ptr<Transport> create_rpc(void* context, uint8_t rpc_id,
+                                                  uint8_t phy_port, const std::string& name) = 0;
+};
+
+/**
+ * 创建传输上下文
+ *
+ * @param local_uri 本进程地址 (ip:port); shm / udp 后端只使用端口号 (udp 绑定 port + rpc_id)
+ * @return 后端未编译进来时打印错误并返回 nullptr
+ */
+std::unique_ptr<TransportNexus> create_transport_nexus(TransportType type,
+                                                       const std::string& local_uri);
+
+}  // namespace malcolm
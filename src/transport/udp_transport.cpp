@@ -0,0 +1,529 @@
+/**
+ * 内核 UDP 传输后端实现
+ */
+
+#include "udp_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+namespace malcolm {
+
+namespace {
+
+// 服务端未响应握手时的重试间隔
+constexpr Timestamp kConnectRetryNs = ms_to_ns(10);
+
+// 请求重传超时 (指数退避) 及检查间隔。重复请求在服务端去重，
+// 慢请求被误判超时只多发一个报文，不会重复执行
+constexpr Timestamp kRetransmitNs = ms_to_ns(20);
+constexpr Timestamp kMaxRetransmitNs = ms_to_ns(1000);
+constexpr Timestamp kRtoScanNs = ms_to_ns(1);
+
+// 一轮事件循环中 recvmmsg 的最大次数 (避免接收把发送饿死)
+constexpr int kMaxRxRounds = 4;
+
+// socket 收发缓冲区 (受 net.core.rmem_max / wmem_max 限制)
+constexpr int kSocketBufferBytes = 8 << 20;
+
+// 从 "ip:port" 中拆出主机和端口，失败返回 false
+bool split_uri(const std::string& uri, std::string* host, uint16_t* port) {
+    size_t colon = uri.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    *host = uri.substr(0, colon);
+    unsigned long value = strtoul(uri.c_str() + colon + 1, nullptr, 10);
+    if (value == 0 || value > UINT16_MAX) {
+        return false;
+    }
+    *port = static_cast<uint16_t>(value);
+    return true;
+}
+
+bool resolve(const std::string& host, uint16_t port, sockaddr_in* addr) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+        return false;
+    }
+    *addr = *reinterpret_cast<const sockaddr_in*>(result->ai_addr);
+    addr->sin_port = htons(port);
+    freeaddrinfo(result);
+    return true;
+}
+
+inline uint64_t peer_key(const sockaddr_in& addr) {
+    return (static_cast<uint64_t>(ntohl(addr.sin_addr.s_addr)) << 16) | ntohs(addr.sin_port);
+}
+
+inline void write_header(uint8_t* packet, uint64_t req_id, uint8_t pkt_type,
+                         uint8_t req_type, size_t data_size, uint32_t incarnation) {
+    udp::PacketHeader hdr{};
+    hdr.req_id = req_id;
+    hdr.data_size = static_cast<uint16_t>(data_size);
+    hdr.req_type = req_type;
+    hdr.pkt_type = pkt_type;
+    hdr.incarnation = incarnation;
+    std::memcpy(packet, &hdr, sizeof(hdr));
+}
+
+}  // namespace
+
+// ==================== UdpNexus ====================
+
+UdpNexus::UdpNexus(const std::string& local_uri, size_t batch_size)
+    : port_(0),
+      batch_size_(std::min(std::max<size_t>(batch_size, 1), udp::kMaxBatch)) {
+    std::string host;
+    split_uri(local_uri, &host, &port_);
+}
+
+void UdpNexus::register_req_func(uint8_t req_type, ReqFunc req_func) {
+    if (!req_funcs_[req_type]) {
+        ++num_req_funcs_;
+    }
+    req_funcs_[req_type] = req_func;
+}
+
+std::unique_ptr<Transport> UdpNexus::create_rpc(void* context, uint8_t rpc_id,
+                                                uint8_t phy_port, const std::string& name) {
+    (void)phy_port;
+    return std::make_unique<UdpTransport>(this, context, rpc_id, name);
+}
+
+// ==================== UdpTransport ====================
+
+UdpTransport::UdpTransport(UdpNexus* nexus, void* context, uint8_t rpc_id, const std::string& name)
+    : nexus_(nexus), context_(context), name_(name), batch_(nexus->batch_size()) {
+    // 重启后的进程复用同一端口，靠实例编号让对端区分新旧实例
+    do {
+        incarnation_ = static_cast<uint32_t>(std::random_device{}() ^ now_ns());
+    } while (incarnation_ == 0);
+
+    // 只有需要接收请求的端点绑定固定端口
+    uint32_t port = 0;
+    if (nexus_->has_req_funcs()) {
+        port = static_cast<uint32_t>(nexus_->port()) + rpc_id;
+        if (nexus_->port() == 0 || port > UINT16_MAX) {
+            throw std::runtime_error("[" + name_ + "] invalid UDP port for rpc_id " +
+                                     std::to_string(rpc_id));
+        }
+    }
+
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("socket() failed: ") + strerror(errno));
+    }
+    int bytes = kSocketBufferBytes;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd_, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        int err = errno;
+        close(fd_);
+        throw std::runtime_error("bind(" + std::to_string(port) + ") failed: " + strerror(err));
+    }
+    socklen_t len = sizeof(local);
+    getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &len);
+
+    // 接收描述符只需设置一次 (msg_namelen 每次接收前重置)
+    rx_buffers_.resize(udp::kMaxBatch * udp::kMaxPacketSize);
+    for (size_t i = 0; i < udp::kMaxBatch; ++i) {
+        rx_iovs_[i].iov_base = rx_buffers_.data() + i * udp::kMaxPacketSize;
+        rx_iovs_[i].iov_len = udp::kMaxPacketSize;
+        std::memset(&rx_msgs_[i], 0, sizeof(mmsghdr));
+        rx_msgs_[i].msg_hdr.msg_name = &rx_addrs_[i];
+        rx_msgs_[i].msg_hdr.msg_iov = &rx_iovs_[i];
+        rx_msgs_[i].msg_hdr.msg_iovlen = 1;
+        std::memset(&tx_msgs_[i], 0, sizeof(mmsghdr));
+        tx_msgs_[i].msg_hdr.msg_iov = &tx_iovs_[i];
+        tx_msgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+    tx_queue_.reserve(2 * batch_);
+
+    printf("[%s] UDP endpoint on port %u (batch %zu)\n",
+           name_.c_str(), ntohs(local.sin_port), batch_);
+}
+
+UdpTransport::~UdpTransport() {
+    flush_tx();
+    if (packets_sent_ + packets_recv_ > 0) {
+        printf("[%s] UDP: sent %lu packets (%.1f per sendmmsg), received %lu (%.1f per recvmmsg), "
+               "%lu retransmits, %lu duplicates\n",
+               name_.c_str(),
+               packets_sent_, tx_calls_ ? static_cast<double>(packets_sent_) / tx_calls_ : 0.0,
+               packets_recv_, rx_calls_ ? static_cast<double>(packets_recv_) / rx_calls_ : 0.0,
+               retransmits_, duplicates_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int UdpTransport::create_session(const std::string& remote_uri, uint8_t remote_rpc_id) {
+    std::string host;
+    uint16_t port = 0;
+    sockaddr_in addr{};
+    if (!split_uri(remote_uri, &host, &port) || port + remote_rpc_id > UINT16_MAX ||
+        !resolve(host, static_cast<uint16_t>(port + remote_rpc_id), &addr)) {
+        fprintf(stderr, "[%s] Invalid remote address %s\n", name_.c_str(), remote_uri.c_str());
+        return -1;
+    }
+
+    sessions_.emplace_back();
+    sessions_.back().addr = addr;
+    ++num_connecting_;
+    // 握手在下一轮事件循环中发出
+    return static_cast<int>(sessions_.size() - 1);
+}
+
+bool UdpTransport::is_connected(int session) const {
+    return session >= 0 && static_cast<size_t>(session) < sessions_.size() &&
+           sessions_[session].connected;
+}
+
+void UdpTransport::run_event_loop_once() {
+    if (num_connecting_ > 0 || num_pending_ > 0) {
+        Timestamp now = now_ns();
+        if (num_connecting_ > 0) {
+            retry_connects(now);
+        }
+        retransmit_expired(now);
+    }
+
+    flush_tx();
+    poll_rx();
+    flush_tx();
+}
+
+MsgBuffer UdpTransport::alloc_msg_buffer_or_die(size_t max_data_size) {
+    if (max_data_size > udp::kMaxMsgSize) {
+        fprintf(stderr, "[%s] Message size %zu exceeds UDP transport limit %zu\n",
+                name_.c_str(), max_data_size, udp::kMaxMsgSize);
+        std::abort();
+    }
+    MsgBuffer msgbuf;
+    msgbuf.buf_ = new uint8_t[udp::kMaxMsgSize];
+    msgbuf.max_data_size_ = max_data_size;
+    msgbuf.data_size_ = max_data_size;
+    return msgbuf;
+}
+
+void UdpTransport::free_msg_buffer(MsgBuffer& msgbuf) {
+    delete[] msgbuf.buf_;
+    msgbuf = MsgBuffer{};
+}
+
+// ==================== 发送 ====================
+
+uint8_t* UdpTransport::queue_packet(const sockaddr_in& addr, size_t size) {
+    if (tx_queue_.size() - tx_head_ >= batch_) {
+        flush_tx();
+    }
+    tx_queue_.emplace_back();
+    Packet& pkt = tx_queue_.back();
+    pkt.addr = addr;
+    pkt.size = static_cast<uint16_t>(size);
+    return pkt.data;
+}
+
+void UdpTransport::queue_control(const sockaddr_in& addr, uint8_t pkt_type, uint64_t req_id) {
+    write_header(queue_packet(addr, sizeof(udp::PacketHeader)), req_id, pkt_type, 0, 0, incarnation_);
+}
+
+void UdpTransport::flush_tx() {
+    while (tx_head_ < tx_queue_.size()) {
+        size_t n = std::min(batch_, tx_queue_.size() - tx_head_);
+        for (size_t i = 0; i < n; ++i) {
+            Packet& pkt = tx_queue_[tx_head_ + i];
+            tx_iovs_[i].iov_base = pkt.data;
+            tx_iovs_[i].iov_len = pkt.size;
+            tx_msgs_[i].msg_hdr.msg_name = &pkt.addr;
+            tx_msgs_[i].msg_hdr.msg_namelen = sizeof(pkt.addr);
+        }
+
+        ++tx_calls_;
+        int sent = sendmmsg(fd_, tx_msgs_.data(), static_cast<unsigned>(n), MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                break;  // 发送缓冲区满，留到下一轮事件循环
+            }
+            // 其它错误只影响队首报文: 丢弃它，请求由重传恢复
+            fprintf(stderr, "[%s] sendmmsg failed: %s\n", name_.c_str(), strerror(errno));
+            ++tx_head_;
+            continue;
+        }
+        tx_head_ += static_cast<size_t>(sent);
+        packets_sent_ += static_cast<uint64_t>(sent);
+        if (static_cast<size_t>(sent) < n) {
+            break;
+        }
+    }
+
+    if (tx_head_ == tx_queue_.size()) {
+        tx_queue_.clear();
+        tx_head_ = 0;
+    } else if (tx_head_ > 0) {
+        tx_queue_.erase(tx_queue_.begin(), tx_queue_.begin() + static_cast<ptrdiff_t>(tx_head_));
+        tx_head_ = 0;
+    }
+}
+
+void UdpTransport::enqueue_request(int session, uint8_t req_type,
+                                   MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                                   ContFunc cont_func, void* tag) {
+    uint32_t req_idx;
+    if (!free_req_idx_.empty()) {
+        req_idx = free_req_idx_.back();
+        free_req_idx_.pop_back();
+    } else {
+        req_idx = static_cast<uint32_t>(pending_.size());
+        pending_.emplace_back();
+    }
+    ++num_pending_;
+
+    PendingReq& pr = pending_[req_idx];
+    pr.cont_func = cont_func;
+    pr.tag = tag;
+    pr.resp_msgbuf = resp_msgbuf;
+    pr.gen = pr.gen + 1 == 0 ? 1 : pr.gen + 1;
+    pr.session = session;
+    pr.sent_at = now_ns();
+    pr.rto = kRetransmitNs;
+
+    size_t size = std::min(req_msgbuf->data_size_, udp::kMaxMsgSize);
+    pr.packet.resize(sizeof(udp::PacketHeader) + size);
+    write_header(pr.packet.data(), (static_cast<uint64_t>(pr.gen) << 32) | req_idx,
+                 udp::kRequest, req_type, size, incarnation_);
+    std::memcpy(pr.packet.data() + sizeof(udp::PacketHeader), req_msgbuf->buf_, size);
+
+    std::memcpy(queue_packet(sessions_[session].addr, pr.packet.size()),
+                pr.packet.data(), pr.packet.size());
+}
+
+void UdpTransport::enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) {
+    auto* handle = static_cast<UdpReqHandle*>(req_handle);
+    size_t size = std::min(resp_msgbuf->data_size_, udp::kMaxMsgSize);
+    size_t packet_size = sizeof(udp::PacketHeader) + size;
+
+    // 请求方已重启: 旧实例的请求不再回复 (它的去重状态已清空，slot 下标可能越界)
+    if (handle->peer_state->incarnation == handle->incarnation) {
+        uint8_t* pkt = queue_packet(handle->peer, packet_size);
+        write_header(pkt, handle->req_id, udp::kResponse, 0, size, handle->incarnation);
+        std::memcpy(pkt + sizeof(udp::PacketHeader), resp_msgbuf->buf_, size);
+
+        // 缓存响应，响应丢失后对端重传的请求直接用它回复
+        PeerSlot& slot = handle->peer_state->slots[handle->slot];
+        if (slot.gen == static_cast<uint32_t>(handle->req_id >> 32)) {
+            slot.responded = true;
+            slot.resp_packet.assign(pkt, pkt + packet_size);
+        }
+    }
+
+    handle->peer_state = nullptr;
+    handle->next_free = free_handles_;
+    free_handles_ = handle;
+}
+
+void UdpTransport::retry_connects(Timestamp now) {
+    for (size_t i = 0; i < sessions_.size(); ++i) {
+        ClientSession& cs = sessions_[i];
+        if (!cs.connected && now >= cs.next_retry) {
+            cs.next_retry = now + kConnectRetryNs;
+            queue_control(cs.addr, udp::kConnect, i);
+        }
+    }
+}
+
+void UdpTransport::retransmit_expired(Timestamp now) {
+    if (num_pending_ == 0 || now < next_rto_scan_) {
+        return;
+    }
+    next_rto_scan_ = now + kRtoScanNs;
+    for (auto& pr : pending_) {
+        if (pr.cont_func && now - pr.sent_at >= pr.rto) {
+            pr.sent_at = now;
+            pr.rto = std::min(pr.rto * 2, kMaxRetransmitNs);
+            ++retransmits_;
+            std::memcpy(queue_packet(sessions_[pr.session].addr, pr.packet.size()),
+                        pr.packet.data(), pr.packet.size());
+        }
+    }
+}
+
+// ==================== 接收 ====================
+
+void UdpTransport::poll_rx() {
+    for (int round = 0; round < kMaxRxRounds; ++round) {
+        for (size_t i = 0; i < batch_; ++i) {
+            rx_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+        int received = recvmmsg(fd_, rx_msgs_.data(), static_cast<unsigned>(batch_),
+                                MSG_DONTWAIT, nullptr);
+        if (received <= 0) {
+            break;
+        }
+        ++rx_calls_;
+        packets_recv_ += static_cast<uint64_t>(received);
+        for (int i = 0; i < received; ++i) {
+            handle_packet(static_cast<const uint8_t*>(rx_iovs_[i].iov_base),
+                          rx_msgs_[i].msg_len, rx_addrs_[i]);
+        }
+        if (static_cast<size_t>(received) < batch_) {
+            break;
+        }
+    }
+}
+
+void UdpTransport::handle_packet(const uint8_t* data, size_t size, const sockaddr_in& from) {
+    udp::PacketHeader hdr;
+    if (size < sizeof(hdr)) {
+        return;
+    }
+    std::memcpy(&hdr, data, sizeof(hdr));
+    if (hdr.data_size > size - sizeof(hdr)) {
+        return;
+    }
+    const uint8_t* payload = data + sizeof(hdr);
+
+    switch (hdr.pkt_type) {
+        case udp::kRequest:
+            handle_request(hdr, payload, from);
+            break;
+        case udp::kResponse:
+            handle_response(hdr, payload);
+            break;
+        case udp::kConnect:
+            peer_state(from, hdr.incarnation);
+            queue_control(from, udp::kConnectAck, hdr.req_id);
+            break;
+        case udp::kConnectAck:
+            if (hdr.req_id < sessions_.size() && !sessions_[hdr.req_id].connected) {
+                sessions_[hdr.req_id].connected = true;
+                --num_connecting_;
+                char ip[INET_ADDRSTRLEN];
+                inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+                printf("[%s] Session %lu connected to %s:%u\n",
+                       name_.c_str(), hdr.req_id, ip, ntohs(from.sin_port));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+UdpTransport::PeerState& UdpTransport::peer_state(const sockaddr_in& from, uint32_t incarnation) {
+    PeerState& peer = peers_[peer_key(from)];
+    if (peer.incarnation != incarnation) {
+        // 新对端或对端重启 (代数从 1 重新开始): 旧的去重状态会把新请求当成迟到的旧报文丢弃
+        if (peer.incarnation != 0) {
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+            printf("[%s] Peer %s:%u restarted, request dedup state reset\n",
+                   name_.c_str(), ip, ntohs(from.sin_port));
+        }
+        peer.incarnation = incarnation;
+        peer.slots.clear();
+    }
+    return peer;
+}
+
+void UdpTransport::handle_request(const udp::PacketHeader& hdr, const uint8_t* payload,
+                                  const sockaddr_in& from) {
+    PeerState& peer = peer_state(from, hdr.incarnation);
+    uint32_t slot_idx = static_cast<uint32_t>(hdr.req_id);
+    uint32_t gen = static_cast<uint32_t>(hdr.req_id >> 32);
+    if (slot_idx >= peer.slots.size()) {
+        peer.slots.resize(static_cast<size_t>(slot_idx) + 1);
+    }
+
+    // 去重: 同一代数是重传，更早的代数是迟到的旧报文
+    PeerSlot& slot = peer.slots[slot_idx];
+    if (slot.gen == gen || (slot.gen != 0 && static_cast<int32_t>(gen - slot.gen) < 0)) {
+        ++duplicates_;
+        if (slot.gen == gen && slot.responded) {
+            std::memcpy(queue_packet(from, slot.resp_packet.size()),
+                        slot.resp_packet.data(), slot.resp_packet.size());
+        }
+        return;
+    }
+    slot.gen = gen;
+    slot.responded = false;
+
+    UdpReqHandle* handle = free_handles_;
+    if (handle) {
+        free_handles_ = handle->next_free;
+    } else {
+        handles_.emplace_back();
+        handle = &handles_.back();
+    }
+    handle->next_free = nullptr;
+    handle->peer = from;
+    handle->peer_state = &peer;
+    handle->slot = slot_idx;
+    handle->req_id = hdr.req_id;
+    handle->incarnation = hdr.incarnation;
+
+    // 请求数据直接指向接收缓冲区，下一次 recvmmsg 之前有效
+    handle->req_msgbuf_.buf_ = const_cast<uint8_t*>(payload);
+    handle->req_msgbuf_.max_data_size_ = hdr.data_size;
+    handle->req_msgbuf_.data_size_ = hdr.data_size;
+    handle->pre_resp_msgbuf_.buf_ = handle->resp_storage;
+    handle->pre_resp_msgbuf_.max_data_size_ = udp::kMaxMsgSize;
+    handle->pre_resp_msgbuf_.data_size_ = udp::kMaxMsgSize;
+
+    ReqFunc req_func = nexus_->req_func(hdr.req_type);
+    if (!req_func) {
+        // 与 eRPC 一样每个请求都必须有响应，未注册的类型回复空消息
+        fprintf(stderr, "[%s] No handler for request type %u\n", name_.c_str(), hdr.req_type);
+        resize_msg_buffer(&handle->pre_resp_msgbuf_, 0);
+        enqueue_response(handle, &handle->pre_resp_msgbuf_);
+        return;
+    }
+    req_func(handle, context_);
+}
+
+void UdpTransport::handle_response(const udp::PacketHeader& hdr, const uint8_t* payload) {
+    uint32_t req_idx = static_cast<uint32_t>(hdr.req_id);
+    uint32_t gen = static_cast<uint32_t>(hdr.req_id >> 32);
+    if (hdr.incarnation != incarnation_ || req_idx >= pending_.size() ||
+        !pending_[req_idx].cont_func || pending_[req_idx].gen != gen) {
+        ++duplicates_;  // 重传导致的重复响应
+        return;
+    }
+
+    // 先归还下标: continuation 中可能再次 enqueue_request
+    PendingReq& pr = pending_[req_idx];
+    ContFunc cont_func = pr.cont_func;
+    void* tag = pr.tag;
+    MsgBuffer* resp_msgbuf = pr.resp_msgbuf;
+    pr.cont_func = nullptr;
+    free_req_idx_.push_back(req_idx);
+    --num_pending_;
+
+    size_t size = std::min<size_t>(hdr.data_size, resp_msgbuf->max_data_size_);
+    std::memcpy(resp_msgbuf->buf_, payload, size);
+    resp_msgbuf->data_size_ = size;
+    cont_func(context_, tag);
+}
+
+}  // namespace malcolm
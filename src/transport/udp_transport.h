@@ -0,0 +1,208 @@
+#pragma once
+
+/**
+ * 内核 UDP 传输后端
+ *
+ * 每个 Transport 一个非阻塞 UDP socket。注册了请求处理函数的端点绑定
+ * <port + rpc_id> (与 eRPC 一样远端用 (uri, rpc_id) 寻址)，只发请求的端点 (Client)
+ * 绑定临时端口。收发都按批进行:
+ *
+ *   接收: 每轮事件循环 recvmmsg() 一次最多取 batch 个报文
+ *   发送: enqueue_* 只把报文放入本地发送队列，攒满 batch 或事件循环结束时 sendmmsg() 一次发出
+ *
+ * batch = 1 时退化为每个报文一次系统调用，用于测量批处理的收益。
+ *
+ * 可靠性与 eRPC 的语义一致 (每个请求恰好一个响应，处理函数至多执行一次):
+ * - 请求编号 = (代数 << 32) | 在途表下标，下标复用时代数加一，迟到的旧响应直接丢弃
+ * - 请求超时未收到响应时重传; 服务端按 (对端地址, 下标) 记录最近一次请求的代数，
+ *   处理中的重复请求丢弃，已回复的重复请求重发缓存的响应，不会重复执行
+ * - 每个端点实例有随机的实例编号，随请求 / 握手发送，响应回显请求方的编号。对端重启后
+ *   (同一地址、编号变化) 服务端清空它的去重状态，旧实例的在途请求不再回复;
+ *   请求方丢弃编号不是自己的响应
+ * 会话建立是一次 Connect / ConnectAck 握手，服务端未启动时定期重试。
+ */
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "transport.h"
+#include "../common/types.h"
+
+namespace malcolm {
+
+namespace udp {
+
+constexpr size_t kMaxMsgSize = 1024;         // 单条消息上限 (单个报文，不分片)
+constexpr size_t kDefaultBatch = 32;         // 每次 recvmmsg / sendmmsg 的报文数
+constexpr size_t kMaxBatch = 64;
+
+enum PacketType : uint8_t {
+    kRequest = 0,
+    kResponse = 1,
+    kConnect = 2,
+    kConnectAck = 3,
+};
+
+struct PacketHeader {
+    uint64_t req_id;       // 请求: (代数 << 32) | 下标; 握手: 会话编号
+    uint16_t data_size;
+    uint8_t  req_type;
+    uint8_t  pkt_type;
+    uint32_t incarnation;  // 请求 / 握手: 发送端实例编号; 响应: 回显请求方的编号
+};
+
+constexpr size_t kMaxPacketSize = sizeof(PacketHeader) + kMaxMsgSize;
+
+}  // namespace udp
+
+class UdpNexus : public TransportNexus {
+public:
+    explicit UdpNexus(const std::string& local_uri, size_t batch_size = udp::kDefaultBatch);
+
+    void register_req_func(uint8_t req_type, ReqFunc req_func) override;
+
+    std::unique_ptr<Transport> create_rpc(void* context, uint8_t rpc_id,
+                                          uint8_t phy_port, const std::string& name) override;
+
+    uint16_t port() const { return port_; }
+    size_t batch_size() const { return batch_size_; }
+    bool has_req_funcs() const { return num_req_funcs_ > 0; }
+    ReqFunc req_func(uint8_t req_type) const { return req_funcs_[req_type]; }
+
+private:
+    uint16_t port_;
+    size_t batch_size_;
+    std::array<ReqFunc, 256> req_funcs_{};
+    size_t num_req_funcs_ = 0;
+};
+
+class UdpTransport : public Transport {
+public:
+    UdpTransport(UdpNexus* nexus, void* context, uint8_t rpc_id, const std::string& name);
+    ~UdpTransport() override;
+
+    int create_session(const std::string& remote_uri, uint8_t remote_rpc_id) override;
+    bool is_connected(int session) const override;
+    void run_event_loop_once() override;
+
+    MsgBuffer alloc_msg_buffer_or_die(size_t max_data_size) override;
+    void free_msg_buffer(MsgBuffer& msgbuf) override;
+
+    void enqueue_request(int session, uint8_t req_type,
+                         MsgBuffer* req_msgbuf, MsgBuffer* resp_msgbuf,
+                         ContFunc cont_func, void* tag) override;
+    void enqueue_response(ReqHandle* req_handle, MsgBuffer* resp_msgbuf) override;
+
+private:
+    struct Packet {
+        sockaddr_in addr;
+        uint16_t size = 0;
+        alignas(8) uint8_t data[udp::kMaxPacketSize];
+    };
+
+    struct ClientSession {
+        sockaddr_in addr;
+        bool connected = false;
+        Timestamp next_retry = 0;
+    };
+
+    /// 服务端记录的对端请求槽位 (对端在途表的一个下标)
+    struct PeerSlot {
+        uint32_t gen = 0;                 // 最近一次请求的代数 (对端代数从 1 开始)
+        bool responded = false;
+        std::vector<uint8_t> resp_packet; // 已回复时缓存的响应报文 (用于重传)
+    };
+
+    struct PeerState {
+        uint32_t incarnation = 0;         // 对端实例编号 (0 = 尚未收到)
+        std::vector<PeerSlot> slots;
+    };
+
+    struct UdpReqHandle : ReqHandle {
+        sockaddr_in peer;
+        PeerState* peer_state = nullptr;  // unordered_map 的节点地址稳定
+        uint32_t slot = 0;
+        uint64_t req_id = 0;
+        uint32_t incarnation = 0;         // 请求方的实例编号
+        UdpReqHandle* next_free = nullptr;
+        uint8_t resp_storage[udp::kMaxMsgSize];
+    };
+
+    struct PendingReq {
+        ContFunc cont_func = nullptr;
+        void* tag = nullptr;
+        MsgBuffer* resp_msgbuf = nullptr;
+        uint32_t gen = 0;
+        int session = -1;
+        Timestamp sent_at = 0;
+        Timestamp rto = 0;                // 当前重传超时 (每次重传翻倍)
+        std::vector<uint8_t> packet;      // 请求报文副本 (用于重传)
+    };
+
+    /// 把报文放入发送队列，攒满一批时立即发送
+    uint8_t* queue_packet(const sockaddr_in& addr, size_t size);
+    void queue_control(const sockaddr_in& addr, uint8_t pkt_type, uint64_t req_id);
+    void flush_tx();
+
+    void poll_rx();
+    void handle_packet(const uint8_t* data, size_t size, const sockaddr_in& from);
+    void handle_request(const udp::PacketHeader& hdr, const uint8_t* payload,
+                        const sockaddr_in& from);
+    void handle_response(const udp::PacketHeader& hdr, const uint8_t* payload);
+
+    /// 按请求 / 握手中的实例编号识别对端重启，重启时清空它的去重状态
+    PeerState& peer_state(const sockaddr_in& from, uint32_t incarnation);
+
+    void retry_connects(Timestamp now);
+    void retransmit_expired(Timestamp now);
+
+    UdpNexus* nexus_;
+    void* context_;
+    std::string name_;
+    size_t batch_;
+    int fd_ = -1;
+    uint32_t incarnation_;                // 本实例编号 (随机，非 0)
+
+    std::vector<ClientSession> sessions_;
+    size_t num_connecting_ = 0;
+
+    // 在途请求表 (下标即请求编号低 32 位，空闲下标栈复用)
+    std::vector<PendingReq> pending_;
+    std::vector<uint32_t> free_req_idx_;
+    size_t num_pending_ = 0;
+    Timestamp next_rto_scan_ = 0;
+
+    // 服务端去重状态，按对端地址索引
+    std::unordered_map<uint64_t, PeerState> peers_;
+
+    // 请求句柄池 (deque 保证地址稳定)
+    std::deque<UdpReqHandle> handles_;
+    UdpReqHandle* free_handles_ = nullptr;
+
+    // 发送队列 (tx_head_ 之前的已发出) 和批量收发用的描述符
+    std::vector<Packet> tx_queue_;
+    size_t tx_head_ = 0;
+    std::array<mmsghdr, udp::kMaxBatch> tx_msgs_;
+    std::array<iovec, udp::kMaxBatch> tx_iovs_;
+    std::array<mmsghdr, udp::kMaxBatch> rx_msgs_;
+    std::array<iovec, udp::kMaxBatch> rx_iovs_;
+    std::array<sockaddr_in, udp::kMaxBatch> rx_addrs_;
+    std::vector<uint8_t> rx_buffers_;
+
+    // 统计
+    uint64_t tx_calls_ = 0;               // sendmmsg 次数
+    uint64_t rx_calls_ = 0;               // 取到报文的 recvmmsg 次数
+    uint64_t packets_sent_ = 0;
+    uint64_t packets_recv_ = 0;
+    uint64_t retransmits_ = 0;
+    uint64_t duplicates_ = 0;
+};
+
+}  // namespace malcolm
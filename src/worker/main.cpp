@@ -56,11 +56,20 @@ void print_usage(const char* prog) {
     printf("Options:\n");
     printf("  --id=N          Worker ID (default: 0)\n");
     printf("  --port=PORT     Listen port (default: 31850)\n");
+    printf("  --transport=T   Transport backend: erpc, shm, udp (default: %s)\n",
+           transport_type_name(kDefaultTransport));
     printf("  --threads=N     Number of RPC threads (default: 8)\n");
     printf("  --mode=MODE     Worker mode: 'fast' or 'slow' (default: fast)\n");
     printf("  --scheduler=S   Local scheduler: 'fcfs' or 'edf' (default: fcfs)\n");
+    printf("  --edf_queue=Q   EDF queue: 'heap' or 'wheel' (default: heap)\n");
     printf("  --capacity=F    Capacity factor (default: 1.0 for fast, 0.2 for slow)\n");
     printf("  --output=DIR    Metrics output directory\n");
+    printf("  --interval_ms=N Interval histogram log period, 0 = off (default: 1000)\n");
+    printf("  --queue_size=N  Task queue capacity, requests beyond it are rejected (default: 10000)\n");
+    printf("  --idle_spin_us=N  Compute thread spin time before parking when idle (default: 50)\n");
+    printf("  --lb=ADDR       LB address (ip:port) to push worker state to (default: no push)\n");
+    printf("  --state_push_us=N  Periodic state push interval (default: 100)\n");
+    printf("  --state_push_delta=N  Push early when queue length changes by N (default: 8, 0 = off)\n");
     printf("  --help          Show this help\n");
 }
 
@@ -80,15 +89,23 @@ int main(int argc, char* argv[]) {
         {"threads",   required_argument, 0, 't'},
         {"mode",      required_argument, 0, 'm'},
         {"scheduler", required_argument, 0, 's'},
+        {"edf_queue", required_argument, 0, 'e'},
         {"capacity",  required_argument, 0, 'c'},
         {"output",    required_argument, 0, 'o'},
+        {"interval_ms", required_argument, 0, 'M'},
+        {"queue_size", required_argument, 0, 'q'},
+        {"idle_spin_us", required_argument, 0, 'S'},
+        {"lb",        required_argument, 0, 'l'},
+        {"state_push_us", required_argument, 0, 'u'},
+        {"state_push_delta", required_argument, 0, 'd'},
+        {"transport", required_argument, 0, 'X'},
         {"help",      no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
     int option_index = 0;
-    while ((opt = getopt_long(argc, argv, "i:p:t:m:s:c:o:h", 
+    while ((opt = getopt_long(argc, argv, "i:p:X:t:m:s:e:c:o:M:q:S:l:u:d:h", 
                               long_options, &option_index)) != -1) {
         switch (opt) {
             case 'i':
@@ -110,12 +127,43 @@ int main(int argc, char* argv[]) {
                     config.scheduler = LocalSchedulerType::kFCFS;
                 }
                 break;
+            case 'e':
+                if (strcmp(optarg, "wheel") == 0) {
+                    config.edf_impl = EDFQueue::Implementation::kTimingWheel;
+                } else {
+                    config.edf_impl = EDFQueue::Implementation::kLocked;
+                }
+                break;
             case 'c':
                 config.capacity_factor = std::stod(optarg);
                 break;
             case 'o':
                 config.metrics_output_dir = optarg;
                 break;
+            case 'M':
+                config.metrics_interval_ms = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'q':
+                config.max_queue_size = std::stoul(optarg);
+                break;
+            case 'S':
+                config.idle_spin_ns = us_to_ns(std::stoul(optarg));
+                break;
+            case 'l':
+                config.lb_address = optarg;
+                break;
+            case 'u':
+                config.state_push_interval_ns = us_to_ns(std::stoul(optarg));
+                break;
+            case 'd':
+                config.state_push_queue_delta = static_cast<uint32_t>(std::stoul(optarg));
+                break;
+            case 'X':
+                if (!parse_transport_type(optarg, &config.transport)) {
+                    fprintf(stderr, "Unknown transport: %s\n", optarg);
+                    return 1;
+                }
+                break;
             case 'h':
             default:
                 print_usage(argv[0]);
@@ -147,11 +195,19 @@ int main(int argc, char* argv[]) {
     printf("Worker ID:       %u\n", config.worker_id);
     printf("Mode:            %s\n", mode.c_str());
     printf("Port:            %u\n", config.port);
+    printf("Transport:       %s\n", transport_type_name(config.transport));
     printf("Threads:         %zu\n", config.num_rpc_threads);
     printf("Scheduler:       %s\n", 
            config.scheduler == LocalSchedulerType::kEDF ? "EDF" : "FCFS");
     printf("Capacity Factor: %.2f\n", config.capacity_factor);
     printf("Artificial Delay: %lu us\n", config.artificial_delay_ns / 1000);
+    printf("Queue Size:      %zu\n", config.max_queue_size);
+    printf("Idle Spin:       %lu us\n", config.idle_spin_ns / 1000);
+    printf("Clock:           %s\n", tsc_clock::calibration().enabled ? "TSC" : "steady_clock");
+    if (!config.lb_address.empty()) {
+        printf("State Push:      %s every %lu us (delta %u)\n", config.lb_address.c_str(),
+               config.state_push_interval_ns / 1000, config.state_push_queue_delta);
+    }
     printf("========================================\n");
     
     // 注册信号处理
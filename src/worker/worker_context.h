@@ -3,7 +3,7 @@
 /**
  * Worker 上下文
  * 
- * 管理 Worker 节点的 eRPC 服务和任务队列
+ * 管理 Worker 节点的 RPC 服务 (经传输层) 和任务队列
  */
 
 #include <string>
@@ -12,18 +12,18 @@
 #include <vector>
 #include <memory>
 #include <functional>
-#include <queue>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 
 #include "../common/types.h"
 #include "../common/metrics.h"
 #include "../common/rpc_types.h"
+#include "../common/workload.h"
 #include "../scheduler/edf_queue.h"
 #include "../scheduler/fcfs_queue.h"
-
-// eRPC 头文件
-#include "rpc.h"
+#include "../scheduler/slack_histogram.h"
+#include "../transport/transport.h"
 
 namespace malcolm {
 
@@ -34,12 +34,20 @@ struct WorkerConfig {
     std::string server_uri;           // 绑定地址 (如 "10.10.1.4:31850")
     uint16_t port = constants::kDefaultPort;
     uint8_t phy_port = 1;             // RDMA 物理端口 (10.10.1.x network)
+    TransportType transport = kDefaultTransport;
     
     uint8_t worker_id = 0;            // Worker ID
-    size_t num_rpc_threads = 8;       // eRPC 服务线程数
-    size_t max_queue_size = 10000;    // 最大队列长度
+    size_t num_rpc_threads = 8;       // 计算线程数
+    size_t max_queue_size = 10000;    // 最大队列长度 (任务队列满时直接回复失败)
+    Timestamp idle_spin_ns = 50000;   // 计算线程空闲时休眠前的自旋时长 (0 = 立即休眠)
+    
+    LocalSchedulerType scheduler = LocalSchedulerType::kFCFS;  // 计算线程取任务的顺序
+    EDFQueue::Implementation edf_impl = EDFQueue::Implementation::kLocked;  // EDF 模式的队列实现
     
-    LocalSchedulerType scheduler = LocalSchedulerType::kFCFS;
+    // 状态推送 (Worker -> LB)，lb_address 为空时不推送
+    std::string lb_address;                         // LB 地址 (ip:port)
+    Timestamp state_push_interval_ns = us_to_ns(100);  // 周期推送间隔
+    uint32_t state_push_queue_delta = 8;            // 队列长度变化达到该值时立即推送 (0 = 只按周期)
     
     // 异构模拟参数
     double capacity_factor = 1.0;     // 处理能力因子 (< 1 表示 Slow Node)
@@ -47,6 +55,7 @@ struct WorkerConfig {
     
     // 指标导出路径
     std::string metrics_output_dir;
+    uint32_t metrics_interval_ms = 1000;  // 区间直方图时间序列周期 (0 = 只导出累计直方图)
 };
 
 /**
@@ -67,35 +76,13 @@ public:
      * @return 实际花费时间 (纳秒)
      */
     Timestamp process(RequestType type, uint32_t expected_us) {
-        // 根据容量因子调整实际服务时间
-        // Slow Node (capacity_factor < 1) 服务时间更长
-        uint64_t adjusted_us = static_cast<uint64_t>(
-            expected_us / capacity_factor_
-        );
-        
-        // 根据请求类型添加额外开销
-        switch (type) {
-            case RequestType::kGetRequest:
-                // 轻量级读取
-                break;
-            case RequestType::kPutRequest:
-                // 中等写入
-                adjusted_us = static_cast<uint64_t>(adjusted_us * 1.2);
-                break;
-            case RequestType::kScanRequest:
-                // 重量级扫描
-                adjusted_us = static_cast<uint64_t>(adjusted_us * 2.0);
-                break;
-            case RequestType::kCompute:
-                // 计算密集型
-                adjusted_us = static_cast<uint64_t>(adjusted_us * 1.5);
-                break;
-        }
+        // 服务时间模型见 modeled_service_time_ns() (离散事件模拟器使用同一模型)
+        Timestamp service_ns = modeled_service_time_ns(type, expected_us, capacity_factor_);
         
         Timestamp start = now_ns();
         
         // 忙等待模拟 (避免上下文切换抖动)
-        Timestamp target = start + us_to_ns(adjusted_us);
+        Timestamp target = start + service_ns;
         while (now_ns() < target) {
             // CPU 忙等待
             // 可以考虑加入一些实际计算来模拟真实负载
@@ -110,47 +97,98 @@ private:
 };
 
 /**
- * 线程安全的任务队列 (用于 I/O 线程 → 计算线程)
+ * 有界无锁任务队列 (用于 I/O 线程 ↔ 计算线程)
+ * 
+ * 基于 MPMCQueue，消费者空闲时先自旋后休眠:
+ * - 取不到任务时先忙等 spin_ns (pause)，期间到达的任务没有唤醒延迟
+ * - 仍无任务则登记为休眠者，在条件变量上等待 (最长 kParkTimeout，以便观察停止标志)
+ * - 生产者只在有休眠者时才加锁 notify，热路径上无锁
  */
-class ThreadSafeTaskQueue {
+class TaskQueue {
 public:
-    void push(Task task) {
-        {
+    static constexpr auto kParkTimeout = std::chrono::milliseconds(1);
+    
+    /**
+     * @param capacity 队列容量 (向上取整到 2 的幂)
+     * @param spin_ns 休眠前的自旋时长 (0 = 立即休眠)
+     */
+    explicit TaskQueue(size_t capacity, Timestamp spin_ns = 0)
+        : queue_(capacity), spin_ns_(spin_ns) {}
+    
+    /// 入队 (非阻塞)，队列满时返回 false 且 task 保持不变
+    bool push(Task&& task) {
+        if (!queue_.try_push(std::move(task))) {
+            return false;
+        }
+        // 与 pop_wait() 登记休眠者后的再次检查配对: 两者至少一方能看到对方
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0) {
             std::lock_guard<std::mutex> lock(mutex_);
-            queue_.push(std::move(task));
+            cv_.notify_one();
         }
-        cv_.notify_one();
+        return true;
     }
     
     bool try_pop(Task& task) {
+        return queue_.try_pop(task);
+    }
+    
+    /**
+     * 取一个任务，队列空时按自旋-休眠策略等待
+     * 
+     * @return false 表示休眠超时或被 wake_all() 唤醒后仍无任务
+     */
+    bool pop_wait(Task& task) {
+        if (queue_.try_pop(task)) return true;
+        
+        if (spin_ns_ > 0) {
+            Timestamp spin_end = now_ns() + spin_ns_;
+            do {
+                for (int i = 0; i < 64; ++i) {
+                    if (queue_.try_pop(task)) return true;
+                    asm volatile("pause" ::: "memory");
+                }
+            } while (now_ns() < spin_end);
+        }
+        
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool got = queue_.try_pop(task);
+        if (!got) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait_for(lock, kParkTimeout, [this] { return !queue_.empty(); });
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        return got || queue_.try_pop(task);
+    }
+    
+    /// 唤醒所有休眠的消费者 (停止时使用)
+    void wake_all() {
         std::lock_guard<std::mutex> lock(mutex_);
-        if (queue_.empty()) return false;
-        task = std::move(queue_.front());
-        queue_.pop();
-        return true;
+        cv_.notify_all();
     }
     
     size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return queue_.size();
+        return queue_.size_approx();
     }
     
-    void wait_for_task() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait(lock, [this] { return !queue_.empty(); });
+    size_t capacity() const {
+        return queue_.capacity();
     }
     
 private:
-    mutable std::mutex mutex_;
+    MPMCQueue<Task> queue_;
+    Timestamp spin_ns_;
+    std::atomic<uint32_t> sleepers_{0};
+    std::mutex mutex_;
     std::condition_variable cv_;
-    std::queue<Task> queue_;
 };
 
 /**
  * Worker 运行时上下文
  * 
  * 架构：
- * - I/O 执行线程：处理 eRPC 事件循环、接收请求、发送响应 (主线程)
+ * - I/O 执行线程：处理传输层事件循环、接收请求、发送响应 (主线程)
  * - 计算执行线程：从任务队列取任务、执行计算、更新指标 (工作线程)
  */
 class WorkerContext {
@@ -178,7 +216,7 @@ public:
     void export_metrics();
     
 private:
-    /// I/O 线程主循环 (处理 eRPC 事件循环和请求入队)
+    /// I/O 线程主循环 (处理传输层事件循环和请求入队)
     void io_thread_main();
     
     /// 计算线程主循环 (处理任务队列中的任务)
@@ -187,9 +225,25 @@ private:
     /// 从任务队列取任务并处理 (计算线程执行)
     void process_tasks();
     
-    /// 处理完成队列，发送响应 (I/O 线程执行，唯一调用 eRPC 的地方)
+    /// 按本地调度策略取下一个任务 (计算线程执行)
+    bool next_task(Task& task);
+    
+    /// 事件循环退出后回收计算线程和传输资源，导出指标 (I/O 线程执行)
+    void shutdown();
+    
+    /// 处理完成队列，发送响应 (I/O 线程执行，唯一调用传输层的地方)
     void process_completions();
     
+    /// 任务队列满时直接向 LB 回复失败 (I/O 线程执行)
+    void reject_request(ReqHandle* req_handle, const RpcWorkerRequest* request,
+                        Timestamp recv_time);
+    
+    /// 填充响应中捎带的状态摘要 (队列长度、在途请求数、量化后的松弛时间直方图)
+    void fill_state_digest(RpcWorkerResponse& response) const;
+    
+    /// 到达推送周期或队列长度变化超过阈值时向 LB 推送状态 (I/O 线程执行)
+    void maybe_push_state();
+    
 private:
     WorkerConfig config_;
     
@@ -197,31 +251,56 @@ private:
     std::vector<std::thread> compute_threads_;
     std::unique_ptr<std::thread> io_thread_;
     
-    // 线程安全的任务队列 (I/O 线程 → 计算线程)
-    ThreadSafeTaskQueue task_queue_;
+    // 无锁任务队列 (I/O 线程 → 计算线程)
+    TaskQueue task_queue_;
+    
+    // task_queue_ 中任务的松弛时间直方图 (I/O 线程入队时计入，计算线程取出时扣减)
+    SlackHistogram queue_slack_hist_;
     
-    // 线程安全的完成队列 (计算线程 → I/O 线程)
-    // 计算线程 push 完成的任务，I/O 线程 pop 并调用 eRPC enqueue_response()
-    ThreadSafeTaskQueue completion_queue_;
+    // 无锁完成队列 (计算线程 → I/O 线程)
+    // 计算线程 push 完成的任务，I/O 线程在事件循环中轮询 pop 并调用 enqueue_response()
+    TaskQueue completion_queue_;
     
-    // 任务调度队列 (已弃用，但保留接口兼容)
+    // EDF 模式下计算线程共享的截止时间堆 (FCFS 模式为空，直接按 task_queue_ 顺序执行)
+    // 计算线程每次取任务前把 task_queue_ 中新到的任务全部移入堆，再取 deadline 最早者
     std::unique_ptr<EDFQueue> edf_queue_;
-    std::unique_ptr<FCFSQueue> fcfs_queue_;
     
     // 负载模拟器
     WorkloadSimulator simulator_;
     
-    // 指标收集
-    MetricsCollector metrics_;
+    // 指标收集 (计算线程并发记录，按线程分片)
+    ConcurrentMetricsCollector metrics_;
+    std::unique_ptr<IntervalMetricsLog> interval_log_;   // 未启用时为空
+    IntervalHistogram* interval_latency_ = nullptr;
     std::atomic<uint64_t> completed_requests_{0};
     std::atomic<uint64_t> active_requests_{0};
+    std::atomic<uint64_t> rejected_requests_{0};   // 任务队列满而拒绝的请求数
     
-    // eRPC 上下文
-    erpc::Nexus* nexus_ = nullptr;
-    erpc::Rpc<erpc::CTransport>* rpc_ = nullptr;
+    // 传输上下文和端点 (端点只由 I/O 线程访问)
+    std::unique_ptr<TransportNexus> nexus_;
+    std::unique_ptr<Transport> rpc_;
+    
+    // 状态推送 (仅 I/O 线程访问，同一时刻最多一个在途推送)
+    struct StatePushState {
+        int session = -1;                 // 到 LB 的会话
+        MsgBuffer req_buf;
+        MsgBuffer resp_buf;
+        bool in_flight = false;
+        bool reject_warned = false;       // LB 拒绝推送的告警只打印一次
+        Timestamp last_push = 0;
+        uint32_t last_queue_length = 0;
+        double load_ema = 0.0;            // 每次推送时按队列长度采样
+        
+        // 控制流量统计
+        uint64_t periodic = 0;            // 按周期发出的推送
+        uint64_t triggered = 0;           // 因队列长度变化提前发出的推送
+        uint64_t bytes = 0;               // 请求 + 确认字节数
+        Timestamp start_time = 0;
+    } state_push_;
     
     // RPC 处理回调 (需要静态)
-    static void request_handler(erpc::ReqHandle* req_handle, void* context);
+    static void request_handler(ReqHandle* req_handle, void* context);
+    static void state_push_callback(void* context, void* tag);
 };
 
 }  // namespace malcolm
@@ -3,24 +3,27 @@
  * 
  * 架构改进：
  * - I/O 执行线程（主线程）：
- *   1. 运行 eRPC 事件循环 (同步处理网络 I/O)
+ *   1. 运行传输层 (eRPC / 共享内存) 事件循环 (同步处理网络 I/O)
  *   2. 在 request_handler 回调中接收请求并入队到 task_queue_
- *   3. 从 completion_queue_ 取完成任务，调用 eRPC enqueue_response()
+ *   3. 从 completion_queue_ 取完成任务，调用 enqueue_response()
  * 
  * - 计算执行线程（工作线程，数量 = num_rpc_threads）：
- *   1. 从 task_queue_ 取任务 (线程安全, 无竞争)
+ *   1. 从 task_queue_ 取任务 (无锁 MPMC，空闲时先自旋后休眠)；
+ *      EDF 模式下先把新任务移入共享的 EDF 堆，再取 deadline 最早的任务
  *   2. 执行计算模拟和延迟注入
  *   3. 更新指标 (延迟、违约)
- *   4. push 完成的任务到 completion_queue_（不调用任何 eRPC 方法）
+ *   4. push 完成的任务到 completion_queue_（不调用任何传输层方法）
  * 
  * 优点：
- * - 消除 eRPC 竞争：只有一个线程（主线程）调用 eRPC 方法
+ * - 消除传输层竞争：只有一个线程（主线程）调用传输层方法
  * - 消除 HoL 阻塞：计算不阻塞 I/O，即使计算线程阻塞在 sleep 中
  * - 线程安全：完成队列用于线程间通信
  */
 
 #include "worker_context.h"
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <thread>
 #include <sstream>
@@ -39,13 +42,24 @@ static size_t get_tid() {
 
 WorkerContext::WorkerContext(const WorkerConfig& config)
     : config_(config),
+      task_queue_(config.max_queue_size, config.idle_spin_ns),
+      // 在途任务不超过任务队列容量 + 计算线程数，完成队列不会满
+      completion_queue_(config.max_queue_size + config.num_rpc_threads),
       simulator_(config.capacity_factor) {
     
-    // 根据调度策略创建队列 (接口兼容，但新架构中不使用)
+    // 根据调度策略决定计算线程的取任务顺序
     if (config_.scheduler == LocalSchedulerType::kEDF) {
-        printf("[Worker %u] Using EDF scheduler (legacy interface)\n", config_.worker_id);
+        edf_queue_ = std::make_unique<EDFQueue>(config_.edf_impl);
+        printf("[Worker %u] Using EDF scheduler (%s)\n", config_.worker_id,
+               config_.edf_impl == EDFQueue::Implementation::kTimingWheel ? "timing wheel" : "heap");
     } else {
-        printf("[Worker %u] Using FCFS scheduler (legacy interface)\n", config_.worker_id);
+        printf("[Worker %u] Using FCFS scheduler\n", config_.worker_id);
+    }
+    
+    if (!config_.metrics_output_dir.empty() && config_.metrics_interval_ms > 0) {
+        interval_log_ = std::make_unique<IntervalMetricsLog>(
+            config_.metrics_output_dir, config_.metrics_interval_ms);
+        interval_latency_ = &interval_log_->add_series("e2e_latency");
     }
     
     printf("[Worker %u] Initialized (capacity_factor=%.2f, compute_threads=%zu)\n",
@@ -63,26 +77,50 @@ void WorkerContext::start() {
     
     g_worker_ctx = this;
     
-    printf("[Worker %u] Starting eRPC service on %s...\n",
-           config_.worker_id, config_.server_uri.c_str());
+    printf("[Worker %u] Starting %s service on %s...\n", config_.worker_id,
+           transport_type_name(config_.transport), config_.server_uri.c_str());
     
-    // 初始化 eRPC Nexus
-    std::string server_uri = config_.server_uri;
-    nexus_ = new erpc::Nexus(server_uri, 0, 0);
+    // 初始化传输上下文
+    nexus_ = create_transport_nexus(config_.transport, config_.server_uri);
+    if (!nexus_) {
+        running_.store(false);
+        g_worker_ctx = nullptr;
+        return;
+    }
     
     // 注册 RPC 处理函数
     nexus_->register_req_func(kReqLBToWorker, request_handler);
     
-    // 创建 RPC 端点 (主线程)
-    rpc_ = new erpc::Rpc<erpc::CTransport>(
-        nexus_, 
+    // 创建传输端点 (主线程)
+    rpc_ = nexus_->create_rpc(
         this,                           // context
         0,                              // rpc_id
-        nullptr,                        // sm_handler (不需要)
-        config_.phy_port                // 物理端口
+        config_.phy_port,               // 物理端口
+        "Worker " + std::to_string(config_.worker_id)
     );
     
-    printf("[Worker %u] eRPC initialized\n", config_.worker_id);
+    printf("[Worker %u] Transport initialized\n", config_.worker_id);
+    
+    // 连接 LB 的派发线程 0 用于状态推送 (不等待连接建立，连上之后才开始推送)
+    if (!config_.lb_address.empty()) {
+        state_push_.session = rpc_->create_session(config_.lb_address, 0);
+        if (state_push_.session < 0) {
+            fprintf(stderr, "[Worker %u] Failed to connect to LB at %s, state push disabled\n",
+                    config_.worker_id, config_.lb_address.c_str());
+        } else {
+            state_push_.req_buf = rpc_->alloc_msg_buffer_or_die(sizeof(RpcStateUpdate));
+            state_push_.resp_buf = rpc_->alloc_msg_buffer_or_die(sizeof(RpcStateUpdateAck));
+            state_push_.start_time = now_ns();
+            printf("[Worker %u] Pushing state to LB at %s every %.0f us (queue delta %u)\n",
+                   config_.worker_id, config_.lb_address.c_str(),
+                   ns_to_us(config_.state_push_interval_ns), config_.state_push_queue_delta);
+        }
+    }
+    
+    if (interval_log_ && !interval_log_->start()) {
+        fprintf(stderr, "[Worker %u] Interval metrics log incomplete under %s\n",
+                config_.worker_id, config_.metrics_output_dir.c_str());
+    }
     
     // 启动计算线程池
     printf("[Worker %u] Starting %zu compute threads\n", 
@@ -93,22 +131,27 @@ void WorkerContext::start() {
         );
     }
     
-    printf("[Worker %u] Running eRPC event loop in main thread...\n",
+    printf("[Worker %u] Running event loop in main thread...\n",
            config_.worker_id);
     
-    // 主线程运行 eRPC 事件循环 (I/O 执行线程)
-    // 注意：eRPC 要求 Rpc 对象在同一线程创建和使用
+    // 主线程运行传输层事件循环 (I/O 执行线程)
+    // 注意：传输端点要求在同一线程创建和使用
     while (running_.load()) {
-        // 运行一次 eRPC 事件循环 - 处理入站请求
+        // 运行一次事件循环 - 处理入站请求
         // 这会调用 request_handler 回调，将请求入队到 task_queue_
         rpc_->run_event_loop_once();
         
         // 处理完成队列（由计算线程填充）
-        // 这部分也必须在 I/O 线程执行，因为会调用 eRPC 方法
+        // 这部分也必须在 I/O 线程执行，因为会调用传输层方法
         process_completions();
+        
+        maybe_push_state();
+        tsc_clock::maybe_reanchor();
     }
     
     printf("[Worker %u] RPC event loop stopped\n", config_.worker_id);
+    
+    shutdown();
 }
 
 void WorkerContext::stop() {
@@ -116,7 +159,15 @@ void WorkerContext::stop() {
         return;  // 已经停止
     }
     
+    // 只翻转标志位并唤醒计算线程: 信号处理函数可能打断正在执行的事件循环，
+    // 传输端点由 start() 退出事件循环后在 shutdown() 中销毁
     printf("[Worker %u] Stopping...\n", config_.worker_id);
+    task_queue_.wake_all();
+}
+
+void WorkerContext::shutdown() {
+    // 唤醒休眠的计算线程，使其立即观察到停止标志
+    task_queue_.wake_all();
     
     // 等待所有计算线程结束
     for (auto& t : compute_threads_) {
@@ -126,15 +177,34 @@ void WorkerContext::stop() {
     }
     compute_threads_.clear();
     
-    // 清理 eRPC
-    if (rpc_) {
-        delete rpc_;
-        rpc_ = nullptr;
+    if (interval_log_) {
+        interval_log_->stop();
     }
-    if (nexus_) {
-        delete nexus_;
-        nexus_ = nullptr;
+    
+    printf("[Worker %u] Completed %lu requests, rejected %lu (task queue full)\n",
+           config_.worker_id, completed_requests_.load(std::memory_order_relaxed),
+           rejected_requests_.load(std::memory_order_relaxed));
+    
+    // 控制流量统计
+    if (state_push_.session >= 0) {
+        uint64_t pushes = state_push_.periodic + state_push_.triggered;
+        double secs = static_cast<double>(now_ns() - state_push_.start_time) / 1e9;
+        printf("[Worker %u] State push: %lu updates (%lu periodic, %lu triggered), "
+               "%lu bytes, %.1f B/s\n",
+               config_.worker_id, pushes, state_push_.periodic, state_push_.triggered,
+               state_push_.bytes, secs > 0 ? state_push_.bytes / secs : 0.0);
+    }
+    
+    // 清理传输资源
+    if (rpc_) {
+        if (state_push_.session >= 0) {
+            rpc_->free_msg_buffer(state_push_.req_buf);
+            rpc_->free_msg_buffer(state_push_.resp_buf);
+            state_push_.session = -1;
+        }
+        rpc_.reset();
     }
+    nexus_.reset();
     
     // 导出最终指标
     if (!config_.metrics_output_dir.empty()) {
@@ -153,7 +223,7 @@ void WorkerContext::wait() {
 }
 
 // 静态 RPC 请求处理回调 (I/O 线程调用)
-void WorkerContext::request_handler(erpc::ReqHandle* req_handle, void* context) {
+void WorkerContext::request_handler(ReqHandle* req_handle, void* context) {
     auto* worker = static_cast<WorkerContext*>(context);
     if (!worker) {
         worker = g_worker_ctx;  // fallback to global
@@ -163,7 +233,7 @@ void WorkerContext::request_handler(erpc::ReqHandle* req_handle, void* context)
     Timestamp recv_time = now_ns();
     
     // 获取请求数据
-    const erpc::MsgBuffer* req_msgbuf = req_handle->get_req_msgbuf();
+    const MsgBuffer* req_msgbuf = req_handle->get_req_msgbuf();
     auto* request = reinterpret_cast<const RpcWorkerRequest*>(req_msgbuf->buf_);
     
     // [DEBUG LOG with TID] 只印前5个避免刷屏
@@ -183,20 +253,138 @@ void WorkerContext::request_handler(erpc::ReqHandle* req_handle, void* context)
     task.client_send_time = request->client_send_time;
     task.service_time_hint = request->service_time_hint;
     
-    // 入队到线程安全队列 (发送给计算线程处理)
-    worker->task_queue_.push(std::move(task));
+    // 入队到无锁任务队列 (发送给计算线程处理)，队列满时立即回复失败
+    // EDF 模式下任务会被移入堆，环形队列本身不会满，因此按在途任务数限制
+    size_t in_flight_limit = worker->config_.max_queue_size + worker->config_.num_rpc_threads;
+    if (worker->active_requests_.load(std::memory_order_relaxed) >= in_flight_limit) {
+        worker->reject_request(req_handle, request, recv_time);
+        return;
+    }
+    // 先计入直方图再入队，保证计算线程出队时扣减的纪元已存在
+    uint64_t slack_epoch = worker->queue_slack_hist_.add(task.deadline, recv_time);
+    task.slack_epoch = slack_epoch;
+    if (!worker->task_queue_.push(std::move(task))) {
+        worker->queue_slack_hist_.remove(slack_epoch, recv_time);
+        worker->reject_request(req_handle, request, recv_time);
+        return;
+    }
     
     worker->active_requests_.fetch_add(1, std::memory_order_relaxed);
 }
 
+void WorkerContext::reject_request(ReqHandle* req_handle,
+                                   const RpcWorkerRequest* request,
+                                   Timestamp recv_time) {
+    if (rejected_requests_.fetch_add(1, std::memory_order_relaxed) == 0) {
+        fprintf(stderr, "[Worker %u] Task queue full (%zu tasks), rejecting requests\n",
+                config_.worker_id, task_queue_.capacity());
+    }
+    
+    MsgBuffer& resp_msgbuf = req_handle->pre_resp_msgbuf_;
+    rpc_->resize_msg_buffer(&resp_msgbuf, sizeof(RpcWorkerResponse));
+    
+    auto* response = reinterpret_cast<RpcWorkerResponse*>(resp_msgbuf.buf_);
+    response->request_id = request->request_id;
+    response->worker_recv_time = recv_time;
+    response->worker_done_time = now_ns();
+    response->queue_time_ns = 0;
+    response->service_time_us = 0;
+    response->worker_id = config_.worker_id;
+    response->success = 0;
+    fill_state_digest(*response);
+    
+    rpc_->enqueue_response(req_handle, &resp_msgbuf);
+}
+
+void WorkerContext::maybe_push_state() {
+    StatePushState& sp = state_push_;
+    if (sp.session < 0 || sp.in_flight) {
+        return;
+    }
+    
+    Timestamp now = now_ns();
+    uint32_t queue_len = static_cast<uint32_t>(queue_length());
+    uint32_t delta = queue_len > sp.last_queue_length ? queue_len - sp.last_queue_length
+                                                      : sp.last_queue_length - queue_len;
+    bool periodic = now - sp.last_push >= config_.state_push_interval_ns;
+    bool triggered = config_.state_push_queue_delta > 0 && delta >= config_.state_push_queue_delta;
+    if (!periodic && !triggered) {
+        return;
+    }
+    if (!rpc_->is_connected(sp.session)) {
+        return;
+    }
+    
+    sp.load_ema = 0.1 * queue_len + 0.9 * sp.load_ema;
+    
+    auto* update = reinterpret_cast<RpcStateUpdate*>(sp.req_buf.buf_);
+    update->queue_length = static_cast<uint16_t>(std::min<uint32_t>(queue_len, UINT16_MAX));
+    update->active_requests = static_cast<uint16_t>(
+        std::min<uint64_t>(active_requests_.load(std::memory_order_relaxed), UINT16_MAX));
+    update->completed_requests = static_cast<uint32_t>(
+        completed_requests_.load(std::memory_order_relaxed));
+    update->load_ema = static_cast<float>(sp.load_ema);
+    update->worker_id = config_.worker_id;
+    update->is_healthy = 1;
+    
+    std::array<uint32_t, constants::kSlackHistogramBins> hist;
+    get_slack_histogram(hist);
+    std::memcpy(update->slack_histogram, hist.data(), sizeof(update->slack_histogram));
+    
+    rpc_->enqueue_request(sp.session, kReqStateUpdate, &sp.req_buf, &sp.resp_buf,
+                          state_push_callback, nullptr);
+    
+    sp.in_flight = true;
+    sp.last_push = now;
+    sp.last_queue_length = queue_len;
+    ++(periodic ? sp.periodic : sp.triggered);
+    sp.bytes += sizeof(RpcStateUpdate) + sizeof(RpcStateUpdateAck);
+}
+
+// 状态推送确认回调 (I/O 线程调用)
+void WorkerContext::state_push_callback(void* context, void* tag) {
+    (void)tag;
+    auto* worker = static_cast<WorkerContext*>(context);
+    if (!worker) return;
+    
+    StatePushState& sp = worker->state_push_;
+    sp.in_flight = false;
+    
+    auto* ack = reinterpret_cast<const RpcStateUpdateAck*>(sp.resp_buf.buf_);
+    if (!ack->accepted && !sp.reject_warned) {
+        sp.reject_warned = true;
+        fprintf(stderr, "[Worker %u] LB rejected state update (unknown worker id?)\n",
+                worker->config_.worker_id);
+    }
+}
+
+void WorkerContext::fill_state_digest(RpcWorkerResponse& response) const {
+    response.queue_length = static_cast<uint16_t>(std::min<size_t>(queue_length(), UINT16_MAX));
+    response.active_requests = static_cast<uint16_t>(
+        std::min<uint64_t>(active_requests_.load(std::memory_order_relaxed), UINT16_MAX));
+    
+    std::array<uint32_t, constants::kSlackHistogramBins> hist;
+    get_slack_histogram(hist);
+    for (size_t b = 0; b < hist.size(); ++b) {
+        response.slack_digest[b] = encode_slack_count(hist[b]);
+    }
+}
+
 size_t WorkerContext::queue_length() const {
-    return task_queue_.size();
+    return task_queue_.size() + (edf_queue_ ? edf_queue_->size() : 0);
 }
 
 void WorkerContext::get_slack_histogram(
     std::array<uint32_t, constants::kSlackHistogramBins>& hist) const {
-    // 新架构中不使用 EDF 队列的 slack 直方图
-    hist.fill(0);
+    // 与 queue_length() 口径一致: 环形队列 + EDF 堆中的任务
+    queue_slack_hist_.snapshot(now_ns(), hist);
+    if (edf_queue_) {
+        std::array<uint32_t, constants::kSlackHistogramBins> edf_hist;
+        edf_queue_->get_slack_histogram(edf_hist);
+        for (size_t b = 0; b < hist.size(); ++b) {
+            hist[b] += edf_hist[b];
+        }
+    }
 }
 
 void WorkerContext::export_metrics() {
@@ -204,7 +392,19 @@ void WorkerContext::export_metrics() {
         return;
     }
     
-    metrics_.export_all(config_.metrics_output_dir);
+    bool success = metrics_.export_all(config_.metrics_output_dir);
+    
+    // 拒绝的请求不进入延迟直方图，单独追加到摘要
+    std::ofstream summary(config_.metrics_output_dir + "/summary.txt", std::ios::app);
+    success &= static_cast<bool>(summary);
+    if (summary) {
+        summary << "Rejected Requests: " << rejected_requests_.load(std::memory_order_relaxed) << "\n";
+    }
+    if (!success) {
+        fprintf(stderr, "[Worker %u] Failed to export metrics to %s\n",
+                config_.worker_id, config_.metrics_output_dir.c_str());
+        return;
+    }
     printf("[Worker %u] Metrics exported to %s\n",
            config_.worker_id, config_.metrics_output_dir.c_str());
 }
@@ -221,13 +421,41 @@ void WorkerContext::compute_thread_main(size_t thread_id) {
            config_.worker_id, get_tid(), thread_id);
 }
 
+bool WorkerContext::next_task(Task& task) {
+    // FCFS: 直接按到达顺序，空闲时先自旋 idle_spin_ns 再休眠 (由入队唤醒)
+    if (!edf_queue_) {
+        if (!task_queue_.pop_wait(task)) {
+            return false;
+        }
+        queue_slack_hist_.remove(task.slack_epoch, now_ns());
+        return true;
+    }
+    
+    // EDF: 先把 I/O 线程新送来的任务全部移入堆，使堆包含所有已到达的任务
+    // (任务从环形队列的直方图转入堆自带的直方图)
+    Task incoming;
+    while (task_queue_.try_pop(incoming)) {
+        queue_slack_hist_.remove(incoming.slack_epoch, now_ns());
+        edf_queue_->push(std::move(incoming));
+    }
+    if (edf_queue_->try_pop(task)) {
+        return true;
+    }
+    
+    // 堆和环形队列都空: 按同样的空闲策略等待新任务，到达后仍经堆取出
+    // (等待期间其他线程可能移入了 deadline 更早的任务)
+    if (!task_queue_.pop_wait(incoming)) {
+        return false;
+    }
+    queue_slack_hist_.remove(incoming.slack_epoch, now_ns());
+    edf_queue_->push(std::move(incoming));
+    return edf_queue_->try_pop(task);
+}
+
 void WorkerContext::process_tasks() {
     Task task;
     
-    // 从线程安全队列取任务 (无忙轮询)
-    if (!task_queue_.try_pop(task)) {
-        // 无任务，短暂等待
-        std::this_thread::sleep_for(std::chrono::microseconds(1));
+    if (!next_task(task)) {
         return;
     }
     
@@ -262,6 +490,9 @@ void WorkerContext::process_tasks() {
     // 记录指标
     Timestamp e2e_latency = done_time - task.arrival_time;
     metrics_.record_latency(static_cast<int64_t>(e2e_latency));
+    if (interval_latency_) {
+        interval_latency_->record(static_cast<int64_t>(e2e_latency));
+    }
     if (!deadline_met) {
         metrics_.record_deadline_miss();
     }
@@ -273,13 +504,15 @@ void WorkerContext::process_tasks() {
     }
     
     // 保存完成信息到任务，然后 push 到完成队列（I/O 线程会处理）
-    // 不在这里调用任何 eRPC 方法！eRPC 只能在 I/O 线程中调用
+    // 不在这里调用任何传输层方法！传输端点只能在 I/O 线程中使用
     task.worker_done_time = done_time;
     task.actual_service_time_us = actual_time;
     task.queue_time_ns = queue_time;
     
-    // Push 到完成队列，I/O 线程会取出并调用 eRPC enqueue_response()
-    completion_queue_.push(std::move(task));
+    // Push 到完成队列，I/O 线程会取出并调用 enqueue_response()
+    while (!completion_queue_.push(std::move(task))) {
+        asm volatile("pause" ::: "memory");
+    }
     
     active_requests_.fetch_sub(1, std::memory_order_relaxed);
     completed_requests_.fetch_add(1, std::memory_order_relaxed);
@@ -288,10 +521,14 @@ void WorkerContext::process_tasks() {
 }
 
 void WorkerContext::process_completions() {
-    // 这个方法在 I/O 线程中执行，安全地调用 eRPC 方法
+    // 这个方法在 I/O 线程中执行，安全地调用传输层方法
     Task task;
     int batch_size = 32;  // 每次最多处理 32 个完成的任务
     
+    // 状态摘要每批只采样一次，同批响应共用
+    RpcWorkerResponse digest;
+    bool digest_ready = false;
+    
     while (batch_size-- > 0 && completion_queue_.try_pop(task)) {
         // [DEBUG LOG with TID] 只印前5个避免刷屏
         if (task.request_id < 5) {
@@ -299,12 +536,12 @@ void WorkerContext::process_completions() {
                    config_.worker_id, get_tid(), task.request_id);
         }
         
-        // 现在安全地调用 eRPC 方法（仅在 I/O 线程）
+        // 现在安全地调用传输层方法（仅在 I/O 线程）
         if (task.request_handle && rpc_) {
-            auto* req_handle = static_cast<erpc::ReqHandle*>(task.request_handle);
+            auto* req_handle = static_cast<ReqHandle*>(task.request_handle);
             
             // 分配响应缓冲区
-            erpc::MsgBuffer& resp_msgbuf = req_handle->pre_resp_msgbuf_;
+            MsgBuffer& resp_msgbuf = req_handle->pre_resp_msgbuf_;
             rpc_->resize_msg_buffer(&resp_msgbuf, sizeof(RpcWorkerResponse));
             
             // 填充响应
@@ -314,10 +551,17 @@ void WorkerContext::process_completions() {
             response->worker_done_time = task.worker_done_time;
             response->queue_time_ns = task.queue_time_ns;
             response->service_time_us = static_cast<uint32_t>(ns_to_us(task.actual_service_time_us));
-            response->queue_length = static_cast<uint16_t>(queue_length());
             response->worker_id = config_.worker_id;
             response->success = 1;
             
+            if (!digest_ready) {
+                fill_state_digest(digest);
+                digest_ready = true;
+            }
+            response->queue_length = digest.queue_length;
+            response->active_requests = digest.active_requests;
+            std::memcpy(response->slack_digest, digest.slack_digest, sizeof(digest.slack_digest));
+            
             // 发送响应
             rpc_->enqueue_response(req_handle, &resp_msgbuf);
         }
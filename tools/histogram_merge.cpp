@@ -0,0 +1,151 @@
+/**
+ * 直方图合并工具
+ *
+ * 无损合并任意多个 HdrHistogram 日志文件 (各进程导出的 .hdr 以及区间日志 .hlog)，
+ * 输出合并后的百分位、CDF CSV 和合并后的 .hdr (可再次作为输入)。
+ * 直方图按桶计数直接相加，多客户端合并后的 P99.99 与单个进程内记录的口径完全一致。
+ *
+ * 用法:
+ *   ./histogram_merge --output=results/exp_a/combined_latency \
+ *                     results/exp_a/client_0/e2e_latency.hdr results/exp_a/client_1/e2e_latency.hdr
+ *   ./histogram_merge --start_sec=30 --output=results/exp_a/combined_latency \
+ *                     results/exp_a/client_0/e2e_latency.hlog ...   # 跳过 30s 预热
+ *
+ * 输出: <output>.hdr, <output>_cdf.csv, <output>_summary.txt
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+
+#include "common/metrics.h"
+
+using namespace malcolm;
+
+static void print_usage(const char* prog) {
+    printf("Usage: %s [options] FILE...\n", prog);
+    printf("Merge HdrHistogram log files (.hdr / .hlog) exactly.\n");
+    printf("Options:\n");
+    printf("  --output=PREFIX   Write PREFIX.hdr, PREFIX_cdf.csv, PREFIX_summary.txt\n");
+    printf("  --start_sec=S     Skip intervals starting before S seconds (default: 0)\n");
+    printf("  --unit=U          Unit for printed percentiles: ns, us, ms (default: us)\n");
+    printf("  --cdf_points=N    Number of CDF points (default: 10000)\n");
+    printf("  --help            Show this help\n");
+}
+
+int main(int argc, char* argv[]) {
+    std::string output;
+    double start_sec = 0.0;
+    std::string unit = "us";
+    int cdf_points = 10000;
+    
+    static struct option long_options[] = {
+        {"output",     required_argument, 0, 'o'},
+        {"start_sec",  required_argument, 0, 's'},
+        {"unit",       required_argument, 0, 'u'},
+        {"cdf_points", required_argument, 0, 'n'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:s:u:n:h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 's':
+                start_sec = std::stod(optarg);
+                break;
+            case 'u':
+                unit = optarg;
+                break;
+            case 'n':
+                cdf_points = std::max(1, std::stoi(optarg));
+                break;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    
+    double divisor = 1.0;
+    if (unit == "us") {
+        divisor = 1e3;
+    } else if (unit == "ms") {
+        divisor = 1e6;
+    } else if (unit != "ns") {
+        fprintf(stderr, "Unknown unit: %s\n", unit.c_str());
+        return 1;
+    }
+    
+    if (optind >= argc) {
+        fprintf(stderr, "Error: No input files\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    LatencyHistogram merged;
+    size_t num_files = 0;
+    for (int i = optind; i < argc; ++i) {
+        LatencyHistogram h;
+        size_t intervals = 0;
+        if (!h.merge_from_file(argv[i], start_sec, &intervals)) {
+            fprintf(stderr, "  %s: not a readable HdrHistogram log, skipped\n", argv[i]);
+            continue;
+        }
+        printf("  %s: %zu interval(s), %ld samples, P50=%.2f%s P99.99=%.2f%s\n",
+               argv[i], intervals, h.total_count(),
+               h.percentile(50.0) / divisor, unit.c_str(),
+               h.percentile(99.99) / divisor, unit.c_str());
+        merged.merge_from(h);
+        ++num_files;
+    }
+    
+    if (merged.total_count() == 0) {
+        fprintf(stderr, "No samples found in %zu file(s)\n", num_files);
+        return 1;
+    }
+    
+    static const double kPercentiles[] = {50.0, 90.0, 95.0, 99.0, 99.5, 99.9, 99.99, 99.999};
+    
+    std::string summary;
+    char line[128];
+    auto append = [&](const char* fmt, auto... args) {
+        snprintf(line, sizeof(line), fmt, args...);
+        summary += line;
+    };
+    append("Files: %zu\n", num_files);
+    append("Total Samples: %ld\n", merged.total_count());
+    append("Unit: %s\n", unit.c_str());
+    append("Mean: %.4f\n", merged.mean() / divisor);
+    append("Stddev: %.4f\n", merged.stddev() / divisor);
+    append("Min: %.4f\n", merged.min() / divisor);
+    append("Max: %.4f\n", merged.max() / divisor);
+    for (double p : kPercentiles) {
+        append("P%g: %.4f\n", p, merged.percentile(p) / divisor);
+    }
+    
+    printf("\n=== Merged Latency (%s) ===\n%s", unit.c_str(), summary.c_str());
+    
+    if (!output.empty()) {
+        bool ok = merged.export_hdr(output + ".hdr");
+        ok &= merged.export_cdf(output + "_cdf.csv", cdf_points);
+        std::ofstream out(output + "_summary.txt");
+        out << summary;
+        ok &= static_cast<bool>(out);
+        if (!ok) {
+            fprintf(stderr, "Failed to write outputs with prefix %s\n", output.c_str());
+            return 1;
+        }
+        printf("\nWrote %s.hdr, %s_cdf.csv, %s_summary.txt\n",
+               output.c_str(), output.c_str(), output.c_str());
+    }
+    
+    return 0;
+}